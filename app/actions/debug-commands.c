@@ -27,6 +27,8 @@
 #include "actions-types.h"
 
 #include "core/gimp.h"
+#include "core/gimp-memory-manager.h"
+#include "core/gimp-memory-pool.h"
 #include "core/gimp-utils.h"
 #include "core/gimpcontext.h"
 #include "core/gimpimage.h"
@@ -78,6 +80,12 @@ debug_mem_profile_cmd_callback (GtkAction *action,
 {
   extern gboolean  gimp_debug_memsize;
   Gimp            *gimp;
+  guint64          hits;
+  guint64          misses;
+  gsize            retained;
+  gint             n_caches;
+  gint64           cache_size;
+  guint64          n_evictions;
   return_if_no_gimp (gimp, data);
 
   gimp_debug_memsize = TRUE;
@@ -85,6 +93,20 @@ debug_mem_profile_cmd_callback (GtkAction *action,
   gimp_object_get_memsize (GIMP_OBJECT (gimp), NULL);
 
   gimp_debug_memsize = FALSE;
+
+  gimp_memory_pool_get_stats (&hits, &misses, &retained);
+
+  g_print ("memory pool: %" G_GUINT64_FORMAT " hits, "
+           "%" G_GUINT64_FORMAT " misses, "
+           "%" G_GSIZE_FORMAT " bytes retained\n",
+           hits, misses, retained);
+
+  gimp_memory_manager_get_stats (&n_caches, &cache_size, &n_evictions);
+
+  g_print ("memory manager: %d caches, "
+           "%" G_GINT64_FORMAT " bytes cached, "
+           "%" G_GUINT64_FORMAT " evictions\n",
+           n_caches, cache_size, n_evictions);
 }
 
 void
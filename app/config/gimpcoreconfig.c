@@ -96,7 +96,9 @@ enum
   PROP_DEFAULT_GRID,
   PROP_UNDO_LEVELS,
   PROP_UNDO_SIZE,
+  PROP_UNDO_SWAP_SIZE,
   PROP_UNDO_PREVIEW_SIZE,
+  PROP_UNDO_COMPRESSION,
   PROP_FILTER_HISTORY_SIZE,
   PROP_PLUGINRC_PATH,
   PROP_LAYER_PREVIEWS,
@@ -543,6 +545,13 @@ gimp_core_config_class_init (GimpCoreConfigClass *klass)
                             GIMP_PARAM_STATIC_STRINGS |
                             GIMP_CONFIG_PARAM_CONFIRM);
 
+  GIMP_CONFIG_PROP_MEMSIZE (object_class, PROP_UNDO_SWAP_SIZE,
+                            "undo-swap-size",
+                            "Undo swap size",
+                            UNDO_SWAP_SIZE_BLURB,
+                            0, GIMP_MAX_MEMSIZE, 0,
+                            GIMP_PARAM_STATIC_STRINGS);
+
   GIMP_CONFIG_PROP_ENUM (object_class, PROP_UNDO_PREVIEW_SIZE,
                          "undo-preview-size",
                          "Undo preview size",
@@ -552,6 +561,14 @@ gimp_core_config_class_init (GimpCoreConfigClass *klass)
                          GIMP_PARAM_STATIC_STRINGS |
                          GIMP_CONFIG_PARAM_RESTART);
 
+  GIMP_CONFIG_PROP_ENUM (object_class, PROP_UNDO_COMPRESSION,
+                         "undo-compression",
+                         "Undo compression",
+                         UNDO_COMPRESSION_BLURB,
+                         GIMP_TYPE_UNDO_COMPRESSION,
+                         GIMP_UNDO_COMPRESSION_NONE,
+                         GIMP_PARAM_STATIC_STRINGS);
+
   GIMP_CONFIG_PROP_INT (object_class, PROP_FILTER_HISTORY_SIZE,
                         "plug-in-history-size", /* compat name */
                         "Filter history size",
@@ -907,9 +924,15 @@ gimp_core_config_set_property (GObject      *object,
     case PROP_UNDO_SIZE:
       core_config->undo_size = g_value_get_uint64 (value);
       break;
+    case PROP_UNDO_SWAP_SIZE:
+      core_config->undo_swap_size = g_value_get_uint64 (value);
+      break;
     case PROP_UNDO_PREVIEW_SIZE:
       core_config->undo_preview_size = g_value_get_enum (value);
       break;
+    case PROP_UNDO_COMPRESSION:
+      core_config->undo_compression = g_value_get_enum (value);
+      break;
     case PROP_PLUGINRC_PATH:
       g_free (core_config->plug_in_rc_path);
       core_config->plug_in_rc_path = g_value_dup_string (value);
@@ -1093,9 +1116,15 @@ gimp_core_config_get_property (GObject    *object,
     case PROP_UNDO_SIZE:
       g_value_set_uint64 (value, core_config->undo_size);
       break;
+    case PROP_UNDO_SWAP_SIZE:
+      g_value_set_uint64 (value, core_config->undo_swap_size);
+      break;
     case PROP_UNDO_PREVIEW_SIZE:
       g_value_set_enum (value, core_config->undo_preview_size);
       break;
+    case PROP_UNDO_COMPRESSION:
+      g_value_set_enum (value, core_config->undo_compression);
+      break;
     case PROP_PLUGINRC_PATH:
       g_value_set_string (value, core_config->plug_in_rc_path);
       break;
@@ -81,7 +81,9 @@ struct _GimpCoreConfig
   GimpGrid               *default_grid;
   gint                    levels_of_undo;
   guint64                 undo_size;
+  guint64                 undo_swap_size;
   GimpViewSize            undo_preview_size;
+  GimpUndoCompression     undo_compression;
   gint                    filter_history_size;
   gchar                  *plug_in_rc_path;
   gboolean                layer_previews;
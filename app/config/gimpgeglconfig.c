@@ -48,6 +48,8 @@ enum
   PROP_SWAP_PATH,
   PROP_NUM_PROCESSORS,
   PROP_TILE_CACHE_SIZE,
+  PROP_MEMORY_LIMIT,
+  PROP_PROJECTION_RELEASE_DELAY,
   PROP_USE_OPENCL,
 
   /* ignored, only for backward compatibility: */
@@ -165,6 +167,21 @@ gimp_gegl_config_class_init (GimpGeglConfigClass *klass)
                             GIMP_PARAM_STATIC_STRINGS |
                             GIMP_CONFIG_PARAM_CONFIRM);
 
+  GIMP_CONFIG_PROP_MEMSIZE (object_class, PROP_MEMORY_LIMIT,
+                            "memory-limit",
+                            "Memory limit",
+                            MEMORY_LIMIT_BLURB,
+                            0, GIMP_MAX_MEM_PROCESS,
+                            0,
+                            GIMP_PARAM_STATIC_STRINGS);
+
+  GIMP_CONFIG_PROP_INT (object_class, PROP_PROJECTION_RELEASE_DELAY,
+                        "projection-release-delay",
+                        "Projection release delay",
+                        PROJECTION_RELEASE_DELAY_BLURB,
+                        0, 24 * 60 * 60, 0,
+                        GIMP_PARAM_STATIC_STRINGS);
+
   GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_USE_OPENCL,
                             "use-opencl",
                             "Use OpenCL",
@@ -224,6 +241,12 @@ gimp_gegl_config_set_property (GObject      *object,
     case PROP_TILE_CACHE_SIZE:
       gegl_config->tile_cache_size = g_value_get_uint64 (value);
       break;
+    case PROP_MEMORY_LIMIT:
+      gegl_config->memory_limit = g_value_get_uint64 (value);
+      break;
+    case PROP_PROJECTION_RELEASE_DELAY:
+      gegl_config->projection_release_delay = g_value_get_int (value);
+      break;
     case PROP_USE_OPENCL:
       gegl_config->use_opencl = FALSE; //g_value_get_boolean (value);
       break;
@@ -260,6 +283,12 @@ gimp_gegl_config_get_property (GObject    *object,
     case PROP_TILE_CACHE_SIZE:
       g_value_set_uint64 (value, gegl_config->tile_cache_size);
       break;
+    case PROP_MEMORY_LIMIT:
+      g_value_set_uint64 (value, gegl_config->memory_limit);
+      break;
+    case PROP_PROJECTION_RELEASE_DELAY:
+      g_value_set_int (value, gegl_config->projection_release_delay);
+      break;
     case PROP_USE_OPENCL:
       g_value_set_boolean (value, FALSE /*gegl_config->use_opencl*/);
       break;
@@ -39,6 +39,8 @@ struct _GimpGeglConfig
   gchar    *swap_path;
   guint     num_processors;
   guint64   tile_cache_size;
+  guint64   memory_limit;
+  gint      projection_release_delay;
   gboolean  use_opencl;
 };
 
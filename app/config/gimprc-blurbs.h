@@ -222,6 +222,12 @@ _("Speed of marching ants in the selection outline.  This value is in " \
 _("GIMP will warn the user if an attempt is made to create an image that " \
   "would take more memory than the size specified here.")
 
+#define MEMORY_LIMIT_BLURB \
+_("When GIMP uses more memory than this, it will drop cached data that " \
+  "can be recreated, such as previews, brush masks and the projections " \
+  "of images which are not displayed, least recently used first.  " \
+  "Set this to 0 for no limit.")
+
 #define MODULE_PATH_BLURB \
 "Sets the module search path."
 
@@ -273,6 +279,11 @@ _("Sets how many processors GIMP should try to use simultaneously.")
 #define PLUGINRC_PATH_BLURB \
 "Sets the pluginrc search path."
 
+#define PROJECTION_RELEASE_DELAY_BLURB \
+_("When no display has shown an image for this many seconds, GIMP will " \
+  "free the image's projection, and render it again when it is needed.  " \
+  "Set this to 0 to keep projections.")
+
 #define LAYER_PREVIEWS_BLURB \
 _("Sets whether GIMP should create previews of layers and channels. " \
   "Previews in the layers and channels dialog are nice to have but they " \
@@ -623,6 +634,17 @@ _("Sets an upper limit to the memory that is used per image to keep " \
   "operations on the undo stack. Regardless of this setting, at least " \
   "as many undo-levels as configured can be undone.")
 
+#define UNDO_SWAP_SIZE_BLURB \
+_("Sets the disk space per image that may be used to keep operations " \
+  "on the undo stack which don't fit into the undo-size limit.  They " \
+  "are written to the swap folder and read back when undone.  With " \
+  "a size of zero, they are discarded.")
+
+#define UNDO_COMPRESSION_BLURB \
+_("Sets how the pixels kept for undoing drawable and selection changes " \
+  "are compressed in the background. Compressed undo steps use less of " \
+  "the undo memory, at the cost of some time when undoing them.")
+
 #define UNDO_PREVIEW_SIZE_BLURB \
 _("Sets the size of the previews in the Undo History.")
 
@@ -648,6 +648,37 @@ gimp_thumbnail_size_get_type (void)
   return type;
 }
 
+GType
+gimp_undo_compression_get_type (void)
+{
+  static const GEnumValue values[] =
+  {
+    { GIMP_UNDO_COMPRESSION_NONE, "GIMP_UNDO_COMPRESSION_NONE", "none" },
+    { GIMP_UNDO_COMPRESSION_ZLIB, "GIMP_UNDO_COMPRESSION_ZLIB", "zlib" },
+    { GIMP_UNDO_COMPRESSION_DELTA_ZLIB, "GIMP_UNDO_COMPRESSION_DELTA_ZLIB", "delta-zlib" },
+    { 0, NULL, NULL }
+  };
+
+  static const GimpEnumDesc descs[] =
+  {
+    { GIMP_UNDO_COMPRESSION_NONE, NC_("undo-compression", "None"), NULL },
+    { GIMP_UNDO_COMPRESSION_ZLIB, NC_("undo-compression", "zlib"), NULL },
+    { GIMP_UNDO_COMPRESSION_DELTA_ZLIB, NC_("undo-compression", "Delta + zlib"), NULL },
+    { 0, NULL, NULL }
+  };
+
+  static GType type = 0;
+
+  if (G_UNLIKELY (! type))
+    {
+      type = g_enum_register_static ("GimpUndoCompression", values);
+      gimp_type_set_translation_context (type, "undo-compression");
+      gimp_enum_set_value_descriptions (type, descs);
+    }
+
+  return type;
+}
+
 GType
 gimp_undo_mode_get_type (void)
 {
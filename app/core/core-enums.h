@@ -298,6 +298,18 @@ typedef enum  /*< pdb-skip >*/
 } GimpThumbnailSize;
 
 
+#define GIMP_TYPE_UNDO_COMPRESSION (gimp_undo_compression_get_type ())
+
+GType gimp_undo_compression_get_type (void) G_GNUC_CONST;
+
+typedef enum  /*< pdb-skip >*/
+{
+  GIMP_UNDO_COMPRESSION_NONE,       /*< desc="None"         >*/
+  GIMP_UNDO_COMPRESSION_ZLIB,       /*< desc="zlib"         >*/
+  GIMP_UNDO_COMPRESSION_DELTA_ZLIB  /*< desc="Delta + zlib" >*/
+} GimpUndoCompression;
+
+
 #define GIMP_TYPE_UNDO_MODE (gimp_undo_mode_get_type ())
 
 GType gimp_undo_mode_get_type (void) G_GNUC_CONST;
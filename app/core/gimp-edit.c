@@ -49,6 +49,7 @@
 #include "gimppickable.h"
 #include "gimpselection.h"
 #include "gimptempbuf.h"
+#include "gimpundobuffer.h"
 
 #include "gimp-intl.h"
 
@@ -680,8 +681,8 @@ gimp_edit_fade (GimpImage   *image,
 
       gimp_drawable_apply_buffer (drawable, buffer,
                                   GEGL_RECTANGLE (0, 0,
-                                                  gegl_buffer_get_width (undo->buffer),
-                                                  gegl_buffer_get_height (undo->buffer)),
+                                                  gimp_undo_buffer_get_width (undo->buffer),
+                                                  gimp_undo_buffer_get_height (undo->buffer)),
                                   TRUE,
                                   gimp_object_get_name (undo),
                                   gimp_context_get_opacity (context),
@@ -0,0 +1,374 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-memory-manager.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+#include <gegl.h>
+
+#include "core-types.h"
+
+#include "config/gimpgeglconfig.h"
+
+#include "gimp.h"
+#include "gimp-memory-manager.h"
+#include "gimp-memory-pool.h"
+#include "gimp-utils.h"
+
+
+/*  keeps track of caches which can be dropped and rebuilt on demand
+ *  (previews, brush masks, projections), in the order they were last
+ *  used.
+ *
+ *  when the process uses more memory than the configured limit, the
+ *  least recently used caches are asked to drop their contents until
+ *  enough memory is estimated to be released.  a cache may refuse,
+ *  e.g. because it is being shown right now.
+ *
+ *  freed memory is often kept by the process for reuse instead of
+ *  being given back to the system, so when dropping caches didn't make
+ *  the process smaller, no more caches are dropped until it grows.
+ *
+ *  all functions must be called from the main thread.
+ */
+
+
+#define CHECK_INTERVAL 5  /*  seconds  */
+
+
+typedef struct _Entry Entry;
+
+struct _Entry
+{
+  gpointer                    owner;
+  GimpMemoryManagerSizeFunc   size_func;
+  GimpMemoryManagerEvictFunc  evict_func;
+  gpointer                    data;
+  GList                       link;
+};
+
+
+/*  local function prototypes  */
+
+static void       gimp_memory_manager_notify_memory_limit (GimpGeglConfig *config);
+static gboolean   gimp_memory_manager_check_timeout       (gpointer        data);
+
+static void       gimp_memory_manager_entry_free          (Entry          *entry);
+
+
+/*  local variables  */
+
+static GHashTable *manager_entries     = NULL;
+static GQueue      manager_lru         = G_QUEUE_INIT;
+static guint64     manager_limit       = 0;
+static guint       manager_check_id    = 0;
+static guint64     manager_n_evictions = 0;
+static gint64      manager_pass_size   = 0;
+static gint64      manager_stuck_size  = 0;
+
+
+/*  public functions  */
+
+void
+gimp_memory_manager_init (Gimp *gimp)
+{
+  GimpGeglConfig *config;
+
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  config = GIMP_GEGL_CONFIG (gimp->config);
+
+  g_signal_connect (config, "notify::memory-limit",
+                    G_CALLBACK (gimp_memory_manager_notify_memory_limit),
+                    NULL);
+
+  gimp_memory_manager_notify_memory_limit (config);
+}
+
+void
+gimp_memory_manager_exit (Gimp *gimp)
+{
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  g_signal_handlers_disconnect_by_func (gimp->config,
+                                        gimp_memory_manager_notify_memory_limit,
+                                        NULL);
+
+  if (manager_check_id)
+    {
+      g_source_remove (manager_check_id);
+      manager_check_id = 0;
+    }
+
+  manager_limit      = 0;
+  manager_pass_size  = 0;
+  manager_stuck_size = 0;
+}
+
+/**
+ * gimp_memory_manager_add:
+ * @owner:      the cache, or whatever owns it
+ * @size_func:  a function returning the cache's current size in bytes
+ * @evict_func: a function dropping the cache's contents, returning
+ *              %FALSE if they can't be dropped right now
+ * @data:       data passed to @size_func and @evict_func
+ *
+ * Starts tracking the cache of @owner, as most recently used. If
+ * @owner is already tracked, its functions are replaced and it is
+ * marked as used.
+ *
+ * gimp_memory_manager_remove() must be called before @owner is freed.
+ **/
+void
+gimp_memory_manager_add (gpointer                    owner,
+                         GimpMemoryManagerSizeFunc   size_func,
+                         GimpMemoryManagerEvictFunc  evict_func,
+                         gpointer                    data)
+{
+  Entry *entry;
+
+  g_return_if_fail (owner != NULL);
+  g_return_if_fail (size_func != NULL);
+  g_return_if_fail (evict_func != NULL);
+
+  if (! manager_entries)
+    manager_entries =
+      g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                             NULL,
+                             (GDestroyNotify) gimp_memory_manager_entry_free);
+
+  entry = g_hash_table_lookup (manager_entries, owner);
+
+  if (entry)
+    {
+      g_queue_unlink (&manager_lru, &entry->link);
+    }
+  else
+    {
+      entry = g_slice_new0 (Entry);
+
+      entry->owner     = owner;
+      entry->link.data = entry;
+
+      g_hash_table_insert (manager_entries, owner, entry);
+    }
+
+  entry->size_func  = size_func;
+  entry->evict_func = evict_func;
+  entry->data       = data;
+
+  g_queue_push_tail_link (&manager_lru, &entry->link);
+}
+
+void
+gimp_memory_manager_remove (gpointer owner)
+{
+  Entry *entry;
+
+  g_return_if_fail (owner != NULL);
+
+  if (! manager_entries)
+    return;
+
+  entry = g_hash_table_lookup (manager_entries, owner);
+
+  if (entry)
+    {
+      g_queue_unlink (&manager_lru, &entry->link);
+
+      g_hash_table_remove (manager_entries, owner);
+    }
+}
+
+/**
+ * gimp_memory_manager_touch:
+ * @owner: the owner of a cache
+ *
+ * Marks the cache of @owner as most recently used. Does nothing if
+ * @owner is not tracked.
+ **/
+void
+gimp_memory_manager_touch (gpointer owner)
+{
+  Entry *entry;
+
+  if (! manager_entries)
+    return;
+
+  entry = g_hash_table_lookup (manager_entries, owner);
+
+  if (entry && manager_lru.tail != &entry->link)
+    {
+      g_queue_unlink (&manager_lru, &entry->link);
+      g_queue_push_tail_link (&manager_lru, &entry->link);
+    }
+}
+
+/**
+ * gimp_memory_manager_check:
+ *
+ * Compares the memory used by the process against the memory limit,
+ * and drops the least recently used caches until the excess is
+ * estimated to be released. This is done periodically while a limit
+ * is set, but can also be called whenever a lot of memory was just
+ * allocated.
+ *
+ * If the last caches dropped didn't make the process smaller, nothing
+ * is dropped until the process grows beyond the size it had then.
+ **/
+void
+gimp_memory_manager_check (void)
+{
+  GList  *owners = NULL;
+  GList  *list;
+  gint64  working_set;
+  gint64  excess;
+
+  if (! manager_limit)
+    return;
+
+  working_set = gimp_get_resident_memory_size ();
+
+  /*  if we can't ask the system, only the caches count  */
+  if (! working_set)
+    gimp_memory_manager_get_stats (NULL, &working_set, NULL);
+
+  if (working_set <= (gint64) manager_limit)
+    {
+      manager_pass_size  = 0;
+      manager_stuck_size = 0;
+
+      return;
+    }
+
+  /*  the memory freed by the last pass stayed with the process, which
+   *  reuses it, dropping more caches would only make them be rebuilt
+   */
+  if (manager_pass_size && working_set >= manager_pass_size)
+    manager_stuck_size = MAX (manager_stuck_size, working_set);
+
+  manager_pass_size = 0;
+
+  if (working_set <= manager_stuck_size)
+    return;
+
+  excess = working_set - manager_limit;
+
+  /*  pooled memory is the cheapest to give back  */
+  excess -= gimp_memory_pool_get_memsize ();
+  gimp_memory_pool_trim (0);
+
+  if (excess <= 0 || ! manager_entries)
+    return;
+
+  /*  evicting may add or remove entries, so work on a copy, and look
+   *  each owner up again before using its entry
+   */
+  for (list = manager_lru.head; list; list = g_list_next (list))
+    {
+      Entry *entry = list->data;
+
+      owners = g_list_prepend (owners, entry->owner);
+    }
+
+  owners = g_list_reverse (owners);
+
+  for (list = owners; list && excess > 0; list = g_list_next (list))
+    {
+      Entry  *entry = g_hash_table_lookup (manager_entries, list->data);
+      gint64  size;
+
+      if (! entry)
+        continue;
+
+      size = entry->size_func (entry->owner, entry->data);
+
+      if (size > 0 && entry->evict_func (entry->owner, entry->data))
+        {
+          excess -= size;
+
+          manager_pass_size = working_set;
+          manager_n_evictions++;
+        }
+    }
+
+  g_list_free (owners);
+}
+
+void
+gimp_memory_manager_get_stats (gint    *n_caches,
+                               gint64  *cache_size,
+                               guint64 *n_evictions)
+{
+  if (n_caches)
+    *n_caches = manager_lru.length;
+
+  if (cache_size)
+    {
+      GList *list;
+
+      *cache_size = 0;
+
+      for (list = manager_lru.head; list; list = g_list_next (list))
+        {
+          Entry *entry = list->data;
+
+          *cache_size += entry->size_func (entry->owner, entry->data);
+        }
+    }
+
+  if (n_evictions)
+    *n_evictions = manager_n_evictions;
+}
+
+
+/*  private functions  */
+
+static void
+gimp_memory_manager_notify_memory_limit (GimpGeglConfig *config)
+{
+  manager_limit = config->memory_limit;
+
+  if (manager_limit && ! manager_check_id)
+    {
+      manager_check_id =
+        g_timeout_add_seconds (CHECK_INTERVAL,
+                               gimp_memory_manager_check_timeout,
+                               NULL);
+    }
+  else if (! manager_limit && manager_check_id)
+    {
+      g_source_remove (manager_check_id);
+      manager_check_id = 0;
+    }
+}
+
+static gboolean
+gimp_memory_manager_check_timeout (gpointer data)
+{
+  gimp_memory_manager_check ();
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+gimp_memory_manager_entry_free (Entry *entry)
+{
+  g_slice_free (Entry, entry);
+}
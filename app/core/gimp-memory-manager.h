@@ -0,0 +1,47 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-memory-manager.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_MEMORY_MANAGER_H__
+#define __GIMP_MEMORY_MANAGER_H__
+
+
+typedef gint64   (* GimpMemoryManagerSizeFunc)  (gpointer owner,
+                                                 gpointer data);
+typedef gboolean (* GimpMemoryManagerEvictFunc) (gpointer owner,
+                                                 gpointer data);
+
+
+void   gimp_memory_manager_init      (Gimp                       *gimp);
+void   gimp_memory_manager_exit      (Gimp                       *gimp);
+
+void   gimp_memory_manager_add       (gpointer                    owner,
+                                      GimpMemoryManagerSizeFunc   size_func,
+                                      GimpMemoryManagerEvictFunc  evict_func,
+                                      gpointer                    data);
+void   gimp_memory_manager_remove    (gpointer                    owner);
+void   gimp_memory_manager_touch     (gpointer                    owner);
+
+void   gimp_memory_manager_check     (void);
+
+void   gimp_memory_manager_get_stats (gint                       *n_caches,
+                                      gint64                     *cache_size,
+                                      guint64                    *n_evictions);
+
+
+#endif /* __GIMP_MEMORY_MANAGER_H__ */
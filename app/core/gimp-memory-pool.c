@@ -0,0 +1,340 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-memory-pool.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+#include <gegl.h>
+
+#include "core-types.h"
+
+#include "config/gimpgeglconfig.h"
+
+#include "gimp.h"
+#include "gimp-memory-pool.h"
+
+
+/*  a pool of freed pixel memory, sorted into size classes, so that
+ *  buffers which are created and destroyed at dab rate (brush masks,
+ *  paint buffers, previews) reuse memory instead of going through
+ *  the system allocator each time.
+ *
+ *  there are four classes per power of two, so a block wastes at most
+ *  a fifth of its size.  the pool never holds more than a bounded
+ *  amount of memory, which follows the tile cache size, and can be
+ *  trimmed at any time.
+ */
+
+
+#define MIN_SHIFT     8   /*  256 bytes  */
+#define MAX_SHIFT     24  /*  16 MiB     */
+#define N_STEPS       4
+#define N_CLASSES     ((MAX_SHIFT - MIN_SHIFT) * N_STEPS + 1)
+
+#define MIN_RETAINED  (  8 * 1024 * 1024)
+#define MAX_RETAINED  (128 * 1024 * 1024)
+
+
+typedef struct _Block Block;
+
+struct _Block
+{
+  Block *next;
+};
+
+
+/*  local function prototypes  */
+
+static void   gimp_memory_pool_notify_tile_cache_size (GimpGeglConfig *config);
+
+static gint   gimp_memory_pool_get_class              (gsize           size,
+                                                       gsize          *class_size);
+static void   gimp_memory_pool_trim_locked            (gsize           max_retained,
+                                                       Block         **freed);
+
+
+/*  local variables  */
+
+static GMutex   pool_mutex;
+static Block   *pool_blocks[N_CLASSES];
+static gsize    pool_retained     = 0;
+static gsize    pool_max_retained = MIN_RETAINED;
+static guint64  pool_hits         = 0;
+static guint64  pool_misses       = 0;
+
+
+/*  public functions  */
+
+void
+gimp_memory_pool_init (Gimp *gimp)
+{
+  GimpGeglConfig *config;
+
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  config = GIMP_GEGL_CONFIG (gimp->config);
+
+  g_signal_connect (config, "notify::tile-cache-size",
+                    G_CALLBACK (gimp_memory_pool_notify_tile_cache_size),
+                    NULL);
+
+  gimp_memory_pool_notify_tile_cache_size (config);
+}
+
+void
+gimp_memory_pool_exit (Gimp *gimp)
+{
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  g_signal_handlers_disconnect_by_func (gimp->config,
+                                        gimp_memory_pool_notify_tile_cache_size,
+                                        NULL);
+
+  g_mutex_lock (&pool_mutex);
+
+  pool_max_retained = 0;
+
+  g_mutex_unlock (&pool_mutex);
+
+  gimp_memory_pool_trim (0);
+}
+
+/**
+ * gimp_memory_pool_alloc:
+ * @size: the number of bytes needed
+ *
+ * Allocates at least @size bytes, with the alignment of gegl_malloc(),
+ * reusing a previously freed block of the same size class if there
+ * is one. This is safe to call from any thread.
+ *
+ * Return value: the memory, to be freed with gimp_memory_pool_free()
+ *               and the same @size.
+ **/
+gpointer
+gimp_memory_pool_alloc (gsize size)
+{
+  Block *block = NULL;
+  gsize  class_size;
+  gint   class;
+
+  class = gimp_memory_pool_get_class (size, &class_size);
+
+  if (class < 0)
+    return gegl_malloc (size);
+
+  g_mutex_lock (&pool_mutex);
+
+  block = pool_blocks[class];
+
+  if (block)
+    {
+      pool_blocks[class] = block->next;
+      pool_retained     -= class_size;
+
+      pool_hits++;
+    }
+  else
+    {
+      pool_misses++;
+    }
+
+  g_mutex_unlock (&pool_mutex);
+
+  if (! block)
+    block = gegl_malloc (class_size);
+
+  return block;
+}
+
+/**
+ * gimp_memory_pool_free:
+ * @mem:  memory returned by gimp_memory_pool_alloc()
+ * @size: the @size it was allocated with
+ *
+ * Returns @mem to the pool, or to the system if the pool holds as
+ * much memory as it may already.
+ **/
+void
+gimp_memory_pool_free (gpointer mem,
+                       gsize    size)
+{
+  gsize class_size;
+  gint  class;
+
+  if (! mem)
+    return;
+
+  class = gimp_memory_pool_get_class (size, &class_size);
+
+  if (class >= 0)
+    {
+      g_mutex_lock (&pool_mutex);
+
+      if (pool_retained + class_size <= pool_max_retained)
+        {
+          Block *block = mem;
+
+          block->next        = pool_blocks[class];
+          pool_blocks[class] = block;
+          pool_retained     += class_size;
+
+          mem = NULL;
+        }
+
+      g_mutex_unlock (&pool_mutex);
+    }
+
+  if (mem)
+    gegl_free (mem);
+}
+
+/**
+ * gimp_memory_pool_trim:
+ * @max_retained: the number of bytes the pool may keep
+ *
+ * Frees pooled blocks, largest first, until the pool holds no more
+ * than @max_retained bytes. Pass 0 to empty the pool, e.g. when
+ * memory is getting tight.
+ **/
+void
+gimp_memory_pool_trim (gsize max_retained)
+{
+  Block *freed = NULL;
+
+  g_mutex_lock (&pool_mutex);
+
+  gimp_memory_pool_trim_locked (max_retained, &freed);
+
+  g_mutex_unlock (&pool_mutex);
+
+  while (freed)
+    {
+      Block *next = freed->next;
+
+      gegl_free (freed);
+
+      freed = next;
+    }
+}
+
+void
+gimp_memory_pool_get_stats (guint64 *hits,
+                            guint64 *misses,
+                            gsize   *retained)
+{
+  g_mutex_lock (&pool_mutex);
+
+  if (hits)     *hits     = pool_hits;
+  if (misses)   *misses   = pool_misses;
+  if (retained) *retained = pool_retained;
+
+  g_mutex_unlock (&pool_mutex);
+}
+
+gint64
+gimp_memory_pool_get_memsize (void)
+{
+  gsize retained;
+
+  gimp_memory_pool_get_stats (NULL, NULL, &retained);
+
+  return retained;
+}
+
+
+/*  private functions  */
+
+static void
+gimp_memory_pool_notify_tile_cache_size (GimpGeglConfig *config)
+{
+  gsize max_retained;
+
+  max_retained = CLAMP (config->tile_cache_size / 16,
+                        MIN_RETAINED, MAX_RETAINED);
+
+  g_mutex_lock (&pool_mutex);
+
+  pool_max_retained = max_retained;
+
+  g_mutex_unlock (&pool_mutex);
+
+  gimp_memory_pool_trim (max_retained);
+}
+
+static gint
+gimp_memory_pool_get_class (gsize  size,
+                            gsize *class_size)
+{
+  gsize base;
+  gsize step;
+  gsize k;
+  gint  shift;
+
+  if (size <= ((gsize) 1 << MIN_SHIFT))
+    {
+      *class_size = (gsize) 1 << MIN_SHIFT;
+
+      return 0;
+    }
+  else if (size > ((gsize) 1 << MAX_SHIFT))
+    {
+      return -1;
+    }
+
+  /*  base < size <= 2 * base  */
+  shift = g_bit_storage (size - 1);
+  base  = (gsize) 1 << (shift - 1);
+  step  = base / N_STEPS;
+  k     = (size - base + step - 1) / step;
+
+  *class_size = base + k * step;
+
+  return (shift - 1 - MIN_SHIFT) * N_STEPS + k;
+}
+
+static void
+gimp_memory_pool_trim_locked (gsize   max_retained,
+                              Block **freed)
+{
+  gint class;
+
+  for (class = N_CLASSES - 1;
+       class >= 0 && pool_retained > max_retained;
+       class--)
+    {
+      gsize class_size;
+
+      if (class == 0)
+        class_size = (gsize) 1 << MIN_SHIFT;
+      else
+        class_size = ((gsize) 1 << ((class - 1) / N_STEPS + MIN_SHIFT)) /
+                     N_STEPS * (N_STEPS + (class - 1) % N_STEPS + 1);
+
+      while (pool_blocks[class] && pool_retained > max_retained)
+        {
+          Block *block = pool_blocks[class];
+
+          pool_blocks[class] = block->next;
+          pool_retained     -= class_size;
+
+          block->next = *freed;
+          *freed      = block;
+        }
+    }
+}
@@ -0,0 +1,39 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-memory-pool.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_MEMORY_POOL_H__
+#define __GIMP_MEMORY_POOL_H__
+
+
+void       gimp_memory_pool_init        (Gimp     *gimp);
+void       gimp_memory_pool_exit        (Gimp     *gimp);
+
+gpointer   gimp_memory_pool_alloc       (gsize     size);
+void       gimp_memory_pool_free        (gpointer  mem,
+                                         gsize     size);
+
+void       gimp_memory_pool_trim        (gsize     max_retained);
+
+void       gimp_memory_pool_get_stats   (guint64  *hits,
+                                         guint64  *misses,
+                                         gsize    *retained);
+gint64     gimp_memory_pool_get_memsize (void);
+
+
+#endif /* __GIMP_MEMORY_POOL_H__ */
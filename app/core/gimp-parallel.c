@@ -0,0 +1,394 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-parallel.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+#include <gegl.h>
+
+#include "core-types.h"
+
+#include "config/gimpgeglconfig.h"
+
+#include "gimp.h"
+#include "gimp-parallel.h"
+
+
+/*  a small work distributor on top of a shared GThreadPool.  the
+ *  calling thread always takes part in the work, and nested calls
+ *  from inside a worker are run sequentially, so that work items
+ *  never wait for the pool they are running on.
+ */
+
+
+typedef struct
+{
+  GimpParallelDistributeFunc  func;
+  gpointer                    user_data;
+  gint                        n;
+
+  GMutex                      mutex;
+  GCond                       cond;
+  gint                        remaining;
+} GimpParallelTask;
+
+typedef struct
+{
+  GimpParallelTask *task;
+  gint              i;
+} GimpParallelItem;
+
+typedef struct
+{
+  GimpParallelDistributeRangeFunc func;
+  gpointer                        user_data;
+  gsize                           size;
+} GimpParallelRangeData;
+
+typedef struct
+{
+  GimpParallelDistributeAreaFunc  func;
+  gpointer                        user_data;
+  const GeglRectangle            *area;
+  gboolean                        vertical;
+} GimpParallelAreaData;
+
+
+/*  local function prototypes  */
+
+static void   gimp_parallel_notify_num_processors (GimpGeglConfig   *config);
+static void   gimp_parallel_set_n_threads         (gint              n_threads);
+
+static void   gimp_parallel_worker                (GimpParallelItem *item,
+                                                   gpointer          data);
+
+static void   gimp_parallel_distribute_range_func (gint              i,
+                                                   gint              n,
+                                                   gpointer          data);
+static void   gimp_parallel_distribute_area_func  (gint              i,
+                                                   gint              n,
+                                                   gpointer          data);
+
+
+/*  local variables  */
+
+static GThreadPool *gimp_parallel_pool      = NULL;
+static gint         gimp_parallel_n_threads = 1;
+static GPrivate     gimp_parallel_is_worker;
+
+
+/*  public functions  */
+
+void
+gimp_parallel_init (Gimp *gimp)
+{
+  GimpGeglConfig *config;
+
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  config = GIMP_GEGL_CONFIG (gimp->config);
+
+  g_signal_connect (config, "notify::num-processors",
+                    G_CALLBACK (gimp_parallel_notify_num_processors),
+                    NULL);
+
+  gimp_parallel_notify_num_processors (config);
+}
+
+void
+gimp_parallel_exit (Gimp *gimp)
+{
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  g_signal_handlers_disconnect_by_func (gimp->config,
+                                        gimp_parallel_notify_num_processors,
+                                        NULL);
+
+  if (gimp_parallel_pool)
+    {
+      g_thread_pool_free (gimp_parallel_pool, FALSE, TRUE);
+      gimp_parallel_pool = NULL;
+    }
+
+  gimp_parallel_n_threads = 1;
+}
+
+gint
+gimp_parallel_get_n_threads (void)
+{
+  return g_atomic_int_get (&gimp_parallel_n_threads);
+}
+
+/**
+ * gimp_parallel_distribute:
+ * @max_n:     the maximal number of work items
+ * @func:      the function to call for each work item
+ * @user_data: user data to pass to @func
+ *
+ * Calls @func (i, n, @user_data) for i = 0 .. n - 1, concurrently,
+ * where n is @max_n limited by the number of configured threads.
+ * Returns only after all calls have finished.
+ **/
+void
+gimp_parallel_distribute (gint                       max_n,
+                          GimpParallelDistributeFunc func,
+                          gpointer                   user_data)
+{
+  GimpParallelTask task;
+  GimpParallelItem items[GIMP_PARALLEL_MAX_THREADS];
+  gint             n;
+  gint             i;
+
+  g_return_if_fail (func != NULL);
+
+  if (max_n == 0)
+    return;
+
+  n = gimp_parallel_get_n_threads ();
+
+  if (max_n > 0)
+    n = MIN (n, max_n);
+
+  if (n == 1                         ||
+      ! gimp_parallel_pool           ||
+      g_private_get (&gimp_parallel_is_worker))
+    {
+      func (0, 1, user_data);
+
+      return;
+    }
+
+  task.func      = func;
+  task.user_data = user_data;
+  task.n         = n;
+  task.remaining = n - 1;
+
+  g_mutex_init (&task.mutex);
+  g_cond_init (&task.cond);
+
+  for (i = 1; i < n; i++)
+    {
+      items[i].task = &task;
+      items[i].i    = i;
+
+      g_thread_pool_push (gimp_parallel_pool, &items[i], NULL);
+    }
+
+  func (0, n, user_data);
+
+  g_mutex_lock (&task.mutex);
+
+  while (task.remaining > 0)
+    g_cond_wait (&task.cond, &task.mutex);
+
+  g_mutex_unlock (&task.mutex);
+
+  g_cond_clear (&task.cond);
+  g_mutex_clear (&task.mutex);
+}
+
+/**
+ * gimp_parallel_distribute_range:
+ * @size:         the size of the range
+ * @min_sub_size: the minimal size of a sub-range, or 0
+ * @func:         the function to call for each sub-range
+ * @user_data:    user data to pass to @func
+ *
+ * Splits [0, @size) into contiguous sub-ranges of at least
+ * @min_sub_size elements and processes them concurrently.
+ **/
+void
+gimp_parallel_distribute_range (gsize                           size,
+                                gsize                           min_sub_size,
+                                GimpParallelDistributeRangeFunc func,
+                                gpointer                        user_data)
+{
+  GimpParallelRangeData data;
+  gint                  n;
+
+  g_return_if_fail (func != NULL);
+
+  if (size == 0)
+    return;
+
+  n = gimp_parallel_get_n_threads ();
+
+  if (min_sub_size > 0)
+    n = MIN (n, size / min_sub_size);
+
+  n = CLAMP (n, 1, (gint) MIN (size, G_MAXINT));
+
+  if (n == 1)
+    {
+      func (0, size, user_data);
+
+      return;
+    }
+
+  data.func      = func;
+  data.user_data = user_data;
+  data.size      = size;
+
+  gimp_parallel_distribute (n, gimp_parallel_distribute_range_func, &data);
+}
+
+/**
+ * gimp_parallel_distribute_area:
+ * @area:         the area to process
+ * @min_sub_area: the minimal number of pixels in a sub-area, or 0
+ * @func:         the function to call for each sub-area
+ * @user_data:    user data to pass to @func
+ *
+ * Splits @area into strips along its longer side and processes them
+ * concurrently.
+ **/
+void
+gimp_parallel_distribute_area (const GeglRectangle            *area,
+                               gsize                           min_sub_area,
+                               GimpParallelDistributeAreaFunc  func,
+                               gpointer                        user_data)
+{
+  GimpParallelAreaData data;
+  gsize                n_pixels;
+  gint                 n;
+
+  g_return_if_fail (area != NULL);
+  g_return_if_fail (func != NULL);
+
+  if (area->width <= 0 || area->height <= 0)
+    return;
+
+  n_pixels = (gsize) area->width * (gsize) area->height;
+
+  data.func      = func;
+  data.user_data = user_data;
+  data.area      = area;
+  data.vertical  = area->height >= area->width;
+
+  n = gimp_parallel_get_n_threads ();
+
+  if (min_sub_area > 0)
+    n = MIN (n, n_pixels / min_sub_area);
+
+  n = CLAMP (n, 1, data.vertical ? area->height : area->width);
+
+  if (n == 1)
+    {
+      func (area, user_data);
+
+      return;
+    }
+
+  gimp_parallel_distribute (n, gimp_parallel_distribute_area_func, &data);
+}
+
+
+/*  private functions  */
+
+static void
+gimp_parallel_notify_num_processors (GimpGeglConfig *config)
+{
+  gimp_parallel_set_n_threads (config->num_processors);
+}
+
+static void
+gimp_parallel_set_n_threads (gint n_threads)
+{
+  n_threads = CLAMP (n_threads, 1, GIMP_PARALLEL_MAX_THREADS);
+
+  if (n_threads > 1)
+    {
+      if (! gimp_parallel_pool)
+        {
+          gimp_parallel_pool =
+            g_thread_pool_new ((GFunc) gimp_parallel_worker, NULL,
+                               n_threads - 1, FALSE, NULL);
+        }
+      else
+        {
+          g_thread_pool_set_max_threads (gimp_parallel_pool,
+                                         n_threads - 1, NULL);
+        }
+    }
+
+  g_atomic_int_set (&gimp_parallel_n_threads, n_threads);
+}
+
+static void
+gimp_parallel_worker (GimpParallelItem *item,
+                      gpointer          data)
+{
+  GimpParallelTask *task = item->task;
+
+  /*  the pool isn't exclusive, its threads may go on to run work of
+   *  other pools, so only flag them while running ours
+   */
+  g_private_set (&gimp_parallel_is_worker, GINT_TO_POINTER (TRUE));
+
+  task->func (item->i, task->n, task->user_data);
+
+  g_private_set (&gimp_parallel_is_worker, NULL);
+
+  g_mutex_lock (&task->mutex);
+
+  if (--task->remaining == 0)
+    g_cond_signal (&task->cond);
+
+  g_mutex_unlock (&task->mutex);
+}
+
+static void
+gimp_parallel_distribute_range_func (gint     i,
+                                     gint     n,
+                                     gpointer data)
+{
+  GimpParallelRangeData *range = data;
+  gsize                  offset;
+  gsize                  size;
+
+  offset = (range->size *  i)      / n;
+  size   = (range->size * (i + 1)) / n - offset;
+
+  if (size > 0)
+    range->func (offset, size, range->user_data);
+}
+
+static void
+gimp_parallel_distribute_area_func (gint     i,
+                                    gint     n,
+                                    gpointer data)
+{
+  GimpParallelAreaData *area_data = data;
+  const GeglRectangle  *area      = area_data->area;
+  GeglRectangle         sub_area  = *area;
+
+  if (area_data->vertical)
+    {
+      sub_area.y      = area->y + (area->height *  i)      / n;
+      sub_area.height = area->y + (area->height * (i + 1)) / n - sub_area.y;
+    }
+  else
+    {
+      sub_area.x      = area->x + (area->width *  i)      / n;
+      sub_area.width  = area->x + (area->width * (i + 1)) / n - sub_area.x;
+    }
+
+  if (sub_area.width > 0 && sub_area.height > 0)
+    area_data->func (&sub_area, area_data->user_data);
+}
@@ -103,6 +103,40 @@ gimp_get_physical_memory_size (void)
   return 0;
 }
 
+/**
+ * gimp_get_resident_memory_size:
+ *
+ * Returns: The amount of physical memory the GIMP process currently
+ * occupies, in bytes, or 0 if it can't be determined on this system.
+ **/
+guint64
+gimp_get_resident_memory_size (void)
+{
+#ifdef G_OS_UNIX
+#if defined(HAVE_UNISTD_H) && defined (_SC_PAGE_SIZE)
+  gchar *contents;
+
+  /*  the second field of statm is the number of resident pages  */
+  if (g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL))
+    {
+      guint64  resident = 0;
+      gchar   *end;
+
+      g_ascii_strtoull (contents, &end, 10);
+
+      if (end != contents)
+        resident = g_ascii_strtoull (end, NULL, 10);
+
+      g_free (contents);
+
+      return resident * sysconf (_SC_PAGE_SIZE);
+    }
+#endif
+#endif
+
+  return 0;
+}
+
 /**
  * gimp_get_backtrace:
  *
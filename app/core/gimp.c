@@ -48,6 +48,7 @@
 #include "gimp-contexts.h"
 #include "gimp-data-factories.h"
 #include "gimp-filter-history.h"
+#include "gimp-memory-pool.h"
 #include "gimp-memsize.h"
 #include "gimp-modules.h"
 #include "gimp-parasites.h"
@@ -71,6 +72,7 @@
 #include "gimppattern.h"
 #include "gimptemplate.h"
 #include "gimptoolinfo.h"
+#include "gimpundobuffer.h"
 
 #include "gimp-intl.h"
 
@@ -568,6 +570,8 @@ gimp_get_memsize (GimpObject *object,
 
   memsize += gimp_g_list_get_memsize (gimp->context_list, 0);
 
+  memsize += gimp_memory_pool_get_memsize ();
+
   memsize += gimp_object_get_memsize (GIMP_OBJECT (gimp->default_context),
                                       gui_size);
   memsize += gimp_object_get_memsize (GIMP_OBJECT (gimp->user_context),
@@ -581,6 +585,8 @@ static void
 gimp_real_initialize (Gimp               *gimp,
                       GimpInitStatusFunc  status_callback)
 {
+  gchar *swap_path;
+
   if (gimp->be_verbose)
     g_print ("INIT: %s\n", G_STRFUNC);
 
@@ -588,6 +594,17 @@ gimp_real_initialize (Gimp               *gimp,
 
   gimp_fonts_set_config (gimp);
 
+  /*  remove undo swap files left behind by crashed sessions  */
+  swap_path =
+    gimp_config_path_expand (GIMP_GEGL_CONFIG (gimp->config)->swap_path,
+                             TRUE, NULL);
+
+  if (swap_path)
+    {
+      gimp_undo_buffer_clean_swap (swap_path);
+      g_free (swap_path);
+    }
+
   /*  set the last values used to default values  */
   gimp->image_new_last_template =
     gimp_config_duplicate (GIMP_CONFIG (gimp->config->default_image));
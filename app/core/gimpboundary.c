@@ -26,12 +26,18 @@
 
 #include "core-types.h"
 
+#include "gimp-parallel.h"
 #include "gimpboundary.h"
 
 
 /* GimpBoundSeg array growth parameter */
 #define MAX_SEGS_INC  2048
 
+/* the number of scanlines the boundary is found in at once, and
+ * cached in a GimpBoundaryCache
+ */
+#define STRIP_HEIGHT  64
+
 
 typedef struct _GimpBoundary GimpBoundary;
 
@@ -52,6 +58,33 @@ struct _GimpBoundary
   gint          max_empty_segs;
 };
 
+struct _GimpBoundaryCache
+{
+  /*  the parameters the strips were found with  */
+  GeglRectangle     region;
+  const Babl       *format;
+  GimpBoundaryType  type;
+  gint              x1, y1, x2, y2;
+  gfloat            threshold;
+  gint              buffer_width;
+
+  /*  the first and last + 1 scanline  */
+  gint              start;
+  gint              end;
+
+  /*  the horizontal segments of each strip, or NULL if not known  */
+  GArray          **strips;
+  gint              n_strips;
+};
+
+typedef struct
+{
+  GimpBoundaryCache *cache;
+  GeglBuffer        *buffer;
+  gint              *invalid;
+  gint               n_invalid;
+} GimpBoundaryStripsData;
+
 
 /*  local function prototypes  */
 
@@ -84,22 +117,23 @@ static void           process_horiz_seg        (GimpBoundary        *boundary,
                                                 gint                 x2,
                                                 gint                 y2,
                                                 gboolean             open);
-static void           make_horiz_segs          (GimpBoundary        *boundary,
+static void           make_horiz_segs          (GArray              *segs,
                                                 gint                 start,
                                                 gint                 end,
                                                 gint                 scanline,
                                                 gint                 empty[],
                                                 gint                 num_empty,
                                                 gint                 top);
-static GimpBoundary * generate_boundary        (GeglBuffer          *buffer,
-                                                const GeglRectangle *region,
-                                                const Babl          *format,
-                                                GimpBoundaryType     type,
-                                                gint                 x1,
-                                                gint                 y1,
-                                                gint                 x2,
-                                                gint                 y2,
-                                                gfloat               threshold);
+static void           generate_strip           (GimpBoundary        *boundary,
+                                                const GimpBoundaryCache *cache,
+                                                GeglBuffer          *buffer,
+                                                gfloat              *line_data,
+                                                gint                 strip_start,
+                                                gint                 strip_end,
+                                                GArray              *segs);
+static void           generate_strips_func     (gint                 i,
+                                                gint                 n,
+                                                gpointer             user_data);
 
 static gint       cmp_segptr_xy1_addr     (const GimpBoundSeg **seg_ptr_a,
                                            const GimpBoundSeg **seg_ptr_b);
@@ -164,9 +198,71 @@ gimp_boundary_find (GeglBuffer          *buffer,
                     gfloat               threshold,
                     int                 *num_segs)
 {
-  GimpBoundary  *boundary;
-  GeglRectangle  rect = { 0, };
+  GimpBoundaryCache *cache;
+  GimpBoundSeg      *segs;
 
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (num_segs != NULL, NULL);
+  g_return_val_if_fail (format != NULL, NULL);
+  g_return_val_if_fail (babl_format_get_bytes_per_pixel (format) ==
+                        sizeof (gfloat), NULL);
+
+  cache = gimp_boundary_cache_new ();
+
+  segs = gimp_boundary_find_cached (cache, buffer, region, format, type,
+                                    x1, y1, x2, y2, threshold, num_segs);
+
+  gimp_boundary_cache_free (cache);
+
+  return segs;
+}
+
+/**
+ * gimp_boundary_find_cached:
+ * @cache:     a #GimpBoundaryCache
+ * @buffer:    a #GeglBuffer
+ * @region:    the area of @buffer to analyze, or %NULL
+ * @format:    a #Babl float format representing the component to analyze
+ * @type:      type of bounds
+ * @x1:        left side of bounds
+ * @y1:        top side of bounds
+ * @x2:        right side of bounds
+ * @y2:        botton side of bounds
+ * @threshold: pixel value of boundary line
+ * @num_segs:  number of returned #GimpBoundSeg's
+ *
+ * Like gimp_boundary_find(), but keeps the segments found in each
+ * strip of scanlines in @cache, and only looks at the strips which
+ * were invalidated using gimp_boundary_cache_invalidate() since the
+ * last call with the same parameters. The strips are processed in
+ * parallel.
+ *
+ * The caller is responsible for invalidating the parts of @cache
+ * whose pixels changed, or all of it when @buffer is replaced.
+ *
+ * Return value: the boundary array.
+ **/
+GimpBoundSeg *
+gimp_boundary_find_cached (GimpBoundaryCache   *cache,
+                           GeglBuffer          *buffer,
+                           const GeglRectangle *region,
+                           const Babl          *format,
+                           GimpBoundaryType     type,
+                           gint                 x1,
+                           gint                 y1,
+                           gint                 x2,
+                           gint                 y2,
+                           gfloat               threshold,
+                           gint                *num_segs)
+{
+  GimpBoundary           *boundary;
+  GimpBoundaryStripsData  data;
+  GeglRectangle           rect = { 0, };
+  gint                    start;
+  gint                    end;
+  gint                    i, j;
+
+  g_return_val_if_fail (cache != NULL, NULL);
   g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
   g_return_val_if_fail (num_segs != NULL, NULL);
   g_return_val_if_fail (format != NULL, NULL);
@@ -183,8 +279,88 @@ gimp_boundary_find (GeglBuffer          *buffer,
       rect.height = gegl_buffer_get_height (buffer);
     }
 
-  boundary = generate_boundary (buffer, &rect, format, type,
-                                x1, y1, x2, y2, threshold);
+  start = 0;
+  end   = 0;
+
+  if (type == GIMP_BOUNDARY_WITHIN_BOUNDS)
+    {
+      start = y1;
+      end   = y2;
+    }
+  else if (type == GIMP_BOUNDARY_IGNORE_BOUNDS)
+    {
+      start = rect.y;
+      end   = rect.y + rect.height;
+    }
+
+  /*  forget all strips if they were found with different parameters  */
+  if (! gegl_rectangle_equal (&rect, &cache->region)          ||
+      format                          != cache->format        ||
+      type                            != cache->type          ||
+      x1                              != cache->x1            ||
+      y1                              != cache->y1            ||
+      x2                              != cache->x2            ||
+      y2                              != cache->y2            ||
+      threshold                       != cache->threshold     ||
+      gegl_buffer_get_width (buffer)  != cache->buffer_width  ||
+      start                           != cache->start         ||
+      end                             != cache->end)
+    {
+      gimp_boundary_cache_invalidate (cache, NULL);
+
+      g_free (cache->strips);
+
+      cache->region       = rect;
+      cache->format       = format;
+      cache->type         = type;
+      cache->x1           = x1;
+      cache->y1           = y1;
+      cache->x2           = x2;
+      cache->y2           = y2;
+      cache->threshold    = threshold;
+      cache->buffer_width = gegl_buffer_get_width (buffer);
+      cache->start        = start;
+      cache->end          = end;
+      cache->n_strips     = MAX (end - start + STRIP_HEIGHT - 1, 0) /
+                            STRIP_HEIGHT;
+      cache->strips       = g_new0 (GArray *, cache->n_strips);
+    }
+
+  /*  find the horizontal segments of the unknown strips in parallel  */
+  data.cache     = cache;
+  data.buffer    = buffer;
+  data.invalid   = g_new (gint, MAX (cache->n_strips, 1));
+  data.n_invalid = 0;
+
+  for (i = 0; i < cache->n_strips; i++)
+    {
+      if (! cache->strips[i])
+        data.invalid[data.n_invalid++] = i;
+    }
+
+  gimp_parallel_distribute (data.n_invalid, generate_strips_func, &data);
+
+  g_free (data.invalid);
+
+  /*  add the vertical segments which close the horizontal ones, in
+   *  scanline order, this is cheap compared to finding the horizontal
+   *  segments and gives the same segments in the same order as
+   *  processing everything in one go
+   */
+  boundary = gimp_boundary_new (&rect);
+
+  for (i = 0; i < cache->n_strips; i++)
+    {
+      const GArray *segs = cache->strips[i];
+
+      for (j = 0; j < segs->len; j++)
+        {
+          const GimpBoundSeg *seg = &g_array_index (segs, GimpBoundSeg, j);
+
+          process_horiz_seg (boundary,
+                             seg->x1, seg->y1, seg->x2, seg->y2, seg->open);
+        }
+    }
 
   *num_segs = boundary->num_segs;
 
@@ -381,6 +557,75 @@ gimp_boundary_simplify (GimpBoundSeg *sorted_segs,
   return (GimpBoundSeg *) g_array_free (new_bounds, FALSE);
 }
 
+/**
+ * gimp_boundary_cache_new:
+ *
+ * Return value: a new, empty #GimpBoundaryCache for
+ *               gimp_boundary_find_cached().
+ **/
+GimpBoundaryCache *
+gimp_boundary_cache_new (void)
+{
+  return g_slice_new0 (GimpBoundaryCache);
+}
+
+void
+gimp_boundary_cache_free (GimpBoundaryCache *cache)
+{
+  g_return_if_fail (cache != NULL);
+
+  gimp_boundary_cache_invalidate (cache, NULL);
+
+  g_free (cache->strips);
+
+  g_slice_free (GimpBoundaryCache, cache);
+}
+
+/**
+ * gimp_boundary_cache_invalidate:
+ * @cache: a #GimpBoundaryCache
+ * @rect:  the area whose pixels changed, or %NULL
+ *
+ * Forgets the strips of @cache which depend on the pixels in @rect,
+ * or all strips if @rect is %NULL.
+ **/
+void
+gimp_boundary_cache_invalidate (GimpBoundaryCache   *cache,
+                                const GeglRectangle *rect)
+{
+  gint first;
+  gint last;
+  gint i;
+
+  g_return_if_fail (cache != NULL);
+
+  first = 0;
+  last  = cache->n_strips - 1;
+
+  if (rect)
+    {
+      /*  the segments of a scanline depend on the scanlines above
+       *  and below it
+       */
+      first = (rect->y - 1 - cache->start) / STRIP_HEIGHT;
+      last  = (rect->y + rect->height - cache->start) / STRIP_HEIGHT;
+
+      if (rect->y - 1 < cache->start)
+        first = 0;
+
+      last = MIN (last, cache->n_strips - 1);
+    }
+
+  for (i = first; i <= last; i++)
+    {
+      if (cache->strips[i])
+        {
+          g_array_free (cache->strips[i], TRUE);
+          cache->strips[i] = NULL;
+        }
+    }
+}
+
 void
 gimp_boundary_offset (GimpBoundSeg *segs,
                       gint          num_segs,
@@ -632,125 +877,156 @@ process_horiz_seg (GimpBoundary *boundary,
 }
 
 static void
-make_horiz_segs (GimpBoundary *boundary,
-                 gint          start,
-                 gint          end,
-                 gint          scanline,
-                 gint          empty[],
-                 gint          num_empty,
-                 gint          top)
+make_horiz_segs (GArray *segs,
+                 gint    start,
+                 gint    end,
+                 gint    scanline,
+                 gint    empty[],
+                 gint    num_empty,
+                 gint    top)
 {
-  gint empty_index;
-  gint e_s, e_e;    /* empty segment start and end values */
+  GimpBoundSeg seg = { 0, };
+  gint         lo, hi;
+  gint         empty_index;
+  gint         e_s, e_e;    /* empty segment start and end values */
+
+  seg.y1   = scanline;
+  seg.y2   = scanline;
+  seg.open = top;
+
+  /*  the empty segments are sorted, skip the ones ending at or before
+   *  @start, they can't overlap [start, end)
+   */
+  lo = 0;
+  hi = num_empty / 2;
 
-  for (empty_index = 0; empty_index < num_empty; empty_index += 2)
+  while (lo < hi)
     {
-      e_s = *empty++;
-      e_e = *empty++;
+      gint mid = (lo + hi) / 2;
+
+      if (empty[mid * 2 + 1] <= start)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  for (empty_index = lo * 2; empty_index < num_empty; empty_index += 2)
+    {
+      e_s = empty[empty_index];
+      e_e = empty[empty_index + 1];
+
+      if (e_s >= end)
+        break;
 
       if (e_s <= start && e_e >= end)
         {
-          process_horiz_seg (boundary,
-                             start, scanline, end, scanline, top);
+          seg.x1 = start;
+          seg.x2 = end;
+
+          g_array_append_val (segs, seg);
         }
       else if ((e_s > start && e_s < end) ||
                (e_e < end && e_e > start))
         {
-          process_horiz_seg (boundary,
-                             MAX (e_s, start), scanline,
-                             MIN (e_e, end), scanline, top);
+          seg.x1 = MAX (e_s, start);
+          seg.x2 = MIN (e_e, end);
+
+          g_array_append_val (segs, seg);
         }
     }
 }
 
-static GimpBoundary *
-generate_boundary (GeglBuffer          *buffer,
-                   const GeglRectangle *region,
-                   const Babl          *format,
-                   GimpBoundaryType     type,
-                   gint                 x1,
-                   gint                 y1,
-                   gint                 x2,
-                   gint                 y2,
-                   gfloat               threshold)
+/*  finds the horizontal segments of the scanlines [strip_start,
+ *  strip_end), the vertical ones are added by the caller
+ */
+static void
+generate_strip (GimpBoundary            *boundary,
+                const GimpBoundaryCache *cache,
+                GeglBuffer              *buffer,
+                gfloat                  *line_data,
+                gint                     strip_start,
+                gint                     strip_end,
+                GArray                  *segs)
 {
-  GimpBoundary  *boundary;
-  GeglRectangle  line_rect = { 0, };
-  gfloat        *line_data;
-  gint           scanline;
-  gint           i;
-  gint           start, end;
-  gint          *tmp_segs;
+  const GeglRectangle *region    = &cache->region;
+  GeglRectangle        line_rect = { 0, };
+  gint                 scanline;
+  gint                 i;
+  gint                *tmp_segs;
 
   gint          num_empty_n = 0;
   gint          num_empty_c = 0;
   gint          num_empty_l = 0;
 
-  boundary = gimp_boundary_new (region);
-
-  line_rect.width  = gegl_buffer_get_width (buffer);
+  line_rect.width  = cache->buffer_width;
   line_rect.height = 1;
 
-  line_data = g_alloca (sizeof (gfloat) * line_rect.width);
-
-  start = 0;
-  end   = 0;
-
-  if (type == GIMP_BOUNDARY_WITHIN_BOUNDS)
+  /*  Find the empty segments for the previous and current scanlines  */
+  line_rect.y = strip_start - 1;
+  if (strip_start == cache->start)
     {
-      start = y1;
-      end   = y2;
+      find_empty_segs (region, NULL,
+                       strip_start - 1, boundary->empty_segs_l,
+                       boundary->max_empty_segs, &num_empty_l,
+                       cache->type,
+                       cache->x1, cache->y1, cache->x2, cache->y2,
+                       cache->threshold);
     }
-  else if (type == GIMP_BOUNDARY_IGNORE_BOUNDS)
+  else
     {
-      start = region->y;
-      end   = region->y + region->height;
+      gegl_buffer_get (buffer, &line_rect, 1.0, cache->format,
+                       line_data, GEGL_AUTO_ROWSTRIDE,
+                       GEGL_ABYSS_NONE);
+
+      find_empty_segs (region, line_data,
+                       strip_start - 1, boundary->empty_segs_l,
+                       boundary->max_empty_segs, &num_empty_l,
+                       cache->type,
+                       cache->x1, cache->y1, cache->x2, cache->y2,
+                       cache->threshold);
     }
 
-  /*  Find the empty segments for the previous and current scanlines  */
-  find_empty_segs (region, NULL,
-                   start - 1, boundary->empty_segs_l,
-                   boundary->max_empty_segs, &num_empty_l,
-                   type, x1, y1, x2, y2,
-                   threshold);
-
-  line_rect.y = start;
-  gegl_buffer_get (buffer, &line_rect, 1.0, format,
+  line_rect.y = strip_start;
+  gegl_buffer_get (buffer, &line_rect, 1.0, cache->format,
                    line_data, GEGL_AUTO_ROWSTRIDE,
                    GEGL_ABYSS_NONE);
 
   find_empty_segs (region, line_data,
-                   start, boundary->empty_segs_c,
+                   strip_start, boundary->empty_segs_c,
                    boundary->max_empty_segs, &num_empty_c,
-                   type, x1, y1, x2, y2,
-                   threshold);
+                   cache->type,
+                   cache->x1, cache->y1, cache->x2, cache->y2,
+                   cache->threshold);
 
-  for (scanline = start; scanline < end; scanline++)
+  for (scanline = strip_start; scanline < strip_end; scanline++)
     {
+      gfloat *next_line_data = line_data;
+
       /*  find the empty segment list for the next scanline  */
       line_rect.y = scanline + 1;
-      if (scanline + 1 == end)
-        line_data = NULL;
+      if (scanline + 1 == cache->end)
+        next_line_data = NULL;
       else
-        gegl_buffer_get (buffer, &line_rect, 1.0, format,
+        gegl_buffer_get (buffer, &line_rect, 1.0, cache->format,
                          line_data, GEGL_AUTO_ROWSTRIDE,
                          GEGL_ABYSS_NONE);
 
-      find_empty_segs (region, line_data,
+      find_empty_segs (region, next_line_data,
                        scanline + 1, boundary->empty_segs_n,
                        boundary->max_empty_segs, &num_empty_n,
-                       type, x1, y1, x2, y2,
-                       threshold);
+                       cache->type,
+                       cache->x1, cache->y1, cache->x2, cache->y2,
+                       cache->threshold);
 
       /*  process the segments on the current scanline  */
       for (i = 1; i < num_empty_c - 1; i += 2)
         {
-          make_horiz_segs (boundary,
+          make_horiz_segs (segs,
                            boundary->empty_segs_c [i],
                            boundary->empty_segs_c [i+1],
                            scanline,
                            boundary->empty_segs_l, num_empty_l, 1);
-          make_horiz_segs (boundary,
+          make_horiz_segs (segs,
                            boundary->empty_segs_c [i],
                            boundary->empty_segs_c [i+1],
                            scanline + 1,
@@ -765,8 +1041,39 @@ generate_boundary (GeglBuffer          *buffer,
       num_empty_c            = num_empty_n;
       boundary->empty_segs_n = tmp_segs;
     }
+}
 
-  return boundary;
+static void
+generate_strips_func (gint     i,
+                      gint     n,
+                      gpointer user_data)
+{
+  GimpBoundaryStripsData *data  = user_data;
+  GimpBoundaryCache      *cache = data->cache;
+  GimpBoundary           *boundary;
+  gfloat                 *line_data;
+  gint                    k;
+
+  boundary  = gimp_boundary_new (&cache->region);
+  line_data = g_new (gfloat, cache->buffer_width);
+
+  for (k = i; k < data->n_invalid; k += n)
+    {
+      gint    strip       = data->invalid[k];
+      gint    strip_start = cache->start + strip * STRIP_HEIGHT;
+      gint    strip_end   = MIN (strip_start + STRIP_HEIGHT, cache->end);
+      GArray *segs;
+
+      segs = g_array_new (FALSE, FALSE, sizeof (GimpBoundSeg));
+
+      generate_strip (boundary, cache, data->buffer, line_data,
+                      strip_start, strip_end, segs);
+
+      cache->strips[strip] = segs;
+    }
+
+  g_free (line_data);
+  gimp_boundary_free (boundary, TRUE);
 }
 
 /*  sorting utility functions  */
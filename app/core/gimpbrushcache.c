@@ -24,6 +24,7 @@
 
 #include "core-types.h"
 
+#include "gimp-memory-manager.h"
 #include "gimpbrushcache.h"
 
 #include "gimp-log.h"
@@ -67,6 +68,16 @@ static void   gimp_brush_cache_get_property (GObject      *object,
                                              GValue       *value,
                                              GParamSpec   *pspec);
 
+static gint64   gimp_brush_cache_get_memsize       (GimpObject     *object,
+                                                    gint64         *gui_size);
+
+static gint64   gimp_brush_cache_get_units_memsize (GimpBrushCache *cache,
+                                                    GList          *units);
+static gint64   gimp_brush_cache_get_evict_size    (GimpBrushCache *cache,
+                                                    gpointer        data);
+static gboolean gimp_brush_cache_evict             (GimpBrushCache *cache,
+                                                    gpointer        data);
+
 
 G_DEFINE_TYPE (GimpBrushCache, gimp_brush_cache, GIMP_TYPE_OBJECT)
 
@@ -76,12 +87,15 @@ G_DEFINE_TYPE (GimpBrushCache, gimp_brush_cache, GIMP_TYPE_OBJECT)
 static void
 gimp_brush_cache_class_init (GimpBrushCacheClass *klass)
 {
-  GObjectClass  *object_class = G_OBJECT_CLASS (klass);
+  GObjectClass    *object_class      = G_OBJECT_CLASS (klass);
+  GimpObjectClass *gimp_object_class = GIMP_OBJECT_CLASS (klass);
+
+  object_class->constructed      = gimp_brush_cache_constructed;
+  object_class->finalize         = gimp_brush_cache_finalize;
+  object_class->set_property     = gimp_brush_cache_set_property;
+  object_class->get_property     = gimp_brush_cache_get_property;
 
-  object_class->constructed  = gimp_brush_cache_constructed;
-  object_class->finalize     = gimp_brush_cache_finalize;
-  object_class->set_property = gimp_brush_cache_set_property;
-  object_class->get_property = gimp_brush_cache_get_property;
+  gimp_object_class->get_memsize = gimp_brush_cache_get_memsize;
 
   g_object_class_install_property (object_class, PROP_DATA_DESTROY,
                                    g_param_spec_pointer ("data-destroy",
@@ -103,6 +117,13 @@ gimp_brush_cache_constructed (GObject *object)
   G_OBJECT_CLASS (parent_class)->constructed (object);
 
   g_assert (cache->data_destroy != NULL);
+
+  gimp_memory_manager_add (object,
+                           (GimpMemoryManagerSizeFunc)
+                           gimp_brush_cache_get_evict_size,
+                           (GimpMemoryManagerEvictFunc)
+                           gimp_brush_cache_evict,
+                           NULL);
 }
 
 static void
@@ -110,6 +131,8 @@ gimp_brush_cache_finalize (GObject *object)
 {
   GimpBrushCache *cache = GIMP_BRUSH_CACHE (object);
 
+  gimp_memory_manager_remove (object);
+
   gimp_brush_cache_clear (cache);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -155,13 +178,27 @@ gimp_brush_cache_get_property (GObject    *object,
     }
 }
 
+static gint64
+gimp_brush_cache_get_memsize (GimpObject *object,
+                              gint64     *gui_size)
+{
+  GimpBrushCache *cache = GIMP_BRUSH_CACHE (object);
+  gint64          memsize;
+
+  memsize = gimp_brush_cache_get_units_memsize (cache, cache->cached_units);
+
+  return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
+                                                                  gui_size);
+}
+
 
 /*  public functions  */
 
 GimpBrushCache *
-gimp_brush_cache_new (GDestroyNotify  data_destroy,
-                      gchar           debug_hit,
-                      gchar           debug_miss)
+gimp_brush_cache_new (GDestroyNotify             data_destroy,
+                      GimpBrushCacheMemsizeFunc  data_memsize,
+                      gchar                      debug_hit,
+                      gchar                      debug_miss)
 {
   GimpBrushCache *cache;
 
@@ -171,8 +208,9 @@ gimp_brush_cache_new (GDestroyNotify  data_destroy,
                          "data-destroy", data_destroy,
                          NULL);
 
-  cache->debug_hit  = debug_hit;
-  cache->debug_miss = debug_miss;
+  cache->data_memsize = data_memsize;
+  cache->debug_hit    = debug_hit;
+  cache->debug_miss   = debug_miss;
 
   return cache;
 }
@@ -235,6 +273,8 @@ gimp_brush_cache_get (GimpBrushCache *cache,
             cache->cached_units->prev = iter;
           cache->cached_units = iter;
 
+          gimp_memory_manager_touch (cache);
+
           return (gconstpointer) unit->data;
         }
     }
@@ -296,4 +336,70 @@ gimp_brush_cache_add (GimpBrushCache *cache,
   unit->op           = op;
 
   cache->cached_units = g_list_prepend (cache->cached_units, unit);
+
+  gimp_memory_manager_touch (cache);
+}
+
+
+/*  private functions  */
+
+static gint64
+gimp_brush_cache_get_units_memsize (GimpBrushCache *cache,
+                                    GList          *units)
+{
+  gint64  memsize = 0;
+  GList  *iter;
+
+  for (iter = units; iter; iter = g_list_next (iter))
+    {
+      GimpBrushCacheUnit *unit = iter->data;
+
+      memsize += sizeof (GList) + sizeof (GimpBrushCacheUnit);
+
+      if (cache->data_memsize)
+        memsize += cache->data_memsize (unit->data);
+    }
+
+  return memsize;
+}
+
+static gint64
+gimp_brush_cache_get_evict_size (GimpBrushCache *cache,
+                                 gpointer        data)
+{
+  if (! cache->cached_units)
+    return 0;
+
+  return gimp_brush_cache_get_units_memsize (cache,
+                                             cache->cached_units->next);
+}
+
+static gboolean
+gimp_brush_cache_evict (GimpBrushCache *cache,
+                        gpointer        data)
+{
+  GList *rest;
+  GList *iter;
+
+  /*  keep the most recently used data, the paint core which asked
+   *  for it last may still be using it
+   */
+  if (! cache->cached_units || ! cache->cached_units->next)
+    return FALSE;
+
+  rest = cache->cached_units->next;
+
+  cache->cached_units->next = NULL;
+  rest->prev                = NULL;
+
+  for (iter = rest; iter; iter = g_list_next (iter))
+    {
+      GimpBrushCacheUnit *unit = iter->data;
+
+      cache->data_destroy (unit->data);
+    }
+
+  g_list_free_full (rest, g_free);
+
+  return TRUE;
 }
@@ -33,18 +33,22 @@
 #define GIMP_BRUSH_CACHE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GIMP_TYPE_BRUSH_CACHE, GimpBrushCacheClass))
 
 
+typedef gsize (* GimpBrushCacheMemsizeFunc) (gconstpointer data);
+
+
 typedef struct _GimpBrushCacheClass GimpBrushCacheClass;
 
 struct _GimpBrushCache
 {
-  GimpObject      parent_instance;
+  GimpObject                 parent_instance;
 
-  GDestroyNotify  data_destroy;
+  GDestroyNotify             data_destroy;
+  GimpBrushCacheMemsizeFunc  data_memsize;
 
-  GList          *cached_units;
+  GList                     *cached_units;
 
-  gchar           debug_hit;
-  gchar           debug_miss;
+  gchar                      debug_hit;
+  gchar                      debug_miss;
 };
 
 struct _GimpBrushCacheClass
@@ -55,9 +59,10 @@ struct _GimpBrushCacheClass
 
 GType            gimp_brush_cache_get_type (void) G_GNUC_CONST;
 
-GimpBrushCache * gimp_brush_cache_new      (GDestroyNotify  data_destory,
-                                            gchar           debug_hit,
-                                            gchar           debug_miss);
+GimpBrushCache * gimp_brush_cache_new      (GDestroyNotify             data_destory,
+                                            GimpBrushCacheMemsizeFunc  data_memsize,
+                                            gchar                      debug_hit,
+                                            gchar                      debug_miss);
 
 void             gimp_brush_cache_clear    (GimpBrushCache *cache);
 
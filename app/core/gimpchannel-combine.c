@@ -31,6 +31,7 @@
 
 #include "gimpchannel.h"
 #include "gimpchannel-combine.h"
+#include "gimpmasktiles.h"
 
 
 void
@@ -87,6 +88,11 @@ gimp_channel_combine_rect (GimpChannel    *mask,
   mask->y2 = CLAMP (mask->y2, 0, gimp_item_get_height (GIMP_ITEM (mask)));
 
   gimp_drawable_update (GIMP_DRAWABLE (mask), x, y, w, h);
+
+  /*  the rect is now uniform, no need to rescan its tiles  */
+  gimp_mask_tiles_set_rect (mask->mask_tiles, GEGL_RECTANGLE (x, y, w, h),
+                            (op == GIMP_CHANNEL_OP_ADD ||
+                             op == GIMP_CHANNEL_OP_REPLACE) ? 1.0 : 0.0);
 }
 
 /**
@@ -34,6 +34,7 @@
 #include "gegl/gimp-gegl-apply-operation.h"
 #include "gegl/gimp-gegl-mask.h"
 #include "gegl/gimp-gegl-nodes.h"
+#include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
 #include "gimp-utils.h"
@@ -50,6 +51,7 @@
 #include "gimpdrawable-fill.h"
 #include "gimpdrawable-stroke.h"
 #include "gimpmarshal.h"
+#include "gimpmasktiles.h"
 #include "gimppaintinfo.h"
 #include "gimppickable.h"
 #include "gimpstrokeoptions.h"
@@ -151,6 +153,11 @@ static void       gimp_channel_convert_type  (GimpDrawable      *drawable,
                                               GeglDitherMethod   mask_dither_type,
                                               gboolean           push_undo,
                                               GimpProgress      *progress);
+static void       gimp_channel_update        (GimpDrawable      *drawable,
+                                              gint               x,
+                                              gint               y,
+                                              gint               width,
+                                              gint               height);
 static void gimp_channel_invalidate_boundary   (GimpDrawable       *drawable);
 static void gimp_channel_get_active_components (GimpDrawable       *drawable,
                                                 gboolean           *active);
@@ -307,6 +314,7 @@ gimp_channel_class_init (GimpChannelClass *klass)
   item_class->raise_failed         = _("Channel cannot be raised higher.");
   item_class->lower_failed         = _("Channel cannot be lowered more.");
 
+  drawable_class->update                = gimp_channel_update;
   drawable_class->convert_type          = gimp_channel_convert_type;
   drawable_class->invalidate_boundary   = gimp_channel_invalidate_boundary;
   drawable_class->get_active_components = gimp_channel_get_active_components;
@@ -358,6 +366,12 @@ gimp_channel_init (GimpChannel *channel)
   channel->y1             = 0;
   channel->x2             = 0;
   channel->y2             = 0;
+
+  channel->boundary_cache_in  = gimp_boundary_cache_new ();
+  channel->boundary_cache_out = gimp_boundary_cache_new ();
+  channel->boundary_updated   = FALSE;
+
+  channel->mask_tiles         = gimp_mask_tiles_new ();
 }
 
 static void
@@ -383,6 +397,24 @@ gimp_channel_finalize (GObject *object)
       channel->segs_out = NULL;
     }
 
+  if (channel->boundary_cache_in)
+    {
+      gimp_boundary_cache_free (channel->boundary_cache_in);
+      channel->boundary_cache_in = NULL;
+    }
+
+  if (channel->boundary_cache_out)
+    {
+      gimp_boundary_cache_free (channel->boundary_cache_out);
+      channel->boundary_cache_out = NULL;
+    }
+
+  if (channel->mask_tiles)
+    {
+      gimp_mask_tiles_free (channel->mask_tiles);
+      channel->mask_tiles = NULL;
+    }
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -509,11 +541,11 @@ gimp_channel_bounds (GimpItem *item,
     {
       GeglBuffer *buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (channel));
 
-      channel->empty = ! gimp_gegl_mask_bounds (buffer,
-                                                &channel->x1,
-                                                &channel->y1,
-                                                &channel->x2,
-                                                &channel->y2);
+      channel->empty = ! gimp_mask_tiles_bounds (channel->mask_tiles, buffer,
+                                                 &channel->x1,
+                                                 &channel->y1,
+                                                 &channel->x2,
+                                                 &channel->y2);
 
       channel->bounds_known = TRUE;
     }
@@ -984,6 +1016,29 @@ gimp_channel_convert_type (GimpDrawable     *drawable,
   g_object_unref (dest_buffer);
 }
 
+static void
+gimp_channel_update (GimpDrawable *drawable,
+                     gint          x,
+                     gint          y,
+                     gint          width,
+                     gint          height)
+{
+  GimpChannel   *channel = GIMP_CHANNEL (drawable);
+  GeglRectangle  rect    = { x, y, width, height };
+
+  /*  only the boundary strips touching the updated area need to be
+   *  found again
+   */
+  gimp_boundary_cache_invalidate (channel->boundary_cache_in,  &rect);
+  gimp_boundary_cache_invalidate (channel->boundary_cache_out, &rect);
+
+  gimp_mask_tiles_invalidate (channel->mask_tiles, &rect);
+
+  channel->boundary_updated = TRUE;
+
+  GIMP_DRAWABLE_CLASS (parent_class)->update (drawable, x, y, width, height);
+}
+
 static void
 gimp_channel_invalidate_boundary (GimpDrawable *drawable)
 {
@@ -1077,6 +1132,12 @@ gimp_channel_set_buffer (GimpDrawable *drawable,
 
   channel->bounds_known = FALSE;
 
+  gimp_boundary_cache_invalidate (channel->boundary_cache_in,  NULL);
+  gimp_boundary_cache_invalidate (channel->boundary_cache_out, NULL);
+  channel->boundary_updated = FALSE;
+
+  gimp_mask_tiles_invalidate (channel->mask_tiles, NULL);
+
   if (gimp_filter_peek_node (GIMP_FILTER (channel)))
     {
       const Babl *color_format;
@@ -1148,6 +1209,15 @@ gimp_channel_real_boundary (GimpChannel         *channel,
       g_free (channel->segs_in);
       g_free (channel->segs_out);
 
+      /*  if the mask changed without telling us where, none of the
+       *  cached strips can be trusted
+       */
+      if (! channel->boundary_updated)
+        {
+          gimp_boundary_cache_invalidate (channel->boundary_cache_in,  NULL);
+          gimp_boundary_cache_invalidate (channel->boundary_cache_out, NULL);
+        }
+
       if (gimp_item_bounds (GIMP_ITEM (channel), &x3, &y3, &x4, &y4))
         {
           GeglBuffer    *buffer;
@@ -1158,12 +1228,14 @@ gimp_channel_real_boundary (GimpChannel         *channel,
 
           buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (channel));
 
-          channel->segs_out = gimp_boundary_find (buffer, &rect,
-                                                  babl_format ("Y float"),
-                                                  GIMP_BOUNDARY_IGNORE_BOUNDS,
-                                                  x1, y1, x2, y2,
-                                                  GIMP_BOUNDARY_HALF_WAY,
-                                                  &channel->num_segs_out);
+          channel->segs_out =
+            gimp_boundary_find_cached (channel->boundary_cache_out,
+                                       buffer, &rect,
+                                       babl_format ("Y float"),
+                                       GIMP_BOUNDARY_IGNORE_BOUNDS,
+                                       x1, y1, x2, y2,
+                                       GIMP_BOUNDARY_HALF_WAY,
+                                       &channel->num_segs_out);
           x1 = MAX (x1, x3);
           y1 = MAX (y1, y3);
           x2 = MIN (x2, x4);
@@ -1171,12 +1243,14 @@ gimp_channel_real_boundary (GimpChannel         *channel,
 
           if (x2 > x1 && y2 > y1)
             {
-              channel->segs_in = gimp_boundary_find (buffer, NULL,
-                                                     babl_format ("Y float"),
-                                                     GIMP_BOUNDARY_WITHIN_BOUNDS,
-                                                     x1, y1, x2, y2,
-                                                     GIMP_BOUNDARY_HALF_WAY,
-                                                     &channel->num_segs_in);
+              channel->segs_in =
+                gimp_boundary_find_cached (channel->boundary_cache_in,
+                                           buffer, NULL,
+                                           babl_format ("Y float"),
+                                           GIMP_BOUNDARY_WITHIN_BOUNDS,
+                                           x1, y1, x2, y2,
+                                           GIMP_BOUNDARY_HALF_WAY,
+                                           &channel->num_segs_in);
             }
           else
             {
@@ -1192,7 +1266,8 @@ gimp_channel_real_boundary (GimpChannel         *channel,
           channel->num_segs_out = 0;
         }
 
-      channel->boundary_known = TRUE;
+      channel->boundary_known   = TRUE;
+      channel->boundary_updated = FALSE;
     }
 
   *segs_in      = channel->segs_in;
@@ -1213,7 +1288,7 @@ gimp_channel_real_is_empty (GimpChannel *channel)
 
   buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (channel));
 
-  if (! gimp_gegl_mask_is_empty (buffer))
+  if (! gimp_mask_tiles_is_empty (channel->mask_tiles, buffer))
     return FALSE;
 
   /*  The mask is empty, meaning we can set the bounds as known  */
@@ -1342,6 +1417,8 @@ gimp_channel_real_clear (GimpChannel *channel,
   channel->y2           = gimp_item_get_height (GIMP_ITEM (channel));
 
   gimp_drawable_update (GIMP_DRAWABLE (channel), 0, 0, -1, -1);
+
+  gimp_mask_tiles_set_rect (channel->mask_tiles, NULL, 0.0);
 }
 
 static void
@@ -1358,8 +1435,8 @@ gimp_channel_real_all (GimpChannel *channel,
 
   /*  clear the channel  */
   color = gegl_color_new ("#fff");
-  gegl_buffer_set_color (gimp_drawable_get_buffer (GIMP_DRAWABLE (channel)),
-                         NULL, color);
+  gimp_gegl_buffer_set_color
+    (gimp_drawable_get_buffer (GIMP_DRAWABLE (channel)), NULL, color);
   g_object_unref (color);
 
   /*  we know the bounds  */
@@ -1371,6 +1448,8 @@ gimp_channel_real_all (GimpChannel *channel,
   channel->y2           = gimp_item_get_height (GIMP_ITEM (channel));
 
   gimp_drawable_update (GIMP_DRAWABLE (channel), 0, 0, -1, -1);
+
+  gimp_mask_tiles_set_rect (channel->mask_tiles, NULL, 1.0);
 }
 
 static void
@@ -1709,7 +1788,7 @@ gimp_channel_new_from_alpha (GimpImage     *image,
                     dest_buffer, NULL);
   gegl_buffer_set_format (dest_buffer, NULL);
 
-  channel->bounds_known = FALSE;
+  gimp_channel_invalidate_bounds (channel);
 
   return channel;
 }
@@ -1960,6 +2039,38 @@ gimp_channel_is_empty (GimpChannel *channel)
   return GIMP_CHANNEL_GET_CLASS (channel)->is_empty (channel);
 }
 
+gboolean
+gimp_channel_is_full (GimpChannel *channel)
+{
+  g_return_val_if_fail (GIMP_IS_CHANNEL (channel), FALSE);
+
+  if (channel->bounds_known && channel->empty)
+    return FALSE;
+
+  return gimp_mask_tiles_is_full (channel->mask_tiles,
+                                  gimp_drawable_get_buffer (GIMP_DRAWABLE (channel)));
+}
+
+/**
+ * gimp_channel_invalidate_bounds:
+ * @channel: a #GimpChannel
+ *
+ * Forgets everything known about the contents of @channel, its bounds,
+ * boundary and tile summary.  Call this after writing to the channel's
+ * buffer directly, without gimp_drawable_update().
+ **/
+void
+gimp_channel_invalidate_bounds (GimpChannel *channel)
+{
+  g_return_if_fail (GIMP_IS_CHANNEL (channel));
+
+  channel->bounds_known     = FALSE;
+  channel->boundary_known   = FALSE;
+  channel->boundary_updated = FALSE;
+
+  gimp_mask_tiles_invalidate (channel->mask_tiles, NULL);
+}
+
 void
 gimp_channel_feather (GimpChannel *channel,
                       gdouble      radius_x,
@@ -209,10 +209,10 @@ gimp_data_factory_new (Gimp                             *gimp,
   factory = g_object_new (GIMP_TYPE_DATA_FACTORY, NULL);
 
   factory->priv->gimp                   = gimp;
-  factory->priv->container              = gimp_list_new (data_type, TRUE);
+  factory->priv->container              = gimp_list_new_indexed (data_type, TRUE);
   gimp_list_set_sort_func (GIMP_LIST (factory->priv->container),
                            (GCompareFunc) gimp_data_compare);
-  factory->priv->container_obsolete     = gimp_list_new (data_type, TRUE);
+  factory->priv->container_obsolete     = gimp_list_new_indexed (data_type, TRUE);
   gimp_list_set_sort_func (GIMP_LIST (factory->priv->container_obsolete),
                            (GCompareFunc) gimp_data_compare);
 
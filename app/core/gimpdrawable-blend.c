@@ -27,6 +27,8 @@
 #include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
+#include "gimp-memory-manager.h"
+#include "gimp-memsize.h"
 #include "gimpchannel.h"
 #include "gimpcontext.h"
 #include "gimpdrawable-blend.h"
@@ -37,6 +39,42 @@
 #include "gimp-intl.h"
 
 
+#define DISTMAP_CACHE_KEY "gimp-drawable-blend-distmap-cache"
+
+
+/*  the last distance map computed from a source, either the selection
+ *  mask or the drawable, kept until the source is updated or the memory
+ *  manager drops it
+ */
+typedef struct
+{
+  GObject       *source;
+  gulong         update_handler;
+
+  gint           drawable_ID;
+  gboolean       legacy_shapeburst;
+  GeglRectangle  region;
+  GeglRectangle  mask_rect;
+
+  GeglBuffer    *dist_buffer;
+} DistmapCache;
+
+
+/*  local function prototypes  */
+
+static void     gimp_drawable_blend_distmap_cache_free     (DistmapCache *cache);
+static void     gimp_drawable_blend_distmap_cache_update   (GimpDrawable *source,
+                                                            gint          x,
+                                                            gint          y,
+                                                            gint          width,
+                                                            gint          height,
+                                                            DistmapCache *cache);
+static gint64   gimp_drawable_blend_distmap_cache_get_size (DistmapCache *cache,
+                                                            gpointer      data);
+static gboolean gimp_drawable_blend_distmap_cache_evict    (DistmapCache *cache,
+                                                            gpointer      data);
+
+
 /*  public functions  */
 
 void
@@ -140,11 +178,14 @@ gimp_drawable_blend_shapeburst_distmap (GimpDrawable        *drawable,
                                         const GeglRectangle *region,
                                         GimpProgress        *progress)
 {
-  GimpChannel *mask;
-  GimpImage   *image;
-  GeglBuffer  *dist_buffer;
-  GeglBuffer  *temp_buffer;
-  GeglNode    *shapeburst;
+  GimpChannel   *mask;
+  GimpImage     *image;
+  GObject       *source;
+  DistmapCache  *cache;
+  GeglBuffer    *dist_buffer;
+  GeglBuffer    *temp_buffer;
+  GeglNode      *shapeburst;
+  GeglRectangle  mask_rect = { 0, };
 
   g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
   g_return_val_if_fail (gimp_item_is_attached (GIMP_ITEM (drawable)), NULL);
@@ -152,12 +193,6 @@ gimp_drawable_blend_shapeburst_distmap (GimpDrawable        *drawable,
 
   image = gimp_item_get_image (GIMP_ITEM (drawable));
 
-  /*  allocate the distance map  */
-  dist_buffer = gegl_buffer_new (region, babl_format ("Y float"));
-
-  /*  allocate the selection mask copy  */
-  temp_buffer = gegl_buffer_new (region, babl_format ("Y float"));
-
   mask = gimp_image_get_mask (image);
 
   /*  If the image mask is not empty, use it as the shape burst source  */
@@ -169,9 +204,42 @@ gimp_drawable_blend_shapeburst_distmap (GimpDrawable        *drawable,
       gimp_item_mask_intersect (GIMP_ITEM (drawable), &x, &y, &width, &height);
       gimp_item_get_offset (GIMP_ITEM (drawable), &off_x, &off_y);
 
+      mask_rect = *GEGL_RECTANGLE (x + off_x, y + off_y, width, height);
+
+      source = G_OBJECT (mask);
+    }
+  else
+    {
+      source = G_OBJECT (drawable);
+    }
+
+  /*  Reuse the last distance map of the source if nothing changed,
+   *  the blend tool asks for it again whenever it is restarted
+   */
+  cache = g_object_get_data (source, DISTMAP_CACHE_KEY);
+
+  if (cache                                                            &&
+      cache->drawable_ID       == gimp_item_get_ID (GIMP_ITEM (drawable)) &&
+      cache->legacy_shapeburst == legacy_shapeburst                       &&
+      gegl_rectangle_equal (&cache->region,    region)                    &&
+      gegl_rectangle_equal (&cache->mask_rect, &mask_rect))
+    {
+      gimp_memory_manager_touch (cache);
+
+      return g_object_ref (cache->dist_buffer);
+    }
+
+  /*  allocate the distance map  */
+  dist_buffer = gegl_buffer_new (region, babl_format ("Y float"));
+
+  /*  allocate the selection mask copy  */
+  temp_buffer = gegl_buffer_new (region, babl_format ("Y float"));
+
+  if (source == G_OBJECT (mask))
+    {
       /*  copy the mask to the temp mask  */
       gegl_buffer_copy (gimp_drawable_get_buffer (GIMP_DRAWABLE (mask)),
-                        GEGL_RECTANGLE (x + off_x, y + off_y, width, height),
+                        &mask_rect,
                         GEGL_ABYSS_NONE, temp_buffer, region);
     }
   else
@@ -223,5 +291,73 @@ gimp_drawable_blend_shapeburst_distmap (GimpDrawable        *drawable,
 
   g_object_unref (temp_buffer);
 
+  cache = g_slice_new0 (DistmapCache);
+
+  cache->source            = source;
+  cache->drawable_ID       = gimp_item_get_ID (GIMP_ITEM (drawable));
+  cache->legacy_shapeburst = legacy_shapeburst;
+  cache->region            = *region;
+  cache->mask_rect         = mask_rect;
+  cache->dist_buffer       = g_object_ref (dist_buffer);
+
+  cache->update_handler =
+    g_signal_connect (source, "update",
+                      G_CALLBACK (gimp_drawable_blend_distmap_cache_update),
+                      cache);
+
+  g_object_set_data_full (source, DISTMAP_CACHE_KEY, cache,
+                          (GDestroyNotify) gimp_drawable_blend_distmap_cache_free);
+
+  gimp_memory_manager_add (cache,
+                           (GimpMemoryManagerSizeFunc)
+                           gimp_drawable_blend_distmap_cache_get_size,
+                           (GimpMemoryManagerEvictFunc)
+                           gimp_drawable_blend_distmap_cache_evict,
+                           NULL);
+
   return dist_buffer;
 }
+
+
+/*  private functions  */
+
+static void
+gimp_drawable_blend_distmap_cache_free (DistmapCache *cache)
+{
+  gimp_memory_manager_remove (cache);
+
+  if (g_signal_handler_is_connected (cache->source, cache->update_handler))
+    g_signal_handler_disconnect (cache->source, cache->update_handler);
+
+  g_object_unref (cache->dist_buffer);
+
+  g_slice_free (DistmapCache, cache);
+}
+
+static void
+gimp_drawable_blend_distmap_cache_update (GimpDrawable *source,
+                                          gint          x,
+                                          gint          y,
+                                          gint          width,
+                                          gint          height,
+                                          DistmapCache *cache)
+{
+  g_object_set_data (G_OBJECT (source), DISTMAP_CACHE_KEY, NULL);
+}
+
+static gint64
+gimp_drawable_blend_distmap_cache_get_size (DistmapCache *cache,
+                                            gpointer      data)
+{
+  return gimp_gegl_buffer_get_memsize (cache->dist_buffer);
+}
+
+static gboolean
+gimp_drawable_blend_distmap_cache_evict (DistmapCache *cache,
+                                         gpointer      data)
+{
+  /*  frees the cache, and untracks it  */
+  g_object_set_data (cache->source, DISTMAP_CACHE_KEY, NULL);
+
+  return TRUE;
+}
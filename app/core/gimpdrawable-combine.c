@@ -39,6 +39,10 @@
 #include "gimptempbuf.h"
 
 
+static gboolean   gimp_drawable_use_mask (GimpDrawable *drawable,
+                                          GimpChannel  *mask);
+
+
 void
 gimp_drawable_real_apply_buffer (GimpDrawable           *drawable,
                                  GeglBuffer             *buffer,
@@ -61,8 +65,7 @@ gimp_drawable_real_apply_buffer (GimpDrawable           *drawable,
   gint               x, y, width, height;
   gint               offset_x, offset_y;
 
-  /*  don't apply the mask to itself and don't apply an empty mask  */
-  if (GIMP_DRAWABLE (mask) == drawable || gimp_channel_is_empty (mask))
+  if (! gimp_drawable_use_mask (drawable, mask))
     mask = NULL;
 
   if (! base_buffer)
@@ -183,8 +186,7 @@ gimp_drawable_real_replace_buffer (GimpDrawable        *drawable,
   gint             offset_x, offset_y;
   gboolean         active_components[MAX_CHANNELS];
 
-  /*  don't apply the mask to itself and don't apply an empty mask  */
-  if (GIMP_DRAWABLE (mask) == drawable || gimp_channel_is_empty (mask))
+  if (! gimp_drawable_use_mask (drawable, mask))
     mask = NULL;
 
   /*  configure the active channel array  */
@@ -263,3 +265,32 @@ gimp_drawable_real_replace_buffer (GimpDrawable        *drawable,
                          active_components);
     }
 }
+
+
+/*  private functions  */
+
+static gboolean
+gimp_drawable_use_mask (GimpDrawable *drawable,
+                        GimpChannel  *mask)
+{
+  GimpItem *item = GIMP_ITEM (drawable);
+  gint      offset_x, offset_y;
+
+  /*  don't apply the mask to itself and don't apply an empty mask  */
+  if (GIMP_DRAWABLE (mask) == drawable || gimp_channel_is_empty (mask))
+    return FALSE;
+
+  gimp_item_get_offset (item, &offset_x, &offset_y);
+
+  /*  a fully selected mask only clips to the image, which changes
+   *  nothing for a drawable inside of it
+   */
+  if (offset_x >= 0 &&
+      offset_y >= 0 &&
+      offset_x + gimp_item_get_width  (item) <= gimp_item_get_width  (GIMP_ITEM (mask)) &&
+      offset_y + gimp_item_get_height (item) <= gimp_item_get_height (GIMP_ITEM (mask)) &&
+      gimp_channel_is_full (mask))
+    return FALSE;
+
+  return TRUE;
+}
@@ -26,6 +26,7 @@
 
 #include "gegl/gimpapplicator.h"
 #include "gegl/gimp-gegl-apply-operation.h"
+#include "gegl/gimp-gegl-utils.h"
 
 #include "gimp-utils.h"
 #include "gimpdrawable.h"
@@ -109,16 +110,8 @@ gimp_drawable_merge_filter (GimpDrawable *drawable,
       GeglRectangle  *rects        = NULL;
       gint            n_rects      = 0;
 
-      undo_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
-                                                     rect.width, rect.height),
-                                     gimp_drawable_get_format (drawable));
-
-      gegl_buffer_copy (gimp_drawable_get_buffer (drawable),
-                        GEGL_RECTANGLE (rect.x, rect.y,
-                                        rect.width, rect.height),
-                        GEGL_ABYSS_NONE,
-                        undo_buffer,
-                        GEGL_RECTANGLE (0, 0, 0, 0));
+      undo_buffer =
+        gimp_gegl_buffer_dup_area (gimp_drawable_get_buffer (drawable), &rect);
 
       applicator = gimp_filter_get_applicator (filter);
 
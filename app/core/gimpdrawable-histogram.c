@@ -121,3 +121,59 @@ gimp_drawable_calculate_histogram (GimpDrawable  *drawable,
         }
     }
 }
+
+/**
+ * gimp_drawable_calculate_histogram_approximate:
+ * @drawable:   a #GimpDrawable
+ * @histogram:  an incremental #GimpHistogram
+ * @max_pixels: about how many pixels to look at, or -1 for all
+ *
+ * Calculates the histogram of @drawable like
+ * gimp_drawable_calculate_histogram(), but estimates it if that would
+ * take more than @max_pixels pixels, see
+ * gimp_histogram_calculate_approximate().
+ *
+ * Return value: %TRUE if @histogram is exact.
+ **/
+gboolean
+gimp_drawable_calculate_histogram_approximate (GimpDrawable  *drawable,
+                                               GimpHistogram *histogram,
+                                               gint64         max_pixels)
+{
+  GimpImage   *image;
+  GimpChannel *mask;
+  gint         x, y, width, height;
+
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), TRUE);
+  g_return_val_if_fail (gimp_item_is_attached (GIMP_ITEM (drawable)), TRUE);
+  g_return_val_if_fail (histogram != NULL, TRUE);
+
+  if (! gimp_item_mask_intersect (GIMP_ITEM (drawable), &x, &y, &width, &height))
+    return TRUE;
+
+  image = gimp_item_get_image (GIMP_ITEM (drawable));
+  mask  = gimp_image_get_mask (image);
+
+  if (! gimp_channel_is_empty (mask))
+    {
+      gint off_x, off_y;
+
+      gimp_item_get_offset (GIMP_ITEM (drawable), &off_x, &off_y);
+
+      return gimp_histogram_calculate_approximate (histogram,
+                                                   gimp_drawable_get_buffer (drawable),
+                                                   GEGL_RECTANGLE (x, y, width, height),
+                                                   gimp_drawable_get_buffer (GIMP_DRAWABLE (mask)),
+                                                   GEGL_RECTANGLE (x + off_x, y + off_y,
+                                                                   width, height),
+                                                   max_pixels);
+    }
+  else
+    {
+      return gimp_histogram_calculate_approximate (histogram,
+                                                   gimp_drawable_get_buffer (drawable),
+                                                   GEGL_RECTANGLE (x, y, width, height),
+                                                   NULL, NULL,
+                                                   max_pixels);
+    }
+}
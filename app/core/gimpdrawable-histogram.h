@@ -21,8 +21,12 @@
 #define __GIMP_DRAWABLE_HISTOGRAM_H__
 
 
-void   gimp_drawable_calculate_histogram (GimpDrawable  *drawable,
-                                          GimpHistogram *histogram);
+void       gimp_drawable_calculate_histogram (GimpDrawable  *drawable,
+                                              GimpHistogram *histogram);
+gboolean   gimp_drawable_calculate_histogram_approximate
+                                             (GimpDrawable  *drawable,
+                                              GimpHistogram *histogram,
+                                              gint64         max_pixels);
 
 
 #endif /* __GIMP_HISTOGRAM_H__ */
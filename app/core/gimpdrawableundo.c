@@ -24,10 +24,15 @@
 
 #include "core-types.h"
 
+#include "config/gimpcoreconfig.h"
+
+#include "gimp.h"
 #include "gimp-memsize.h"
 #include "gimpimage.h"
+#include "gimpimage-undo.h"
 #include "gimpdrawable.h"
 #include "gimpdrawableundo.h"
+#include "gimpundobuffer.h"
 
 
 enum
@@ -52,12 +57,23 @@ static void     gimp_drawable_undo_get_property (GObject             *object,
 static gint64   gimp_drawable_undo_get_memsize  (GimpObject          *object,
                                                  gint64              *gui_size);
 
+static gint64   gimp_drawable_undo_get_uncompressed_size
+                                                (GimpUndo            *undo);
+static void     gimp_drawable_undo_swap_out     (GimpUndo            *undo,
+                                                 const gchar         *path);
+static gint64   gimp_drawable_undo_get_swap_size
+                                                (GimpUndo            *undo);
+
 static void     gimp_drawable_undo_pop          (GimpUndo            *undo,
                                                  GimpUndoMode         undo_mode,
                                                  GimpUndoAccumulator *accum);
 static void     gimp_drawable_undo_free         (GimpUndo            *undo,
                                                  GimpUndoMode         undo_mode);
 
+static void     gimp_drawable_undo_compress     (GimpDrawableUndo    *drawable_undo);
+static void     gimp_drawable_undo_compressed   (GimpUndoBuffer      *undo_buffer,
+                                                 GimpUndo            *undo);
+
 
 G_DEFINE_TYPE (GimpDrawableUndo, gimp_drawable_undo, GIMP_TYPE_ITEM_UNDO)
 
@@ -71,14 +87,17 @@ gimp_drawable_undo_class_init (GimpDrawableUndoClass *klass)
   GimpObjectClass *gimp_object_class = GIMP_OBJECT_CLASS (klass);
   GimpUndoClass   *undo_class        = GIMP_UNDO_CLASS (klass);
 
-  object_class->constructed      = gimp_drawable_undo_constructed;
-  object_class->set_property     = gimp_drawable_undo_set_property;
-  object_class->get_property     = gimp_drawable_undo_get_property;
+  object_class->constructed         = gimp_drawable_undo_constructed;
+  object_class->set_property        = gimp_drawable_undo_set_property;
+  object_class->get_property        = gimp_drawable_undo_get_property;
 
-  gimp_object_class->get_memsize = gimp_drawable_undo_get_memsize;
+  gimp_object_class->get_memsize    = gimp_drawable_undo_get_memsize;
 
-  undo_class->pop                = gimp_drawable_undo_pop;
-  undo_class->free               = gimp_drawable_undo_free;
+  undo_class->get_uncompressed_size = gimp_drawable_undo_get_uncompressed_size;
+  undo_class->swap_out              = gimp_drawable_undo_swap_out;
+  undo_class->get_swap_size         = gimp_drawable_undo_get_swap_size;
+  undo_class->pop                   = gimp_drawable_undo_pop;
+  undo_class->free                  = gimp_drawable_undo_free;
 
   g_object_class_install_property (object_class, PROP_BUFFER,
                                    g_param_spec_object ("buffer", NULL, NULL,
@@ -112,7 +131,9 @@ gimp_drawable_undo_constructed (GObject *object)
   G_OBJECT_CLASS (parent_class)->constructed (object);
 
   g_assert (GIMP_IS_DRAWABLE (GIMP_ITEM_UNDO (object)->item));
-  g_assert (GEGL_IS_BUFFER (drawable_undo->buffer));
+  g_assert (drawable_undo->buffer != NULL);
+
+  gimp_drawable_undo_compress (drawable_undo);
 }
 
 static void
@@ -126,7 +147,7 @@ gimp_drawable_undo_set_property (GObject      *object,
   switch (property_id)
     {
     case PROP_BUFFER:
-      drawable_undo->buffer = g_value_dup_object (value);
+      drawable_undo->buffer = gimp_undo_buffer_new (g_value_get_object (value));
       break;
     case PROP_X:
       drawable_undo->x = g_value_get_int (value);
@@ -152,7 +173,9 @@ gimp_drawable_undo_get_property (GObject    *object,
   switch (property_id)
     {
     case PROP_BUFFER:
-      g_value_set_object (value, drawable_undo->buffer);
+      g_value_set_object (value,
+                          gimp_undo_buffer_get_buffer (drawable_undo->buffer,
+                                                       NULL));
       break;
     case PROP_X:
       g_value_set_int (value, drawable_undo->x);
@@ -174,25 +197,75 @@ gimp_drawable_undo_get_memsize (GimpObject *object,
   GimpDrawableUndo *drawable_undo = GIMP_DRAWABLE_UNDO (object);
   gint64            memsize       = 0;
 
-  memsize += gimp_gegl_buffer_get_memsize (drawable_undo->buffer);
+  memsize += gimp_undo_buffer_get_memsize (drawable_undo->buffer);
 
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
 }
 
+static gint64
+gimp_drawable_undo_get_uncompressed_size (GimpUndo *undo)
+{
+  GimpDrawableUndo *drawable_undo = GIMP_DRAWABLE_UNDO (undo);
+
+  return (GIMP_UNDO_CLASS (parent_class)->get_uncompressed_size (undo) +
+          gimp_undo_buffer_get_raw_memsize (drawable_undo->buffer) -
+          gimp_undo_buffer_get_memsize (drawable_undo->buffer));
+}
+
+static void
+gimp_drawable_undo_swap_out (GimpUndo    *undo,
+                             const gchar *path)
+{
+  GimpDrawableUndo *drawable_undo = GIMP_DRAWABLE_UNDO (undo);
+
+  if (drawable_undo->buffer)
+    gimp_undo_buffer_swap_out (drawable_undo->buffer, path,
+                               undo->image->gimp->config->undo_compression,
+                               (GimpUndoBufferCallback)
+                               gimp_drawable_undo_compressed,
+                               drawable_undo);
+}
+
+static gint64
+gimp_drawable_undo_get_swap_size (GimpUndo *undo)
+{
+  GimpDrawableUndo *drawable_undo = GIMP_DRAWABLE_UNDO (undo);
+
+  return gimp_undo_buffer_get_swap_size (drawable_undo->buffer);
+}
+
 static void
 gimp_drawable_undo_pop (GimpUndo            *undo,
                         GimpUndoMode         undo_mode,
                         GimpUndoAccumulator *accum)
 {
   GimpDrawableUndo *drawable_undo = GIMP_DRAWABLE_UNDO (undo);
+  GeglBuffer       *buffer;
+  GError           *error         = NULL;
 
   GIMP_UNDO_CLASS (parent_class)->pop (undo, undo_mode, accum);
 
+  buffer = gimp_undo_buffer_get_buffer (drawable_undo->buffer, &error);
+
+  /*  leave the drawable alone rather than writing garbage into it  */
+  if (! buffer)
+    {
+      gimp_message_literal (undo->image->gimp, NULL, GIMP_MESSAGE_ERROR,
+                            error->message);
+      g_clear_error (&error);
+
+      accum->failed = TRUE;
+      return;
+    }
+
   gimp_drawable_swap_pixels (GIMP_DRAWABLE (GIMP_ITEM_UNDO (undo)->item),
-                             drawable_undo->buffer,
+                             buffer,
                              drawable_undo->x,
                              drawable_undo->y);
+
+  /*  the buffer now holds the pixels to redo (or undo) again  */
+  gimp_drawable_undo_compress (drawable_undo);
 }
 
 static void
@@ -203,7 +276,7 @@ gimp_drawable_undo_free (GimpUndo     *undo,
 
   if (drawable_undo->buffer)
     {
-      g_object_unref (drawable_undo->buffer);
+      gimp_undo_buffer_free (drawable_undo->buffer);
       drawable_undo->buffer = NULL;
     }
 
@@ -215,3 +288,22 @@ gimp_drawable_undo_free (GimpUndo     *undo,
 
   GIMP_UNDO_CLASS (parent_class)->free (undo, undo_mode);
 }
+
+static void
+gimp_drawable_undo_compress (GimpDrawableUndo *drawable_undo)
+{
+  GimpImage *image = GIMP_UNDO (drawable_undo)->image;
+
+  gimp_undo_buffer_compress (drawable_undo->buffer,
+                             image->gimp->config->undo_compression,
+                             (GimpUndoBufferCallback)
+                             gimp_drawable_undo_compressed,
+                             drawable_undo);
+}
+
+static void
+gimp_drawable_undo_compressed (GimpUndoBuffer *undo_buffer,
+                               GimpUndo       *undo)
+{
+  gimp_image_undo_memsize_changed (undo->image, undo);
+}
@@ -35,11 +35,11 @@ typedef struct _GimpDrawableUndoClass GimpDrawableUndoClass;
 
 struct _GimpDrawableUndo
 {
-  GimpItemUndo  parent_instance;
+  GimpItemUndo    parent_instance;
 
-  GeglBuffer   *buffer;
-  gint          x;
-  gint          y;
+  GimpUndoBuffer *buffer;
+  gint            x;
+  gint            y;
 
   /* stuff for "Fade" */
   GeglBuffer             *applied_buffer;
@@ -31,6 +31,7 @@
 
 #include "gegl/gimp-babl.h"
 
+#include "gimp-parallel.h"
 #include "gimphistogram.h"
 
 
@@ -42,14 +43,80 @@ enum
   PROP_VALUES
 };
 
+/*  the sub-histograms of blocks of tiles of the last calculated
+ *  buffer, for recalculating only the blocks that changed
+ */
+typedef struct
+{
+  GeglBuffer     *buffer;
+  GeglRectangle   buffer_rect;
+  GeglBuffer     *mask;
+  GeglRectangle   mask_rect;
+  gboolean        has_mask;
+  const Babl     *format;
+
+  gint            block_width;
+  gint            block_height;
+  gint            first_col;
+  gint            first_row;
+  gint            n_cols;
+  gint            n_blocks;
+
+  gdouble       **blocks;
+  gboolean       *counted;     /*  whether the block is in values       */
+  gint            n_counted;
+  gint64          counted_pixels;
+  gint64          total_pixels;
+  gdouble        *values;      /*  the sum of the counted blocks        */
+} HistogramCache;
+
 struct _GimpHistogramPrivate
 {
-  gboolean gamma_correct;
-  gint     n_channels;
-  gint     n_bins;
-  gdouble *values;
+  gboolean        gamma_correct;
+  gint            n_channels;
+  gint            n_bins;
+  gdouble        *values;
+  gboolean        approximate;
+  gdouble         error;
+
+  gboolean        incremental;
+  HistogramCache *cache;
 };
 
+typedef struct
+{
+  GeglBuffer     *buffer;
+  GeglRectangle   buffer_rect;
+  GeglBuffer     *mask;
+  GeglRectangle   mask_rect;
+  const Babl     *format;
+  gboolean        u8;
+  gint            n_components;
+  gint            n_bins;
+  gfloat          scale;
+  gdouble         Y[3];
+  gfloat          u8_to_float[256];
+
+  gint            tile_width;
+  gint            tile_height;
+  gint            first_col;
+  gint            first_row;
+  gint            n_cols;
+  gint            n_areas;
+
+  gdouble        *values[GIMP_PARALLEL_MAX_THREADS];
+
+  HistogramCache *cache;
+  const gint     *dirty_blocks;
+  gint            n_dirty_blocks;
+} CalculateContext;
+
+
+/*  the approximate size of the blocks of an incremental histogram, in
+ *  pixels along each side, rounded to whole tiles
+ */
+#define HISTOGRAM_BLOCK_SIZE 512
+
 
 /*  local function prototypes  */
 
@@ -70,6 +137,44 @@ static void     gimp_histogram_alloc_values (GimpHistogram *histogram,
                                              gint           n_components,
                                              gint           n_bins);
 
+static void     gimp_histogram_clear_cache     (GimpHistogram          *histogram);
+static gboolean gimp_histogram_cache_matches   (HistogramCache         *cache,
+                                                const CalculateContext *context);
+static gboolean gimp_histogram_calculate_internal
+                                               (GimpHistogram          *histogram,
+                                                GeglBuffer             *buffer,
+                                                const GeglRectangle    *buffer_rect,
+                                                GeglBuffer             *mask,
+                                                const GeglRectangle    *mask_rect,
+                                                gint64                  max_pixels);
+static gboolean gimp_histogram_calculate_incremental
+                                               (GimpHistogram          *histogram,
+                                                CalculateContext       *context,
+                                                gint64                  max_pixels);
+static gint64   gimp_histogram_cache_get_block (HistogramCache         *cache,
+                                                gint                    block,
+                                                GeglRectangle          *area);
+
+static void     gimp_histogram_calculate_func  (gint                    i,
+                                                gint                    n,
+                                                gpointer                user_data);
+static void     gimp_histogram_calculate_blocks_func
+                                               (gint                    i,
+                                                gint                    n,
+                                                gpointer                user_data);
+static void     gimp_histogram_calculate_area  (CalculateContext       *context,
+                                                gdouble                *values,
+                                                GeglRectangle          *area);
+static void     gimp_histogram_calculate_float (CalculateContext       *context,
+                                                gdouble                *values,
+                                                const gfloat           *data,
+                                                const gfloat           *mask_data,
+                                                gint                    length);
+static void     gimp_histogram_calculate_u8    (CalculateContext       *context,
+                                                gdouble                *values,
+                                                const guint8           *data,
+                                                const gfloat           *mask_data,
+                                                gint                    length);
 
 G_DEFINE_TYPE (GimpHistogram, gimp_histogram, GIMP_TYPE_OBJECT)
 
@@ -221,6 +326,8 @@ gimp_histogram_duplicate (GimpHistogram *histogram)
                                     sizeof (gdouble) *
                                     dup->priv->n_channels *
                                     dup->priv->n_bins);
+  dup->priv->approximate = histogram->priv->approximate;
+  dup->priv->error       = histogram->priv->error;
 
   return dup;
 }
@@ -231,208 +338,309 @@ gimp_histogram_calculate (GimpHistogram       *histogram,
                           const GeglRectangle *buffer_rect,
                           GeglBuffer          *mask,
                           const GeglRectangle *mask_rect)
+{
+  g_return_if_fail (GIMP_IS_HISTOGRAM (histogram));
+  g_return_if_fail (GEGL_IS_BUFFER (buffer));
+  g_return_if_fail (buffer_rect != NULL);
+
+  gimp_histogram_calculate_internal (histogram, buffer, buffer_rect,
+                                     mask, mask_rect, -1);
+}
+
+/**
+ * gimp_histogram_calculate_approximate:
+ * @histogram:   an incremental %GimpHistogram
+ * @buffer:      the buffer
+ * @buffer_rect: the area of @buffer
+ * @mask:        a mask, or %NULL
+ * @mask_rect:   the area of @mask
+ * @max_pixels:  about how many pixels to look at, or -1 for all
+ *
+ * Like gimp_histogram_calculate(), but stops after looking at about
+ * @max_pixels pixels of the blocks that aren't known yet, picking one
+ * block at random out of each of a number of evenly sized runs of
+ * them. Until all blocks are known, the histogram is estimated from
+ * the known ones and gimp_histogram_is_approximate() returns %TRUE.
+ * Calling this again continues where the last call stopped, so an
+ * exact histogram can be completed in the background.
+ *
+ * Return value: %TRUE if the histogram is exact.
+ **/
+gboolean
+gimp_histogram_calculate_approximate (GimpHistogram       *histogram,
+                                      GeglBuffer          *buffer,
+                                      const GeglRectangle *buffer_rect,
+                                      GeglBuffer          *mask,
+                                      const GeglRectangle *mask_rect,
+                                      gint64               max_pixels)
+{
+  g_return_val_if_fail (GIMP_IS_HISTOGRAM (histogram), TRUE);
+  g_return_val_if_fail (histogram->priv->incremental, TRUE);
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), TRUE);
+  g_return_val_if_fail (buffer_rect != NULL, TRUE);
+
+  return gimp_histogram_calculate_internal (histogram, buffer, buffer_rect,
+                                            mask, mask_rect, max_pixels);
+}
+
+/**
+ * gimp_histogram_is_approximate:
+ * @histogram: a %GimpHistogram
+ * @error:     return location for the error bound, or %NULL
+ *
+ * Tells whether @histogram was estimated from a part of its buffer by
+ * gimp_histogram_calculate_approximate(). If it was, @error is set to
+ * a bound, at 95% confidence, on how far the share of pixels in any
+ * range of bins is off, as a fraction of all pixels. Blocks are
+ * counted as single samples for this, which overestimates the error
+ * of most images.
+ *
+ * Return value: %TRUE if the histogram is approximate.
+ **/
+gboolean
+gimp_histogram_is_approximate (GimpHistogram *histogram,
+                               gdouble       *error)
+{
+  g_return_val_if_fail (GIMP_IS_HISTOGRAM (histogram), FALSE);
+
+  if (error)
+    *error = histogram->priv->error;
+
+  return histogram->priv->approximate;
+}
+
+static gboolean
+gimp_histogram_calculate_internal (GimpHistogram       *histogram,
+                                   GeglBuffer          *buffer,
+                                   const GeglRectangle *buffer_rect,
+                                   GeglBuffer          *mask,
+                                   const GeglRectangle *mask_rect,
+                                   gint64               max_pixels)
 {
   GimpHistogramPrivate *priv;
-  GeglBufferIterator   *iter;
+  CalculateContext      context = { 0, };
   const Babl           *format;
   const Babl           *model;
   gint                  n_components;
   gint                  n_bins;
-
-  g_return_if_fail (GIMP_IS_HISTOGRAM (histogram));
-  g_return_if_fail (GEGL_IS_BUFFER (buffer));
-  g_return_if_fail (buffer_rect != NULL);
+  gint                  n_values;
+  gboolean              exact;
+  gint                  i;
 
   priv = histogram->priv;
 
   format = gegl_buffer_get_format (buffer);
   model  = babl_format_get_model (format);
 
-  if (babl_format_get_type (format, 0) == babl_type ("u8")) n_bins = 256;
-  else n_bins = 1024;
+  if (babl_format_get_type (format, 0) == babl_type ("u8"))
+    {
+      n_bins = 256;
 
-  if (model == babl_model ("Y")) format = babl_format ("Y float");
-  else if (model == babl_model ("YA")) format = babl_format ("YA float");
-  else if (model == babl_model ("RGB")) format = babl_format ("RGB float");
-  else if (model == babl_model ("RGBA")) format = babl_format ("RGBA float");
-  else g_return_if_reached ();
+      /*  u8 bins are the component values themselves, so read the
+       *  buffer as it is instead of converting it to float
+       */
+      context.u8 = TRUE;
+    }
+  else
+    {
+      n_bins = 1024;
+    }
+
+  if (context.u8)
+    {
+      if (model == babl_model ("Y")) format = babl_format ("Y u8");
+      else if (model == babl_model ("YA")) format = babl_format ("YA u8");
+      else if (model == babl_model ("RGB")) format = babl_format ("RGB u8");
+      else if (model == babl_model ("RGBA")) format = babl_format ("RGBA u8");
+      else g_return_val_if_reached (TRUE);
+    }
+  else
+    {
+      if (model == babl_model ("Y")) format = babl_format ("Y float");
+      else if (model == babl_model ("YA")) format = babl_format ("YA float");
+      else if (model == babl_model ("RGB")) format = babl_format ("RGB float");
+      else if (model == babl_model ("RGBA")) format = babl_format ("RGBA float");
+      else g_return_val_if_reached (TRUE);
+    }
 
   n_components = babl_format_get_n_components (format);
 
   g_object_freeze_notify (G_OBJECT (histogram));
 
+  context.buffer       = buffer;
+  context.buffer_rect  = *buffer_rect;
+  context.mask         = mask;
+  context.format       = format;
+  context.n_components = n_components;
+  context.n_bins       = n_bins;
+  context.scale        = n_bins - 0.0001;
+
+  if (mask)
+    context.mask_rect = *mask_rect;
+
+  gimp_get_Y (context.Y);
+
+  for (i = 0; i < 256; i++)
+    context.u8_to_float[i] = i / 255.0;
+
+  g_object_get (buffer,
+                "tile-width",  &context.tile_width,
+                "tile-height", &context.tile_height,
+                NULL);
+
+  context.first_col  = buffer_rect->x / context.tile_width;
+  context.first_row  = buffer_rect->y / context.tile_height;
+  context.n_cols     = (buffer_rect->x + buffer_rect->width +
+                        context.tile_width - 1) / context.tile_width -
+                       context.first_col;
+  context.n_areas    = context.n_cols *
+                       ((buffer_rect->y + buffer_rect->height +
+                         context.tile_height - 1) / context.tile_height -
+                        context.first_row);
+
+  if (priv->incremental)
+    {
+      exact = gimp_histogram_calculate_incremental (histogram, &context,
+                                                    max_pixels);
+
+      g_object_notify (G_OBJECT (histogram), "values");
+
+      g_object_thaw_notify (G_OBJECT (histogram));
+
+      return exact;
+    }
+
   gimp_histogram_alloc_values (histogram, n_components, n_bins);
 
-  iter = gegl_buffer_iterator_new (buffer, buffer_rect, 0, format,
-                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+  n_values = priv->n_channels * priv->n_bins;
 
-  if (mask)
-    gegl_buffer_iterator_add (iter, mask, mask_rect, 0,
-                              babl_format ("Y float"),
-                              GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+  /*  the first thread accumulates right into the histogram, the
+   *  others into their own bins which are added up afterwards
+   */
+  context.values[0] = priv->values;
 
-#define VALUE(c,i) (priv->values[(c) * priv->n_bins + \
-                                 (gint) (CLAMP ((i), 0.0, 1.0) * \
-                                         (priv->n_bins - 0.0001))])
+  if (context.n_areas > 0)
+    gimp_parallel_distribute (MIN (context.n_areas,
+                                   GIMP_PARALLEL_MAX_THREADS),
+                              gimp_histogram_calculate_func,
+                              &context);
 
-  while (gegl_buffer_iterator_next (iter))
+  for (i = 1; i < GIMP_PARALLEL_MAX_THREADS; i++)
     {
-      const gfloat *data   = iter->data[0];
-      gint          length = iter->length;
-      gfloat        max;
-      gfloat        luminance;
-      double Y[3];
-      gimp_get_Y (Y);
+      const gdouble *values = context.values[i];
+      gint           j;
 
-      if (mask)
-        {
-          const gfloat *mask_data = iter->data[1];
+      if (! values)
+        continue;
 
-          switch (n_components)
-            {
-            case 1:
-              while (length--)
-                {
-                  const gdouble masked = *mask_data;
-
-                  VALUE (0, data[0]) += masked;
-
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-
-            case 2:
-              while (length--)
-                {
-                  const gdouble masked = *mask_data;
-                  const gdouble weight = data[1];
-
-                  VALUE (0, data[0]) += weight * masked;
-                  VALUE (1, data[1]) += masked;
-
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-
-            case 3: /* calculate separate value values */
-              while (length--)
-                {
-                  const gdouble masked = *mask_data;
-
-                  VALUE (1, data[0]) += masked;
-                  VALUE (2, data[1]) += masked;
-                  VALUE (3, data[2]) += masked;
-
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
-                  VALUE (0, max) += masked;
-
-                  luminance = (data[0] * Y[0]) + (data[1] * Y[1]) + (data[2] * Y[2]);
-                  VALUE (4, luminance) += masked;
-
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-
-            case 4: /* calculate separate value values */
-              while (length--)
-                {
-                  const gdouble masked = *mask_data;
-                  const gdouble weight = data[3];
-
-                  VALUE (1, data[0]) += weight * masked;
-                  VALUE (2, data[1]) += weight * masked;
-                  VALUE (3, data[2]) += weight * masked;
-                  VALUE (4, data[3]) += masked;
-
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
-                  VALUE (0, max) += weight * masked;
-
-                  luminance = (data[0] * Y[0]) + (data[1] * Y[1]) + (data[2] * Y[2]);
-                  VALUE (5, luminance) += weight * masked;
-
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-            }
-        }
-      else /* no mask */
-        {
-          switch (n_components)
-            {
-            case 1:
-              while (length--)
-                {
-                  VALUE (0, data[0]) += 1.0;
-
-                  data += n_components;
-                }
-              break;
-
-            case 2:
-              while (length--)
-                {
-                  const gdouble weight = data[1];
-
-                  VALUE (0, data[0]) += weight;
-                  VALUE (1, data[1]) += 1.0;
-
-                  data += n_components;
-                }
-              break;
-
-            case 3: /* calculate separate value values */
-              while (length--)
-                {
-                  VALUE (1, data[0]) += 1.0;
-                  VALUE (2, data[1]) += 1.0;
-                  VALUE (3, data[2]) += 1.0;
-
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
-                  VALUE (0, max) += 1.0;
-
-                  luminance = (data[0] * Y[0]) + (data[1] * Y[1]) + (data[2] * Y[2]);
-                  VALUE (4, luminance) += 1.0;
-
-                  data += n_components;
-                }
-              break;
-
-            case 4: /* calculate separate value values */
-              while (length--)
-                {
-                  const gdouble weight = data[3];
-
-                  VALUE (1, data[0]) += weight;
-                  VALUE (2, data[1]) += weight;
-                  VALUE (3, data[2]) += weight;
-                  VALUE (4, data[3]) += 1.0;
-
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
-                  VALUE (0, max) += weight;
-
-                  luminance = (data[0] * Y[0]) + (data[1] * Y[1]) + (data[2] * Y[2]);
-                  VALUE (5, luminance) += weight;
-
-                  data += n_components;
-                }
-              break;
-            }
-        }
+      for (j = 0; j < n_values; j++)
+        priv->values[j] += values[j];
+
+      g_free (context.values[i]);
     }
 
+  priv->approximate = FALSE;
+  priv->error       = 0.0;
+
   g_object_notify (G_OBJECT (histogram), "values");
 
   g_object_thaw_notify (G_OBJECT (histogram));
 
-#undef VALUE
+  return TRUE;
+}
+
+/**
+ * gimp_histogram_set_incremental:
+ * @histogram:   a %GimpHistogram
+ * @incremental: whether to keep sub-histograms for later calculations
+ *
+ * Makes gimp_histogram_calculate() keep the sub-histograms of blocks
+ * of tiles, so that calculating the histogram of the same buffer
+ * again only looks at the blocks that were passed to
+ * gimp_histogram_invalidate() in the meantime. This costs some memory
+ * per block and is meant for histograms which are kept up to date
+ * while the buffer is being edited.
+ **/
+void
+gimp_histogram_set_incremental (GimpHistogram *histogram,
+                                gboolean       incremental)
+{
+  g_return_if_fail (GIMP_IS_HISTOGRAM (histogram));
+
+  histogram->priv->incremental = incremental ? TRUE : FALSE;
+
+  if (! incremental)
+    gimp_histogram_clear_cache (histogram);
+}
+
+/**
+ * gimp_histogram_invalidate:
+ * @histogram: a %GimpHistogram
+ * @rect:      the changed area of the buffer, or %NULL
+ *
+ * Tells an incremental @histogram that @rect of the buffer it was
+ * calculated from has changed, in buffer coordinates. Passing %NULL
+ * makes the next calculation start over, for changes that aren't
+ * limited to an area, like a changed selection.
+ **/
+void
+gimp_histogram_invalidate (GimpHistogram       *histogram,
+                           const GeglRectangle *rect)
+{
+  HistogramCache *cache;
+  gint            col1, col2;
+  gint            row1, row2;
+  gint            col, row;
+
+  g_return_if_fail (GIMP_IS_HISTOGRAM (histogram));
+
+  cache = histogram->priv->cache;
+
+  if (! cache)
+    return;
+
+  if (! rect)
+    {
+      gimp_histogram_clear_cache (histogram);
+
+      return;
+    }
+
+  if (rect->width <= 0 || rect->height <= 0)
+    return;
+
+  col1 = MAX (rect->x / cache->block_width - cache->first_col, 0);
+  row1 = MAX (rect->y / cache->block_height - cache->first_row, 0);
+  col2 = MIN ((rect->x + rect->width - 1) / cache->block_width -
+              cache->first_col,
+              cache->n_cols - 1);
+  row2 = MIN ((rect->y + rect->height - 1) / cache->block_height -
+              cache->first_row,
+              cache->n_blocks / cache->n_cols - 1);
+
+  for (row = row1; row <= row2; row++)
+    for (col = col1; col <= col2; col++)
+      {
+        gint block = row * cache->n_cols + col;
+
+        /*  take the old contribution of the block out  */
+        if (cache->counted[block])
+          {
+            const gdouble *values = cache->blocks[block];
+            gint           n_values;
+            gint           j;
+
+            n_values = histogram->priv->n_channels * histogram->priv->n_bins;
+
+            for (j = 0; j < n_values; j++)
+              cache->values[j] -= values[j];
+
+            cache->counted[block]  = FALSE;
+            cache->n_counted      -= 1;
+            cache->counted_pixels -=
+              gimp_histogram_cache_get_block (cache, block, NULL);
+          }
+      }
 }
 
 void
@@ -440,6 +648,11 @@ gimp_histogram_clear_values (GimpHistogram *histogram)
 {
   g_return_if_fail (GIMP_IS_HISTOGRAM (histogram));
 
+  gimp_histogram_clear_cache (histogram);
+
+  histogram->priv->approximate = FALSE;
+  histogram->priv->error       = 0.0;
+
   if (histogram->priv->values)
     {
       g_free (histogram->priv->values);
@@ -617,7 +830,8 @@ gdouble
 gimp_histogram_get_mean (GimpHistogram        *histogram,
                          GimpHistogramChannel  channel,
                          gint                  start,
-                         gint                  end)
+                         gint                  end,
+                         gboolean             *approximate)
 {
   GimpHistogramPrivate *priv;
   gint                  i;
@@ -628,6 +842,9 @@ gimp_histogram_get_mean (GimpHistogram        *histogram,
 
   priv = histogram->priv;
 
+  if (approximate)
+    *approximate = priv->approximate;
+
   /*  the gray alpha channel is in slot 1  */
   if (priv->n_channels == 4 && channel == GIMP_HISTOGRAM_ALPHA)
     channel = 1;
@@ -677,7 +894,8 @@ gdouble
 gimp_histogram_get_median (GimpHistogram         *histogram,
                            GimpHistogramChannel   channel,
                            gint                   start,
-                           gint                   end)
+                           gint                   end,
+                           gboolean              *approximate)
 {
   GimpHistogramPrivate *priv;
   gint                  i;
@@ -688,6 +906,9 @@ gimp_histogram_get_median (GimpHistogram         *histogram,
 
   priv = histogram->priv;
 
+  if (approximate)
+    *approximate = priv->approximate;
+
   /*  the gray alpha channel is in slot 1  */
   if (priv->n_channels == 4 && channel == GIMP_HISTOGRAM_ALPHA)
     channel = 1;
@@ -742,7 +963,8 @@ gdouble
 gimp_histogram_get_threshold (GimpHistogram        *histogram,
                               GimpHistogramChannel  channel,
                               gint                  start,
-                              gint                  end)
+                              gint                  end,
+                              gboolean             *approximate)
 {
   GimpHistogramPrivate *priv;
   gint                 i;
@@ -760,6 +982,9 @@ gimp_histogram_get_threshold (GimpHistogram        *histogram,
 
   priv = histogram->priv;
 
+  if (approximate)
+    *approximate = priv->approximate;
+
   /*  the gray alpha channel is in slot 1  */
   if (priv->n_channels == 4 && channel == GIMP_HISTOGRAM_ALPHA)
     channel = 1;
@@ -928,3 +1153,565 @@ gimp_histogram_alloc_values (GimpHistogram *histogram,
               priv->n_channels * priv->n_bins * sizeof (gdouble));
     }
 }
+
+static void
+gimp_histogram_clear_cache (GimpHistogram *histogram)
+{
+  HistogramCache *cache = histogram->priv->cache;
+  gint            k;
+
+  if (! cache)
+    return;
+
+  if (cache->buffer)
+    g_object_remove_weak_pointer (G_OBJECT (cache->buffer),
+                                  (gpointer *) &cache->buffer);
+
+  if (cache->mask)
+    g_object_remove_weak_pointer (G_OBJECT (cache->mask),
+                                  (gpointer *) &cache->mask);
+
+  for (k = 0; k < cache->n_blocks; k++)
+    g_free (cache->blocks[k]);
+
+  g_free (cache->blocks);
+  g_free (cache->counted);
+  g_free (cache->values);
+
+  g_slice_free (HistogramCache, cache);
+
+  histogram->priv->cache = NULL;
+}
+
+static gboolean
+gimp_histogram_cache_matches (HistogramCache         *cache,
+                              const CalculateContext *context)
+{
+  if (! cache                                                   ||
+      ! cache->buffer                                           ||
+      cache->buffer != context->buffer                          ||
+      cache->format != context->format                          ||
+      ! gegl_rectangle_equal (&cache->buffer_rect,
+                              &context->buffer_rect))
+    return FALSE;
+
+  if (cache->has_mask != (context->mask != NULL))
+    return FALSE;
+
+  if (context->mask &&
+      (cache->mask != context->mask ||
+       ! gegl_rectangle_equal (&cache->mask_rect, &context->mask_rect)))
+    return FALSE;
+
+  return TRUE;
+}
+
+static gboolean
+gimp_histogram_calculate_incremental (GimpHistogram    *histogram,
+                                      CalculateContext *context,
+                                      gint64            max_pixels)
+{
+  GimpHistogramPrivate *priv = histogram->priv;
+  HistogramCache       *cache;
+  gint                 *dirty_blocks;
+  gint                  n_dirty_blocks = 0;
+  gint                  n_values;
+  gint                  k;
+  gint                  j;
+
+  if (! gimp_histogram_cache_matches (priv->cache, context))
+    {
+      const GeglRectangle *rect = &context->buffer_rect;
+      gint                 n_rows;
+
+      gimp_histogram_clear_cache (histogram);
+      gimp_histogram_alloc_values (histogram,
+                                   context->n_components, context->n_bins);
+
+      cache = g_slice_new0 (HistogramCache);
+
+      cache->buffer      = context->buffer;
+      cache->buffer_rect = context->buffer_rect;
+      cache->format      = context->format;
+
+      g_object_add_weak_pointer (G_OBJECT (cache->buffer),
+                                 (gpointer *) &cache->buffer);
+
+      if (context->mask)
+        {
+          cache->mask      = context->mask;
+          cache->mask_rect = context->mask_rect;
+          cache->has_mask  = TRUE;
+
+          g_object_add_weak_pointer (G_OBJECT (cache->mask),
+                                     (gpointer *) &cache->mask);
+        }
+
+      cache->block_width  = MAX (HISTOGRAM_BLOCK_SIZE / context->tile_width,
+                                 1) * context->tile_width;
+      cache->block_height = MAX (HISTOGRAM_BLOCK_SIZE / context->tile_height,
+                                 1) * context->tile_height;
+
+      cache->first_col = rect->x / cache->block_width;
+      cache->first_row = rect->y / cache->block_height;
+      cache->n_cols    = (rect->x + rect->width +
+                          cache->block_width - 1) / cache->block_width -
+                         cache->first_col;
+      n_rows           = (rect->y + rect->height +
+                          cache->block_height - 1) / cache->block_height -
+                         cache->first_row;
+      cache->n_blocks  = MAX (cache->n_cols * n_rows, 0);
+
+      cache->blocks  = g_new0 (gdouble *, cache->n_blocks);
+      cache->counted = g_new0 (gboolean,  cache->n_blocks);
+      cache->values  = g_new0 (gdouble,
+                               priv->n_channels * priv->n_bins);
+
+      cache->total_pixels = (gint64) MAX (rect->width,  0) *
+                            (gint64) MAX (rect->height, 0);
+
+      priv->cache = cache;
+    }
+
+  cache    = priv->cache;
+  n_values = priv->n_channels * priv->n_bins;
+
+  dirty_blocks = g_new (gint, cache->n_blocks);
+
+  for (k = 0; k < cache->n_blocks; k++)
+    {
+      if (! cache->counted[k])
+        dirty_blocks[n_dirty_blocks++] = k;
+    }
+
+  /*  if the missing blocks are more than we may look at, pick one at
+   *  random out of each of as many runs of them as we may look at, so
+   *  that the picked blocks spread over the whole buffer
+   */
+  if (max_pixels >= 0 && n_dirty_blocks > 0)
+    {
+      gint64 block_pixels = (gint64) cache->block_width * cache->block_height;
+      gint   n_picked;
+
+      n_picked = MAX (max_pixels / block_pixels, 1);
+
+      if (n_picked < n_dirty_blocks)
+        {
+          for (k = 0; k < n_picked; k++)
+            {
+              gint first = (gint64) k       * n_dirty_blocks / n_picked;
+              gint last  = (gint64) (k + 1) * n_dirty_blocks / n_picked;
+
+              dirty_blocks[k] = dirty_blocks[g_random_int_range (first, last)];
+            }
+
+          n_dirty_blocks = n_picked;
+        }
+    }
+
+  context->cache          = cache;
+  context->dirty_blocks   = dirty_blocks;
+  context->n_dirty_blocks = n_dirty_blocks;
+
+  if (n_dirty_blocks > 0)
+    gimp_parallel_distribute (MIN (n_dirty_blocks,
+                                   GIMP_PARALLEL_MAX_THREADS),
+                              gimp_histogram_calculate_blocks_func,
+                              context);
+
+  for (k = 0; k < n_dirty_blocks; k++)
+    {
+      gint           block  = dirty_blocks[k];
+      const gdouble *values = cache->blocks[block];
+
+      for (j = 0; j < n_values; j++)
+        cache->values[j] += values[j];
+
+      cache->counted[block]  = TRUE;
+      cache->n_counted      += 1;
+      cache->counted_pixels += gimp_histogram_cache_get_block (cache, block,
+                                                               NULL);
+    }
+
+  g_free (dirty_blocks);
+
+  if (cache->n_counted == cache->n_blocks)
+    {
+      memcpy (priv->values, cache->values, n_values * sizeof (gdouble));
+
+      priv->approximate = FALSE;
+      priv->error       = 0.0;
+    }
+  else
+    {
+      /*  scale the known blocks up to the whole area, and bound the
+       *  error of a share of pixels like for a random sample of
+       *  blocks, with the correction for a finite population
+       */
+      gdouble scale = 0.0;
+      gdouble n     = cache->n_counted;
+
+      if (cache->counted_pixels > 0)
+        scale = (gdouble) cache->total_pixels / cache->counted_pixels;
+
+      for (j = 0; j < n_values; j++)
+        priv->values[j] = cache->values[j] * scale;
+
+      priv->approximate = TRUE;
+
+      if (n > 0)
+        priv->error = MIN (1.96 * 0.5 *
+                           sqrt ((1.0 - n / cache->n_blocks) / n), 1.0);
+      else
+        priv->error = 1.0;
+    }
+
+  return ! priv->approximate;
+}
+
+/*  returns the number of pixels of @block inside the buffer rect, and
+ *  the block's area in @area
+ */
+static gint64
+gimp_histogram_cache_get_block (HistogramCache *cache,
+                                gint            block,
+                                GeglRectangle  *area)
+{
+  GeglRectangle rect;
+
+  rect.x      = (cache->first_col + block % cache->n_cols) *
+                cache->block_width;
+  rect.y      = (cache->first_row + block / cache->n_cols) *
+                cache->block_height;
+  rect.width  = cache->block_width;
+  rect.height = cache->block_height;
+
+  if (! gegl_rectangle_intersect (&rect, &rect, &cache->buffer_rect))
+    rect.width = rect.height = 0;
+
+  if (area)
+    *area = rect;
+
+  return (gint64) rect.width * rect.height;
+}
+
+static void
+gimp_histogram_calculate_func (gint     i,
+                               gint     n,
+                               gpointer user_data)
+{
+  CalculateContext *context = user_data;
+  gdouble          *values;
+  gint              k;
+
+  if (i > 0)
+    context->values[i] = g_new0 (gdouble,
+                                 (context->n_components + 2) *
+                                 context->n_bins);
+
+  values = context->values[i];
+
+  for (k = i; k < context->n_areas; k += n)
+    {
+      GeglRectangle area;
+
+      area.x      = (context->first_col + k % context->n_cols) *
+                    context->tile_width;
+      area.y      = (context->first_row + k / context->n_cols) *
+                    context->tile_height;
+      area.width  = context->tile_width;
+      area.height = context->tile_height;
+
+      gimp_histogram_calculate_area (context, values, &area);
+    }
+}
+
+static void
+gimp_histogram_calculate_blocks_func (gint     i,
+                                      gint     n,
+                                      gpointer user_data)
+{
+  CalculateContext *context = user_data;
+  HistogramCache   *cache   = context->cache;
+  gsize             size;
+  gint              k;
+
+  size = sizeof (gdouble) * (context->n_components + 2) * context->n_bins;
+
+  for (k = i; k < context->n_dirty_blocks; k += n)
+    {
+      gint          block = context->dirty_blocks[k];
+      GeglRectangle area;
+
+      if (! cache->blocks[block])
+        cache->blocks[block] = g_malloc (size);
+
+      memset (cache->blocks[block], 0, size);
+
+      if (gimp_histogram_cache_get_block (cache, block, &area) > 0)
+        gimp_histogram_calculate_area (context, cache->blocks[block],
+                                       &area);
+    }
+}
+
+static void
+gimp_histogram_calculate_area (CalculateContext *context,
+                               gdouble          *values,
+                               GeglRectangle    *area)
+{
+  GeglBufferIterator *iter;
+
+  if (! gegl_rectangle_intersect (area, area, &context->buffer_rect))
+    return;
+
+  iter = gegl_buffer_iterator_new (context->buffer, area, 0,
+                                   context->format,
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  if (context->mask)
+    {
+      GeglRectangle mask_area = *area;
+
+      mask_area.x += context->mask_rect.x - context->buffer_rect.x;
+      mask_area.y += context->mask_rect.y - context->buffer_rect.y;
+
+      gegl_buffer_iterator_add (iter, context->mask, &mask_area, 0,
+                                babl_format ("Y float"),
+                                GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+    }
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const gfloat *mask_data = context->mask ? iter->data[1] : NULL;
+
+      if (context->u8)
+        gimp_histogram_calculate_u8 (context, values,
+                                     iter->data[0], mask_data,
+                                     iter->length);
+      else
+        gimp_histogram_calculate_float (context, values,
+                                        iter->data[0], mask_data,
+                                        iter->length);
+    }
+}
+
+/*  the bins of the three colors and the alpha of an RGBA pixel, four
+ *  at a time where SSE2 is available. clamping this way also puts
+ *  NaNs into the first bin.
+ */
+static inline void
+gimp_histogram_get_bins_rgba (const gfloat *pixel,
+                              gfloat        scale,
+                              gint         *bins)
+{
+#if defined(__SSE2__) && defined(__GNUC__) && __GNUC__ >= 4
+  typedef float v4sf __attribute__((vector_size(16)));
+  typedef int   v4si __attribute__((vector_size(16)));
+  const v4sf zero    = { 0.0f,  0.0f,  0.0f,  0.0f  };
+  const v4sf one     = { 1.0f,  1.0f,  1.0f,  1.0f  };
+  v4sf       scalev  = { scale, scale, scale, scale };
+  v4sf       v;
+  v4si       b;
+
+  memcpy (&v, pixel, sizeof (v));
+
+  v = __builtin_ia32_minps (__builtin_ia32_maxps (v, zero), one);
+  b = __builtin_ia32_cvttps2dq (v * scalev);
+
+  memcpy (bins, &b, sizeof (b));
+#else
+  gint c;
+
+  for (c = 0; c < 4; c++)
+    bins[c] = (gint) (CLAMP (pixel[c], 0.0f, 1.0f) * scale);
+#endif
+}
+
+static void
+gimp_histogram_calculate_float (CalculateContext *context,
+                                gdouble          *values,
+                                const gfloat     *data,
+                                const gfloat     *mask_data,
+                                gint              length)
+{
+  const gint     n_bins = context->n_bins;
+  const gfloat   scale  = context->scale;
+  const gdouble *Y      = context->Y;
+  gfloat         max;
+  gfloat         luminance;
+  gint           j;
+
+#define VALUE(c,i) (values[(c) * n_bins + \
+                           (gint) (CLAMP ((i), 0.0f, 1.0f) * scale)])
+#define BIN(c,b)   (values[(c) * n_bins + (b)])
+
+  switch (context->n_components)
+    {
+    case 1:
+      for (j = 0; j < length; j++)
+        {
+          const gdouble masked = mask_data ? mask_data[j] : 1.0;
+
+          VALUE (0, data[0]) += masked;
+
+          data += 1;
+        }
+      break;
+
+    case 2:
+      for (j = 0; j < length; j++)
+        {
+          const gdouble masked = mask_data ? mask_data[j] : 1.0;
+          const gdouble weight = data[1];
+
+          VALUE (0, data[0]) += weight * masked;
+          VALUE (1, data[1]) += masked;
+
+          data += 2;
+        }
+      break;
+
+    case 3: /* calculate separate value values */
+      for (j = 0; j < length; j++)
+        {
+          const gdouble masked = mask_data ? mask_data[j] : 1.0;
+
+          VALUE (1, data[0]) += masked;
+          VALUE (2, data[1]) += masked;
+          VALUE (3, data[2]) += masked;
+
+          max = MAX (data[0], data[1]);
+          max = MAX (data[2], max);
+          VALUE (0, max) += masked;
+
+          luminance = (data[0] * Y[0]) + (data[1] * Y[1]) + (data[2] * Y[2]);
+          VALUE (4, luminance) += masked;
+
+          data += 3;
+        }
+      break;
+
+    case 4: /* calculate separate value values */
+      for (j = 0; j < length; j++)
+        {
+          const gdouble masked = mask_data ? mask_data[j] : 1.0;
+          const gdouble weight = data[3];
+          gint          bins[4];
+
+          gimp_histogram_get_bins_rgba (data, scale, bins);
+
+          BIN (1, bins[0]) += weight * masked;
+          BIN (2, bins[1]) += weight * masked;
+          BIN (3, bins[2]) += weight * masked;
+          BIN (4, bins[3]) += masked;
+
+          /*  the bins are monotonic, so the bin of the maximum is the
+           *  maximum of the bins
+           */
+          BIN (0, MAX (MAX (bins[0], bins[1]), bins[2])) += weight * masked;
+
+          luminance = (data[0] * Y[0]) + (data[1] * Y[1]) + (data[2] * Y[2]);
+          VALUE (5, luminance) += weight * masked;
+
+          data += 4;
+        }
+      break;
+    }
+
+#undef BIN
+#undef VALUE
+}
+
+/*  like gimp_histogram_calculate_float(), for u8 data whose components
+ *  are their own bins
+ */
+static void
+gimp_histogram_calculate_u8 (CalculateContext *context,
+                             gdouble          *values,
+                             const guint8     *data,
+                             const gfloat     *mask_data,
+                             gint              length)
+{
+  const gint     n_bins = context->n_bins;
+  const gfloat   scale  = context->scale;
+  const gdouble *Y      = context->Y;
+  const gfloat  *f      = context->u8_to_float;
+  gfloat         luminance;
+  gint           j;
+
+#define VALUE(c,i) (values[(c) * n_bins + \
+                           (gint) (CLAMP ((i), 0.0f, 1.0f) * scale)])
+#define BIN(c,b)   (values[(c) * n_bins + (b)])
+
+  switch (context->n_components)
+    {
+    case 1:
+      for (j = 0; j < length; j++)
+        {
+          const gdouble masked = mask_data ? mask_data[j] : 1.0;
+
+          BIN (0, data[0]) += masked;
+
+          data += 1;
+        }
+      break;
+
+    case 2:
+      for (j = 0; j < length; j++)
+        {
+          const gdouble masked = mask_data ? mask_data[j] : 1.0;
+          const gdouble weight = f[data[1]];
+
+          BIN (0, data[0]) += weight * masked;
+          BIN (1, data[1]) += masked;
+
+          data += 2;
+        }
+      break;
+
+    case 3:
+      for (j = 0; j < length; j++)
+        {
+          const gdouble masked = mask_data ? mask_data[j] : 1.0;
+
+          BIN (1, data[0]) += masked;
+          BIN (2, data[1]) += masked;
+          BIN (3, data[2]) += masked;
+
+          BIN (0, MAX (MAX (data[0], data[1]), data[2])) += masked;
+
+          luminance = (f[data[0]] * Y[0] +
+                       f[data[1]] * Y[1] +
+                       f[data[2]] * Y[2]);
+          VALUE (4, luminance) += masked;
+
+          data += 3;
+        }
+      break;
+
+    case 4:
+      for (j = 0; j < length; j++)
+        {
+          const gdouble masked = mask_data ? mask_data[j] : 1.0;
+          const gdouble weight = f[data[3]];
+
+          BIN (1, data[0]) += weight * masked;
+          BIN (2, data[1]) += weight * masked;
+          BIN (3, data[2]) += weight * masked;
+          BIN (4, data[3]) += masked;
+
+          BIN (0, MAX (MAX (data[0], data[1]), data[2])) += weight * masked;
+
+          luminance = (f[data[0]] * Y[0] +
+                       f[data[1]] * Y[1] +
+                       f[data[2]] * Y[2]);
+          VALUE (5, luminance) += weight * masked;
+
+          data += 4;
+        }
+      break;
+    }
+
+#undef BIN
+#undef VALUE
+}
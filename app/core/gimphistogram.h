@@ -59,6 +59,22 @@ void            gimp_histogram_calculate     (GimpHistogram        *histogram,
                                               const GeglRectangle  *buffer_rect,
                                               GeglBuffer           *mask,
                                               const GeglRectangle  *mask_rect);
+gboolean        gimp_histogram_calculate_approximate
+                                             (GimpHistogram        *histogram,
+                                              GeglBuffer           *buffer,
+                                              const GeglRectangle  *buffer_rect,
+                                              GeglBuffer           *mask,
+                                              const GeglRectangle  *mask_rect,
+                                              gint64                max_pixels);
+gboolean        gimp_histogram_is_approximate
+                                             (GimpHistogram        *histogram,
+                                              gdouble              *error);
+
+void            gimp_histogram_set_incremental
+                                             (GimpHistogram        *histogram,
+                                              gboolean              incremental);
+void            gimp_histogram_invalidate    (GimpHistogram        *histogram,
+                                              const GeglRectangle  *rect);
 
 void            gimp_histogram_clear_values  (GimpHistogram        *histogram);
 
@@ -71,11 +87,13 @@ gdouble         gimp_histogram_get_count     (GimpHistogram        *histogram,
 gdouble         gimp_histogram_get_mean      (GimpHistogram        *histogram,
                                               GimpHistogramChannel  channel,
                                               gint                  start,
-                                              gint                  end);
+                                              gint                  end,
+                                              gboolean             *approximate);
 gdouble         gimp_histogram_get_median    (GimpHistogram        *histogram,
                                               GimpHistogramChannel  channel,
                                               gint                  start,
-                                              gint                  end);
+                                              gint                  end,
+                                              gboolean             *approximate);
 gdouble         gimp_histogram_get_std_dev   (GimpHistogram        *histogram,
                                               GimpHistogramChannel  channel,
                                               gint                  start,
@@ -83,7 +101,8 @@ gdouble         gimp_histogram_get_std_dev   (GimpHistogram        *histogram,
 gdouble         gimp_histogram_get_threshold (GimpHistogram        *histogram,
                                               GimpHistogramChannel  channel,
                                               gint                  start,
-                                              gint                  end);
+                                              gint                  end,
+                                              gboolean             *approximate);
 gdouble         gimp_histogram_get_value     (GimpHistogram        *histogram,
                                               GimpHistogramChannel  channel,
                                               gint                  bin);
@@ -385,8 +385,7 @@ gimp_image_duplicate_mask (GimpImage *image,
   gegl_buffer_copy (gimp_drawable_get_buffer (mask), NULL, GEGL_ABYSS_NONE,
                     gimp_drawable_get_buffer (new_mask), NULL);
 
-  GIMP_CHANNEL (new_mask)->bounds_known   = FALSE;
-  GIMP_CHANNEL (new_mask)->boundary_known = FALSE;
+  gimp_channel_invalidate_bounds (GIMP_CHANNEL (new_mask));
 }
 
 static void
@@ -20,6 +20,8 @@
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gegl.h>
 
+#include "libgimpconfig/gimpconfig.h"
+
 #include "core-types.h"
 
 #include "config/gimpcoreconfig.h"
@@ -37,11 +39,13 @@
 
 /*  local function prototypes  */
 
-static void          gimp_image_undo_pop_stack       (GimpImage     *image,
+static gboolean      gimp_image_undo_pop_stack       (GimpImage     *image,
                                                       GimpUndoStack *undo_stack,
                                                       GimpUndoStack *redo_stack,
                                                       GimpUndoMode   undo_mode);
 static void          gimp_image_undo_free_space      (GimpImage     *image);
+static void          gimp_image_undo_swap_out        (GimpImage     *image);
+static void          gimp_image_undo_free_bottom     (GimpImage     *image);
 static void          gimp_image_undo_free_redo       (GimpImage     *image);
 
 static GimpDirtyMask gimp_image_undo_dirty_from_type (GimpUndoType   undo_type);
@@ -124,12 +128,10 @@ gimp_image_undo (GimpImage *image)
   g_return_val_if_fail (private->pushing_undo_group == GIMP_UNDO_GROUP_NONE,
                         FALSE);
 
-  gimp_image_undo_pop_stack (image,
-                             private->undo_stack,
-                             private->redo_stack,
-                             GIMP_UNDO_MODE_UNDO);
-
-  return TRUE;
+  return gimp_image_undo_pop_stack (image,
+                                    private->undo_stack,
+                                    private->redo_stack,
+                                    GIMP_UNDO_MODE_UNDO);
 }
 
 gboolean
@@ -144,12 +146,10 @@ gimp_image_redo (GimpImage *image)
   g_return_val_if_fail (private->pushing_undo_group == GIMP_UNDO_GROUP_NONE,
                         FALSE);
 
-  gimp_image_undo_pop_stack (image,
-                             private->redo_stack,
-                             private->undo_stack,
-                             GIMP_UNDO_MODE_REDO);
-
-  return TRUE;
+  return gimp_image_undo_pop_stack (image,
+                                    private->redo_stack,
+                                    private->undo_stack,
+                                    GIMP_UNDO_MODE_REDO);
 }
 
 /*
@@ -171,13 +171,14 @@ gimp_image_strong_undo (GimpImage *image)
 
   undo = gimp_undo_stack_peek (private->undo_stack);
 
-  gimp_image_undo (image);
+  if (! gimp_image_undo (image))
+    return FALSE;
 
   while (gimp_undo_is_weak (undo))
     {
       undo = gimp_undo_stack_peek (private->undo_stack);
-      if (gimp_undo_is_weak (undo))
-        gimp_image_undo (image);
+      if (gimp_undo_is_weak (undo) && ! gimp_image_undo (image))
+        break;
     }
 
   return TRUE;
@@ -204,13 +205,14 @@ gimp_image_strong_redo (GimpImage *image)
 
   undo = gimp_undo_stack_peek (private->redo_stack);
 
-  gimp_image_redo (image);
+  if (! gimp_image_redo (image))
+    return FALSE;
 
   while (gimp_undo_is_weak (undo))
     {
       undo = gimp_undo_stack_peek (private->redo_stack);
-      if (gimp_undo_is_weak (undo))
-        gimp_image_redo (image);
+      if (gimp_undo_is_weak (undo) && ! gimp_image_redo (image))
+        break;
     }
 
   return TRUE;
@@ -263,6 +265,57 @@ gimp_image_undo_free (GimpImage *image)
    */
 }
 
+/**
+ * gimp_image_undo_memsize_changed:
+ * @image: a #GimpImage
+ * @undo:  an undo of @image, possibly inside an undo group
+ *
+ * Updates the undo memory totals of @image after the size of @undo
+ * changed while it was on the undo or redo stack.
+ **/
+void
+gimp_image_undo_memsize_changed (GimpImage *image,
+                                 GimpUndo  *undo)
+{
+  GimpImagePrivate *private;
+  GimpUndoStack    *stacks[2];
+  gint              i;
+
+  g_return_if_fail (GIMP_IS_IMAGE (image));
+  g_return_if_fail (GIMP_IS_UNDO (undo));
+
+  private = GIMP_IMAGE_GET_PRIVATE (image);
+
+  stacks[0] = private->undo_stack;
+  stacks[1] = private->redo_stack;
+
+  for (i = 0; i < G_N_ELEMENTS (stacks); i++)
+    {
+      GList *list;
+
+      if (gimp_container_have (stacks[i]->undos, GIMP_OBJECT (undo)))
+        {
+          gimp_undo_stack_update_undo (stacks[i], undo);
+          return;
+        }
+
+      for (list = GIMP_LIST (stacks[i]->undos)->queue->head;
+           list;
+           list = g_list_next (list))
+        {
+          GimpUndoStack *group = list->data;
+
+          if (GIMP_IS_UNDO_STACK (group) &&
+              gimp_container_have (group->undos, GIMP_OBJECT (undo)))
+            {
+              gimp_undo_stack_update_undo (group, undo);
+              gimp_undo_stack_update_undo (stacks[i], GIMP_UNDO (group));
+              return;
+            }
+        }
+    }
+}
+
 gint
 gimp_image_get_undo_group_count (GimpImage *image)
 {
@@ -421,6 +474,8 @@ gimp_image_undo_push (GimpImage     *image,
       undo_group = GIMP_UNDO_STACK (gimp_undo_stack_peek (private->undo_stack));
 
       gimp_undo_stack_push_undo (undo_group, undo);
+      gimp_undo_stack_update_undo (private->undo_stack,
+                                   GIMP_UNDO (undo_group));
 
       return undo;
     }
@@ -485,7 +540,7 @@ gimp_image_undo_get_fadeable (GimpImage *image)
 
 /*  private functions  */
 
-static void
+static gboolean
 gimp_image_undo_pop_stack (GimpImage     *image,
                            GimpUndoStack *undo_stack,
                            GimpUndoStack *redo_stack,
@@ -498,6 +553,18 @@ gimp_image_undo_pop_stack (GimpImage     *image,
 
   undo = gimp_undo_stack_pop_undo (undo_stack, undo_mode, &accum);
 
+  if (undo && accum.failed)
+    {
+      /*  the step couldn't be popped, leave it where it was so undoing
+       *  (or redoing) stops there
+       */
+      gimp_undo_stack_push_undo (undo_stack, undo);
+
+      g_object_thaw_notify (G_OBJECT (image));
+
+      return FALSE;
+    }
+
   if (undo)
     {
       if (GIMP_IS_UNDO_STACK (undo))
@@ -532,55 +599,136 @@ gimp_image_undo_pop_stack (GimpImage     *image,
     }
 
   g_object_thaw_notify (G_OBJECT (image));
+
+  return TRUE;
 }
 
 static void
 gimp_image_undo_free_space (GimpImage *image)
 {
   GimpImagePrivate *private = GIMP_IMAGE_GET_PRIVATE (image);
+  GimpUndoStack    *undo_stack;
   GimpContainer    *container;
   gint              min_undo_levels;
   gint              max_undo_levels;
   gint64            undo_size;
+  gint64            undo_swap_size;
 
-  container = private->undo_stack->undos;
+  undo_stack = private->undo_stack;
+  container  = undo_stack->undos;
 
   min_undo_levels = image->gimp->config->levels_of_undo;
   max_undo_levels = 1024; /* FIXME */
   undo_size       = image->gimp->config->undo_size;
+  undo_swap_size  = image->gimp->config->undo_swap_size;
 
 #ifdef DEBUG_IMAGE_UNDO
   g_printerr ("undo_steps: %d    undo_bytes: %ld\n",
               gimp_container_get_n_children (container),
-              (glong) gimp_object_get_memsize (GIMP_OBJECT (container), NULL));
+              (glong) gimp_object_get_memsize (GIMP_OBJECT (undo_stack), NULL));
 #endif
 
   /*  keep at least min_undo_levels undo steps  */
   if (gimp_container_get_n_children (container) <= min_undo_levels)
     return;
 
-  while ((gimp_object_get_memsize (GIMP_OBJECT (container), NULL) > undo_size) ||
-         (gimp_container_get_n_children (container) > max_undo_levels))
+  if (undo_swap_size > 0 &&
+      gimp_object_get_memsize (GIMP_OBJECT (undo_stack), NULL) > undo_size)
     {
-      GimpUndo *freed = gimp_undo_stack_free_bottom (private->undo_stack,
-                                                     GIMP_UNDO_MODE_UNDO);
-
-#ifdef DEBUG_IMAGE_UNDO
-      g_printerr ("freed one step: undo_steps: %d    undo_bytes: %ld\n",
-                  gimp_container_get_n_children (container),
-                  (glong) gimp_object_get_memsize (GIMP_OBJECT (container),
-                                                   NULL));
-#endif
-
-      gimp_image_undo_event (image, GIMP_UNDO_EVENT_UNDO_EXPIRED, freed);
+      gimp_image_undo_swap_out (image);
+    }
 
-      g_object_unref (freed);
+  while ((gimp_object_get_memsize (GIMP_OBJECT (undo_stack), NULL) > undo_size) ||
+         (gimp_container_get_n_children (container) > max_undo_levels)         ||
+         (undo_stack->swap_size > undo_swap_size))
+    {
+      gimp_image_undo_free_bottom (image);
 
       if (gimp_container_get_n_children (container) <= min_undo_levels)
         return;
     }
 }
 
+static void
+gimp_image_undo_swap_out (GimpImage *image)
+{
+  GimpImagePrivate *private    = GIMP_IMAGE_GET_PRIVATE (image);
+  GimpUndoStack    *undo_stack = private->undo_stack;
+  GimpCoreConfig   *config     = image->gimp->config;
+  gchar            *path;
+  GList            *list;
+  gint              n;
+
+  path = gimp_config_path_expand (GIMP_GEGL_CONFIG (config)->swap_path,
+                                  TRUE, NULL);
+
+  if (! path)
+    return;
+
+  n = gimp_container_get_n_children (undo_stack->undos);
+
+  /*  move the oldest steps to disk, but keep the min_undo_levels newest
+   *  ones in memory.  when the swap space is full, the oldest swapped
+   *  steps make room for the next one, so the history is kept as long
+   *  as possible.  the steps no longer count as memory right away, the
+   *  actual writing happens in the background.
+   */
+  for (list = GIMP_LIST (undo_stack->undos)->queue->tail;
+       list && n > config->levels_of_undo;
+       list = g_list_previous (list), n--)
+    {
+      GimpUndo *undo = list->data;
+
+      if (gimp_object_get_memsize (GIMP_OBJECT (undo_stack), NULL) <=
+          config->undo_size)
+        break;
+
+      if (undo->swap_size > 0)
+        continue;
+
+      /*  the undo's memory is a bound for what it takes on disk  */
+      if (undo->memsize > config->undo_swap_size)
+        break;
+
+      /*  all steps below this one are swapped out already  */
+      while (undo_stack->swap_size + undo->memsize > config->undo_swap_size &&
+             gimp_container_get_last_child (undo_stack->undos) !=
+             GIMP_OBJECT (undo))
+        {
+          gimp_image_undo_free_bottom (image);
+        }
+
+      if (undo_stack->swap_size + undo->memsize > config->undo_swap_size)
+        break;
+
+      gimp_undo_swap_out (undo, path);
+      gimp_undo_stack_update_undo (undo_stack, undo);
+    }
+
+  g_free (path);
+}
+
+static void
+gimp_image_undo_free_bottom (GimpImage *image)
+{
+  GimpImagePrivate *private    = GIMP_IMAGE_GET_PRIVATE (image);
+  GimpUndoStack    *undo_stack = private->undo_stack;
+  GimpUndo         *freed;
+
+  freed = gimp_undo_stack_free_bottom (undo_stack, GIMP_UNDO_MODE_UNDO);
+
+#ifdef DEBUG_IMAGE_UNDO
+  g_printerr ("freed one step: undo_steps: %d    undo_bytes: %ld\n",
+              gimp_container_get_n_children (undo_stack->undos),
+              (glong) gimp_object_get_memsize (GIMP_OBJECT (undo_stack),
+                                               NULL));
+#endif
+
+  gimp_image_undo_event (image, GIMP_UNDO_EVENT_UNDO_EXPIRED, freed);
+
+  g_object_unref (freed);
+}
+
 static void
 gimp_image_undo_free_redo (GimpImage *image)
 {
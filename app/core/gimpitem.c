@@ -157,6 +157,12 @@ static void       gimp_item_real_resize             (GimpItem       *item,
                                                      gint            offset_x,
                                                      gint            offset_y);
 
+static gboolean   gimp_item_selection_bounds        (GimpChannel    *selection,
+                                                     gint           *x,
+                                                     gint           *y,
+                                                     gint           *width,
+                                                     gint           *height);
+
 
 
 G_DEFINE_TYPE (GimpItem, gimp_item, GIMP_TYPE_FILTER)
@@ -645,6 +651,29 @@ gimp_item_real_resize (GimpItem     *item,
                         private->offset_y - offset_y);
 }
 
+static gboolean
+gimp_item_selection_bounds (GimpChannel *selection,
+                            gint        *x,
+                            gint        *y,
+                            gint        *width,
+                            gint        *height)
+{
+  /*  a fully selected mask covers the whole image, which the tile
+   *  summary tells without finding the bounds pixel by pixel
+   */
+  if (! selection->bounds_known && gimp_channel_is_full (selection))
+    {
+      *x      = 0;
+      *y      = 0;
+      *width  = gimp_item_get_width  (GIMP_ITEM (selection));
+      *height = gimp_item_get_height (GIMP_ITEM (selection));
+
+      return TRUE;
+    }
+
+  return gimp_item_bounds (GIMP_ITEM (selection), x, y, width, height);
+}
+
 
 /*  public functions  */
 
@@ -2282,7 +2311,7 @@ gimp_item_mask_bounds (GimpItem *item,
    */
   if (GIMP_ITEM (selection) != item       &&
       ! gimp_channel_is_empty (selection) &&
-      gimp_item_bounds (GIMP_ITEM (selection), &x, &y, &width, &height))
+      gimp_item_selection_bounds (selection, &x, &y, &width, &height))
     {
       gint off_x, off_y;
       gint x2, y2;
@@ -2356,8 +2385,8 @@ gimp_item_mask_intersect (GimpItem *item,
    */
   if (GIMP_ITEM (selection) != item       &&
       ! gimp_channel_is_empty (selection) &&
-      gimp_item_bounds (GIMP_ITEM (selection),
-                        &tmp_x, &tmp_y, &tmp_width, &tmp_height))
+      gimp_item_selection_bounds (selection,
+                                  &tmp_x, &tmp_y, &tmp_width, &tmp_height))
     {
       gint off_x, off_y;
 
@@ -33,6 +33,7 @@
 #include "gimpitem.h"
 #include "gimpitemstack.h"
 #include "gimpitemtree.h"
+#include "gimpnameindex.h"
 
 
 enum
@@ -49,14 +50,15 @@ typedef struct _GimpItemTreePrivate GimpItemTreePrivate;
 
 struct _GimpItemTreePrivate
 {
-  GimpImage  *image;
+  GimpImage     *image;
 
-  GType       container_type;
-  GType       item_type;
+  GType          container_type;
+  GType          item_type;
 
-  GimpItem   *active_item;
+  GimpItem      *active_item;
 
-  GHashTable *name_hash;
+  GHashTable    *name_hash;
+  GimpNameIndex *name_index;
 };
 
 #define GIMP_ITEM_TREE_GET_PRIVATE(object) \
@@ -84,6 +86,8 @@ static gint64   gimp_item_tree_get_memsize   (GimpObject   *object,
 static void     gimp_item_tree_uniquefy_name (GimpItemTree *tree,
                                               GimpItem     *item,
                                               const gchar  *new_name);
+static void     gimp_item_tree_name_remove   (GimpItemTree *tree,
+                                              GimpItem     *item);
 
 
 G_DEFINE_TYPE (GimpItemTree, gimp_item_tree, GIMP_TYPE_OBJECT)
@@ -139,7 +143,8 @@ gimp_item_tree_init (GimpItemTree *tree)
 {
   GimpItemTreePrivate *private = GIMP_ITEM_TREE_GET_PRIVATE (tree);
 
-  private->name_hash = g_hash_table_new (g_str_hash, g_str_equal);
+  private->name_hash  = g_hash_table_new (g_str_hash, g_str_equal);
+  private->name_index = gimp_name_index_new ();
 }
 
 static void
@@ -159,6 +164,7 @@ gimp_item_tree_constructed (GObject *object)
                                   "name",          g_type_name (private->item_type),
                                   "children-type", private->item_type,
                                   "policy",        GIMP_CONTAINER_POLICY_STRONG,
+                                  "indexed",       TRUE,
                                   NULL);
 }
 
@@ -174,6 +180,12 @@ gimp_item_tree_finalize (GObject *object)
       private->name_hash = NULL;
     }
 
+  if (private->name_index)
+    {
+      gimp_name_index_free (private->name_index);
+      private->name_index = NULL;
+    }
+
   if (tree->container)
     {
       g_object_unref (tree->container);
@@ -245,11 +257,14 @@ static gint64
 gimp_item_tree_get_memsize (GimpObject *object,
                             gint64     *gui_size)
 {
-  GimpItemTree *tree    = GIMP_ITEM_TREE (object);
-  gint64        memsize = 0;
+  GimpItemTree        *tree    = GIMP_ITEM_TREE (object);
+  GimpItemTreePrivate *private = GIMP_ITEM_TREE_GET_PRIVATE (tree);
+  gint64               memsize = 0;
 
   memsize += gimp_object_get_memsize (GIMP_OBJECT (tree->container), gui_size);
 
+  memsize += gimp_name_index_get_memsize (private->name_index);
+
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
 }
@@ -477,8 +492,7 @@ gimp_item_tree_remove_item (GimpItemTree *tree,
 
   g_object_ref (item);
 
-  g_hash_table_remove (private->name_hash,
-                       gimp_object_get_name (item));
+  gimp_item_tree_name_remove (tree, item);
 
   children = gimp_viewable_get_children (GIMP_VIEWABLE (item));
 
@@ -488,8 +502,7 @@ gimp_item_tree_remove_item (GimpItemTree *tree,
 
       while (list)
         {
-          g_hash_table_remove (private->name_hash,
-                               gimp_object_get_name (list->data));
+          gimp_item_tree_name_remove (tree, list->data);
 
           list = g_list_remove (list, list->data);
         }
@@ -640,8 +653,7 @@ gimp_item_tree_uniquefy_name (GimpItemTree *tree,
 
   if (new_name)
     {
-      g_hash_table_remove (private->name_hash,
-                           gimp_object_get_name (item));
+      gimp_item_tree_name_remove (tree, item);
 
       gimp_object_set_name (GIMP_OBJECT (item), new_name);
     }
@@ -657,13 +669,17 @@ gimp_item_tree_uniquefy_name (GimpItemTree *tree,
   if (g_hash_table_lookup (private->name_hash,
                            gimp_object_get_name (item)))
     {
+      static GRegex *end_numbers = NULL;
+
       gchar      *name        = g_strdup (gimp_object_get_name (item));
       gchar      *new_name    = NULL;
       gint        number      = 0;
       gint        precision   = 1;
-      GRegex     *end_numbers = g_regex_new (" ?#([0-9]+)\\s*$", 0, 0, NULL);
       GMatchInfo *match_info  = NULL;
 
+      if (! end_numbers)
+        end_numbers = g_regex_new (" ?#([0-9]+)\\s*$", 0, 0, NULL);
+
       if (g_regex_match (end_numbers, name, 0, &match_info))
         {
           gchar *match;
@@ -682,11 +698,15 @@ gimp_item_tree_uniquefy_name (GimpItemTree *tree,
           name[start_pos] = '\0';
         }
       g_match_info_free (match_info);
-      g_regex_unref (end_numbers);
 
+      /*  the name index skips all numbers that are known to be taken,
+       *  so adding many items of the same name doesn't try all the
+       *  names before them
+       */
       do
         {
-          number++;
+          number = gimp_name_index_next_number (private->name_index,
+                                                name, precision, number);
 
           g_free (new_name);
 
@@ -705,4 +725,21 @@ gimp_item_tree_uniquefy_name (GimpItemTree *tree,
   g_hash_table_insert (private->name_hash,
                        (gpointer) gimp_object_get_name (item),
                        item);
+
+  gimp_name_index_add (private->name_index, gimp_object_get_name (item));
+}
+
+static void
+gimp_item_tree_name_remove (GimpItemTree *tree,
+                            GimpItem     *item)
+{
+  GimpItemTreePrivate *private = GIMP_ITEM_TREE_GET_PRIVATE (tree);
+  const gchar         *name    = gimp_object_get_name (item);
+
+  if (g_hash_table_lookup (private->name_hash, name) == item)
+    {
+      gimp_name_index_remove (private->name_index, name);
+
+      g_hash_table_remove (private->name_hash, name);
+    }
 }
@@ -1665,7 +1665,7 @@ gimp_layer_create_mask (GimpLayer       *layer,
                                               copy_y - offset_y,
                                               0, 0));
 
-            GIMP_CHANNEL (mask)->bounds_known = FALSE;
+            gimp_channel_invalidate_bounds (GIMP_CHANNEL (mask));
           }
       }
       break;
@@ -1718,7 +1718,7 @@ gimp_layer_create_mask (GimpLayer       *layer,
         g_object_unref (src_buffer);
       }
 
-      GIMP_CHANNEL (mask)->bounds_known = FALSE;
+      gimp_channel_invalidate_bounds (GIMP_CHANNEL (mask));
       break;
     }
 
@@ -160,6 +160,7 @@ gimp_layer_stack_new (GType layer_type)
                        "name",          g_type_name (layer_type),
                        "children-type", layer_type,
                        "policy",        GIMP_CONTAINER_POLICY_STRONG,
+                       "indexed",       TRUE,
                        NULL);
 }
 
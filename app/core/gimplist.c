@@ -29,6 +29,7 @@
 
 #include "gimp-memsize.h"
 #include "gimplist.h"
+#include "gimpnameindex.h"
 
 
 enum
@@ -36,10 +37,30 @@ enum
   PROP_0,
   PROP_UNIQUE_NAMES,
   PROP_SORT_FUNC,
-  PROP_APPEND
+  PROP_APPEND,
+  PROP_INDEXED
 };
 
 
+typedef struct _GimpListEntry GimpListEntry;
+typedef struct _GimpListName  GimpListName;
+
+struct _GimpListEntry
+{
+  GimpObject    *object;
+  GList         *link;
+  gint           index;
+  gchar         *name;   /*  the name the child is indexed by  */
+};
+
+struct _GimpListName
+{
+  GimpListEntry *first;
+  gint           count;
+};
+
+
+static void         gimp_list_constructed        (GObject       *object);
 static void         gimp_list_finalize           (GObject       *object);
 static void         gimp_list_set_property       (GObject       *object,
                                                   guint          property_id,
@@ -73,11 +94,36 @@ static GimpObject * gimp_list_get_child_by_index (GimpContainer *container,
 static gint         gimp_list_get_child_index    (GimpContainer *container,
                                                   GimpObject    *object);
 
+static gboolean     gimp_list_name_is_taken      (GimpList      *gimp_list,
+                                                  GimpObject    *object,
+                                                  const gchar   *name);
 static void         gimp_list_uniquefy_name      (GimpList      *gimp_list,
                                                   GimpObject    *object);
 static void         gimp_list_object_renamed     (GimpObject    *object,
                                                   GimpList      *list);
 
+static gint         gimp_list_index_find_sorted  (GimpList      *list,
+                                                  GimpObject    *object);
+static void         gimp_list_index_insert       (GimpList      *list,
+                                                  GimpObject    *object,
+                                                  gint           index);
+static void         gimp_list_index_remove       (GimpList      *list,
+                                                  GimpListEntry *entry);
+static void         gimp_list_index_renumber     (GimpList      *list,
+                                                  gint           first,
+                                                  gint           last);
+static void         gimp_list_index_rebuild      (GimpList      *list);
+static void         gimp_list_name_add           (GimpList      *list,
+                                                  GimpListEntry *entry);
+static void         gimp_list_name_remove        (GimpList      *list,
+                                                  GimpListEntry *entry);
+static void         gimp_list_name_find_first    (GimpList      *list,
+                                                  GimpListName  *name,
+                                                  const gchar   *string,
+                                                  GimpListEntry *exclude);
+static void         gimp_list_entry_free         (GimpListEntry *entry);
+static void         gimp_list_name_free          (GimpListName  *name);
+
 
 G_DEFINE_TYPE (GimpList, gimp_list, GIMP_TYPE_CONTAINER)
 
@@ -91,6 +137,7 @@ gimp_list_class_init (GimpListClass *klass)
   GimpObjectClass    *gimp_object_class = GIMP_OBJECT_CLASS (klass);
   GimpContainerClass *container_class   = GIMP_CONTAINER_CLASS (klass);
 
+  object_class->constructed           = gimp_list_constructed;
   object_class->finalize              = gimp_list_finalize;
   object_class->set_property          = gimp_list_set_property;
   object_class->get_property          = gimp_list_get_property;
@@ -126,6 +173,13 @@ gimp_list_class_init (GimpListClass *klass)
                                                          FALSE,
                                                          GIMP_PARAM_READWRITE |
                                                          G_PARAM_CONSTRUCT));
+
+  g_object_class_install_property (object_class, PROP_INDEXED,
+                                   g_param_spec_boolean ("indexed",
+                                                         NULL, NULL,
+                                                         FALSE,
+                                                         GIMP_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT_ONLY));
 }
 
 static void
@@ -135,6 +189,40 @@ gimp_list_init (GimpList *list)
   list->unique_names = FALSE;
   list->sort_func    = NULL;
   list->append       = FALSE;
+  list->indexed      = FALSE;
+}
+
+static void
+gimp_list_constructed (GObject *object)
+{
+  GimpList *list = GIMP_LIST (object);
+
+  G_OBJECT_CLASS (parent_class)->constructed (object);
+
+  /*  an indexed list keeps an array of its children's positions and
+   *  hashes of its children and their names next to the queue, which
+   *  makes looking up children by index or name, and the index of a
+   *  child, O(1), at the cost of renumbering entries when the list
+   *  changes.
+   */
+  if (list->indexed)
+    {
+      list->entries = g_ptr_array_new ();
+      list->objects = g_hash_table_new_full (g_direct_hash,
+                                             g_direct_equal,
+                                             NULL,
+                                             (GDestroyNotify) gimp_list_entry_free);
+      list->names   = g_hash_table_new_full (g_str_hash,
+                                             g_str_equal,
+                                             g_free,
+                                             (GDestroyNotify) gimp_list_name_free);
+
+      /*  and keeps track of the numbers used by "<name> #<n>" names,
+       *  so making names unique doesn't have to try them one by one
+       */
+      if (list->unique_names)
+        list->name_index = gimp_name_index_new ();
+    }
 }
 
 static void
@@ -148,6 +236,30 @@ gimp_list_finalize (GObject *object)
       list->queue = NULL;
     }
 
+  if (list->entries)
+    {
+      g_ptr_array_free (list->entries, TRUE);
+      list->entries = NULL;
+    }
+
+  if (list->names)
+    {
+      g_hash_table_unref (list->names);
+      list->names = NULL;
+    }
+
+  if (list->objects)
+    {
+      g_hash_table_unref (list->objects);
+      list->objects = NULL;
+    }
+
+  if (list->name_index)
+    {
+      gimp_name_index_free (list->name_index);
+      list->name_index = NULL;
+    }
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -170,6 +282,9 @@ gimp_list_set_property (GObject      *object,
     case PROP_APPEND:
       list->append = g_value_get_boolean (value);
       break;
+    case PROP_INDEXED:
+      list->indexed = g_value_get_boolean (value);
+      break;
 
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -196,6 +311,9 @@ gimp_list_get_property (GObject    *object,
     case PROP_APPEND:
       g_value_set_boolean (value, list->append);
       break;
+    case PROP_INDEXED:
+      g_value_set_boolean (value, list->indexed);
+      break;
 
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -222,6 +340,36 @@ gimp_list_get_memsize (GimpObject *object,
       memsize += gimp_g_queue_get_memsize (list->queue, 0);
     }
 
+  if (list->indexed)
+    {
+      GHashTableIter iter;
+      gpointer       key;
+      gint           i;
+
+      memsize += (sizeof (GPtrArray) +
+                  list->entries->len * sizeof (gpointer));
+
+      memsize += gimp_g_hash_table_get_memsize (list->objects,
+                                                sizeof (GimpListEntry));
+      memsize += gimp_g_hash_table_get_memsize (list->names,
+                                                sizeof (GimpListName));
+
+      for (i = 0; i < list->entries->len; i++)
+        {
+          GimpListEntry *entry = g_ptr_array_index (list->entries, i);
+
+          memsize += gimp_string_get_memsize (entry->name);
+        }
+
+      g_hash_table_iter_init (&iter, list->names);
+
+      while (g_hash_table_iter_next (&iter, &key, NULL))
+        memsize += gimp_string_get_memsize (key);
+
+      if (list->name_index)
+        memsize += gimp_name_index_get_memsize (list->name_index);
+    }
+
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
 }
@@ -245,12 +393,25 @@ gimp_list_add (GimpContainer *container,
   if (list->unique_names)
     gimp_list_uniquefy_name (list, object);
 
-  if (list->unique_names || list->sort_func)
+  if (list->unique_names || list->sort_func || list->indexed)
     g_signal_connect (object, "name-changed",
                       G_CALLBACK (gimp_list_object_renamed),
                       list);
 
-  if (list->sort_func)
+  if (list->indexed)
+    {
+      gint index;
+
+      if (list->sort_func)
+        index = gimp_list_index_find_sorted (list, object);
+      else if (list->append)
+        index = list->entries->len;
+      else
+        index = 0;
+
+      gimp_list_index_insert (list, object, index);
+    }
+  else if (list->sort_func)
     {
       g_queue_insert_sorted (list->queue, object, gimp_list_sort_func,
                              list->sort_func);
@@ -273,12 +434,16 @@ gimp_list_remove (GimpContainer *container,
 {
   GimpList *list = GIMP_LIST (container);
 
-  if (list->unique_names || list->sort_func)
+  if (list->unique_names || list->sort_func || list->indexed)
     g_signal_handlers_disconnect_by_func (object,
                                           gimp_list_object_renamed,
                                           list);
 
-  g_queue_remove (list->queue, object);
+  if (list->indexed)
+    gimp_list_index_remove (list,
+                            g_hash_table_lookup (list->objects, object));
+  else
+    g_queue_remove (list->queue, object);
 
   GIMP_CONTAINER_CLASS (parent_class)->remove (container, object);
 }
@@ -290,6 +455,43 @@ gimp_list_reorder (GimpContainer *container,
 {
   GimpList *list = GIMP_LIST (container);
 
+  if (list->indexed)
+    {
+      GimpListEntry *entry     = g_hash_table_lookup (list->objects, object);
+      gint           old_index = entry->index;
+      GimpListName  *name      = NULL;
+
+      g_queue_delete_link (list->queue, entry->link);
+      g_ptr_array_remove_index (list->entries, old_index);
+
+      if (new_index < list->entries->len)
+        {
+          GimpListEntry *next = g_ptr_array_index (list->entries, new_index);
+
+          g_queue_insert_before (list->queue, next->link, object);
+          entry->link = next->link->prev;
+        }
+      else
+        {
+          g_queue_push_tail (list->queue, object);
+          entry->link = list->queue->tail;
+        }
+
+      g_ptr_array_insert (list->entries, new_index, entry);
+
+      gimp_list_index_renumber (list,
+                                MIN (old_index, new_index),
+                                MAX (old_index, new_index));
+
+      if (entry->name)
+        name = g_hash_table_lookup (list->names, entry->name);
+
+      if (name && name->count > 1)
+        gimp_list_name_find_first (list, name, entry->name, NULL);
+
+      return;
+    }
+
   g_queue_remove (list->queue, object);
 
   if (new_index == gimp_container_get_n_children (container) - 1)
@@ -313,6 +515,9 @@ gimp_list_have (GimpContainer *container,
 {
   GimpList *list = GIMP_LIST (container);
 
+  if (list->indexed)
+    return g_hash_table_lookup (list->objects, object) != NULL;
+
   return g_queue_find (list->queue, object) ? TRUE : FALSE;
 }
 
@@ -333,6 +538,13 @@ gimp_list_get_child_by_name (GimpContainer *container,
   GimpList *list = GIMP_LIST (container);
   GList    *glist;
 
+  if (list->indexed)
+    {
+      GimpListName *entry = g_hash_table_lookup (list->names, name);
+
+      return entry ? entry->first->object : NULL;
+    }
+
   for (glist = list->queue->head; glist; glist = g_list_next (glist))
     {
       GimpObject *object = glist->data;
@@ -350,6 +562,18 @@ gimp_list_get_child_by_index (GimpContainer *container,
 {
   GimpList *list = GIMP_LIST (container);
 
+  if (list->indexed)
+    {
+      GimpListEntry *entry;
+
+      if (index < 0 || index >= list->entries->len)
+        return NULL;
+
+      entry = g_ptr_array_index (list->entries, index);
+
+      return entry->object;
+    }
+
   return g_queue_peek_nth (list->queue, index);
 }
 
@@ -359,6 +583,13 @@ gimp_list_get_child_index (GimpContainer *container,
 {
   GimpList *list = GIMP_LIST (container);
 
+  if (list->indexed)
+    {
+      GimpListEntry *entry = g_hash_table_lookup (list->objects, object);
+
+      return entry ? entry->index : -1;
+    }
+
   return g_queue_index (list->queue, (gpointer) object);
 }
 
@@ -430,6 +661,41 @@ gimp_list_new_weak (GType    children_type,
   return GIMP_CONTAINER (list);
 }
 
+/**
+ * gimp_list_new_indexed:
+ * @children_type: the #GType of objects the list is going to hold
+ * @unique_names:  if the list should ensure that all its children
+ *                 have unique names.
+ *
+ * Creates a new #GimpList object like gimp_list_new(), but keeps an
+ * index of its children so looking them up by name, by index, or
+ * asking for their index doesn't have to walk the list.
+ *
+ * The returned list has the #GIMP_CONTAINER_POLICY_STRONG.
+ *
+ * Return value: a new #GimpList object
+ **/
+GimpContainer *
+gimp_list_new_indexed (GType    children_type,
+                       gboolean unique_names)
+{
+  GimpList *list;
+
+  g_return_val_if_fail (g_type_is_a (children_type, GIMP_TYPE_OBJECT), NULL);
+
+  list = g_object_new (GIMP_TYPE_LIST,
+                       "children-type", children_type,
+                       "policy",        GIMP_CONTAINER_POLICY_STRONG,
+                       "unique-names",  unique_names ? TRUE : FALSE,
+                       "indexed",       TRUE,
+                       NULL);
+
+  /* for debugging purposes only */
+  gimp_object_set_static_name (GIMP_OBJECT (list), g_type_name (children_type));
+
+  return GIMP_CONTAINER (list);
+}
+
 /**
  * gimp_list_reverse:
  * @list: a #GimpList
@@ -445,6 +711,10 @@ gimp_list_reverse (GimpList *list)
     {
       gimp_container_freeze (GIMP_CONTAINER (list));
       g_queue_reverse (list->queue);
+
+      if (list->indexed)
+        gimp_list_index_rebuild (list);
+
       gimp_container_thaw (GIMP_CONTAINER (list));
     }
 }
@@ -509,6 +779,10 @@ gimp_list_sort (GimpList     *list,
     {
       gimp_container_freeze (GIMP_CONTAINER (list));
       g_queue_sort (list->queue, gimp_list_sort_func, sort_func);
+
+      if (list->indexed)
+        gimp_list_index_rebuild (list);
+
       gimp_container_thaw (GIMP_CONTAINER (list));
     }
 }
@@ -530,15 +804,20 @@ gimp_list_sort_by_name (GimpList *list)
 
 /*  private functions  */
 
-static void
-gimp_list_uniquefy_name (GimpList   *gimp_list,
-                         GimpObject *object)
+static gboolean
+gimp_list_name_is_taken (GimpList    *gimp_list,
+                         GimpObject  *object,
+                         const gchar *name)
 {
-  gchar *name = (gchar *) gimp_object_get_name (object);
   GList *list;
 
-  if (! name)
-    return;
+  if (gimp_list->indexed)
+    {
+      /*  @object is never indexed under a name while it is being
+       *  made unique, see gimp_list_object_renamed()
+       */
+      return g_hash_table_lookup (gimp_list->names, name) != NULL;
+    }
 
   for (list = gimp_list->queue->head; list; list = g_list_next (list))
     {
@@ -548,10 +827,22 @@ gimp_list_uniquefy_name (GimpList   *gimp_list,
       if (object != object2 &&
           name2             &&
           ! strcmp (name, name2))
-        break;
+        return TRUE;
     }
 
-  if (list)
+  return FALSE;
+}
+
+static void
+gimp_list_uniquefy_name (GimpList   *gimp_list,
+                         GimpObject *object)
+{
+  gchar *name = (gchar *) gimp_object_get_name (object);
+
+  if (! name)
+    return;
+
+  if (gimp_list_name_is_taken (gimp_list, object, name))
     {
       gchar *ext;
       gchar *new_name   = NULL;
@@ -585,24 +876,17 @@ gimp_list_uniquefy_name (GimpList   *gimp_list,
 
       do
         {
-          unique_ext++;
+          if (gimp_list->name_index)
+            unique_ext = gimp_name_index_next_number (gimp_list->name_index,
+                                                      name, 1, unique_ext);
+          else
+            unique_ext++;
 
           g_free (new_name);
 
           new_name = g_strdup_printf ("%s #%d", name, unique_ext);
-
-          for (list = gimp_list->queue->head; list; list = g_list_next (list))
-            {
-              GimpObject  *object2 = list->data;
-              const gchar *name2   = gimp_object_get_name (object2);
-
-              if (object != object2 &&
-                  name2             &&
-                  ! strcmp (new_name, name2))
-                break;
-            }
         }
-      while (list);
+      while (gimp_list_name_is_taken (gimp_list, object, new_name));
 
       g_free (name);
 
@@ -614,6 +898,18 @@ static void
 gimp_list_object_renamed (GimpObject *object,
                           GimpList   *list)
 {
+  GimpListEntry *entry = NULL;
+
+  if (list->indexed)
+    {
+      entry = g_hash_table_lookup (list->objects, object);
+
+      gimp_list_name_remove (list, entry);
+
+      g_free (entry->name);
+      entry->name = NULL;
+    }
+
   if (list->unique_names)
     {
       g_signal_handlers_block_by_func (object,
@@ -627,6 +923,13 @@ gimp_list_object_renamed (GimpObject *object,
                                          list);
     }
 
+  if (entry)
+    {
+      entry->name = g_strdup (gimp_object_get_name (object));
+
+      gimp_list_name_add (list, entry);
+    }
+
   if (list->sort_func)
     {
       GList *glist;
@@ -652,3 +955,218 @@ gimp_list_object_renamed (GimpObject *object,
         gimp_container_reorder (GIMP_CONTAINER (list), object, new_index);
     }
 }
+
+static gint
+gimp_list_index_find_sorted (GimpList   *list,
+                             GimpObject *object)
+{
+  gint low  = 0;
+  gint high = list->entries->len;
+
+  /*  the position g_queue_insert_sorted() would pick: before the first
+   *  child that doesn't sort before @object
+   */
+  while (low < high)
+    {
+      gint           mid   = (low + high) / 2;
+      GimpListEntry *entry = g_ptr_array_index (list->entries, mid);
+
+      if (list->sort_func (entry->object, object) < 0)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+  return low;
+}
+
+static void
+gimp_list_index_insert (GimpList   *list,
+                        GimpObject *object,
+                        gint        index)
+{
+  GimpListEntry *entry = g_slice_new0 (GimpListEntry);
+
+  entry->object = object;
+  entry->name   = g_strdup (gimp_object_get_name (object));
+
+  if (index < list->entries->len)
+    {
+      GimpListEntry *next = g_ptr_array_index (list->entries, index);
+
+      g_queue_insert_before (list->queue, next->link, object);
+      entry->link = next->link->prev;
+    }
+  else
+    {
+      g_queue_push_tail (list->queue, object);
+      entry->link = list->queue->tail;
+    }
+
+  g_ptr_array_insert (list->entries, index, entry);
+  g_hash_table_insert (list->objects, object, entry);
+
+  gimp_list_index_renumber (list, index, list->entries->len - 1);
+
+  gimp_list_name_add (list, entry);
+}
+
+static void
+gimp_list_index_remove (GimpList      *list,
+                        GimpListEntry *entry)
+{
+  gint index = entry->index;
+
+  gimp_list_name_remove (list, entry);
+
+  g_queue_delete_link (list->queue, entry->link);
+  g_ptr_array_remove_index (list->entries, index);
+
+  gimp_list_index_renumber (list, index, list->entries->len - 1);
+
+  g_hash_table_remove (list->objects, entry->object);
+}
+
+static void
+gimp_list_index_renumber (GimpList *list,
+                          gint      first,
+                          gint      last)
+{
+  gint i;
+
+  for (i = first; i <= last && i < list->entries->len; i++)
+    {
+      GimpListEntry *entry = g_ptr_array_index (list->entries, i);
+
+      entry->index = i;
+    }
+}
+
+static void
+gimp_list_index_rebuild (GimpList *list)
+{
+  GList *glist;
+  gint   i;
+
+  g_ptr_array_set_size (list->entries, 0);
+
+  for (glist = list->queue->head; glist; glist = g_list_next (glist))
+    {
+      GimpListEntry *entry = g_hash_table_lookup (list->objects, glist->data);
+
+      entry->link  = glist;
+      entry->index = list->entries->len;
+
+      g_ptr_array_add (list->entries, entry);
+    }
+
+  /*  reordering doesn't change which names are used, or how often,
+   *  only which entry of each name comes first
+   */
+  for (i = 0; i < list->entries->len; i++)
+    {
+      GimpListEntry *entry = g_ptr_array_index (list->entries, i);
+      GimpListName  *name;
+
+      if (! entry->name)
+        continue;
+
+      name = g_hash_table_lookup (list->names, entry->name);
+
+      if (name->first->index > entry->index)
+        name->first = entry;
+    }
+}
+
+static void
+gimp_list_name_add (GimpList      *list,
+                    GimpListEntry *entry)
+{
+  GimpListName *name;
+
+  if (! entry->name)
+    return;
+
+  if (list->name_index)
+    gimp_name_index_add (list->name_index, entry->name);
+
+  name = g_hash_table_lookup (list->names, entry->name);
+
+  if (! name)
+    {
+      name = g_slice_new (GimpListName);
+
+      name->first = entry;
+      name->count = 1;
+
+      g_hash_table_insert (list->names, g_strdup (entry->name), name);
+    }
+  else
+    {
+      name->count++;
+
+      if (entry->index < name->first->index)
+        name->first = entry;
+    }
+}
+
+static void
+gimp_list_name_remove (GimpList      *list,
+                       GimpListEntry *entry)
+{
+  GimpListName *name;
+
+  if (! entry->name)
+    return;
+
+  if (list->name_index)
+    gimp_name_index_remove (list->name_index, entry->name);
+
+  name = g_hash_table_lookup (list->names, entry->name);
+
+  if (! name)
+    return;
+
+  name->count--;
+
+  if (name->count == 0)
+    g_hash_table_remove (list->names, entry->name);
+  else if (name->first == entry)
+    gimp_list_name_find_first (list, name, entry->name, entry);
+}
+
+static void
+gimp_list_name_find_first (GimpList      *list,
+                           GimpListName  *name,
+                           const gchar   *string,
+                           GimpListEntry *exclude)
+{
+  gint i;
+
+  for (i = 0; i < list->entries->len; i++)
+    {
+      GimpListEntry *entry = g_ptr_array_index (list->entries, i);
+
+      if (entry != exclude &&
+          entry->name      &&
+          ! strcmp (entry->name, string))
+        {
+          name->first = entry;
+          return;
+        }
+    }
+}
+
+static void
+gimp_list_entry_free (GimpListEntry *entry)
+{
+  g_free (entry->name);
+
+  g_slice_free (GimpListEntry, entry);
+}
+
+static void
+gimp_list_name_free (GimpListName *name)
+{
+  g_slice_free (GimpListName, name);
+}
@@ -43,6 +43,15 @@ struct _GimpList
   gboolean       unique_names;
   GCompareFunc   sort_func;
   gboolean       append;
+  gboolean       indexed;
+
+  /*  only if indexed  */
+  GPtrArray     *entries;  /*  the children's entries, in order  */
+  GHashTable    *objects;  /*  child -> entry                    */
+  GHashTable    *names;    /*  name  -> first entry of that name */
+
+  /*  only if indexed and unique_names  */
+  GimpNameIndex *name_index;
 };
 
 struct _GimpListClass
@@ -57,6 +66,8 @@ GimpContainer * gimp_list_new           (GType         children_type,
                                          gboolean      unique_names);
 GimpContainer * gimp_list_new_weak      (GType         children_type,
                                          gboolean      unique_names);
+GimpContainer * gimp_list_new_indexed   (GType         children_type,
+                                         gboolean      unique_names);
 
 void            gimp_list_reverse       (GimpList     *list);
 void            gimp_list_set_sort_func (GimpList     *list,
@@ -0,0 +1,595 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gegl.h>
+
+#include "core-types.h"
+
+#include "gimp-parallel.h"
+#include "gimpmasktiles.h"
+
+
+/*  a summary of a mask, tile by tile: whether each tile is empty,
+ *  fully selected, or partially selected and within which bounds.
+ *  tiles whose pixels changed are marked as unknown and only those
+ *  are looked at again, so the mask's bounds, and whether it is empty
+ *  or fully selected, can be found without going over all of its
+ *  pixels.
+ */
+
+
+#define TILE_SHIFT  6
+#define TILE_SIZE   (1 << TILE_SHIFT)
+
+
+typedef struct
+{
+  guint8 state;
+  guint8 x1, y1;    /*  the bounds within the tile, for PARTIAL tiles  */
+  guint8 x2, y2;
+} Tile;
+
+struct _GimpMaskTiles
+{
+  gint  width;
+  gint  height;
+  gint  n_tiles_x;
+  gint  n_tiles_y;
+  Tile *tiles;
+  gint  n_unknown;
+};
+
+typedef struct
+{
+  GimpMaskTiles *tiles;
+  GeglBuffer    *buffer;
+  gint          *unknown;
+  gint           n_unknown;
+} ScanData;
+
+
+/*  local function prototypes  */
+
+static void   gimp_mask_tiles_validate    (GimpMaskTiles       *tiles,
+                                           GeglBuffer          *buffer);
+static void   gimp_mask_tiles_get_rect    (GimpMaskTiles       *tiles,
+                                           gint                 index,
+                                           GeglRectangle       *rect);
+static void   gimp_mask_tiles_set_state   (GimpMaskTiles       *tiles,
+                                           gint                 index,
+                                           GimpMaskTileState    state);
+static void   gimp_mask_tiles_scan_tile   (GimpMaskTiles       *tiles,
+                                           GeglBuffer          *buffer,
+                                           gint                 index,
+                                           gfloat              *data);
+static void   gimp_mask_tiles_scan_func   (gint                 i,
+                                           gint                 n,
+                                           gpointer             user_data);
+static void   gimp_mask_tiles_scan_all    (GimpMaskTiles       *tiles,
+                                           GeglBuffer          *buffer);
+
+
+/*  public functions  */
+
+GimpMaskTiles *
+gimp_mask_tiles_new (void)
+{
+  return g_slice_new0 (GimpMaskTiles);
+}
+
+void
+gimp_mask_tiles_free (GimpMaskTiles *tiles)
+{
+  g_return_if_fail (tiles != NULL);
+
+  g_free (tiles->tiles);
+
+  g_slice_free (GimpMaskTiles, tiles);
+}
+
+/**
+ * gimp_mask_tiles_invalidate:
+ * @tiles: a #GimpMaskTiles
+ * @rect:  the area of the mask which changed, or %NULL
+ *
+ * Forgets what is known about the tiles intersecting @rect, or about
+ * all tiles if @rect is %NULL.
+ **/
+void
+gimp_mask_tiles_invalidate (GimpMaskTiles       *tiles,
+                            const GeglRectangle *rect)
+{
+  gint tx1, ty1, tx2, ty2;
+  gint tx, ty;
+
+  g_return_if_fail (tiles != NULL);
+
+  if (! rect)
+    {
+      if (tiles->tiles)
+        memset (tiles->tiles, 0,
+                sizeof (Tile) * tiles->n_tiles_x * tiles->n_tiles_y);
+
+      tiles->n_unknown = tiles->n_tiles_x * tiles->n_tiles_y;
+
+      return;
+    }
+
+  if (rect->width <= 0 || rect->height <= 0)
+    return;
+
+  tx1 = MAX (rect->x, 0) >> TILE_SHIFT;
+  ty1 = MAX (rect->y, 0) >> TILE_SHIFT;
+  tx2 = MIN ((rect->x + rect->width  - 1) >> TILE_SHIFT, tiles->n_tiles_x - 1);
+  ty2 = MIN ((rect->y + rect->height - 1) >> TILE_SHIFT, tiles->n_tiles_y - 1);
+
+  for (ty = ty1; ty <= ty2; ty++)
+    for (tx = tx1; tx <= tx2; tx++)
+      gimp_mask_tiles_set_state (tiles, ty * tiles->n_tiles_x + tx,
+                                 GIMP_MASK_TILE_UNKNOWN);
+}
+
+/**
+ * gimp_mask_tiles_set_rect:
+ * @tiles: a #GimpMaskTiles
+ * @rect:  the area of the mask which was filled, or %NULL
+ * @value: the value it was filled with
+ *
+ * Records that @rect, or the whole mask if @rect is %NULL, was filled
+ * with @value. The tiles completely inside @rect become known, the
+ * ones only partly inside it unknown.
+ **/
+void
+gimp_mask_tiles_set_rect (GimpMaskTiles       *tiles,
+                          const GeglRectangle *rect,
+                          gfloat               value)
+{
+  GeglRectangle     area;
+  GimpMaskTileState state;
+  gint              tx1, ty1, tx2, ty2;
+  gint              tx, ty;
+
+  g_return_if_fail (tiles != NULL);
+
+  area.x      = 0;
+  area.y      = 0;
+  area.width  = tiles->width;
+  area.height = tiles->height;
+
+  if (rect && ! gegl_rectangle_intersect (&area, &area, rect))
+    return;
+
+  if (value <= 0.0)
+    state = GIMP_MASK_TILE_EMPTY;
+  else if (value >= 1.0)
+    state = GIMP_MASK_TILE_FULL;
+  else
+    state = GIMP_MASK_TILE_PARTIAL;
+
+  tx1 = area.x >> TILE_SHIFT;
+  ty1 = area.y >> TILE_SHIFT;
+  tx2 = (area.x + area.width  - 1) >> TILE_SHIFT;
+  ty2 = (area.y + area.height - 1) >> TILE_SHIFT;
+
+  for (ty = ty1; ty <= ty2; ty++)
+    for (tx = tx1; tx <= tx2; tx++)
+      {
+        gint          index = ty * tiles->n_tiles_x + tx;
+        GeglRectangle tile_rect;
+
+        gimp_mask_tiles_get_rect (tiles, index, &tile_rect);
+
+        if (gegl_rectangle_contains (&area, &tile_rect))
+          {
+            Tile *tile = &tiles->tiles[index];
+
+            gimp_mask_tiles_set_state (tiles, index, state);
+
+            tile->x1 = 0;
+            tile->y1 = 0;
+            tile->x2 = tile_rect.width;
+            tile->y2 = tile_rect.height;
+          }
+        else
+          {
+            gimp_mask_tiles_set_state (tiles, index, GIMP_MASK_TILE_UNKNOWN);
+          }
+      }
+}
+
+/**
+ * gimp_mask_tiles_bounds:
+ * @tiles:  a #GimpMaskTiles
+ * @buffer: the mask @tiles summarizes
+ * @x1:     return location for the left side of the bounds
+ * @y1:     return location for the top side of the bounds
+ * @x2:     return location for the right side of the bounds
+ * @y2:     return location for the bottom side of the bounds
+ *
+ * Like gimp_gegl_mask_bounds(), but only looks at the pixels of the
+ * tiles which are not known yet.
+ *
+ * Return value: %FALSE if the mask is empty.
+ **/
+gboolean
+gimp_mask_tiles_bounds (GimpMaskTiles *tiles,
+                        GeglBuffer    *buffer,
+                        gint          *x1,
+                        gint          *y1,
+                        gint          *x2,
+                        gint          *y2)
+{
+  gint tx1, ty1, tx2, ty2;
+  gint index;
+
+  g_return_val_if_fail (tiles != NULL, FALSE);
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), FALSE);
+  g_return_val_if_fail (x1 != NULL, FALSE);
+  g_return_val_if_fail (y1 != NULL, FALSE);
+  g_return_val_if_fail (x2 != NULL, FALSE);
+  g_return_val_if_fail (y2 != NULL, FALSE);
+
+  gimp_mask_tiles_validate (tiles, buffer);
+  gimp_mask_tiles_scan_all (tiles, buffer);
+
+  tx1 = tiles->width;
+  ty1 = tiles->height;
+  tx2 = 0;
+  ty2 = 0;
+
+  for (index = 0; index < tiles->n_tiles_x * tiles->n_tiles_y; index++)
+    {
+      const Tile *tile = &tiles->tiles[index];
+      gint        x    = (index % tiles->n_tiles_x) << TILE_SHIFT;
+      gint        y    = (index / tiles->n_tiles_x) << TILE_SHIFT;
+
+      if (tile->state == GIMP_MASK_TILE_EMPTY)
+        continue;
+
+      tx1 = MIN (tx1, x + tile->x1);
+      ty1 = MIN (ty1, y + tile->y1);
+      tx2 = MAX (tx2, x + tile->x2);
+      ty2 = MAX (ty2, y + tile->y2);
+    }
+
+  if (tx1 >= tx2 || ty1 >= ty2)
+    {
+      *x1 = 0;
+      *y1 = 0;
+      *x2 = tiles->width;
+      *y2 = tiles->height;
+
+      return FALSE;
+    }
+
+  *x1 = tx1;
+  *y1 = ty1;
+  *x2 = tx2;
+  *y2 = ty2;
+
+  return TRUE;
+}
+
+gboolean
+gimp_mask_tiles_is_empty (GimpMaskTiles *tiles,
+                          GeglBuffer    *buffer)
+{
+  gfloat *data = NULL;
+  gint    n_tiles;
+  gint    index;
+  gint    pass;
+
+  g_return_val_if_fail (tiles != NULL, FALSE);
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), FALSE);
+
+  gimp_mask_tiles_validate (tiles, buffer);
+
+  n_tiles = tiles->n_tiles_x * tiles->n_tiles_y;
+
+  /*  first look for a known non-empty tile, then go through the
+   *  unknown ones until one of them isn't empty
+   */
+  for (pass = 0; pass < 2; pass++)
+    {
+      for (index = 0; index < n_tiles; index++)
+        {
+          Tile *tile = &tiles->tiles[index];
+
+          if (pass == 1 && tile->state == GIMP_MASK_TILE_UNKNOWN)
+            {
+              if (! data)
+                data = g_new (gfloat, TILE_SIZE * TILE_SIZE);
+
+              gimp_mask_tiles_scan_tile (tiles, buffer, index, data);
+              tiles->n_unknown--;
+            }
+
+          if (tile->state == GIMP_MASK_TILE_FULL || tile->state == GIMP_MASK_TILE_PARTIAL)
+            {
+              g_free (data);
+
+              return FALSE;
+            }
+        }
+
+      if (tiles->n_unknown == 0)
+        break;
+    }
+
+  g_free (data);
+
+  return TRUE;
+}
+
+gboolean
+gimp_mask_tiles_is_full (GimpMaskTiles *tiles,
+                         GeglBuffer    *buffer)
+{
+  gfloat *data = NULL;
+  gint    n_tiles;
+  gint    index;
+  gint    pass;
+
+  g_return_val_if_fail (tiles != NULL, FALSE);
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), FALSE);
+
+  gimp_mask_tiles_validate (tiles, buffer);
+
+  n_tiles = tiles->n_tiles_x * tiles->n_tiles_y;
+
+  /*  like gimp_mask_tiles_is_empty(), stops at the first tile which
+   *  isn't fully selected
+   */
+  for (pass = 0; pass < 2; pass++)
+    {
+      for (index = 0; index < n_tiles; index++)
+        {
+          Tile *tile = &tiles->tiles[index];
+
+          if (pass == 1 && tile->state == GIMP_MASK_TILE_UNKNOWN)
+            {
+              if (! data)
+                data = g_new (gfloat, TILE_SIZE * TILE_SIZE);
+
+              gimp_mask_tiles_scan_tile (tiles, buffer, index, data);
+              tiles->n_unknown--;
+            }
+
+          if (tile->state == GIMP_MASK_TILE_EMPTY ||
+              tile->state == GIMP_MASK_TILE_PARTIAL)
+            {
+              g_free (data);
+
+              return FALSE;
+            }
+        }
+
+      if (tiles->n_unknown == 0)
+        break;
+    }
+
+  g_free (data);
+
+  return n_tiles > 0;
+}
+
+/**
+ * gimp_mask_tiles_get_state:
+ * @tiles: a #GimpMaskTiles
+ * @x:     x coordinate of a pixel of the mask
+ * @y:     y coordinate of a pixel of the mask
+ * @rect:  return location for the tile's area, or %NULL
+ *
+ * Returns what is currently known about the tile containing @x, @y,
+ * without looking at any pixels.
+ *
+ * Return value: the state of the tile, %GIMP_MASK_TILE_UNKNOWN if
+ * nothing is known about it or @x, @y is outside of the mask.
+ **/
+GimpMaskTileState
+gimp_mask_tiles_get_state (GimpMaskTiles *tiles,
+                           gint           x,
+                           gint           y,
+                           GeglRectangle *rect)
+{
+  gint index;
+
+  g_return_val_if_fail (tiles != NULL, GIMP_MASK_TILE_UNKNOWN);
+
+  if (x < 0 || x >= tiles->width ||
+      y < 0 || y >= tiles->height)
+    return GIMP_MASK_TILE_UNKNOWN;
+
+  index = (y >> TILE_SHIFT) * tiles->n_tiles_x + (x >> TILE_SHIFT);
+
+  if (rect)
+    gimp_mask_tiles_get_rect (tiles, index, rect);
+
+  return tiles->tiles[index].state;
+}
+
+
+/*  private functions  */
+
+/*  starts over if the mask's size changed  */
+static void
+gimp_mask_tiles_validate (GimpMaskTiles *tiles,
+                          GeglBuffer    *buffer)
+{
+  gint width  = gegl_buffer_get_width  (buffer);
+  gint height = gegl_buffer_get_height (buffer);
+
+  if (width != tiles->width || height != tiles->height)
+    {
+      tiles->width     = width;
+      tiles->height    = height;
+      tiles->n_tiles_x = (width  + TILE_SIZE - 1) >> TILE_SHIFT;
+      tiles->n_tiles_y = (height + TILE_SIZE - 1) >> TILE_SHIFT;
+
+      g_free (tiles->tiles);
+      tiles->tiles = g_new (Tile, tiles->n_tiles_x * tiles->n_tiles_y);
+
+      gimp_mask_tiles_invalidate (tiles, NULL);
+    }
+}
+
+static void
+gimp_mask_tiles_get_rect (GimpMaskTiles *tiles,
+                          gint           index,
+                          GeglRectangle *rect)
+{
+  rect->x      = (index % tiles->n_tiles_x) << TILE_SHIFT;
+  rect->y      = (index / tiles->n_tiles_x) << TILE_SHIFT;
+  rect->width  = MIN (TILE_SIZE, tiles->width  - rect->x);
+  rect->height = MIN (TILE_SIZE, tiles->height - rect->y);
+}
+
+static void
+gimp_mask_tiles_set_state (GimpMaskTiles     *tiles,
+                           gint               index,
+                           GimpMaskTileState  state)
+{
+  Tile *tile = &tiles->tiles[index];
+
+  if (tile->state == GIMP_MASK_TILE_UNKNOWN)
+    tiles->n_unknown--;
+
+  if (state == GIMP_MASK_TILE_UNKNOWN)
+    tiles->n_unknown++;
+
+  tile->state = state;
+}
+
+static void
+gimp_mask_tiles_scan_tile (GimpMaskTiles *tiles,
+                           GeglBuffer    *buffer,
+                           gint           index,
+                           gfloat        *data)
+{
+  Tile          *tile = &tiles->tiles[index];
+  GeglRectangle  rect;
+  gboolean       full = TRUE;
+  gint           x1, y1, x2, y2;
+  gint           x, y;
+
+  gimp_mask_tiles_get_rect (tiles, index, &rect);
+
+  gegl_buffer_get (buffer, &rect, 1.0, babl_format ("Y float"),
+                   data, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  x1 = rect.width;
+  y1 = rect.height;
+  x2 = 0;
+  y2 = 0;
+
+  for (y = 0; y < rect.height; y++)
+    {
+      const gfloat *row   = data + y * rect.width;
+      gint          first = -1;
+      gint          last  = -1;
+
+      for (x = 0; x < rect.width; x++)
+        {
+          if (row[x])
+            {
+              if (first < 0)
+                first = x;
+
+              last = x;
+            }
+
+          if (row[x] != 1.0)
+            full = FALSE;
+        }
+
+      if (first >= 0)
+        {
+          x1 = MIN (x1, first);
+          x2 = MAX (x2, last + 1);
+
+          if (y < y1)
+            y1 = y;
+
+          y2 = y + 1;
+        }
+    }
+
+  /*  tiles are scanned by several threads at once, so the count of
+   *  unknown tiles is left to the caller
+   */
+  if (full)
+    tile->state = GIMP_MASK_TILE_FULL;
+  else if (x1 >= x2)
+    tile->state = GIMP_MASK_TILE_EMPTY;
+  else
+    tile->state = GIMP_MASK_TILE_PARTIAL;
+
+  tile->x1 = full ? 0           : x1;
+  tile->y1 = full ? 0           : y1;
+  tile->x2 = full ? rect.width  : x2;
+  tile->y2 = full ? rect.height : y2;
+}
+
+static void
+gimp_mask_tiles_scan_func (gint     i,
+                           gint     n,
+                           gpointer user_data)
+{
+  ScanData *scan = user_data;
+  gfloat   *data = g_new (gfloat, TILE_SIZE * TILE_SIZE);
+  gint      k;
+
+  for (k = i; k < scan->n_unknown; k += n)
+    gimp_mask_tiles_scan_tile (scan->tiles, scan->buffer,
+                               scan->unknown[k], data);
+
+  g_free (data);
+}
+
+/*  finds the state of all unknown tiles, in parallel  */
+static void
+gimp_mask_tiles_scan_all (GimpMaskTiles *tiles,
+                          GeglBuffer    *buffer)
+{
+  ScanData scan;
+  gint     n_tiles = tiles->n_tiles_x * tiles->n_tiles_y;
+  gint     index;
+
+  if (tiles->n_unknown == 0)
+    return;
+
+  scan.tiles     = tiles;
+  scan.buffer    = buffer;
+  scan.unknown   = g_new (gint, tiles->n_unknown);
+  scan.n_unknown = 0;
+
+  for (index = 0; index < n_tiles; index++)
+    {
+      if (tiles->tiles[index].state == GIMP_MASK_TILE_UNKNOWN)
+        scan.unknown[scan.n_unknown++] = index;
+    }
+
+  gimp_parallel_distribute (scan.n_unknown, gimp_mask_tiles_scan_func, &scan);
+
+  g_free (scan.unknown);
+
+  tiles->n_unknown = 0;
+}
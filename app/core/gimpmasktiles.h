@@ -0,0 +1,58 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_MASK_TILES_H__
+#define __GIMP_MASK_TILES_H__
+
+
+typedef enum
+{
+  GIMP_MASK_TILE_UNKNOWN,
+  GIMP_MASK_TILE_EMPTY,
+  GIMP_MASK_TILE_FULL,
+  GIMP_MASK_TILE_PARTIAL
+} GimpMaskTileState;
+
+
+GimpMaskTiles * gimp_mask_tiles_new        (void);
+void            gimp_mask_tiles_free       (GimpMaskTiles       *tiles);
+
+void            gimp_mask_tiles_invalidate (GimpMaskTiles       *tiles,
+                                            const GeglRectangle *rect);
+void            gimp_mask_tiles_set_rect   (GimpMaskTiles       *tiles,
+                                            const GeglRectangle *rect,
+                                            gfloat               value);
+
+gboolean        gimp_mask_tiles_bounds     (GimpMaskTiles       *tiles,
+                                            GeglBuffer          *buffer,
+                                            gint                *x1,
+                                            gint                *y1,
+                                            gint                *x2,
+                                            gint                *y2);
+gboolean        gimp_mask_tiles_is_empty   (GimpMaskTiles       *tiles,
+                                            GeglBuffer          *buffer);
+gboolean        gimp_mask_tiles_is_full    (GimpMaskTiles       *tiles,
+                                            GeglBuffer          *buffer);
+
+GimpMaskTileState
+                gimp_mask_tiles_get_state  (GimpMaskTiles       *tiles,
+                                            gint                 x,
+                                            gint                 y,
+                                            GeglRectangle       *rect);
+
+
+#endif /* __GIMP_MASK_TILES_H__ */
@@ -22,11 +22,17 @@
 
 #include "core-types.h"
 
+#include "config/gimpcoreconfig.h"
+
 #include "gegl/gimp-gegl-utils.h"
 
+#include "gimp.h"
 #include "gimp-memsize.h"
 #include "gimpchannel.h"
+#include "gimpimage.h"
+#include "gimpimage-undo.h"
 #include "gimpmaskundo.h"
+#include "gimpundobuffer.h"
 
 
 enum
@@ -49,12 +55,23 @@ static void     gimp_mask_undo_get_property (GObject             *object,
 static gint64   gimp_mask_undo_get_memsize  (GimpObject          *object,
                                              gint64              *gui_size);
 
+static gint64   gimp_mask_undo_get_uncompressed_size
+                                            (GimpUndo            *undo);
+static void     gimp_mask_undo_swap_out     (GimpUndo            *undo,
+                                             const gchar         *path);
+static gint64   gimp_mask_undo_get_swap_size
+                                            (GimpUndo            *undo);
+
 static void     gimp_mask_undo_pop          (GimpUndo            *undo,
                                              GimpUndoMode         undo_mode,
                                              GimpUndoAccumulator *accum);
 static void     gimp_mask_undo_free         (GimpUndo            *undo,
                                              GimpUndoMode         undo_mode);
 
+static void     gimp_mask_undo_compress     (GimpMaskUndo        *mask_undo);
+static void     gimp_mask_undo_compressed   (GimpUndoBuffer      *undo_buffer,
+                                             GimpUndo            *undo);
+
 
 G_DEFINE_TYPE (GimpMaskUndo, gimp_mask_undo, GIMP_TYPE_ITEM_UNDO)
 
@@ -68,14 +85,17 @@ gimp_mask_undo_class_init (GimpMaskUndoClass *klass)
   GimpObjectClass *gimp_object_class = GIMP_OBJECT_CLASS (klass);
   GimpUndoClass   *undo_class        = GIMP_UNDO_CLASS (klass);
 
-  object_class->constructed      = gimp_mask_undo_constructed;
-  object_class->set_property     = gimp_mask_undo_set_property;
-  object_class->get_property     = gimp_mask_undo_get_property;
+  object_class->constructed         = gimp_mask_undo_constructed;
+  object_class->set_property        = gimp_mask_undo_set_property;
+  object_class->get_property        = gimp_mask_undo_get_property;
 
-  gimp_object_class->get_memsize = gimp_mask_undo_get_memsize;
+  gimp_object_class->get_memsize    = gimp_mask_undo_get_memsize;
 
-  undo_class->pop                = gimp_mask_undo_pop;
-  undo_class->free               = gimp_mask_undo_free;
+  undo_class->get_uncompressed_size = gimp_mask_undo_get_uncompressed_size;
+  undo_class->swap_out              = gimp_mask_undo_swap_out;
+  undo_class->get_swap_size         = gimp_mask_undo_get_swap_size;
+  undo_class->pop                   = gimp_mask_undo_pop;
+  undo_class->free                  = gimp_mask_undo_free;
 
   g_object_class_install_property (object_class, PROP_CONVERT_FORMAT,
                                    g_param_spec_boolean ("convert-format",
@@ -107,20 +127,21 @@ gimp_mask_undo_constructed (GObject *object)
 
   if (gimp_item_bounds (item, &x, &y, &w, &h))
     {
-      mask_undo->buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, w, h),
-                                           gimp_drawable_get_format (drawable));
+      GeglBuffer *buffer;
 
-      gegl_buffer_copy (gimp_drawable_get_buffer (drawable),
-                        GEGL_RECTANGLE (x, y, w, h),
-                        GEGL_ABYSS_NONE,
-                        mask_undo->buffer,
-                        GEGL_RECTANGLE (0, 0, 0, 0));
+      buffer = gimp_gegl_buffer_dup_area (gimp_drawable_get_buffer (drawable),
+                                          GEGL_RECTANGLE (x, y, w, h));
+
+      mask_undo->buffer = gimp_undo_buffer_new (buffer);
+      g_object_unref (buffer);
 
       mask_undo->x = x;
       mask_undo->y = y;
     }
 
   mask_undo->format = gimp_drawable_get_format (drawable);
+
+  gimp_mask_undo_compress (mask_undo);
 }
 
 static void
@@ -170,12 +191,44 @@ gimp_mask_undo_get_memsize (GimpObject *object,
   GimpMaskUndo *mask_undo = GIMP_MASK_UNDO (object);
   gint64        memsize   = 0;
 
-  memsize += gimp_gegl_buffer_get_memsize (mask_undo->buffer);
+  memsize += gimp_undo_buffer_get_memsize (mask_undo->buffer);
 
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
 }
 
+static gint64
+gimp_mask_undo_get_uncompressed_size (GimpUndo *undo)
+{
+  GimpMaskUndo *mask_undo = GIMP_MASK_UNDO (undo);
+
+  return (GIMP_UNDO_CLASS (parent_class)->get_uncompressed_size (undo) +
+          gimp_undo_buffer_get_raw_memsize (mask_undo->buffer) -
+          gimp_undo_buffer_get_memsize (mask_undo->buffer));
+}
+
+static void
+gimp_mask_undo_swap_out (GimpUndo    *undo,
+                         const gchar *path)
+{
+  GimpMaskUndo *mask_undo = GIMP_MASK_UNDO (undo);
+
+  if (mask_undo->buffer)
+    gimp_undo_buffer_swap_out (mask_undo->buffer, path,
+                               undo->image->gimp->config->undo_compression,
+                               (GimpUndoBufferCallback)
+                               gimp_mask_undo_compressed,
+                               mask_undo);
+}
+
+static gint64
+gimp_mask_undo_get_swap_size (GimpUndo *undo)
+{
+  GimpMaskUndo *mask_undo = GIMP_MASK_UNDO (undo);
+
+  return gimp_undo_buffer_get_swap_size (mask_undo->buffer);
+}
+
 static void
 gimp_mask_undo_pop (GimpUndo            *undo,
                     GimpUndoMode         undo_mode,
@@ -185,6 +238,7 @@ gimp_mask_undo_pop (GimpUndo            *undo,
   GimpItem     *item      = GIMP_ITEM_UNDO (undo)->item;
   GimpDrawable *drawable  = GIMP_DRAWABLE (item);
   GimpChannel  *channel   = GIMP_CHANNEL (item);
+  GeglBuffer   *buffer    = NULL;
   GeglBuffer   *new_buffer;
   const Babl   *format;
   gint          x, y, w, h;
@@ -193,16 +247,29 @@ gimp_mask_undo_pop (GimpUndo            *undo,
 
   GIMP_UNDO_CLASS (parent_class)->pop (undo, undo_mode, accum);
 
-  if (gimp_item_bounds (item, &x, &y, &w, &h))
+  if (mask_undo->buffer)
     {
-      new_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, w, h),
-                                    gimp_drawable_get_format (drawable));
+      GError *error = NULL;
 
-      gegl_buffer_copy (gimp_drawable_get_buffer (drawable),
-                        GEGL_RECTANGLE (x, y, w, h),
-                        GEGL_ABYSS_NONE,
-                        new_buffer,
-                        GEGL_RECTANGLE (0, 0, 0, 0));
+      buffer = gimp_undo_buffer_get_buffer (mask_undo->buffer, &error);
+
+      /*  leave the mask alone rather than writing garbage into it  */
+      if (! buffer)
+        {
+          gimp_message_literal (undo->image->gimp, NULL, GIMP_MESSAGE_ERROR,
+                                error->message);
+          g_clear_error (&error);
+
+          accum->failed = TRUE;
+          return;
+        }
+    }
+
+  if (gimp_item_bounds (item, &x, &y, &w, &h))
+    {
+      new_buffer =
+        gimp_gegl_buffer_dup_area (gimp_drawable_get_buffer (drawable),
+                                   GEGL_RECTANGLE (x, y, w, h));
 
       gegl_buffer_clear (gimp_drawable_get_buffer (drawable),
                          GEGL_RECTANGLE (x, y, w, h));
@@ -230,16 +297,16 @@ gimp_mask_undo_pop (GimpUndo            *undo,
 
   if (mask_undo->buffer)
     {
-      width  = gegl_buffer_get_width  (mask_undo->buffer);
-      height = gegl_buffer_get_height (mask_undo->buffer);
+      width  = gimp_undo_buffer_get_width  (mask_undo->buffer);
+      height = gimp_undo_buffer_get_height (mask_undo->buffer);
 
-      gegl_buffer_copy (mask_undo->buffer,
+      gegl_buffer_copy (buffer,
                         NULL,
                         GEGL_ABYSS_NONE,
                         gimp_drawable_get_buffer (drawable),
                         GEGL_RECTANGLE (mask_undo->x, mask_undo->y, 0, 0));
 
-      g_object_unref (mask_undo->buffer);
+      gimp_undo_buffer_free (mask_undo->buffer);
     }
 
   /* invalidate the current bounds and boundary of the mask */
@@ -266,11 +333,19 @@ gimp_mask_undo_pop (GimpUndo            *undo,
   channel->bounds_known = TRUE;
 
   /*  set the new mask undo parameters  */
-  mask_undo->buffer = new_buffer;
+  mask_undo->buffer = NULL;
   mask_undo->x      = x;
   mask_undo->y      = y;
   mask_undo->format = format;
 
+  if (new_buffer)
+    {
+      mask_undo->buffer = gimp_undo_buffer_new (new_buffer);
+      g_object_unref (new_buffer);
+
+      gimp_mask_undo_compress (mask_undo);
+    }
+
   gimp_drawable_update (drawable, 0, 0, -1, -1);
 }
 
@@ -282,9 +357,29 @@ gimp_mask_undo_free (GimpUndo     *undo,
 
   if (mask_undo->buffer)
     {
-      g_object_unref (mask_undo->buffer);
+      gimp_undo_buffer_free (mask_undo->buffer);
       mask_undo->buffer = NULL;
     }
 
   GIMP_UNDO_CLASS (parent_class)->free (undo, undo_mode);
 }
+
+static void
+gimp_mask_undo_compress (GimpMaskUndo *mask_undo)
+{
+  GimpImage *image = GIMP_UNDO (mask_undo)->image;
+
+  if (mask_undo->buffer)
+    gimp_undo_buffer_compress (mask_undo->buffer,
+                               image->gimp->config->undo_compression,
+                               (GimpUndoBufferCallback)
+                               gimp_mask_undo_compressed,
+                               mask_undo);
+}
+
+static void
+gimp_mask_undo_compressed (GimpUndoBuffer *undo_buffer,
+                           GimpUndo       *undo)
+{
+  gimp_image_undo_memsize_changed (undo->image, undo);
+}
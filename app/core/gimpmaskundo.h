@@ -35,14 +35,14 @@ typedef struct _GimpMaskUndoClass GimpMaskUndoClass;
 
 struct _GimpMaskUndo
 {
-  GimpItemUndo  parent_instance;
+  GimpItemUndo    parent_instance;
 
-  gboolean      convert_format;
+  gboolean        convert_format;
 
-  GeglBuffer   *buffer;
-  gint          x;
-  gint          y;
-  const Babl   *format;
+  GimpUndoBuffer *buffer;
+  gint            x;
+  gint            y;
+  const Babl     *format;
 };
 
 struct _GimpMaskUndoClass
@@ -0,0 +1,305 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib-object.h>
+
+#include "core-types.h"
+
+#include "gimp-memsize.h"
+#include "gimpnameindex.h"
+
+
+/*  an index of the "<base> #<number>" names in use, so that finding a
+ *  free number for a new unique name doesn't have to try all the
+ *  numbers that are already taken one by one.
+ *
+ *  names are grouped by their base and by the precision their number
+ *  is printed with ("Layer #1" vs. "Layer #001"), and only names
+ *  which are exactly what "%s #%.*d" prints are counted, so a number
+ *  is only ever skipped if the name it would produce really exists.
+ */
+
+
+#define MAX_DIGITS 9  /*  what always fits into a gint  */
+
+
+typedef struct
+{
+  GHashTable *numbers;     /*  number -> use count                  */
+  gint        first_free;  /*  all numbers below it, down to 1, are  *
+                            *  used                                 */
+} NameBase;
+
+struct _GimpNameIndex
+{
+  GHashTable *bases;       /*  "<precision>:<base>" -> NameBase  */
+};
+
+
+/*  local function prototypes  */
+
+static gboolean   gimp_name_index_split     (const gchar *name,
+                                             gchar      **key,
+                                             gint        *number);
+static gchar    * gimp_name_index_key       (const gchar *base,
+                                             gint         base_len,
+                                             gint         precision);
+static void       gimp_name_index_base_free (NameBase    *base);
+
+
+/*  public functions  */
+
+GimpNameIndex *
+gimp_name_index_new (void)
+{
+  GimpNameIndex *index = g_slice_new (GimpNameIndex);
+
+  index->bases = g_hash_table_new_full (g_str_hash,
+                                        g_str_equal,
+                                        g_free,
+                                        (GDestroyNotify) gimp_name_index_base_free);
+
+  return index;
+}
+
+void
+gimp_name_index_free (GimpNameIndex *index)
+{
+  g_return_if_fail (index != NULL);
+
+  g_hash_table_unref (index->bases);
+
+  g_slice_free (GimpNameIndex, index);
+}
+
+void
+gimp_name_index_add (GimpNameIndex *index,
+                     const gchar   *name)
+{
+  NameBase *base;
+  gchar    *key;
+  gint      number;
+  gint      count;
+
+  g_return_if_fail (index != NULL);
+
+  if (! name || ! gimp_name_index_split (name, &key, &number))
+    return;
+
+  base = g_hash_table_lookup (index->bases, key);
+
+  if (! base)
+    {
+      base = g_slice_new (NameBase);
+
+      base->numbers    = g_hash_table_new (g_direct_hash, g_direct_equal);
+      base->first_free = 1;
+
+      g_hash_table_insert (index->bases, key, base);
+    }
+  else
+    {
+      g_free (key);
+    }
+
+  count = GPOINTER_TO_INT (g_hash_table_lookup (base->numbers,
+                                                GINT_TO_POINTER (number)));
+
+  g_hash_table_insert (base->numbers,
+                       GINT_TO_POINTER (number), GINT_TO_POINTER (count + 1));
+
+  while (g_hash_table_contains (base->numbers,
+                                GINT_TO_POINTER (base->first_free)))
+    {
+      base->first_free++;
+    }
+}
+
+void
+gimp_name_index_remove (GimpNameIndex *index,
+                        const gchar   *name)
+{
+  NameBase *base;
+  gchar    *key;
+  gint      number;
+  gint      count;
+
+  g_return_if_fail (index != NULL);
+
+  if (! name || ! gimp_name_index_split (name, &key, &number))
+    return;
+
+  base = g_hash_table_lookup (index->bases, key);
+
+  if (base)
+    {
+      count = GPOINTER_TO_INT (g_hash_table_lookup (base->numbers,
+                                                    GINT_TO_POINTER (number)));
+
+      if (count > 1)
+        {
+          g_hash_table_insert (base->numbers,
+                               GINT_TO_POINTER (number),
+                               GINT_TO_POINTER (count - 1));
+        }
+      else if (count == 1)
+        {
+          g_hash_table_remove (base->numbers, GINT_TO_POINTER (number));
+
+          if (number >= 1 && number < base->first_free)
+            base->first_free = number;
+
+          if (g_hash_table_size (base->numbers) == 0)
+            g_hash_table_remove (index->bases, key);
+        }
+    }
+
+  g_free (key);
+}
+
+/**
+ * gimp_name_index_next_number:
+ * @index:     a #GimpNameIndex
+ * @base:      the name without its " #<number>" suffix
+ * @precision: the minimum number of digits the number is printed with
+ * @number:    the number to start after
+ *
+ * Returns the first number after @number for which the name "%s #%.*d"
+ * printed from @base, @precision and the number is not in @index.
+ *
+ * The index only knows the names that were added to it; callers should
+ * still check that the resulting name is free, and ask again starting
+ * after the returned number if it isn't.
+ *
+ * Return value: the next number that may be free.
+ **/
+gint
+gimp_name_index_next_number (GimpNameIndex *index,
+                             const gchar   *base,
+                             gint           precision,
+                             gint           number)
+{
+  NameBase *name_base;
+  gchar    *key;
+
+  g_return_val_if_fail (index != NULL, number + 1);
+  g_return_val_if_fail (base != NULL, number + 1);
+
+  number = MAX (number, 0) + 1;
+
+  key = gimp_name_index_key (base, strlen (base), MAX (precision, 1));
+
+  name_base = g_hash_table_lookup (index->bases, key);
+
+  g_free (key);
+
+  if (name_base)
+    {
+      number = MAX (number, name_base->first_free);
+
+      while (g_hash_table_contains (name_base->numbers,
+                                    GINT_TO_POINTER (number)))
+        {
+          number++;
+        }
+    }
+
+  return number;
+}
+
+gint64
+gimp_name_index_get_memsize (GimpNameIndex *index)
+{
+  GHashTableIter iter;
+  gpointer       key;
+  gpointer       value;
+  gint64         memsize;
+
+  g_return_val_if_fail (index != NULL, 0);
+
+  memsize = (sizeof (GimpNameIndex) +
+             gimp_g_hash_table_get_memsize (index->bases, sizeof (NameBase)));
+
+  g_hash_table_iter_init (&iter, index->bases);
+
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      NameBase *base = value;
+
+      memsize += gimp_string_get_memsize (key);
+      memsize += gimp_g_hash_table_get_memsize (base->numbers, 0);
+    }
+
+  return memsize;
+}
+
+
+/*  private functions  */
+
+static gboolean
+gimp_name_index_split (const gchar  *name,
+                       gchar       **key,
+                       gint         *number)
+{
+  const gchar *end    = name + strlen (name);
+  const gchar *digits = end;
+  gint         n_digits;
+  gint         precision;
+
+  while (digits > name && g_ascii_isdigit (digits[-1]))
+    digits--;
+
+  n_digits = end - digits;
+
+  if (n_digits < 1 || n_digits > MAX_DIGITS ||
+      digits - name < 2 || digits[-1] != '#' || digits[-2] != ' ')
+    return FALSE;
+
+  /*  "#1" is what precision 1 prints, "#001" only what precision 3
+   *  prints
+   */
+  if (digits[0] == '0' && n_digits > 1)
+    precision = n_digits;
+  else
+    precision = 1;
+
+  *key    = gimp_name_index_key (name, digits - 2 - name, precision);
+  *number = atoi (digits);
+
+  return TRUE;
+}
+
+static gchar *
+gimp_name_index_key (const gchar *base,
+                     gint         base_len,
+                     gint         precision)
+{
+  return g_strdup_printf ("%d:%.*s", precision, base_len, base);
+}
+
+static void
+gimp_name_index_base_free (NameBase *base)
+{
+  g_hash_table_unref (base->numbers);
+
+  g_slice_free (NameBase, base);
+}
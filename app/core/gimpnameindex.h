@@ -0,0 +1,38 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_NAME_INDEX_H__
+#define __GIMP_NAME_INDEX_H__
+
+
+GimpNameIndex * gimp_name_index_new         (void);
+void            gimp_name_index_free        (GimpNameIndex *index);
+
+void            gimp_name_index_add         (GimpNameIndex *index,
+                                             const gchar   *name);
+void            gimp_name_index_remove      (GimpNameIndex *index,
+                                             const gchar   *name);
+
+gint            gimp_name_index_next_number (GimpNameIndex *index,
+                                             const gchar   *base,
+                                             gint           precision,
+                                             gint           number);
+
+gint64          gimp_name_index_get_memsize (GimpNameIndex *index);
+
+
+#endif /* __GIMP_NAME_INDEX_H__ */
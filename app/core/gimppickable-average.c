@@ -0,0 +1,527 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimppickable-average.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <cairo.h>
+#include <gegl.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "core-types.h"
+
+#include "gimp-memory-manager.h"
+#include "gimpdrawable.h"
+#include "gimpimage.h"
+#include "gimppickable.h"
+#include "gimppickable-average.h"
+#include "gimpprojection.h"
+
+
+#define AVERAGE_CACHE_KEY  "gimp-pickable-average-cache"
+
+/*  the pickable is split into blocks of BLOCK_SIZE x BLOCK_SIZE
+ *  pixels, each with a summed-area table built when the block is
+ *  first sampled. At most MAX_TABLES tables are kept at a time, the
+ *  least recently used ones are dropped but their block sums are kept.
+ *
+ *  the whole cache is tracked by the memory manager, which may drop
+ *  it when memory runs low; it is rebuilt on the next pick.
+ */
+#define BLOCK_SIZE         64
+#define TABLE_STRIDE       (BLOCK_SIZE + 1)
+#define MAX_TABLES         64
+
+
+typedef struct
+{
+  gboolean  valid;
+  gdouble   sum[4];
+
+  /*  TABLE_STRIDE x TABLE_STRIDE sums of RaGaBaA double, the first
+   *  row and column are zero
+   */
+  gdouble  *table;
+  GList    *link;
+} AverageBlock;
+
+typedef struct
+{
+  GObject       *notifier;
+  gulong         update_handler;
+
+  GeglBuffer    *buffer;
+  GeglRectangle  extent;
+
+  gint           n_cols;
+  gint           n_rows;
+  AverageBlock  *blocks;
+
+  GQueue         tables;
+} AverageCache;
+
+
+/*  local function prototypes  */
+
+static AverageCache * gimp_pickable_average_cache_get     (GimpPickable        *pickable,
+                                                           GeglBuffer          *buffer);
+static void           gimp_pickable_average_cache_free    (AverageCache        *cache);
+static gint64         gimp_pickable_average_cache_get_size
+                                                          (AverageCache        *cache,
+                                                           gpointer             data);
+static gboolean       gimp_pickable_average_cache_evict   (AverageCache        *cache,
+                                                           gpointer             data);
+static void           gimp_pickable_average_cache_invalidate
+                                                          (AverageCache        *cache,
+                                                           gint                 x,
+                                                           gint                 y,
+                                                           gint                 width,
+                                                           gint                 height);
+static void           gimp_pickable_average_drawable_update
+                                                          (GimpDrawable        *drawable,
+                                                           gint                 x,
+                                                           gint                 y,
+                                                           gint                 width,
+                                                           gint                 height,
+                                                           AverageCache        *cache);
+static void           gimp_pickable_average_projection_update
+                                                          (GimpProjection      *proj,
+                                                           gboolean             now,
+                                                           gint                 x,
+                                                           gint                 y,
+                                                           gint                 width,
+                                                           gint                 height,
+                                                           AverageCache        *cache);
+
+static void           gimp_pickable_average_block_table   (AverageCache        *cache,
+                                                           gint                 col,
+                                                           gint                 row);
+static void           gimp_pickable_average_block_sum     (AverageCache        *cache,
+                                                           gint                 col,
+                                                           gint                 row,
+                                                           const GeglRectangle *rect,
+                                                           gdouble             *sum);
+
+static void           gimp_pickable_average_sum_buffer    (GeglBuffer          *buffer,
+                                                           const GeglRectangle *rect,
+                                                           gdouble             *sum);
+
+
+/*  public functions  */
+
+/**
+ * gimp_pickable_get_average:
+ * @pickable: a #GimpPickable
+ * @rect:     the area to average
+ * @average:  return location for the average, in "RaGaBaA double"
+ *
+ * Averages the pixels of @pickable inside @rect, ignoring the parts
+ * of @rect that lie outside of the pickable.
+ *
+ * Drawables, images and projections keep per-block summed-area tables
+ * which are updated as the pickable changes, so that picking again
+ * only costs a few lookups per block touched by @rect instead of
+ * reading each pixel.
+ *
+ * Return value: the number of pixels averaged, 0 if @rect does not
+ * intersect @pickable, in which case @average is left untouched.
+ **/
+gint
+gimp_pickable_get_average (GimpPickable        *pickable,
+                           const GeglRectangle *rect,
+                           gdouble             *average)
+{
+  GeglBuffer    *buffer;
+  AverageCache  *cache;
+  GeglRectangle  area;
+  gdouble        sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+  gint           n_pixels;
+  gint           c;
+
+  g_return_val_if_fail (GIMP_IS_PICKABLE (pickable), 0);
+  g_return_val_if_fail (rect != NULL, 0);
+  g_return_val_if_fail (average != NULL, 0);
+
+  /*  an image's pixels are its projection's, keep the tables there  */
+  if (GIMP_IS_IMAGE (pickable))
+    pickable = GIMP_PICKABLE (gimp_image_get_projection (GIMP_IMAGE (pickable)));
+
+  buffer = gimp_pickable_get_buffer (pickable);
+
+  if (! gegl_rectangle_intersect (&area, rect, gegl_buffer_get_extent (buffer)))
+    return 0;
+
+  n_pixels = area.width * area.height;
+
+  cache = gimp_pickable_average_cache_get (pickable, buffer);
+
+  if (cache)
+    {
+      gint first_col = (area.x - cache->extent.x) / BLOCK_SIZE;
+      gint first_row = (area.y - cache->extent.y) / BLOCK_SIZE;
+      gint last_col  = (area.x + area.width  - 1 - cache->extent.x) / BLOCK_SIZE;
+      gint last_row  = (area.y + area.height - 1 - cache->extent.y) / BLOCK_SIZE;
+      gint col, row;
+
+      for (row = first_row; row <= last_row; row++)
+        for (col = first_col; col <= last_col; col++)
+          gimp_pickable_average_block_sum (cache, col, row, &area, sum);
+    }
+  else
+    {
+      gimp_pickable_average_sum_buffer (buffer, &area, sum);
+    }
+
+  for (c = 0; c < 4; c++)
+    average[c] = sum[c] / n_pixels;
+
+  return n_pixels;
+}
+
+
+/*  private functions  */
+
+static AverageCache *
+gimp_pickable_average_cache_get (GimpPickable *pickable,
+                                 GeglBuffer   *buffer)
+{
+  AverageCache        *cache;
+  const GeglRectangle *extent = gegl_buffer_get_extent (buffer);
+
+  if (! GIMP_IS_DRAWABLE (pickable) && ! GIMP_IS_PROJECTION (pickable))
+    return NULL;
+
+  cache = g_object_get_data (G_OBJECT (pickable), AVERAGE_CACHE_KEY);
+
+  /*  the buffer was replaced or resized, start over  */
+  if (cache &&
+      (cache->buffer != buffer ||
+       ! gegl_rectangle_equal (&cache->extent, extent)))
+    {
+      g_object_set_data (G_OBJECT (pickable), AVERAGE_CACHE_KEY, NULL);
+      cache = NULL;
+    }
+
+  if (cache)
+    {
+      gimp_memory_manager_touch (cache);
+
+      return cache;
+    }
+
+  cache = g_slice_new0 (AverageCache);
+
+  cache->notifier = G_OBJECT (pickable);
+  cache->buffer   = buffer;
+  cache->extent   = *extent;
+  cache->n_cols   = (extent->width  + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  cache->n_rows   = (extent->height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  cache->blocks   = g_new0 (AverageBlock, cache->n_cols * cache->n_rows);
+
+  g_queue_init (&cache->tables);
+
+  g_object_add_weak_pointer (G_OBJECT (buffer), (gpointer *) &cache->buffer);
+
+  /*  projection updates are in image coordinates, which are the
+   *  buffer's for the image projections we get here
+   */
+  if (GIMP_IS_DRAWABLE (pickable))
+    cache->update_handler =
+      g_signal_connect (pickable, "update",
+                        G_CALLBACK (gimp_pickable_average_drawable_update),
+                        cache);
+  else
+    cache->update_handler =
+      g_signal_connect (pickable, "update",
+                        G_CALLBACK (gimp_pickable_average_projection_update),
+                        cache);
+
+  g_object_set_data_full (G_OBJECT (pickable), AVERAGE_CACHE_KEY, cache,
+                          (GDestroyNotify) gimp_pickable_average_cache_free);
+
+  gimp_memory_manager_add (cache,
+                           (GimpMemoryManagerSizeFunc)
+                           gimp_pickable_average_cache_get_size,
+                           (GimpMemoryManagerEvictFunc)
+                           gimp_pickable_average_cache_evict,
+                           NULL);
+
+  return cache;
+}
+
+static void
+gimp_pickable_average_cache_free (AverageCache *cache)
+{
+  gint i;
+
+  gimp_memory_manager_remove (cache);
+
+  if (g_signal_handler_is_connected (cache->notifier, cache->update_handler))
+    g_signal_handler_disconnect (cache->notifier, cache->update_handler);
+
+  if (cache->buffer)
+    g_object_remove_weak_pointer (G_OBJECT (cache->buffer),
+                                  (gpointer *) &cache->buffer);
+
+  for (i = 0; i < cache->n_cols * cache->n_rows; i++)
+    g_free (cache->blocks[i].table);
+
+  g_queue_clear (&cache->tables);
+  g_free (cache->blocks);
+
+  g_slice_free (AverageCache, cache);
+}
+
+static gint64
+gimp_pickable_average_cache_get_size (AverageCache *cache,
+                                      gpointer      data)
+{
+  return (sizeof (AverageCache) +
+          (gint64) cache->n_cols * cache->n_rows * sizeof (AverageBlock) +
+          (gint64) g_queue_get_length (&cache->tables) *
+          TABLE_STRIDE * TABLE_STRIDE * 4 * sizeof (gdouble));
+}
+
+static gboolean
+gimp_pickable_average_cache_evict (AverageCache *cache,
+                                   gpointer      data)
+{
+  /*  frees the cache, and untracks it  */
+  g_object_set_data (cache->notifier, AVERAGE_CACHE_KEY, NULL);
+
+  return TRUE;
+}
+
+static void
+gimp_pickable_average_cache_invalidate (AverageCache *cache,
+                                        gint          x,
+                                        gint          y,
+                                        gint          width,
+                                        gint          height)
+{
+  GeglRectangle area;
+  gint          first_col, first_row;
+  gint          last_col,  last_row;
+  gint          col, row;
+
+  if (! gegl_rectangle_intersect (&area,
+                                  GEGL_RECTANGLE (x, y, width, height),
+                                  &cache->extent))
+    return;
+
+  first_col = (area.x - cache->extent.x) / BLOCK_SIZE;
+  first_row = (area.y - cache->extent.y) / BLOCK_SIZE;
+  last_col  = (area.x + area.width  - 1 - cache->extent.x) / BLOCK_SIZE;
+  last_row  = (area.y + area.height - 1 - cache->extent.y) / BLOCK_SIZE;
+
+  for (row = first_row; row <= last_row; row++)
+    for (col = first_col; col <= last_col; col++)
+      {
+        AverageBlock *block = &cache->blocks[row * cache->n_cols + col];
+
+        if (block->table)
+          {
+            g_queue_delete_link (&cache->tables, block->link);
+
+            g_free (block->table);
+            block->table = NULL;
+            block->link  = NULL;
+          }
+
+        block->valid = FALSE;
+      }
+}
+
+static void
+gimp_pickable_average_drawable_update (GimpDrawable *drawable,
+                                       gint          x,
+                                       gint          y,
+                                       gint          width,
+                                       gint          height,
+                                       AverageCache *cache)
+{
+  gimp_pickable_average_cache_invalidate (cache, x, y, width, height);
+}
+
+static void
+gimp_pickable_average_projection_update (GimpProjection *proj,
+                                         gboolean        now,
+                                         gint            x,
+                                         gint            y,
+                                         gint            width,
+                                         gint            height,
+                                         AverageCache   *cache)
+{
+  gimp_pickable_average_cache_invalidate (cache, x, y, width, height);
+}
+
+static void
+gimp_pickable_average_block_table (AverageCache *cache,
+                                   gint          col,
+                                   gint          row)
+{
+  AverageBlock  *block = &cache->blocks[row * cache->n_cols + col];
+  GeglRectangle  rect;
+  gdouble       *data;
+  gdouble       *table;
+  gint           x, y, c;
+
+  if (block->table)
+    {
+      /*  most recently used tables go to the head  */
+      g_queue_unlink (&cache->tables, block->link);
+      g_queue_push_head_link (&cache->tables, block->link);
+
+      return;
+    }
+
+  if (g_queue_get_length (&cache->tables) >= MAX_TABLES)
+    {
+      AverageBlock *old = g_queue_pop_tail (&cache->tables);
+
+      g_free (old->table);
+      old->table = NULL;
+      old->link  = NULL;
+    }
+
+  rect.x      = cache->extent.x + col * BLOCK_SIZE;
+  rect.y      = cache->extent.y + row * BLOCK_SIZE;
+  rect.width  = MIN (BLOCK_SIZE, cache->extent.x + cache->extent.width  - rect.x);
+  rect.height = MIN (BLOCK_SIZE, cache->extent.y + cache->extent.height - rect.y);
+
+  data  = g_new (gdouble, rect.width * rect.height * 4);
+  table = g_new0 (gdouble, TABLE_STRIDE * TABLE_STRIDE * 4);
+
+  gegl_buffer_get (cache->buffer, &rect, 1.0,
+                   babl_format ("RaGaBaA double"), data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (y = 0; y < rect.height; y++)
+    {
+      const gdouble *src   = data + y * rect.width * 4;
+      gdouble       *above = table + y       * TABLE_STRIDE * 4;
+      gdouble       *dest  = table + (y + 1) * TABLE_STRIDE * 4;
+      gdouble        row_sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+      for (x = 0; x < rect.width; x++)
+        for (c = 0; c < 4; c++)
+          {
+            row_sum[c] += src[x * 4 + c];
+
+            dest[(x + 1) * 4 + c] = above[(x + 1) * 4 + c] + row_sum[c];
+          }
+    }
+
+  g_free (data);
+
+  block->table = table;
+
+  if (! block->valid)
+    {
+      const gdouble *corner = table + (rect.height * TABLE_STRIDE +
+                                       rect.width) * 4;
+
+      memcpy (block->sum, corner, sizeof (block->sum));
+
+      block->valid = TRUE;
+    }
+
+  g_queue_push_head (&cache->tables, block);
+  block->link = cache->tables.head;
+}
+
+static void
+gimp_pickable_average_block_sum (AverageCache        *cache,
+                                 gint                 col,
+                                 gint                 row,
+                                 const GeglRectangle *rect,
+                                 gdouble             *sum)
+{
+  AverageBlock  *block = &cache->blocks[row * cache->n_cols + col];
+  GeglRectangle  block_rect;
+  GeglRectangle  area;
+  gint           x1, y1, x2, y2;
+  gint           c;
+
+  block_rect.x      = cache->extent.x + col * BLOCK_SIZE;
+  block_rect.y      = cache->extent.y + row * BLOCK_SIZE;
+  block_rect.width  = MIN (BLOCK_SIZE,
+                           cache->extent.x + cache->extent.width  - block_rect.x);
+  block_rect.height = MIN (BLOCK_SIZE,
+                           cache->extent.y + cache->extent.height - block_rect.y);
+
+  gegl_rectangle_intersect (&area, &block_rect, rect);
+
+  if (gegl_rectangle_equal (&area, &block_rect))
+    {
+      if (! block->valid)
+        gimp_pickable_average_block_table (cache, col, row);
+
+      for (c = 0; c < 4; c++)
+        sum[c] += block->sum[c];
+
+      return;
+    }
+
+  gimp_pickable_average_block_table (cache, col, row);
+
+  x1 = area.x - block_rect.x;
+  y1 = area.y - block_rect.y;
+  x2 = x1 + area.width;
+  y2 = y1 + area.height;
+
+  for (c = 0; c < 4; c++)
+    {
+      const gdouble *table = block->table;
+
+      sum[c] += (table[(y2 * TABLE_STRIDE + x2) * 4 + c] -
+                 table[(y1 * TABLE_STRIDE + x2) * 4 + c] -
+                 table[(y2 * TABLE_STRIDE + x1) * 4 + c] +
+                 table[(y1 * TABLE_STRIDE + x1) * 4 + c]);
+    }
+}
+
+static void
+gimp_pickable_average_sum_buffer (GeglBuffer          *buffer,
+                                  const GeglRectangle *rect,
+                                  gdouble             *sum)
+{
+  GeglBufferIterator *iter;
+
+  iter = gegl_buffer_iterator_new (buffer, rect, 0,
+                                   babl_format ("RaGaBaA double"),
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const gdouble *data  = iter->data[0];
+      gint           count = iter->length;
+
+      while (count--)
+        {
+          sum[0] += data[0];
+          sum[1] += data[1];
+          sum[2] += data[2];
+          sum[3] += data[3];
+
+          data += 4;
+        }
+    }
+}
@@ -18,6 +18,7 @@
 #include "config.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <cairo.h>
 #include <gegl.h>
@@ -30,11 +31,85 @@
 
 #include "gegl/gimp-babl.h"
 
+#include "gimp-parallel.h"
 #include "gimp-utils.h" /* GIMP_TIMER */
 #include "gimppickable.h"
 #include "gimppickable-contiguous-region.h"
 
 
+#define TILE_SHIFT         6
+#define TILE_SIZE          (1 << TILE_SHIFT)
+
+/*  the sequential fill hands over to the parallel one once it has
+ *  fetched more than 1/MAX_TILED_FRACTION of the image's tiles
+ */
+#define MAX_TILED_FRACTION 8
+#define MIN_TILED_TILES    64
+
+
+typedef struct
+{
+  gint y;
+  gint old_y;
+  gint start;
+  gint end;
+} Segment;
+
+typedef struct
+{
+  GeglBuffer          *src_buffer;
+  const Babl          *format;
+  gint                 n_components;
+  gboolean             has_alpha;
+  gboolean             select_transparent;
+  GimpSelectCriterion  select_criterion;
+  gboolean             antialias;
+  gfloat               threshold;
+  const gfloat        *col;
+  gint                 width;
+  gint                 height;
+} RegionParams;
+
+typedef struct
+{
+  const RegionParams  *params;
+  gint                 n_tiles_x;
+  gint                 n_tiles_y;
+  gfloat             **tiles;      /*  per-tile differences, or NULL  */
+  gint                 n_fetched;
+  gfloat              *src;        /*  scratch for one tile of pixels */
+} TileCache;
+
+typedef struct
+{
+  gint start;
+  gint end;
+} Run;
+
+typedef struct
+{
+  gint    y1;
+  gint    y2;
+  GArray *runs;      /*  the runs of matching pixels, row by row       */
+  GArray *parent;    /*  union-find parents, indexed like runs         */
+  gint   *row_runs;  /*  index of the first run of each row, and end   */
+  gint    offset;    /*  index of the first run in the merged labels   */
+} Band;
+
+typedef struct
+{
+  const RegionParams *params;
+  GeglBuffer         *mask_buffer;
+  gint                reach;
+  gint                tile_height;
+  gint                n_tile_rows;
+  Band               *bands;
+  gint                n_bands;
+  gint               *parent;
+  gint                root;
+} ParallelRegion;
+
+
 /*  local function prototypes  */
 
 static const Babl * choose_format         (GeglBuffer          *buffer,
@@ -49,7 +124,11 @@ static gfloat   pixel_difference          (const gfloat        *col1,
                                            gboolean             has_alpha,
                                            gboolean             select_transparent,
                                            GimpSelectCriterion  select_criterion);
-static void     push_segment              (GQueue              *segment_queue,
+static void     row_difference            (const RegionParams  *params,
+                                           const gfloat        *src,
+                                           gfloat              *diff,
+                                           gint                 n_pixels);
+static void     push_segment              (GArray              *segment_stack,
                                            gint                 y,
                                            gint                 old_y,
                                            gint                 start,
@@ -57,28 +136,29 @@ static void     push_segment              (GQueue              *segment_queue,
                                            gint                 new_y,
                                            gint                 new_start,
                                            gint                 new_end);
-static void     pop_segment               (GQueue              *segment_queue,
+static void     pop_segment               (GArray              *segment_stack,
                                            gint                *y,
                                            gint                *old_y,
                                            gint                *start,
                                            gint                *end);
-static gboolean find_contiguous_segment   (const gfloat        *col,
-                                           GeglBuffer          *src_buffer,
-                                           GeglBuffer          *mask_buffer,
-                                           const Babl          *src_format,
-                                           const Babl          *mask_format,
-                                           gint                 n_components,
-                                           gboolean             has_alpha,
-                                           gint                 width,
-                                           gboolean             select_transparent,
-                                           GimpSelectCriterion  select_criterion,
-                                           gboolean             antialias,
-                                           gfloat               threshold,
+static gboolean find_contiguous_segment   (TileCache           *cache,
                                            gint                 initial_x,
                                            gint                 initial_y,
                                            gint                *start,
-                                           gint                *end,
-                                           gfloat              *row);
+                                           gint                *end);
+static gboolean find_contiguous_region_tiled
+                                          (const RegionParams  *params,
+                                           GeglBuffer          *mask_buffer,
+                                           gboolean             diagonal_neighbors,
+                                           gint                 x,
+                                           gint                 y,
+                                           gint                 max_tiles);
+static void     find_contiguous_region_parallel
+                                          (const RegionParams  *params,
+                                           GeglBuffer          *mask_buffer,
+                                           gboolean             diagonal_neighbors,
+                                           gint                 x,
+                                           gint                 y);
 static void     find_contiguous_region    (GeglBuffer          *src_buffer,
                                            GeglBuffer          *mask_buffer,
                                            const Babl          *format,
@@ -408,7 +488,27 @@ pixel_difference (const gfloat        *col1,
 }
 
 static void
-push_segment (GQueue *segment_queue,
+row_difference (const RegionParams *params,
+                const gfloat       *src,
+                gfloat             *diff,
+                gint                n_pixels)
+{
+  while (n_pixels--)
+    {
+      *diff++ = pixel_difference (params->col, src,
+                                  params->antialias,
+                                  params->threshold,
+                                  params->n_components,
+                                  params->has_alpha,
+                                  params->select_transparent,
+                                  params->select_criterion);
+
+      src += params->n_components;
+    }
+}
+
+static void
+push_segment (GArray *segment_stack,
               gint    y,
               gint    old_y,
               gint    start,
@@ -417,21 +517,20 @@ push_segment (GQueue *segment_queue,
               gint    new_start,
               gint    new_end)
 {
-  /* To avoid excessive memory allocation (y, old_y, start, end) tuples are
-   * stored in interleaved format:
-   *
-   * [y1] [old_y1] [start1] [end1] [y2] [old_y2] [start2] [end2]
-   */
+  Segment segment;
+
+  segment.y     = new_y;
+  segment.old_y = y;
 
   if (new_y != old_y)
     {
       /* If the new segment's y-coordinate is different than the old (source)
        * segment's y-coordinate, push the entire segment.
        */
-      g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_y));
-      g_queue_push_tail (segment_queue, GINT_TO_POINTER (y));
-      g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_start));
-      g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_end));
+      segment.start = new_start;
+      segment.end   = new_end;
+
+      g_array_append_val (segment_stack, segment);
     }
   else
     {
@@ -443,187 +542,235 @@ push_segment (GQueue *segment_queue,
        */
       if (new_start < start)
         {
-          g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_y));
-          g_queue_push_tail (segment_queue, GINT_TO_POINTER (y));
-          g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_start));
-          g_queue_push_tail (segment_queue, GINT_TO_POINTER (start + 1));
+          segment.start = new_start;
+          segment.end   = start + 1;
+
+          g_array_append_val (segment_stack, segment);
         }
 
       if (new_end > end)
         {
-          g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_y));
-          g_queue_push_tail (segment_queue, GINT_TO_POINTER (y));
-          g_queue_push_tail (segment_queue, GINT_TO_POINTER (end - 1));
-          g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_end));
+          segment.start = end - 1;
+          segment.end   = new_end;
+
+          g_array_append_val (segment_stack, segment);
         }
     }
 }
 
 static void
-pop_segment (GQueue *segment_queue,
+pop_segment (GArray *segment_stack,
              gint   *y,
              gint   *old_y,
              gint   *start,
              gint   *end)
 {
-  *y     = GPOINTER_TO_INT (g_queue_pop_head (segment_queue));
-  *old_y = GPOINTER_TO_INT (g_queue_pop_head (segment_queue));
-  *start = GPOINTER_TO_INT (g_queue_pop_head (segment_queue));
-  *end   = GPOINTER_TO_INT (g_queue_pop_head (segment_queue));
+  const Segment *segment;
+
+  segment = &g_array_index (segment_stack, Segment, segment_stack->len - 1);
+
+  *y     = segment->y;
+  *old_y = segment->old_y;
+  *start = segment->start;
+  *end   = segment->end;
+
+  g_array_set_size (segment_stack, segment_stack->len - 1);
+}
+
+static gfloat *
+tile_cache_fetch (TileCache *cache,
+                  gint       tile_x,
+                  gint       tile_y)
+{
+  const RegionParams  *params = cache->params;
+  gfloat             **tile;
+
+  tile = &cache->tiles[tile_y * cache->n_tiles_x + tile_x];
+
+  if (! *tile)
+    {
+      GeglRectangle rect;
+      gint          y;
+
+      rect.x      = tile_x * TILE_SIZE;
+      rect.y      = tile_y * TILE_SIZE;
+      rect.width  = MIN (TILE_SIZE, params->width  - rect.x);
+      rect.height = MIN (TILE_SIZE, params->height - rect.y);
+
+      *tile = g_new0 (gfloat, TILE_SIZE * TILE_SIZE);
+
+      gegl_buffer_get (params->src_buffer, &rect, 1.0,
+                       params->format, cache->src,
+                       sizeof (gfloat) * params->n_components * TILE_SIZE,
+                       GEGL_ABYSS_NONE);
+
+      for (y = 0; y < rect.height; y++)
+        {
+          row_difference (params,
+                          cache->src + y * TILE_SIZE * params->n_components,
+                          *tile + y * TILE_SIZE,
+                          rect.width);
+        }
+
+      cache->n_fetched++;
+    }
+
+  return *tile;
+}
+
+/*  returns the difference of the pixel at (x, y) from the seed color,
+ *  which is stored negated once the pixel is selected
+ */
+static inline gfloat *
+tile_cache_get (TileCache *cache,
+                gint       x,
+                gint       y)
+{
+  gint    tile_x = x >> TILE_SHIFT;
+  gint    tile_y = y >> TILE_SHIFT;
+  gfloat *tile   = cache->tiles[tile_y * cache->n_tiles_x + tile_x];
+
+  if (G_UNLIKELY (! tile))
+    tile = tile_cache_fetch (cache, tile_x, tile_y);
+
+  return tile + ((y & (TILE_SIZE - 1)) << TILE_SHIFT) + (x & (TILE_SIZE - 1));
 }
 
-/* #define FETCH_ROW 1 */
+static void
+tile_cache_write (TileCache  *cache,
+                  GeglBuffer *mask_buffer)
+{
+  const RegionParams *params = cache->params;
+  gint                tile_x, tile_y;
+
+  for (tile_y = 0; tile_y < cache->n_tiles_y; tile_y++)
+    for (tile_x = 0; tile_x < cache->n_tiles_x; tile_x++)
+      {
+        gfloat        *tile = cache->tiles[tile_y * cache->n_tiles_x + tile_x];
+        gboolean       selected = FALSE;
+        GeglRectangle  rect;
+        gint           i;
+
+        if (! tile)
+          continue;
+
+        for (i = 0; i < TILE_SIZE * TILE_SIZE; i++)
+          {
+            if (tile[i] < 0.0)
+              {
+                tile[i]  = -tile[i];
+                selected = TRUE;
+              }
+            else
+              {
+                tile[i] = 0.0;
+              }
+          }
+
+        if (! selected)
+          continue;
+
+        rect.x      = tile_x * TILE_SIZE;
+        rect.y      = tile_y * TILE_SIZE;
+        rect.width  = MIN (TILE_SIZE, params->width  - rect.x);
+        rect.height = MIN (TILE_SIZE, params->height - rect.y);
+
+        gegl_buffer_set (mask_buffer, &rect, 0, babl_format ("Y float"),
+                         tile, sizeof (gfloat) * TILE_SIZE);
+      }
+}
 
 static gboolean
-find_contiguous_segment (const gfloat        *col,
-                         GeglBuffer          *src_buffer,
-                         GeglBuffer          *mask_buffer,
-                         const Babl          *src_format,
-                         const Babl          *mask_format,
-                         gint                 n_components,
-                         gboolean             has_alpha,
-                         gint                 width,
-                         gboolean             select_transparent,
-                         GimpSelectCriterion  select_criterion,
-                         gboolean             antialias,
-                         gfloat               threshold,
-                         gint                 initial_x,
-                         gint                 initial_y,
-                         gint                *start,
-                         gint                *end,
-                         gfloat              *row)
+find_contiguous_segment (TileCache *cache,
+                         gint       initial_x,
+                         gint       initial_y,
+                         gint      *start,
+                         gint      *end)
 {
-  gfloat *s;
-  gfloat  mask_row[width];
-  gfloat  diff;
-
-#ifdef FETCH_ROW
-  gegl_buffer_get (src_buffer, GEGL_RECTANGLE (0, initial_y, width, 1), 1.0,
-                   src_format,
-                   row, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-  s = row + initial_x * n_components;
-#else
-  s = g_alloca (n_components * sizeof (gfloat));
-
-  gegl_buffer_sample (src_buffer, initial_x, initial_y, NULL, s, src_format,
-                      GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-#endif
+  gfloat *p;
 
-  diff = pixel_difference (col, s, antialias, threshold,
-                           n_components, has_alpha, select_transparent,
-                           select_criterion);
+  p = tile_cache_get (cache, initial_x, initial_y);
 
   /* check the starting pixel */
-  if (! diff)
+  if (*p == 0.0)
     return FALSE;
 
-  mask_row[initial_x] = diff;
+  *p = -fabs (*p);
 
   *start = initial_x - 1;
-#ifdef FETCH_ROW
-  s = row + *start * n_components;
-#endif
 
   while (*start >= 0)
     {
-#ifndef FETCH_ROW
-      gegl_buffer_sample (src_buffer, *start, initial_y, NULL, s, src_format,
-                          GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-#endif
-
-      diff = pixel_difference (col, s, antialias, threshold,
-                               n_components, has_alpha, select_transparent,
-                               select_criterion);
-      if (diff == 0.0)
+      p = tile_cache_get (cache, *start, initial_y);
+
+      if (*p == 0.0)
         break;
 
-      mask_row[*start] = diff;
+      *p = -fabs (*p);
 
       (*start)--;
-#ifdef FETCH_ROW
-      s -= n_components;
-#endif
     }
 
   *end = initial_x + 1;
-#ifdef FETCH_ROW
-  s = row + *end * n_components;
-#endif
 
-  while (*end < width)
+  while (*end < cache->params->width)
     {
-#ifndef FETCH_ROW
-      gegl_buffer_sample (src_buffer, *end, initial_y, NULL, s, src_format,
-                          GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-#endif
-
-      diff = pixel_difference (col, s, antialias, threshold,
-                               n_components, has_alpha, select_transparent,
-                               select_criterion);
-      if (diff == 0.0)
+      p = tile_cache_get (cache, *end, initial_y);
+
+      if (*p == 0.0)
         break;
 
-      mask_row[*end] = diff;
+      *p = -fabs (*p);
 
       (*end)++;
-#ifdef FETCH_ROW
-      s += n_components;
-#endif
     }
 
-  gegl_buffer_set (mask_buffer, GEGL_RECTANGLE (*start + 1, initial_y,
-                                                *end - *start - 1, 1),
-                   0, mask_format, &mask_row[*start + 1],
-                   GEGL_AUTO_ROWSTRIDE);
-
   return TRUE;
 }
 
-static void
-find_contiguous_region (GeglBuffer          *src_buffer,
-                        GeglBuffer          *mask_buffer,
-                        const Babl          *format,
-                        gint                 n_components,
-                        gboolean             has_alpha,
-                        gboolean             select_transparent,
-                        GimpSelectCriterion  select_criterion,
-                        gboolean             antialias,
-                        gfloat               threshold,
-                        gboolean             diagonal_neighbors,
-                        gint                 x,
-                        gint                 y,
-                        const gfloat        *col)
+/*  the scanline flood fill, on a cache of per-tile color differences
+ *  which only covers the tiles the region touches.  gives up, without
+ *  touching @mask_buffer, once more than @max_tiles tiles have been
+ *  fetched, unless @max_tiles is 0.
+ */
+static gboolean
+find_contiguous_region_tiled (const RegionParams *params,
+                              GeglBuffer         *mask_buffer,
+                              gboolean            diagonal_neighbors,
+                              gint                x,
+                              gint                y,
+                              gint                max_tiles)
 {
-  const Babl *mask_format = babl_format ("Y float");
-  gint        old_y;
-  gint        start, end;
-  gint        new_start, new_end;
-  GQueue     *segment_queue;
-  gfloat     *row = NULL;
-
-#ifdef FETCH_ROW
-  row = g_new (gfloat, gegl_buffer_get_width (src_buffer) * n_components);
-#endif
-
-  segment_queue = g_queue_new ();
-
-  push_segment (segment_queue,
+  TileCache  cache;
+  GArray    *segment_stack;
+  gint       old_y;
+  gint       start, end;
+  gint       new_start, new_end;
+  gboolean   completed = TRUE;
+  gint       i;
+
+  cache.params    = params;
+  cache.n_tiles_x = (params->width  + TILE_SIZE - 1) / TILE_SIZE;
+  cache.n_tiles_y = (params->height + TILE_SIZE - 1) / TILE_SIZE;
+  cache.tiles     = g_new0 (gfloat *, cache.n_tiles_x * cache.n_tiles_y);
+  cache.n_fetched = 0;
+  cache.src       = g_new (gfloat,
+                           TILE_SIZE * TILE_SIZE * params->n_components);
+
+  segment_stack = g_array_sized_new (FALSE, FALSE, sizeof (Segment), 256);
+
+  push_segment (segment_stack,
                 y, /* dummy values: */ -1, 0, 0,
                 y, x - 1, x + 1);
 
   do
     {
-      pop_segment (segment_queue,
+      pop_segment (segment_stack,
                    &y, &old_y, &start, &end);
 
       for (x = start + 1; x < end; x++)
         {
-          gfloat val;
-
-          gegl_buffer_sample (mask_buffer, x, y, NULL, &val,
-                              mask_format,
-                              GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-          if (val != 0.0)
+          if (*tile_cache_get (&cache, x, y) < 0.0)
             {
               /* If the current pixel is selected, then we've already visited
                * the next pixel.  (Note that we assume that the maximal image
@@ -633,15 +780,8 @@ find_contiguous_region (GeglBuffer          *src_buffer,
               continue;
             }
 
-          if (! find_contiguous_segment (col, src_buffer, mask_buffer,
-                                         format, mask_format,
-                                         n_components,
-                                         has_alpha,
-                                         gegl_buffer_get_width (src_buffer),
-                                         select_transparent, select_criterion,
-                                         antialias, threshold, x, y,
-                                         &new_start, &new_end,
-                                         row))
+          if (! find_contiguous_segment (&cache, x, y,
+                                         &new_start, &new_end))
             continue;
 
           /* We can skip directly to `new_end + 1` on the next iteration, since
@@ -657,31 +797,447 @@ find_contiguous_region (GeglBuffer          *src_buffer,
               if (new_start >= 0)
                 new_start--;
 
-              if (new_end < gegl_buffer_get_width (src_buffer))
+              if (new_end < params->width)
                 new_end++;
             }
 
-          if (y + 1 < gegl_buffer_get_height (src_buffer))
+          if (y + 1 < params->height)
             {
-              push_segment (segment_queue,
+              push_segment (segment_stack,
                             y, old_y, start, end,
                             y + 1, new_start, new_end);
             }
 
           if (y - 1 >= 0)
             {
-              push_segment (segment_queue,
+              push_segment (segment_stack,
                             y, old_y, start, end,
                             y - 1, new_start, new_end);
             }
+        }
+
+      if (max_tiles > 0 && cache.n_fetched > max_tiles)
+        {
+          completed = FALSE;
+          break;
+        }
+    }
+  while (segment_stack->len > 0);
+
+  if (completed)
+    tile_cache_write (&cache, mask_buffer);
+
+  g_array_free (segment_stack, TRUE);
+
+  for (i = 0; i < cache.n_tiles_x * cache.n_tiles_y; i++)
+    g_free (cache.tiles[i]);
+
+  g_free (cache.tiles);
+  g_free (cache.src);
+
+  return completed;
+}
+
+static inline gint
+find_root (gint *parent,
+           gint  i)
+{
+  while (parent[i] != i)
+    {
+      parent[i] = parent[parent[i]];
+      i = parent[i];
+    }
+
+  return i;
+}
+
+static inline void
+union_runs (gint *parent,
+            gint  i,
+            gint  j)
+{
+  i = find_root (parent, i);
+  j = find_root (parent, j);
+
+  /*  always keep the lower index as root, so the result doesn't
+   *  depend on the order of the unions
+   */
+  if (i < j)
+    parent[j] = i;
+  else if (j < i)
+    parent[i] = j;
+}
+
+/*  unions the overlapping runs [@prev_first, @prev_last) of one row
+ *  with the runs [@first, @last) of the row below it, @prev_offset and
+ *  @offset map the run indices to indices into @parent
+ */
+static void
+union_rows (gint      *parent,
+            const Run *prev_runs,
+            gint       prev_offset,
+            gint       prev_first,
+            gint       prev_last,
+            const Run *runs,
+            gint       offset,
+            gint       first,
+            gint       last,
+            gint       reach)
+{
+  gint i = prev_first;
+  gint j = first;
+
+  while (i < prev_last && j < last)
+    {
+      const Run *a = &prev_runs[i];
+      const Run *b = &runs[j];
+
+      if (a->end + reach <= b->start)
+        {
+          i++;
+        }
+      else if (b->end + reach <= a->start)
+        {
+          j++;
+        }
+      else
+        {
+          union_runs (parent, prev_offset + i, offset + j);
+
+          if (a->end < b->end)
+            i++;
+          else
+            j++;
+        }
+    }
+}
+
+static void
+find_band_runs (ParallelRegion *region,
+                gint            i,
+                gfloat         *src,
+                gfloat         *diff)
+{
+  const RegionParams *params = region->params;
+  Band               *band   = &region->bands[i];
+  gint                width  = params->width;
+  gint                y;
+
+  band->y1 = MIN (params->height,
+                  (region->n_tile_rows *  i)      / region->n_bands *
+                  region->tile_height);
+  band->y2 = MIN (params->height,
+                  (region->n_tile_rows * (i + 1)) / region->n_bands *
+                  region->tile_height);
+
+  band->runs     = g_array_new (FALSE, FALSE, sizeof (Run));
+  band->parent   = g_array_new (FALSE, FALSE, sizeof (gint));
+  band->row_runs = g_new (gint, band->y2 - band->y1 + 1);
+
+  for (y = band->y1; y < band->y2; y++)
+    {
+      gint row = y - band->y1;
+      gint x   = 0;
+
+      band->row_runs[row] = band->runs->len;
+
+      gegl_buffer_get (params->src_buffer, GEGL_RECTANGLE (0, y, width, 1),
+                       1.0, params->format, src,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      row_difference (params, src, diff, width);
+
+      while (x < width)
+        {
+          Run  run;
+          gint index;
+
+          while (x < width && diff[x] == 0.0)
+            x++;
+
+          if (x == width)
+            break;
+
+          run.start = x;
+
+          while (x < width && diff[x] != 0.0)
+            x++;
+
+          run.end = x;
+
+          index = band->parent->len;
+
+          g_array_append_val (band->runs,   run);
+          g_array_append_val (band->parent, index);
+        }
+
+      if (row > 0)
+        {
+          const Run *runs = (const Run *) band->runs->data;
+
+          union_rows ((gint *) band->parent->data,
+                      runs, 0, band->row_runs[row - 1], band->row_runs[row],
+                      runs, 0, band->row_runs[row],     band->runs->len,
+                      region->reach);
+        }
+    }
+
+  band->row_runs[band->y2 - band->y1] = band->runs->len;
+}
+
+static void
+find_runs_func (gint     i,
+                gint     n,
+                gpointer user_data)
+{
+  ParallelRegion     *region = user_data;
+  const RegionParams *params = region->params;
+  gfloat             *src;
+  gfloat             *diff;
+  gint                b;
+
+  src  = g_new (gfloat, params->width * params->n_components);
+  diff = g_new (gfloat, params->width);
+
+  for (b = i; b < region->n_bands; b += n)
+    find_band_runs (region, b, src, diff);
+
+  g_free (diff);
+  g_free (src);
+}
+
+static void
+write_runs_func (gint     i,
+                 gint     n,
+                 gpointer user_data)
+{
+  ParallelRegion     *region = user_data;
+  const RegionParams *params = region->params;
+  gint                width  = params->width;
+  gfloat             *src;
+  gfloat             *mask;
+  gint                b;
+
+  src  = g_new  (gfloat, width * params->n_components);
+  mask = g_new0 (gfloat, width);
+
+  for (b = i; b < region->n_bands; b += n)
+    {
+      const Band *band = &region->bands[b];
+      const Run  *runs = (const Run *) band->runs->data;
+      gint        y;
+
+      for (y = band->y1; y < band->y2; y++)
+        {
+          gint row   = y - band->y1;
+          gint x1    = width;
+          gint x2    = 0;
+          gint k;
+
+          for (k = band->row_runs[row]; k < band->row_runs[row + 1]; k++)
+            {
+              if (region->parent[band->offset + k] == region->root)
+                {
+                  x1 = MIN (x1, runs[k].start);
+                  x2 = MAX (x2, runs[k].end);
+                }
+            }
+
+          if (x1 >= x2)
+            continue;
+
+          gegl_buffer_get (params->src_buffer,
+                           GEGL_RECTANGLE (x1, y, x2 - x1, 1),
+                           1.0, params->format, src,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          for (k = band->row_runs[row]; k < band->row_runs[row + 1]; k++)
+            {
+              if (region->parent[band->offset + k] == region->root)
+                {
+                  row_difference (params,
+                                  src + (runs[k].start - x1) *
+                                        params->n_components,
+                                  mask + runs[k].start,
+                                  runs[k].end - runs[k].start);
+                }
+            }
+
+          gegl_buffer_set (region->mask_buffer,
+                           GEGL_RECTANGLE (x1, y, x2 - x1, 1),
+                           0, babl_format ("Y float"), mask + x1,
+                           GEGL_AUTO_ROWSTRIDE);
+
+          memset (mask + x1, 0, sizeof (gfloat) * (x2 - x1));
+        }
+    }
+
+  g_free (mask);
+  g_free (src);
+}
 
+/*  labels the runs of matching pixels of horizontal bands in parallel,
+ *  merges the labels of neighboring bands with union-find, and writes
+ *  the runs connected to the seed.  always scans the whole image.
+ */
+static void
+find_contiguous_region_parallel (const RegionParams *params,
+                                 GeglBuffer         *mask_buffer,
+                                 gboolean            diagonal_neighbors,
+                                 gint                x,
+                                 gint                y)
+{
+  ParallelRegion  region;
+  gint            n_runs = 0;
+  gint            seed   = -1;
+  gint            i, k;
+
+  region.params      = params;
+  region.mask_buffer = mask_buffer;
+  region.reach       = diagonal_neighbors ? 1 : 0;
+
+  /*  bands are made of whole mask tiles, so that no two threads
+   *  write to the same tile
+   */
+  g_object_get (mask_buffer,
+                "tile-height", &region.tile_height,
+                NULL);
+
+  region.n_tile_rows = (params->height + region.tile_height - 1) /
+                       region.tile_height;
+
+  region.n_bands = MIN (region.n_tile_rows, gimp_parallel_get_n_threads ());
+  region.bands   = g_new0 (Band, region.n_bands);
+
+  gimp_parallel_distribute (region.n_bands, find_runs_func, &region);
+
+  for (i = 0; i < region.n_bands; i++)
+    {
+      region.bands[i].offset = n_runs;
+
+      n_runs += region.bands[i].runs->len;
+    }
+
+  region.parent = g_new (gint, MAX (n_runs, 1));
+
+  for (i = 0; i < region.n_bands; i++)
+    {
+      const Band *band   = &region.bands[i];
+      const gint *parent = (const gint *) band->parent->data;
+
+      for (k = 0; k < band->runs->len; k++)
+        region.parent[band->offset + k] = band->offset + parent[k];
+    }
+
+  /*  merge the labels across band boundaries  */
+  for (i = 1; i < region.n_bands; i++)
+    {
+      const Band *prev = &region.bands[i - 1];
+      const Band *band = &region.bands[i];
+      gint        prev_rows;
+
+      if (prev->y2 == prev->y1 || band->y2 == band->y1)
+        continue;
+
+      prev_rows = prev->y2 - prev->y1;
+
+      union_rows (region.parent,
+                  (const Run *) prev->runs->data, prev->offset,
+                  prev->row_runs[prev_rows - 1], prev->row_runs[prev_rows],
+                  (const Run *) band->runs->data, band->offset,
+                  band->row_runs[0], band->row_runs[1],
+                  region.reach);
+    }
+
+  for (k = 0; k < n_runs; k++)
+    region.parent[k] = find_root (region.parent, k);
+
+  /*  find the run containing the seed, if any  */
+  for (i = 0; i < region.n_bands && seed < 0; i++)
+    {
+      const Band *band = &region.bands[i];
+
+      if (y >= band->y1 && y < band->y2)
+        {
+          const Run *runs = (const Run *) band->runs->data;
+          gint       row  = y - band->y1;
+
+          for (k = band->row_runs[row]; k < band->row_runs[row + 1]; k++)
+            {
+              if (x >= runs[k].start && x < runs[k].end)
+                {
+                  seed = band->offset + k;
+                  break;
+                }
+            }
         }
     }
-  while (! g_queue_is_empty (segment_queue));
 
-  g_queue_free (segment_queue);
+  if (seed >= 0)
+    {
+      region.root = region.parent[seed];
+
+      gimp_parallel_distribute (region.n_bands, write_runs_func, &region);
+    }
+
+  for (i = 0; i < region.n_bands; i++)
+    {
+      g_array_free (region.bands[i].runs,   TRUE);
+      g_array_free (region.bands[i].parent, TRUE);
+      g_free (region.bands[i].row_runs);
+    }
+
+  g_free (region.bands);
+  g_free (region.parent);
+}
 
-#ifdef FETCH_ROW
-  g_free (row);
-#endif
+static void
+find_contiguous_region (GeglBuffer          *src_buffer,
+                        GeglBuffer          *mask_buffer,
+                        const Babl          *format,
+                        gint                 n_components,
+                        gboolean             has_alpha,
+                        gboolean             select_transparent,
+                        GimpSelectCriterion  select_criterion,
+                        gboolean             antialias,
+                        gfloat               threshold,
+                        gboolean             diagonal_neighbors,
+                        gint                 x,
+                        gint                 y,
+                        const gfloat        *col)
+{
+  RegionParams params;
+  gint         max_tiles = 0;
+
+  params.src_buffer         = src_buffer;
+  params.format             = format;
+  params.n_components       = n_components;
+  params.has_alpha          = has_alpha;
+  params.select_transparent = select_transparent;
+  params.select_criterion   = select_criterion;
+  params.antialias          = antialias;
+  params.threshold          = threshold;
+  params.col                = col;
+  params.width              = gegl_buffer_get_width  (src_buffer);
+  params.height             = gegl_buffer_get_height (src_buffer);
+
+  /*  small regions are filled sequentially, only looking at the tiles
+   *  they touch.  once a region turns out to cover a good part of the
+   *  image, scanning all of it in parallel is faster.
+   */
+  if (gimp_parallel_get_n_threads () > 1)
+    {
+      gint n_tiles = ((params.width  + TILE_SIZE - 1) / TILE_SIZE) *
+                     ((params.height + TILE_SIZE - 1) / TILE_SIZE);
+
+      max_tiles = MAX (n_tiles / MAX_TILED_FRACTION, MIN_TILED_TILES);
+    }
+
+  if (! find_contiguous_region_tiled (&params, mask_buffer,
+                                      diagonal_neighbors, x, y,
+                                      max_tiles))
+    {
+      find_contiguous_region_parallel (&params, mask_buffer,
+                                       diagonal_neighbors, x, y);
+    }
 }
@@ -39,6 +39,7 @@
 #include "gimpobject.h"
 #include "gimpimage.h"
 #include "gimppickable.h"
+#include "gimppickable-average.h"
 
 
 static void   gimp_pickable_interface_base_init (GimpPickableInterface *iface);
@@ -292,29 +293,15 @@ gimp_pickable_pick_color (GimpPickable *pickable,
 
   if (sample_average)
     {
-      gint    count        = 0;
-      gdouble color_avg[4] = { 0.0, 0.0, 0.0, 0.0 };
-      gint    radius       = (gint) average_radius;
-      gint    i, j;
+      gint radius = (gint) average_radius;
 
       format = babl_format ("RaGaBaA double");
 
-      for (i = x - radius; i <= x + radius; i++)
-        for (j = y - radius; j <= y + radius; j++)
-          if (gimp_pickable_get_pixel_at (pickable, i, j, format, sample))
-            {
-              count++;
-
-              color_avg[RED]   += sample[RED];
-              color_avg[GREEN] += sample[GREEN];
-              color_avg[BLUE]  += sample[BLUE];
-              color_avg[ALPHA] += sample[ALPHA];
-            }
-
-      sample[RED]   = color_avg[RED]   / count;
-      sample[GREEN] = color_avg[GREEN] / count;
-      sample[BLUE]  = color_avg[BLUE]  / count;
-      sample[ALPHA] = color_avg[ALPHA] / count;
+      gimp_pickable_get_average (pickable,
+                                 GEGL_RECTANGLE (x - radius, y - radius,
+                                                 2 * radius + 1,
+                                                 2 * radius + 1),
+                                 sample);
 
       gimp_pickable_pixel_to_rgb (pickable, format, sample, color);
     }
@@ -28,11 +28,14 @@
 
 #include "core-types.h"
 
+#include "config/gimpgeglconfig.h"
+
 #include "gegl/gimp-babl.h"
 #include "gegl/gimp-gegl-utils.h"
 #include "gegl/gimptilehandlervalidate.h"
 
 #include "gimp.h"
+#include "gimp-memory-manager.h"
 #include "gimp-memsize.h"
 #include "gimpimage.h"
 #include "gimpmarshal.h"
@@ -96,6 +99,11 @@ struct _GimpProjectionPrivate
   cairo_rectangle_int_t      priority_rect;
 
   gboolean                   invalidate_preview;
+  gboolean                   evicted;
+
+  gint64                     last_use;
+  guint                      release_id;
+  gboolean                   release_connected;
 };
 
 
@@ -138,6 +146,14 @@ static void        gimp_projection_rgb_to_pixel         (GimpPickable    *pickab
                                                           gpointer         pixel);
 
 static void        gimp_projection_free_buffer           (GimpProjection  *proj);
+static void        gimp_projection_touch                 (GimpProjection  *proj);
+static gint        gimp_projection_get_release_delay     (GimpProjection  *proj);
+static void        gimp_projection_update_release        (GimpProjection  *proj);
+static gboolean    gimp_projection_release_timeout       (GimpProjection  *proj);
+static gint64      gimp_projection_get_evict_size        (GimpProjection  *proj,
+                                                          gpointer         data);
+static gboolean    gimp_projection_evict                 (GimpProjection  *proj,
+                                                          gpointer         data);
 static void        gimp_projection_add_update_area       (GimpProjection  *proj,
                                                           gint             x,
                                                           gint             y,
@@ -415,8 +431,36 @@ gimp_projection_get_buffer (GimpPickable *pickable)
       proj->priv->invalidate_preview = TRUE;
       gimp_projection_flush (proj);
 
+      gimp_memory_manager_add (proj,
+                               (GimpMemoryManagerSizeFunc)
+                               gimp_projection_get_evict_size,
+                               (GimpMemoryManagerEvictFunc)
+                               gimp_projection_evict,
+                               NULL);
+
+      proj->priv->last_use = g_get_monotonic_time ();
+
+      if (GIMP_IS_IMAGE (proj->priv->projectable) &&
+          ! proj->priv->release_connected)
+        {
+          GimpImage *image = GIMP_IMAGE (proj->priv->projectable);
+
+          g_signal_connect_object (image->gimp->config,
+                                   "notify::projection-release-delay",
+                                   G_CALLBACK (gimp_projection_update_release),
+                                   proj, G_CONNECT_SWAPPED);
+
+          proj->priv->release_connected = TRUE;
+        }
+
+      gimp_projection_update_release (proj);
+
       g_object_notify (G_OBJECT (pickable), "buffer");
     }
+  else
+    {
+      gimp_projection_touch (proj);
+    }
 
   return proj->priv->buffer;
 }
@@ -616,6 +660,12 @@ gimp_projection_finish_draw (GimpProjection *proj)
 static void
 gimp_projection_free_buffer (GimpProjection  *proj)
 {
+  if (proj->priv->release_id)
+    {
+      g_source_remove (proj->priv->release_id);
+      proj->priv->release_id = 0;
+    }
+
   if (proj->priv->chunk_render.idle_id)
     gimp_projection_chunk_render_stop (proj);
 
@@ -633,6 +683,8 @@ gimp_projection_free_buffer (GimpProjection  *proj)
 
   if (proj->priv->buffer)
     {
+      gimp_memory_manager_remove (proj);
+
       if (proj->priv->validate_handler)
         gegl_buffer_remove_handler (proj->priv->buffer,
                                     proj->priv->validate_handler);
@@ -646,6 +698,159 @@ gimp_projection_free_buffer (GimpProjection  *proj)
       g_object_unref (proj->priv->validate_handler);
       proj->priv->validate_handler = NULL;
     }
+
+  proj->priv->evicted = FALSE;
+}
+
+static void
+gimp_projection_touch (GimpProjection *proj)
+{
+  proj->priv->evicted  = FALSE;
+  proj->priv->last_use = g_get_monotonic_time ();
+
+  gimp_memory_manager_touch (proj);
+}
+
+static gint
+gimp_projection_get_release_delay (GimpProjection *proj)
+{
+  GimpImage *image;
+
+  if (! GIMP_IS_IMAGE (proj->priv->projectable))
+    return 0;
+
+  image = GIMP_IMAGE (proj->priv->projectable);
+
+  return GIMP_GEGL_CONFIG (image->gimp->config)->projection_release_delay;
+}
+
+/*  (re)starts the timer releasing the buffer of an image projection,
+ *  if there is a buffer and a delay is set
+ */
+static void
+gimp_projection_update_release (GimpProjection *proj)
+{
+  gint delay = gimp_projection_get_release_delay (proj);
+
+  if (proj->priv->release_id)
+    {
+      g_source_remove (proj->priv->release_id);
+      proj->priv->release_id = 0;
+    }
+
+  if (proj->priv->buffer && delay > 0)
+    {
+      proj->priv->release_id =
+        g_timeout_add_seconds_full (G_PRIORITY_LOW, delay,
+                                    (GSourceFunc) gimp_projection_release_timeout,
+                                    proj, NULL);
+    }
+}
+
+static gboolean
+gimp_projection_release_timeout (GimpProjection *proj)
+{
+  GimpImage *image = GIMP_IMAGE (proj->priv->projectable);
+  gint64     delay = gimp_projection_get_release_delay (proj);
+  gint64     now   = g_get_monotonic_time ();
+  gint64     remaining;
+
+  /*  only count the time nobody looks at the image, and nothing is
+   *  left to render
+   */
+  if (gimp_image_get_display_count (image) > 0 ||
+      proj->priv->update_region                ||
+      proj->priv->chunk_render.idle_id)
+    {
+      proj->priv->last_use = now;
+    }
+
+  remaining = proj->priv->last_use + delay * G_TIME_SPAN_SECOND - now;
+
+  /*  the projection was used since the timer started, wait for the
+   *  rest of the delay
+   */
+  if (remaining > 0)
+    {
+      proj->priv->release_id =
+        g_timeout_add_seconds_full (G_PRIORITY_LOW,
+                                    (remaining + G_TIME_SPAN_SECOND - 1) /
+                                    G_TIME_SPAN_SECOND,
+                                    (GSourceFunc) gimp_projection_release_timeout,
+                                    proj, NULL);
+
+      return G_SOURCE_REMOVE;
+    }
+
+  GIMP_LOG (PROJECTION, "releasing the projection of image %d",
+            gimp_image_get_ID (image));
+
+  /*  the buffer is created again, and rendered from scratch, the next
+   *  time it is asked for
+   */
+  proj->priv->release_id = 0;
+
+  gimp_projection_free_buffer (proj);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gint64
+gimp_projection_get_evict_size (GimpProjection *proj,
+                                gpointer        data)
+{
+  GimpTileHandlerValidate *validate;
+  const GeglRectangle     *extent;
+  gint                     n_tiles;
+
+  if (! proj->priv->buffer || proj->priv->evicted)
+    return 0;
+
+  /*  only count the tiles which were actually rendered  */
+  validate = proj->priv->validate_handler;
+  extent   = gegl_buffer_get_extent (proj->priv->buffer);
+
+  n_tiles = gimp_tile_handler_validate_count_tiles (validate,
+                                                    extent->x,
+                                                    extent->y,
+                                                    extent->width,
+                                                    extent->height);
+
+  return ((gint64) n_tiles *
+          validate->tile_width * validate->tile_height *
+          babl_format_get_bytes_per_pixel (validate->format));
+}
+
+static gboolean
+gimp_projection_evict (GimpProjection *proj,
+                       gpointer        data)
+{
+  const GeglRectangle *extent;
+
+  if (! proj->priv->buffer || proj->priv->evicted)
+    return FALSE;
+
+  /*  keep what is being shown, and what is still being rendered  */
+  if (GIMP_IS_IMAGE (proj->priv->projectable) &&
+      gimp_image_get_display_count (GIMP_IMAGE (proj->priv->projectable)) > 0)
+    return FALSE;
+
+  if (proj->priv->update_region || proj->priv->chunk_render.idle_id)
+    return FALSE;
+
+  /*  a group layer's buffer is its projection's buffer, so instead of
+   *  freeing the buffer, drop its tiles and let them be rendered again
+   *  when they are needed
+   */
+  extent = gegl_buffer_get_extent (proj->priv->buffer);
+
+  gimp_tile_handler_validate_discard (proj->priv->validate_handler,
+                                      extent->x,     extent->y,
+                                      extent->width, extent->height);
+
+  proj->priv->evicted = TRUE;
+
+  return TRUE;
 }
 
 static void
@@ -1006,6 +1211,8 @@ gimp_projection_projectable_flush (GimpProjectable *projectable,
   if (invalidate_preview)
     proj->priv->invalidate_preview = TRUE;
 
+  gimp_projection_touch (proj);
+
   gimp_projection_flush (proj);
 }
 
@@ -29,11 +29,22 @@
 
 #include "core-types.h"
 
+#include "gimp-parallel.h"
 #include "gimpboundary.h"
 #include "gimpbezierdesc.h"
 #include "gimpscanconvert.h"
 
 
+/*  the number of sample rows per pixel row when antialiasing  */
+#define SUBSAMPLES         16
+
+/*  the maximal distance of a flattened curve from the real one, in
+ *  pixels, which is cairo's default tolerance
+ */
+#define FLATTEN_TOLERANCE  0.1
+#define FLATTEN_MAX_DEPTH  16
+
+
 struct _GimpScanConvert
 {
   gdouble         ratio_xy;
@@ -56,6 +67,61 @@ struct _GimpScanConvert
   GArray         *path_data;
 };
 
+typedef struct
+{
+  gdouble x0, y0;   /*  the upper end  */
+  gdouble y1;       /*  the lower end  */
+  gdouble dxdy;
+} GimpScanConvertEdge;
+
+typedef struct
+{
+  GeglBuffer                *buffer;
+  GeglRectangle              extents;
+  const GimpScanConvertEdge *edges;
+  gint                       n_edges;
+  gboolean                   replace;
+  gboolean                   antialias;
+  gfloat                     value;
+  gint                       tile_height;
+  gint                       first_tile_row;
+  gint                       n_bands;
+} GimpScanConvertFill;
+
+typedef struct
+{
+  gfloat  *coverage;   /*  one band of coverage values          */
+  gfloat  *delta;      /*  coverage steps of the current row    */
+  gint    *active;     /*  the edges crossing the sample row,   */
+                       /*  in the order of their crossings      */
+  gint     n_active;
+  gint     next_edge;
+  gint     last_edge;
+  gdouble *xs;         /*  where they cross it                  */
+  gint     row_x1;
+  gint     row_x2;
+} GimpScanConvertBand;
+
+
+/*  local function prototypes  */
+
+static void   gimp_scan_convert_render_stroke (GimpScanConvert     *sc,
+                                               GeglBuffer          *buffer,
+                                               const GeglRectangle *rect,
+                                               gint                 off_x,
+                                               gint                 off_y,
+                                               gboolean             replace,
+                                               gboolean             antialias,
+                                               gdouble              value);
+static void   gimp_scan_convert_render_fill   (GimpScanConvert     *sc,
+                                               GeglBuffer          *buffer,
+                                               const GeglRectangle *rect,
+                                               gint                 off_x,
+                                               gint                 off_y,
+                                               gboolean             replace,
+                                               gboolean             antialias,
+                                               gdouble              value);
+
 
 /*  public functions  */
 
@@ -496,38 +562,187 @@ gimp_scan_convert_render_full (GimpScanConvert *sc,
                                gboolean         antialias,
                                gdouble          value)
 {
-  const Babl         *format;
-  GeglBufferIterator *iter;
-  GeglRectangle      *roi;
-  cairo_t            *cr;
-  cairo_surface_t    *surface;
-  cairo_path_t        path;
-  gint                bpp;
-  gint                x, y;
-  gint                width, height;
+  GeglRectangle rect;
 
   g_return_if_fail (sc != NULL);
   g_return_if_fail (GEGL_IS_BUFFER (buffer));
 
-  x      = 0;
-  y      = 0;
-  width  = gegl_buffer_get_width  (buffer);
-  height = gegl_buffer_get_height (buffer);
+  rect.x      = 0;
+  rect.y      = 0;
+  rect.width  = gegl_buffer_get_width  (buffer);
+  rect.height = gegl_buffer_get_height (buffer);
 
-  if (sc->clip && ! gimp_rectangle_intersect (x, y, width, height,
+  if (sc->clip && ! gimp_rectangle_intersect (rect.x, rect.y,
+                                              rect.width, rect.height,
                                               sc->clip_x, sc->clip_y,
                                               sc->clip_w, sc->clip_h,
-                                              &x, &y, &width, &height))
+                                              &rect.x, &rect.y,
+                                              &rect.width, &rect.height))
     return;
 
+  if (sc->do_stroke)
+    gimp_scan_convert_render_stroke (sc, buffer, &rect, off_x, off_y,
+                                     replace, antialias, value);
+  else
+    gimp_scan_convert_render_fill (sc, buffer, &rect, off_x, off_y,
+                                   replace, antialias, value);
+}
+
+
+/*  private functions  */
+
+/*  clears the parts of @rect which are not in @inner  */
+static void
+gimp_scan_convert_clear_outside (GeglBuffer          *buffer,
+                                 const GeglRectangle *rect,
+                                 const GeglRectangle *inner)
+{
+  GeglRectangle area;
+
+  if (inner->width <= 0 || inner->height <= 0)
+    {
+      gegl_buffer_clear (buffer, rect);
+
+      return;
+    }
+
+  /*  above and below  */
+  area.x      = rect->x;
+  area.width  = rect->width;
+
+  area.y      = rect->y;
+  area.height = inner->y - rect->y;
+
+  if (area.height > 0)
+    gegl_buffer_clear (buffer, &area);
+
+  area.y      = inner->y + inner->height;
+  area.height = rect->y + rect->height - area.y;
+
+  if (area.height > 0)
+    gegl_buffer_clear (buffer, &area);
+
+  /*  left and right  */
+  area.y      = inner->y;
+  area.height = inner->height;
+
+  area.x      = rect->x;
+  area.width  = inner->x - rect->x;
+
+  if (area.width > 0)
+    gegl_buffer_clear (buffer, &area);
+
+  area.x      = inner->x + inner->width;
+  area.width  = rect->x + rect->width - area.x;
+
+  if (area.width > 0)
+    gegl_buffer_clear (buffer, &area);
+}
+
+static void
+gimp_scan_convert_setup_stroke (GimpScanConvert *sc,
+                                cairo_t         *cr)
+{
+  cairo_set_miter_limit (cr, sc->miter);
+
+  cairo_set_line_cap (cr,
+                      sc->cap == GIMP_CAP_BUTT ? CAIRO_LINE_CAP_BUTT :
+                      sc->cap == GIMP_CAP_ROUND ? CAIRO_LINE_CAP_ROUND :
+                      CAIRO_LINE_CAP_SQUARE);
+  cairo_set_line_join (cr,
+                       sc->join == GIMP_JOIN_MITER ? CAIRO_LINE_JOIN_MITER :
+                       sc->join == GIMP_JOIN_ROUND ? CAIRO_LINE_JOIN_ROUND :
+                       CAIRO_LINE_JOIN_BEVEL);
+
+  cairo_set_line_width (cr, sc->width);
+
+  if (sc->dash_info)
+    cairo_set_dash (cr,
+                    (double *) sc->dash_info->data,
+                    sc->dash_info->len,
+                    sc->dash_offset);
+
+  cairo_scale (cr, 1.0, sc->ratio_xy);
+}
+
+/*  the buffer area the stroke can touch, clipped to @rect  */
+static gboolean
+gimp_scan_convert_get_stroke_extents (GimpScanConvert     *sc,
+                                      cairo_path_t        *path,
+                                      const GeglRectangle *rect,
+                                      gint                 off_x,
+                                      gint                 off_y,
+                                      GeglRectangle       *extents)
+{
+  cairo_surface_t *surface;
+  cairo_t         *cr;
+  gdouble          x1, y1, x2, y2;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_A8, 1, 1);
+  cr = cairo_create (surface);
+
+  cairo_append_path (cr, path);
+  gimp_scan_convert_setup_stroke (sc, cr);
+
+  cairo_stroke_extents (cr, &x1, &y1, &x2, &y2);
+  cairo_user_to_device (cr, &x1, &y1);
+  cairo_user_to_device (cr, &x2, &y2);
+
+  cairo_destroy (cr);
+  cairo_surface_destroy (surface);
+
+  /*  leave a pixel for antialiasing  */
+  extents->x      = floor (MIN (x1, x2)) - off_x - 1;
+  extents->y      = floor (MIN (y1, y2)) - off_y - 1;
+  extents->width  = ceil  (MAX (x1, x2)) - off_x + 1 - extents->x;
+  extents->height = ceil  (MAX (y1, y2)) - off_y + 1 - extents->y;
+
+  return gegl_rectangle_intersect (extents, extents, rect);
+}
+
+/*  strokes are rendered by cairo, tile by tile, but only on the tiles
+ *  the stroke can reach
+ */
+static void
+gimp_scan_convert_render_stroke (GimpScanConvert     *sc,
+                                 GeglBuffer          *buffer,
+                                 const GeglRectangle *rect,
+                                 gint                 off_x,
+                                 gint                 off_y,
+                                 gboolean             replace,
+                                 gboolean             antialias,
+                                 gdouble              value)
+{
+  const Babl         *format;
+  GeglBufferIterator *iter;
+  GeglRectangle      *roi;
+  GeglRectangle       extents;
+  cairo_t            *cr;
+  cairo_surface_t    *surface;
+  cairo_path_t        path;
+  gint                bpp;
+
   path.status   = CAIRO_STATUS_SUCCESS;
   path.data     = (cairo_path_data_t *) sc->path_data->data;
   path.num_data = sc->path_data->len;
 
+  if (! gimp_scan_convert_get_stroke_extents (sc, &path, rect, off_x, off_y,
+                                              &extents))
+    {
+      extents.width  = 0;
+      extents.height = 0;
+    }
+
+  if (replace)
+    gimp_scan_convert_clear_outside (buffer, rect, &extents);
+
+  if (extents.width <= 0 || extents.height <= 0)
+    return;
+
   format = babl_format ("Y u8");
   bpp    = babl_format_get_bytes_per_pixel (format);
 
-  iter = gegl_buffer_iterator_new (buffer, NULL, 0, format,
+  iter = gegl_buffer_iterator_new (buffer, &extents, 0, format,
                                    GEGL_ACCESS_READWRITE, GEGL_ABYSS_NONE);
   roi = &iter->roi[0];
 
@@ -586,35 +801,9 @@ gimp_scan_convert_render_full (GimpScanConvert *sc,
 
       cairo_set_antialias (cr, antialias ?
                            CAIRO_ANTIALIAS_GRAY : CAIRO_ANTIALIAS_NONE);
-      cairo_set_miter_limit (cr, sc->miter);
 
-      if (sc->do_stroke)
-        {
-          cairo_set_line_cap (cr,
-                              sc->cap == GIMP_CAP_BUTT ? CAIRO_LINE_CAP_BUTT :
-                              sc->cap == GIMP_CAP_ROUND ? CAIRO_LINE_CAP_ROUND :
-                              CAIRO_LINE_CAP_SQUARE);
-          cairo_set_line_join (cr,
-                               sc->join == GIMP_JOIN_MITER ? CAIRO_LINE_JOIN_MITER :
-                               sc->join == GIMP_JOIN_ROUND ? CAIRO_LINE_JOIN_ROUND :
-                               CAIRO_LINE_JOIN_BEVEL);
-
-          cairo_set_line_width (cr, sc->width);
-
-          if (sc->dash_info)
-            cairo_set_dash (cr,
-                            (double *) sc->dash_info->data,
-                            sc->dash_info->len,
-                            sc->dash_offset);
-
-          cairo_scale (cr, 1.0, sc->ratio_xy);
-          cairo_stroke (cr);
-        }
-      else
-        {
-          cairo_set_fill_rule (cr, CAIRO_FILL_RULE_EVEN_ODD);
-          cairo_fill (cr);
-        }
+      gimp_scan_convert_setup_stroke (sc, cr);
+      cairo_stroke (cr);
 
       cairo_destroy (cr);
       cairo_surface_destroy (surface);
@@ -635,3 +824,520 @@ gimp_scan_convert_render_full (GimpScanConvert *sc,
         }
     }
 }
+
+static void
+gimp_scan_convert_add_edge (GArray  *edges,
+                            gdouble  x0,
+                            gdouble  y0,
+                            gdouble  x1,
+                            gdouble  y1)
+{
+  GimpScanConvertEdge edge;
+
+  /*  horizontal edges never cross a sample row  */
+  if (y0 == y1)
+    return;
+
+  if (y0 < y1)
+    {
+      edge.x0 = x0;
+      edge.y0 = y0;
+      edge.y1 = y1;
+    }
+  else
+    {
+      edge.x0 = x1;
+      edge.y0 = y1;
+      edge.y1 = y0;
+    }
+
+  edge.dxdy = (x1 - x0) / (y1 - y0);
+
+  g_array_append_val (edges, edge);
+}
+
+static void
+gimp_scan_convert_flatten_curve (GArray  *edges,
+                                 gdouble  x0,
+                                 gdouble  y0,
+                                 gdouble  x1,
+                                 gdouble  y1,
+                                 gdouble  x2,
+                                 gdouble  y2,
+                                 gdouble  x3,
+                                 gdouble  y3,
+                                 gint     depth)
+{
+  gdouble dx = x3 - x0;
+  gdouble dy = y3 - y0;
+  gdouble d1 = fabs ((x1 - x3) * dy - (y1 - y3) * dx);
+  gdouble d2 = fabs ((x2 - x3) * dy - (y2 - y3) * dx);
+  gdouble chord = SQR (dx) + SQR (dy);
+  gboolean flat;
+
+  /*  the control points' distance from the chord, or from the end
+   *  points if the curve is closed
+   */
+  if (chord > 1e-12)
+    flat = SQR (d1 + d2) <= SQR (FLATTEN_TOLERANCE) * chord;
+  else
+    flat = (SQR (x1 - x0) + SQR (y1 - y0) <= SQR (FLATTEN_TOLERANCE) &&
+            SQR (x2 - x0) + SQR (y2 - y0) <= SQR (FLATTEN_TOLERANCE));
+
+  if (flat || depth >= FLATTEN_MAX_DEPTH)
+    {
+      gimp_scan_convert_add_edge (edges, x0, y0, x3, y3);
+    }
+  else
+    {
+      gdouble x01   = (x0 + x1) / 2.0,   y01   = (y0 + y1) / 2.0;
+      gdouble x12   = (x1 + x2) / 2.0,   y12   = (y1 + y2) / 2.0;
+      gdouble x23   = (x2 + x3) / 2.0,   y23   = (y2 + y3) / 2.0;
+      gdouble x012  = (x01 + x12) / 2.0, y012  = (y01 + y12) / 2.0;
+      gdouble x123  = (x12 + x23) / 2.0, y123  = (y12 + y23) / 2.0;
+      gdouble x0123 = (x012 + x123) / 2.0;
+      gdouble y0123 = (y012 + y123) / 2.0;
+
+      gimp_scan_convert_flatten_curve (edges,
+                                       x0, y0, x01, y01, x012, y012,
+                                       x0123, y0123, depth + 1);
+      gimp_scan_convert_flatten_curve (edges,
+                                       x0123, y0123, x123, y123, x23, y23,
+                                       x3, y3, depth + 1);
+    }
+}
+
+static gint
+gimp_scan_convert_edge_compare (const GimpScanConvertEdge *edge1,
+                                const GimpScanConvertEdge *edge2)
+{
+  if (edge1->y0 < edge2->y0)
+    return -1;
+  else if (edge1->y0 > edge2->y0)
+    return 1;
+
+  return 0;
+}
+
+/*  flattens the path into an array of edges in buffer coordinates,
+ *  closing all subpaths as cairo_fill() does, and sorted by their
+ *  upper end
+ */
+static GArray *
+gimp_scan_convert_get_edges (GimpScanConvert *sc,
+                             gint             off_x,
+                             gint             off_y)
+{
+  const cairo_path_data_t *data  = (const cairo_path_data_t *) sc->path_data->data;
+  gint                     n     = sc->path_data->len;
+  GArray                  *edges;
+  gdouble                  start_x = 0.0, start_y = 0.0;
+  gdouble                  x       = 0.0, y       = 0.0;
+  gint                     i;
+
+  edges = g_array_new (FALSE, FALSE, sizeof (GimpScanConvertEdge));
+
+  for (i = 0; i < n; i += data[i].header.length)
+    {
+      const cairo_path_data_t *points = &data[i + 1];
+
+      switch (data[i].header.type)
+        {
+        case CAIRO_PATH_MOVE_TO:
+          gimp_scan_convert_add_edge (edges, x, y, start_x, start_y);
+
+          start_x = x = points[0].point.x - off_x;
+          start_y = y = points[0].point.y - off_y;
+          break;
+
+        case CAIRO_PATH_LINE_TO:
+          gimp_scan_convert_add_edge (edges,
+                                      x, y,
+                                      points[0].point.x - off_x,
+                                      points[0].point.y - off_y);
+
+          x = points[0].point.x - off_x;
+          y = points[0].point.y - off_y;
+          break;
+
+        case CAIRO_PATH_CURVE_TO:
+          gimp_scan_convert_flatten_curve (edges,
+                                           x, y,
+                                           points[0].point.x - off_x,
+                                           points[0].point.y - off_y,
+                                           points[1].point.x - off_x,
+                                           points[1].point.y - off_y,
+                                           points[2].point.x - off_x,
+                                           points[2].point.y - off_y,
+                                           0);
+
+          x = points[2].point.x - off_x;
+          y = points[2].point.y - off_y;
+          break;
+
+        case CAIRO_PATH_CLOSE_PATH:
+          gimp_scan_convert_add_edge (edges, x, y, start_x, start_y);
+
+          x = start_x;
+          y = start_y;
+          break;
+        }
+    }
+
+  gimp_scan_convert_add_edge (edges, x, y, start_x, start_y);
+
+  g_array_sort (edges, (GCompareFunc) gimp_scan_convert_edge_compare);
+
+  return edges;
+}
+
+/*  adds the even-odd spans of one sample row to the row's coverage,
+ *  horizontally exact when antialiasing, by pixel centers otherwise
+ */
+static void
+gimp_scan_convert_fill_sample_row (GimpScanConvertFill *fill,
+                                   GimpScanConvertBand *band,
+                                   gdouble              sample_y,
+                                   gint                 row)
+{
+  const GimpScanConvertEdge *edges    = fill->edges;
+  gfloat                    *coverage = band->coverage +
+                                        row * fill->extents.width;
+  gfloat                    *delta    = band->delta;
+  gdouble                    x_max    = fill->extents.width;
+  gint                       n_active = 0;
+  gint                       i, j;
+
+  /*  update the active edges, new ones go to the end  */
+  while (band->next_edge < band->last_edge &&
+         edges[band->next_edge].y0 <= sample_y)
+    {
+      band->active[band->n_active++] = band->next_edge++;
+    }
+
+  for (i = 0; i < band->n_active; i++)
+    {
+      const GimpScanConvertEdge *edge = &edges[band->active[i]];
+
+      if (edge->y1 > sample_y)
+        {
+          band->active[n_active] = band->active[i];
+          band->xs[n_active]     = (edge->x0 +
+                                    (sample_y - edge->y0) * edge->dxdy -
+                                    fill->extents.x);
+          n_active++;
+        }
+    }
+
+  band->n_active = n_active;
+
+  /*  insertion sort, the active edges are still sorted by their
+   *  crossings with the previous sample row, which hardly move, so
+   *  only new edges and the rare crossing edges have to be moved
+   */
+  for (i = 1; i < n_active; i++)
+    {
+      gdouble x    = band->xs[i];
+      gint    edge = band->active[i];
+
+      for (j = i; j > 0 && band->xs[j - 1] > x; j--)
+        {
+          band->xs[j]     = band->xs[j - 1];
+          band->active[j] = band->active[j - 1];
+        }
+
+      band->xs[j]     = x;
+      band->active[j] = edge;
+    }
+
+  for (i = 0; i + 1 < n_active; i += 2)
+    {
+      gdouble a = CLAMP (band->xs[i],     0.0, x_max);
+      gdouble b = CLAMP (band->xs[i + 1], 0.0, x_max);
+      gint    ia, ib;
+
+      if (fill->antialias)
+        {
+          if (b <= a)
+            continue;
+
+          ia = (gint) a;
+          ib = (gint) b;
+
+          if (ia == ib)
+            {
+              coverage[ia] += b - a;
+            }
+          else
+            {
+              coverage[ia]  += ia + 1 - a;
+              delta[ia + 1] += 1.0;
+              delta[ib]     -= 1.0;
+
+              if (ib < fill->extents.width)
+                coverage[ib] += b - ib;
+            }
+        }
+      else
+        {
+          ia = ceil (a - 0.5);
+          ib = ceil (b - 0.5);
+
+          if (ib <= ia)
+            continue;
+
+          delta[ia] += 1.0;
+          delta[ib] -= 1.0;
+        }
+
+      band->row_x1 = MIN (band->row_x1, ia);
+      band->row_x2 = MAX (band->row_x2, ib + 1);
+    }
+}
+
+static void
+gimp_scan_convert_fill_band (GimpScanConvertFill *fill,
+                             GimpScanConvertBand *band,
+                             const GeglRectangle *band_rect)
+{
+  const GimpScanConvertEdge *edges     = fill->edges;
+  const gint                 width     = fill->extents.width;
+  const gint                 n_samples = fill->antialias ? SUBSAMPLES : 1;
+  GeglRectangle              area;
+  gint                       x1        = width;
+  gint                       x2        = 0;
+  gint                       row;
+  gint                       i;
+
+  /*  the edges are sorted by their upper end, only the ones before
+   *  the first edge starting below the band can reach into it, the
+   *  ones ending above it are dropped at the first sample row
+   */
+  band->next_edge = 0;
+  band->last_edge = 0;
+  band->n_active  = 0;
+
+  while (band->last_edge < fill->n_edges &&
+         edges[band->last_edge].y0 < band_rect->y + band_rect->height)
+    {
+      band->last_edge++;
+    }
+
+  memset (band->coverage, 0,
+          sizeof (gfloat) * width * band_rect->height);
+
+  for (row = 0; row < band_rect->height; row++)
+    {
+      gfloat *coverage = band->coverage + row * width;
+      gfloat  sum      = 0.0;
+      gint    k;
+
+      band->row_x1 = width;
+      band->row_x2 = 0;
+
+      for (k = 0; k < n_samples; k++)
+        {
+          gdouble sample_y = band_rect->y + row + (k + 0.5) / n_samples;
+
+          gimp_scan_convert_fill_sample_row (fill, band, sample_y, row);
+        }
+
+      band->row_x2 = MIN (band->row_x2, width);
+
+      if (band->row_x1 >= band->row_x2)
+        continue;
+
+      /*  integrate the coverage steps of the fully covered pixels  */
+      for (i = band->row_x1; i < band->row_x2; i++)
+        {
+          sum += band->delta[i];
+
+          coverage[i] = (coverage[i] + sum) / n_samples;
+
+          band->delta[i] = 0.0;
+        }
+
+      band->delta[band->row_x2] = 0.0;
+
+      x1 = MIN (x1, band->row_x1);
+      x2 = MAX (x2, band->row_x2);
+    }
+
+  area.x      = fill->extents.x + x1;
+  area.y      = band_rect->y;
+  area.width  = MAX (x2 - x1, 0);
+  area.height = band_rect->height;
+
+  if (fill->replace)
+    {
+      GeglRectangle full = *band_rect;
+
+      full.x     = fill->extents.x;
+      full.width = width;
+
+      gimp_scan_convert_clear_outside (fill->buffer, &full, &area);
+    }
+
+  if (area.width > 0)
+    {
+      GeglBufferIterator *iter;
+      GeglRectangle      *roi;
+      const gfloat        value = fill->value;
+
+      iter = gegl_buffer_iterator_new (fill->buffer, &area, 0,
+                                       babl_format ("Y float"),
+                                       fill->replace ?
+                                       GEGL_ACCESS_WRITE :
+                                       GEGL_ACCESS_READWRITE,
+                                       GEGL_ABYSS_NONE);
+      roi = &iter->roi[0];
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          gfloat *dest = iter->data[0];
+          gint    y;
+
+          for (y = 0; y < roi->height; y++)
+            {
+              const gfloat *src = band->coverage +
+                                  (roi->y + y - band_rect->y) * width +
+                                  (roi->x - fill->extents.x);
+
+              if (fill->replace)
+                {
+                  for (i = 0; i < roi->width; i++)
+                    dest[i] = src[i] * value;
+                }
+              else
+                {
+                  for (i = 0; i < roi->width; i++)
+                    dest[i] += src[i] * (value - dest[i]);
+                }
+
+              dest += roi->width;
+            }
+        }
+    }
+}
+
+static void
+gimp_scan_convert_fill_func (gint     i,
+                             gint     n,
+                             gpointer user_data)
+{
+  GimpScanConvertFill *fill = user_data;
+  GimpScanConvertBand  band;
+  gint                 k;
+
+  band.coverage = g_new  (gfloat, fill->extents.width * fill->tile_height);
+  band.delta    = g_new0 (gfloat, fill->extents.width + 2);
+  band.active   = g_new  (gint,    fill->n_edges);
+  band.xs       = g_new  (gdouble, fill->n_edges);
+
+  for (k = i; k < fill->n_bands; k += n)
+    {
+      GeglRectangle band_rect;
+      gint          y1;
+      gint          y2;
+
+      /*  bands are aligned to tile rows, so that no two threads
+       *  write to the same tile
+       */
+      y1 = (fill->first_tile_row + k)     * fill->tile_height;
+      y2 = (fill->first_tile_row + k + 1) * fill->tile_height;
+
+      band_rect.x      = fill->extents.x;
+      band_rect.y      = MAX (y1, fill->extents.y);
+      band_rect.width  = fill->extents.width;
+      band_rect.height = MIN (y2, fill->extents.y + fill->extents.height) -
+                         band_rect.y;
+
+      gimp_scan_convert_fill_band (fill, &band, &band_rect);
+    }
+
+  g_free (band.coverage);
+  g_free (band.delta);
+  g_free (band.active);
+  g_free (band.xs);
+}
+
+/*  fills are rasterized natively: the path is flattened to edges and
+ *  each band of tile rows is scanned with an active edge list, using
+ *  SUBSAMPLES sample rows per pixel row and exact horizontal coverage
+ *  when antialiasing. only the area covered by the path is written.
+ */
+static void
+gimp_scan_convert_render_fill (GimpScanConvert     *sc,
+                               GeglBuffer          *buffer,
+                               const GeglRectangle *rect,
+                               gint                 off_x,
+                               gint                 off_y,
+                               gboolean             replace,
+                               gboolean             antialias,
+                               gdouble              value)
+{
+  GimpScanConvertFill  fill;
+  GArray              *edges;
+  gdouble              x1 = G_MAXDOUBLE, y1 = G_MAXDOUBLE;
+  gdouble              x2 = -G_MAXDOUBLE, y2 = -G_MAXDOUBLE;
+  gint                 i;
+
+  edges = gimp_scan_convert_get_edges (sc, off_x, off_y);
+
+  for (i = 0; i < edges->len; i++)
+    {
+      const GimpScanConvertEdge *edge = &g_array_index (edges,
+                                                        GimpScanConvertEdge,
+                                                        i);
+      gdouble x_end = edge->x0 + (edge->y1 - edge->y0) * edge->dxdy;
+
+      x1 = MIN (x1, MIN (edge->x0, x_end));
+      x2 = MAX (x2, MAX (edge->x0, x_end));
+      y1 = MIN (y1, edge->y0);
+      y2 = MAX (y2, edge->y1);
+    }
+
+  fill.extents.width  = 0;
+  fill.extents.height = 0;
+
+  if (edges->len > 0)
+    {
+      fill.extents.x      = floor (x1);
+      fill.extents.y      = floor (y1);
+      fill.extents.width  = ceil (x2) - fill.extents.x;
+      fill.extents.height = ceil (y2) - fill.extents.y;
+
+      if (! gegl_rectangle_intersect (&fill.extents, &fill.extents, rect))
+        {
+          fill.extents.width  = 0;
+          fill.extents.height = 0;
+        }
+    }
+
+  if (replace)
+    gimp_scan_convert_clear_outside (buffer, rect, &fill.extents);
+
+  if (fill.extents.width > 0 && fill.extents.height > 0)
+    {
+      fill.buffer    = buffer;
+      fill.edges     = (const GimpScanConvertEdge *) edges->data;
+      fill.n_edges   = edges->len;
+      fill.replace   = replace;
+      fill.antialias = antialias;
+      fill.value     = value;
+
+      g_object_get (buffer,
+                    "tile-height", &fill.tile_height,
+                    NULL);
+
+      fill.first_tile_row = fill.extents.y / fill.tile_height;
+      fill.n_bands        = (fill.extents.y + fill.extents.height +
+                             fill.tile_height - 1) / fill.tile_height -
+                            fill.first_tile_row;
+
+      gimp_parallel_distribute (fill.n_bands,
+                                gimp_scan_convert_fill_func, &fill);
+    }
+
+  g_array_free (edges, TRUE);
+}
@@ -29,16 +29,18 @@
 
 #include "libgimpcolor/gimpcolor.h"
 
+#include "gimp-memory-pool.h"
 #include "gimptempbuf.h"
 
 
 struct _GimpTempBuf
 {
-  gint        ref_count;
-  gint        width;
-  gint        height;
-  const Babl *format;
-  guchar     *data;
+  gint         ref_count;
+  gint         width;
+  gint         height;
+  const Babl  *format;
+  guchar      *data;
+  GimpTempBuf *parent;  /*  the temp buf owning data, for views  */
 };
 
 
@@ -58,8 +60,39 @@ gimp_temp_buf_new (gint        width,
   temp->width     = width;
   temp->height    = height;
   temp->format    = format;
-  temp->data      = gegl_malloc (width * height *
-                                 babl_format_get_bytes_per_pixel (format));
+  temp->data      = gimp_memory_pool_alloc (gimp_temp_buf_get_data_size (temp));
+  temp->parent    = NULL;
+
+  return temp;
+}
+
+/*  a temp buf using the start of @parent's data as its own, so that
+ *  memory allocated once for a large buffer can be used for smaller
+ *  ones
+ */
+GimpTempBuf *
+gimp_temp_buf_new_view (GimpTempBuf *parent,
+                        gint         width,
+                        gint         height,
+                        const Babl  *format)
+{
+  GimpTempBuf *temp;
+
+  g_return_val_if_fail (parent != NULL, NULL);
+  g_return_val_if_fail (width > 0 && height > 0, NULL);
+  g_return_val_if_fail (format != NULL, NULL);
+  g_return_val_if_fail ((gsize) babl_format_get_bytes_per_pixel (format) *
+                        width * height <=
+                        gimp_temp_buf_get_data_size (parent), NULL);
+
+  temp = g_slice_new (GimpTempBuf);
+
+  temp->ref_count = 1;
+  temp->width     = width;
+  temp->height    = height;
+  temp->format    = format;
+  temp->data      = parent->data;
+  temp->parent    = gimp_temp_buf_ref (parent);
 
   return temp;
 }
@@ -147,8 +180,10 @@ gimp_temp_buf_unref (GimpTempBuf *buf)
 
   if (buf->ref_count < 1)
     {
-      if (buf->data)
-        gegl_free (buf->data);
+      if (buf->parent)
+        gimp_temp_buf_unref (buf->parent);
+      else if (buf->data)
+        gimp_memory_pool_free (buf->data, gimp_temp_buf_get_data_size (buf));
 
       g_slice_free (GimpTempBuf, buf);
     }
@@ -260,7 +295,9 @@ gimp_temp_buf_data_clear (GimpTempBuf *buf)
 gsize
 gimp_temp_buf_get_memsize (const GimpTempBuf *buf)
 {
-  if (buf)
+  if (buf && buf->parent)
+    return sizeof (GimpTempBuf);
+  else if (buf)
     return (sizeof (GimpTempBuf) + gimp_temp_buf_get_data_size (buf));
 
   return 0;
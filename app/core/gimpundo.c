@@ -73,6 +73,8 @@ static void          gimp_undo_get_property        (GObject             *object,
 static gint64        gimp_undo_get_memsize         (GimpObject          *object,
                                                     gint64              *gui_size);
 
+static gchar       * gimp_undo_get_description     (GimpViewable        *viewable,
+                                                    gchar              **tooltip);
 static gboolean      gimp_undo_get_popup_size      (GimpViewable        *viewable,
                                                     gint                 width,
                                                     gint                 height,
@@ -89,6 +91,11 @@ static void          gimp_undo_real_pop            (GimpUndo            *undo,
                                                     GimpUndoAccumulator *accum);
 static void          gimp_undo_real_free           (GimpUndo            *undo,
                                                     GimpUndoMode         undo_mode);
+static gint64        gimp_undo_real_get_uncompressed_size
+                                                   (GimpUndo            *undo);
+static void          gimp_undo_real_swap_out       (GimpUndo            *undo,
+                                                    const gchar         *path);
+static gint64        gimp_undo_real_get_swap_size  (GimpUndo            *undo);
 
 static gboolean      gimp_undo_create_preview_idle (gpointer             data);
 static void       gimp_undo_create_preview_private (GimpUndo            *undo,
@@ -138,11 +145,15 @@ gimp_undo_class_init (GimpUndoClass *klass)
   gimp_object_class->get_memsize    = gimp_undo_get_memsize;
 
   viewable_class->default_icon_name = "edit-undo";
+  viewable_class->get_description   = gimp_undo_get_description;
   viewable_class->get_popup_size    = gimp_undo_get_popup_size;
   viewable_class->get_new_preview   = gimp_undo_get_new_preview;
 
   klass->pop                        = gimp_undo_real_pop;
   klass->free                       = gimp_undo_real_free;
+  klass->get_uncompressed_size      = gimp_undo_real_get_uncompressed_size;
+  klass->swap_out                   = gimp_undo_real_swap_out;
+  klass->get_swap_size              = gimp_undo_real_get_swap_size;
 
   g_object_class_install_property (object_class, PROP_IMAGE,
                                    g_param_spec_object ("image", NULL, NULL,
@@ -279,6 +290,42 @@ gimp_undo_get_memsize (GimpObject *object,
                                                                   gui_size);
 }
 
+static gchar *
+gimp_undo_get_description (GimpViewable  *viewable,
+                           gchar        **tooltip)
+{
+  GimpUndo *undo = GIMP_UNDO (viewable);
+
+  if (tooltip)
+    {
+      gint64 memsize      = gimp_object_get_memsize (GIMP_OBJECT (undo), NULL);
+      gint64 uncompressed = gimp_undo_get_uncompressed_size (undo);
+      gint64 swap_size    = gimp_undo_get_swap_size (undo);
+
+      if (swap_size > 0)
+        {
+          gchar *size = g_format_size (swap_size);
+
+          *tooltip = g_strdup_printf (_("%s swapped to disk"), size);
+
+          g_free (size);
+        }
+      else if (uncompressed > memsize && memsize > 0)
+        {
+          gchar *size = g_format_size (memsize);
+
+          *tooltip = g_strdup_printf (_("%s, compressed %.1f:1"),
+                                      size,
+                                      (gdouble) uncompressed / memsize);
+
+          g_free (size);
+        }
+    }
+
+  return GIMP_VIEWABLE_CLASS (parent_class)->get_description (viewable,
+                                                              tooltip);
+}
+
 static gboolean
 gimp_undo_get_popup_size (GimpViewable *viewable,
                           gint          width,
@@ -350,6 +397,24 @@ gimp_undo_real_free (GimpUndo     *undo,
 {
 }
 
+static gint64
+gimp_undo_real_get_uncompressed_size (GimpUndo *undo)
+{
+  return gimp_object_get_memsize (GIMP_OBJECT (undo), NULL);
+}
+
+static void
+gimp_undo_real_swap_out (GimpUndo    *undo,
+                         const gchar *path)
+{
+}
+
+static gint64
+gimp_undo_real_get_swap_size (GimpUndo *undo)
+{
+  return 0;
+}
+
 void
 gimp_undo_pop (GimpUndo            *undo,
                GimpUndoMode         undo_mode,
@@ -373,6 +438,21 @@ gimp_undo_pop (GimpUndo            *undo,
     }
 
   g_signal_emit (undo, undo_signals[POP], 0, undo_mode, accum);
+
+  /*  a step which couldn't be popped leaves the image as it was  */
+  if (accum->failed && undo->dirty_mask != GIMP_DIRTY_NONE)
+    {
+      switch (undo_mode)
+        {
+        case GIMP_UNDO_MODE_UNDO:
+          gimp_image_dirty (undo->image, undo->dirty_mask);
+          break;
+
+        case GIMP_UNDO_MODE_REDO:
+          gimp_image_clean (undo->image, undo->dirty_mask);
+          break;
+        }
+    }
 }
 
 void
@@ -384,6 +464,53 @@ gimp_undo_free (GimpUndo     *undo,
   g_signal_emit (undo, undo_signals[FREE], 0, undo_mode);
 }
 
+/**
+ * gimp_undo_get_uncompressed_size:
+ * @undo: a #GimpUndo
+ *
+ * Return value: the memory @undo would use if none of its pixels
+ * were compressed.
+ **/
+gint64
+gimp_undo_get_uncompressed_size (GimpUndo *undo)
+{
+  g_return_val_if_fail (GIMP_IS_UNDO (undo), 0);
+
+  return GIMP_UNDO_GET_CLASS (undo)->get_uncompressed_size (undo);
+}
+
+/**
+ * gimp_undo_swap_out:
+ * @undo: a #GimpUndo
+ * @path: the directory for swap files
+ *
+ * Starts moving the pixels kept by @undo to swap files in @path.  The
+ * memory they use is no longer counted once this returns.
+ **/
+void
+gimp_undo_swap_out (GimpUndo    *undo,
+                    const gchar *path)
+{
+  g_return_if_fail (GIMP_IS_UNDO (undo));
+  g_return_if_fail (path != NULL);
+
+  GIMP_UNDO_GET_CLASS (undo)->swap_out (undo, path);
+}
+
+/**
+ * gimp_undo_get_swap_size:
+ * @undo: a #GimpUndo
+ *
+ * Return value: the disk space used by @undo's swap files.
+ **/
+gint64
+gimp_undo_get_swap_size (GimpUndo *undo)
+{
+  g_return_val_if_fail (GIMP_IS_UNDO (undo), 0);
+
+  return GIMP_UNDO_GET_CLASS (undo)->get_swap_size (undo);
+}
+
 typedef struct _GimpUndoIdle GimpUndoIdle;
 
 struct _GimpUndoIdle
@@ -452,11 +579,12 @@ static void
 gimp_undo_create_preview_private (GimpUndo    *undo,
                                   GimpContext *context)
 {
-  GimpImage    *image = undo->image;
-  GimpViewable *preview_viewable;
-  GimpViewSize  preview_size;
-  gint          width;
-  gint          height;
+  GimpImage     *image = undo->image;
+  GimpUndoStack *stack;
+  GimpViewable  *preview_viewable;
+  GimpViewSize   preview_size;
+  gint           width;
+  gint           height;
 
   switch (undo->undo_type)
     {
@@ -498,6 +626,12 @@ gimp_undo_create_preview_private (GimpUndo    *undo,
   undo->preview = gimp_viewable_get_new_preview (preview_viewable, context,
                                                  width, height);
 
+  /*  the preview was created after the push, count it now  */
+  stack = gimp_image_get_undo_stack (image);
+
+  if (undo == gimp_undo_stack_peek (stack))
+    gimp_undo_stack_update_undo (stack, undo);
+
   gimp_viewable_invalidate_preview (GIMP_VIEWABLE (undo));
 }
 
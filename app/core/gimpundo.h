@@ -36,6 +36,8 @@ struct _GimpUndoAccumulator
   gboolean resolution_changed;
 
   gboolean unit_changed;
+
+  gboolean failed;  /*  a step couldn't restore its data  */
 };
 
 
@@ -61,6 +63,10 @@ struct _GimpUndo
 
   GimpTempBuf      *preview;
   guint             preview_idle_id;
+
+  gint64            memsize;        /* size when pushed, for the stack    */
+  gint64            gui_size;
+  gint64            swap_size;
 };
 
 struct _GimpUndoClass
@@ -72,6 +78,12 @@ struct _GimpUndoClass
                  GimpUndoAccumulator *accum);
   void (* free) (GimpUndo            *undo,
                  GimpUndoMode         undo_mode);
+
+  /*  virtual functions  */
+  gint64 (* get_uncompressed_size) (GimpUndo    *undo);
+  void   (* swap_out)              (GimpUndo    *undo,
+                                    const gchar *path);
+  gint64 (* get_swap_size)         (GimpUndo    *undo);
 };
 
 
@@ -83,6 +95,12 @@ void          gimp_undo_pop             (GimpUndo            *undo,
 void          gimp_undo_free            (GimpUndo            *undo,
                                          GimpUndoMode         undo_mode);
 
+gint64        gimp_undo_get_uncompressed_size
+                                        (GimpUndo            *undo);
+void          gimp_undo_swap_out        (GimpUndo            *undo,
+                                         const gchar         *path);
+gint64        gimp_undo_get_swap_size   (GimpUndo            *undo);
+
 void          gimp_undo_create_preview  (GimpUndo            *undo,
                                          GimpContext         *context,
                                          gboolean             create_now);
@@ -0,0 +1,1086 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpundobuffer.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gegl.h>
+#include <glib/gstdio.h>
+
+#ifdef G_OS_WIN32
+#include <windows.h>
+#endif
+
+#include "core-types.h"
+
+#include "gegl/gimp-gegl-utils.h"
+
+#include "gimp-memsize.h"
+#include "gimp-parallel.h"
+#include "gimp-utils.h"
+#include "gimpundobuffer.h"
+
+#include "gimp-intl.h"
+
+
+/*  the pixels an undo step keeps, optionally compressed.
+ *
+ *  compression runs on a background thread, reading a copy-on-write
+ *  duplicate of the buffer, so the buffer stays usable until the
+ *  compressed strips are ready and replace it in the main loop.  the
+ *  buffer is compressed in strips one tile row high, which lets the
+ *  strips be decompressed in parallel into separate tiles.
+ *
+ *  the strips can also be swapped out to a file, by the same
+ *  background thread, and are read back when the pixels are needed.
+ */
+
+
+#define SWAP_FILE_PREFIX "gimp-undo-"
+
+
+typedef struct _UndoStrip   UndoStrip;
+typedef struct _CompressJob CompressJob;
+
+struct _UndoStrip
+{
+  guint8  *data;   /*  NULL if swapped out  */
+  gsize    size;   /*  stored uncompressed if this is the raw size  */
+  goffset  offset; /*  in the swap file  */
+};
+
+struct _GimpUndoBuffer
+{
+  GeglBuffer             *buffer;        /*  NULL while compressed  */
+  GeglRectangle           extent;
+  const Babl             *format;
+
+  GimpUndoCompression     compression;
+  gint                    strip_height;
+  gint                    n_strips;
+  UndoStrip              *strips;
+  gint64                  compressed_size;
+  gchar                  *swap_file;     /*  set while swapped out  */
+  gboolean                lost;          /*  the pixels couldn't be read  */
+
+  CompressJob            *job;
+  GimpUndoBufferCallback  callback;
+  gpointer                user_data;
+};
+
+struct _CompressJob
+{
+  GimpUndoBuffer      *undo_buffer;
+  GeglBuffer          *buffer;        /*  NULL to swap out given strips  */
+  GimpUndoCompression  compression;
+  gint                 strip_height;
+  gint                 n_strips;
+  UndoStrip           *strips;
+  gchar               *swap_file;
+  gboolean             swapped;
+
+  /*  protected by compress_mutex  */
+  gboolean             cancelled;
+  guint                idle_id;
+};
+
+typedef struct
+{
+  GimpUndoBuffer *undo_buffer;
+  GeglBuffer     *buffer;
+  const guint8   *swap_data;
+  gsize           swap_length;
+  gint            failed;
+} DecompressContext;
+
+
+/*  local function prototypes  */
+
+static void          gimp_undo_buffer_cancel          (GimpUndoBuffer      *undo_buffer);
+static void          gimp_undo_buffer_finish          (GimpUndoBuffer      *undo_buffer);
+static CompressJob * gimp_undo_buffer_job_new         (GimpUndoBuffer      *undo_buffer,
+                                                       GimpUndoCompression  compression);
+static void          gimp_undo_buffer_job_run         (CompressJob         *job);
+static void          gimp_undo_buffer_job_free        (CompressJob         *job);
+
+static gboolean      gimp_undo_buffer_decompress      (GimpUndoBuffer      *undo_buffer,
+                                                       GError             **error);
+static void          gimp_undo_buffer_decompress_func (gint                 i,
+                                                       gint                 n,
+                                                       DecompressContext   *context);
+
+static void          gimp_undo_buffer_compress_func   (CompressJob         *job,
+                                                       gpointer             data);
+static gboolean      gimp_undo_buffer_write_strips    (CompressJob         *job);
+static gboolean      gimp_undo_buffer_compress_done   (CompressJob         *job);
+
+static void          gimp_undo_buffer_strips_free     (UndoStrip           *strips,
+                                                       gint                 n_strips);
+static gboolean      gimp_undo_buffer_pid_is_running  (gint                 pid);
+static gint          gimp_undo_buffer_component_size  (const Babl          *format);
+static void          gimp_undo_buffer_predict         (const guint8        *src,
+                                                       guint8              *dest,
+                                                       gint                 width,
+                                                       gint                 bpp,
+                                                       gint                 component_size);
+static void          gimp_undo_buffer_unpredict       (const guint8        *src,
+                                                       guint8              *dest,
+                                                       gint                 width,
+                                                       gint                 bpp,
+                                                       gint                 component_size);
+
+
+static GThreadPool *compress_pool = NULL;
+static GMutex       compress_mutex;
+static GCond        compress_cond;
+
+
+/*  public functions  */
+
+GimpUndoBuffer *
+gimp_undo_buffer_new (GeglBuffer *buffer)
+{
+  GimpUndoBuffer *undo_buffer;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
+
+  undo_buffer = g_slice_new0 (GimpUndoBuffer);
+
+  undo_buffer->buffer = g_object_ref (buffer);
+  undo_buffer->extent = *gegl_buffer_get_extent (buffer);
+  undo_buffer->format = gegl_buffer_get_format (buffer);
+
+  return undo_buffer;
+}
+
+void
+gimp_undo_buffer_free (GimpUndoBuffer *undo_buffer)
+{
+  g_return_if_fail (undo_buffer != NULL);
+
+  gimp_undo_buffer_cancel (undo_buffer);
+
+  if (undo_buffer->buffer)
+    g_object_unref (undo_buffer->buffer);
+
+  gimp_undo_buffer_strips_free (undo_buffer->strips, undo_buffer->n_strips);
+
+  if (undo_buffer->swap_file)
+    {
+      g_unlink (undo_buffer->swap_file);
+      g_free (undo_buffer->swap_file);
+    }
+
+  g_slice_free (GimpUndoBuffer, undo_buffer);
+}
+
+/**
+ * gimp_undo_buffer_get_buffer:
+ * @undo_buffer: a #GimpUndoBuffer
+ * @error:       return location for an error, or %NULL
+ *
+ * Returns the pixels of @undo_buffer, reading them back from the swap
+ * file and decompressing them if needed.  Any compression still
+ * running is stopped, the buffer stays uncompressed until
+ * gimp_undo_buffer_compress() is called again, so it may be modified
+ * in place.
+ *
+ * Return value: the buffer, owned by @undo_buffer, or %NULL if the
+ * pixels couldn't be read back.
+ **/
+GeglBuffer *
+gimp_undo_buffer_get_buffer (GimpUndoBuffer  *undo_buffer,
+                             GError         **error)
+{
+  g_return_val_if_fail (undo_buffer != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (undo_buffer->lost)
+    {
+      g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                           _("The undo data was lost."));
+      return NULL;
+    }
+
+  /*  a job that took the strips has to finish, the others can be
+   *  dropped because the buffer is still there
+   */
+  if (undo_buffer->job && ! undo_buffer->job->buffer)
+    gimp_undo_buffer_finish (undo_buffer);
+  else
+    gimp_undo_buffer_cancel (undo_buffer);
+
+  if (! undo_buffer->buffer &&
+      ! gimp_undo_buffer_decompress (undo_buffer, error))
+    {
+      return NULL;
+    }
+
+  return undo_buffer->buffer;
+}
+
+gint
+gimp_undo_buffer_get_width (GimpUndoBuffer *undo_buffer)
+{
+  g_return_val_if_fail (undo_buffer != NULL, 0);
+
+  return undo_buffer->extent.width;
+}
+
+gint
+gimp_undo_buffer_get_height (GimpUndoBuffer *undo_buffer)
+{
+  g_return_val_if_fail (undo_buffer != NULL, 0);
+
+  return undo_buffer->extent.height;
+}
+
+/**
+ * gimp_undo_buffer_compress:
+ * @undo_buffer: a #GimpUndoBuffer
+ * @compression: the codec to use
+ * @callback:    function to call when the pixels are compressed, or %NULL
+ * @user_data:   data to pass to @callback
+ *
+ * Starts compressing the pixels of @undo_buffer on a background thread.
+ * Once done, the uncompressed buffer is released from the main loop and
+ * @callback is called, so the owner can account for the smaller size.
+ **/
+void
+gimp_undo_buffer_compress (GimpUndoBuffer         *undo_buffer,
+                           GimpUndoCompression     compression,
+                           GimpUndoBufferCallback  callback,
+                           gpointer                user_data)
+{
+  CompressJob *job;
+
+  g_return_if_fail (undo_buffer != NULL);
+
+  gimp_undo_buffer_cancel (undo_buffer);
+
+  if (compression == GIMP_UNDO_COMPRESSION_NONE || ! undo_buffer->buffer)
+    return;
+
+  undo_buffer->callback  = callback;
+  undo_buffer->user_data = user_data;
+
+  job = gimp_undo_buffer_job_new (undo_buffer, compression);
+
+  gimp_undo_buffer_job_run (job);
+}
+
+gboolean
+gimp_undo_buffer_is_compressed (GimpUndoBuffer *undo_buffer)
+{
+  g_return_val_if_fail (undo_buffer != NULL, FALSE);
+
+  return undo_buffer->buffer == NULL;
+}
+
+/**
+ * gimp_undo_buffer_swap_out:
+ * @undo_buffer: a #GimpUndoBuffer
+ * @path:        the directory to write the swap file to
+ * @compression: the codec to use if the pixels are not compressed yet
+ * @callback:    function to call when the pixels are swapped out, or %NULL
+ * @user_data:   data to pass to @callback
+ *
+ * Starts writing the pixels of @undo_buffer to a file in @path on a
+ * background thread, and releases them from memory once they are
+ * written.  The pixels no longer count as memory from now on, if
+ * writing fails they count again when @callback is called.
+ **/
+void
+gimp_undo_buffer_swap_out (GimpUndoBuffer         *undo_buffer,
+                           const gchar            *path,
+                           GimpUndoCompression     compression,
+                           GimpUndoBufferCallback  callback,
+                           gpointer                user_data)
+{
+  static gint  id  = 0;
+  static gint  pid = 0;
+  CompressJob *job;
+  gchar       *basename;
+
+  g_return_if_fail (undo_buffer != NULL);
+  g_return_if_fail (path != NULL);
+
+  if (gimp_undo_buffer_is_swapped (undo_buffer) || undo_buffer->lost)
+    return;
+
+  if (g_mkdir_with_parents (path, 0755) != 0)
+    return;
+
+  /*  a running compression starts over, writing its result  */
+  gimp_undo_buffer_cancel (undo_buffer);
+
+  undo_buffer->callback  = callback;
+  undo_buffer->user_data = user_data;
+
+  if (undo_buffer->buffer)
+    {
+      job = gimp_undo_buffer_job_new (undo_buffer, compression);
+    }
+  else
+    {
+      /*  already compressed, the job takes the strips for writing  */
+      job = g_slice_new0 (CompressJob);
+
+      job->undo_buffer  = undo_buffer;
+      job->compression  = undo_buffer->compression;
+      job->strip_height = undo_buffer->strip_height;
+      job->n_strips     = undo_buffer->n_strips;
+      job->strips       = undo_buffer->strips;
+
+      undo_buffer->strips   = NULL;
+      undo_buffer->n_strips = 0;
+      undo_buffer->job      = job;
+    }
+
+  if (pid == 0)
+    pid = gimp_get_pid ();
+
+  basename = g_strdup_printf (SWAP_FILE_PREFIX "%d-%d", pid, id++);
+  job->swap_file = g_build_filename (path, basename, NULL);
+  g_free (basename);
+
+  gimp_undo_buffer_job_run (job);
+}
+
+gboolean
+gimp_undo_buffer_is_swapped (GimpUndoBuffer *undo_buffer)
+{
+  g_return_val_if_fail (undo_buffer != NULL, FALSE);
+
+  return (undo_buffer->swap_file != NULL ||
+          (undo_buffer->job && undo_buffer->job->swap_file));
+}
+
+gint64
+gimp_undo_buffer_get_memsize (GimpUndoBuffer *undo_buffer)
+{
+  gint64 memsize = 0;
+
+  if (! undo_buffer)
+    return 0;
+
+  memsize += sizeof (GimpUndoBuffer);
+
+  if (gimp_undo_buffer_is_swapped (undo_buffer))
+    memsize += undo_buffer->n_strips * sizeof (UndoStrip);
+  else if (undo_buffer->buffer)
+    memsize += gimp_gegl_buffer_get_memsize (undo_buffer->buffer);
+  else
+    memsize += (undo_buffer->n_strips * sizeof (UndoStrip) +
+                undo_buffer->compressed_size);
+
+  return memsize;
+}
+
+gint64
+gimp_undo_buffer_get_raw_memsize (GimpUndoBuffer *undo_buffer)
+{
+  if (! undo_buffer)
+    return 0;
+
+  if (undo_buffer->buffer && ! gimp_undo_buffer_is_swapped (undo_buffer))
+    return gimp_undo_buffer_get_memsize (undo_buffer);
+
+  return (sizeof (GimpUndoBuffer) +
+          (gint64) babl_format_get_bytes_per_pixel (undo_buffer->format) *
+          undo_buffer->extent.width *
+          undo_buffer->extent.height);
+}
+
+/**
+ * gimp_undo_buffer_get_swap_size:
+ * @undo_buffer: a #GimpUndoBuffer
+ *
+ * Return value: the disk space used by @undo_buffer's swap file, or
+ * expected to be used while it is being written.
+ **/
+gint64
+gimp_undo_buffer_get_swap_size (GimpUndoBuffer *undo_buffer)
+{
+  if (! undo_buffer || ! gimp_undo_buffer_is_swapped (undo_buffer))
+    return 0;
+
+  if (undo_buffer->swap_file)
+    return undo_buffer->compressed_size;
+
+  if (undo_buffer->buffer)
+    return (gimp_undo_buffer_get_raw_memsize (undo_buffer) -
+            sizeof (GimpUndoBuffer));
+
+  return undo_buffer->compressed_size;
+}
+
+
+/**
+ * gimp_undo_buffer_clean_swap:
+ * @path: the directory swap files are written to
+ *
+ * Removes the swap files left in @path by sessions which didn't exit
+ * cleanly.  Files of sessions which are still running are kept.
+ **/
+void
+gimp_undo_buffer_clean_swap (const gchar *path)
+{
+  GDir        *dir;
+  const gchar *name;
+
+  g_return_if_fail (path != NULL);
+
+  dir = g_dir_open (path, 0, NULL);
+
+  if (! dir)
+    return;
+
+  while ((name = g_dir_read_name (dir)))
+    {
+      gint pid;
+
+      if (! g_str_has_prefix (name, SWAP_FILE_PREFIX))
+        continue;
+
+      pid = atoi (name + strlen (SWAP_FILE_PREFIX));
+
+      if (pid > 0 && ! gimp_undo_buffer_pid_is_running (pid))
+        {
+          gchar *filename = g_build_filename (path, name, NULL);
+
+          g_unlink (filename);
+          g_free (filename);
+        }
+    }
+
+  g_dir_close (dir);
+}
+
+/*  private functions  */
+
+static void
+gimp_undo_buffer_cancel (GimpUndoBuffer *undo_buffer)
+{
+  CompressJob *job = undo_buffer->job;
+
+  if (! job)
+    return;
+
+  undo_buffer->job = NULL;
+
+  g_mutex_lock (&compress_mutex);
+
+  if (job->idle_id)
+    {
+      /*  the job is done, but its result wasn't picked up yet  */
+      g_source_remove (job->idle_id);
+      job->idle_id = 0;
+
+      g_mutex_unlock (&compress_mutex);
+
+      gimp_undo_buffer_job_free (job);
+    }
+  else
+    {
+      /*  the worker frees the job when it sees the flag  */
+      job->cancelled = TRUE;
+
+      g_mutex_unlock (&compress_mutex);
+    }
+}
+
+static void
+gimp_undo_buffer_finish (GimpUndoBuffer *undo_buffer)
+{
+  CompressJob *job = undo_buffer->job;
+
+  g_mutex_lock (&compress_mutex);
+
+  while (! job->idle_id)
+    g_cond_wait (&compress_cond, &compress_mutex);
+
+  g_source_remove (job->idle_id);
+
+  g_mutex_unlock (&compress_mutex);
+
+  gimp_undo_buffer_compress_done (job);
+}
+
+static CompressJob *
+gimp_undo_buffer_job_new (GimpUndoBuffer      *undo_buffer,
+                          GimpUndoCompression  compression)
+{
+  CompressJob *job;
+  gint         tile_height;
+
+  g_object_get (undo_buffer->buffer,
+                "tile-height", &tile_height,
+                NULL);
+
+  job = g_slice_new0 (CompressJob);
+
+  job->undo_buffer  = undo_buffer;
+  job->buffer       = gimp_gegl_buffer_dup_area (undo_buffer->buffer,
+                                                 &undo_buffer->extent);
+  job->compression  = compression;
+  job->strip_height = MAX (tile_height, 1);
+  job->n_strips     = ((undo_buffer->extent.height + job->strip_height - 1) /
+                       job->strip_height);
+  job->strips       = g_new0 (UndoStrip, job->n_strips);
+
+  undo_buffer->job = job;
+
+  return job;
+}
+
+static void
+gimp_undo_buffer_job_run (CompressJob *job)
+{
+  if (! compress_pool)
+    compress_pool = g_thread_pool_new ((GFunc) gimp_undo_buffer_compress_func,
+                                       NULL, 1, FALSE, NULL);
+
+  g_thread_pool_push (compress_pool, job, NULL);
+}
+
+static gboolean
+gimp_undo_buffer_decompress (GimpUndoBuffer  *undo_buffer,
+                             GError         **error)
+{
+  DecompressContext  context = { 0, };
+  gchar             *swap_data = NULL;
+  gsize              swap_length = 0;
+  gint               tile_height;
+
+  if (undo_buffer->swap_file)
+    {
+      gboolean success;
+
+      success = g_file_get_contents (undo_buffer->swap_file,
+                                     &swap_data, &swap_length, error);
+
+      g_unlink (undo_buffer->swap_file);
+      g_clear_pointer (&undo_buffer->swap_file, g_free);
+
+      if (! success)
+        {
+          gimp_undo_buffer_strips_free (undo_buffer->strips,
+                                        undo_buffer->n_strips);
+
+          undo_buffer->strips          = NULL;
+          undo_buffer->n_strips        = 0;
+          undo_buffer->compressed_size = 0;
+          undo_buffer->lost            = TRUE;
+
+          return FALSE;
+        }
+    }
+
+  context.undo_buffer = undo_buffer;
+  context.buffer      = gegl_buffer_new (&undo_buffer->extent,
+                                         undo_buffer->format);
+  context.swap_data   = (const guint8 *) swap_data;
+  context.swap_length = swap_length;
+
+  g_object_get (context.buffer,
+                "tile-height", &tile_height,
+                NULL);
+
+  /*  strips may only be written in parallel if they cover whole tiles  */
+  if (tile_height == undo_buffer->strip_height &&
+      undo_buffer->extent.y % tile_height == 0)
+    {
+      gimp_parallel_distribute (MIN (undo_buffer->n_strips,
+                                     GIMP_PARALLEL_MAX_THREADS),
+                                (GimpParallelDistributeFunc)
+                                gimp_undo_buffer_decompress_func,
+                                &context);
+    }
+  else
+    {
+      gimp_undo_buffer_decompress_func (0, 1, &context);
+    }
+
+  gimp_undo_buffer_strips_free (undo_buffer->strips, undo_buffer->n_strips);
+  g_free (swap_data);
+
+  undo_buffer->strips          = NULL;
+  undo_buffer->n_strips        = 0;
+  undo_buffer->compressed_size = 0;
+
+  if (g_atomic_int_get (&context.failed))
+    {
+      g_object_unref (context.buffer);
+
+      undo_buffer->lost = TRUE;
+
+      g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                           _("The undo data is damaged."));
+
+      return FALSE;
+    }
+
+  undo_buffer->buffer = context.buffer;
+
+  return TRUE;
+}
+
+static void
+gimp_undo_buffer_decompress_func (gint               i,
+                                  gint               n,
+                                  DecompressContext *context)
+{
+  GimpUndoBuffer *undo_buffer    = context->undo_buffer;
+  gint            bpp            = babl_format_get_bytes_per_pixel (undo_buffer->format);
+  gint            component_size = gimp_undo_buffer_component_size (undo_buffer->format);
+  gint            row_size       = undo_buffer->extent.width * bpp;
+  guint8         *raw;
+  guint8         *predicted      = NULL;
+  gint            k;
+
+  raw = g_malloc (row_size * undo_buffer->strip_height);
+
+  if (undo_buffer->compression == GIMP_UNDO_COMPRESSION_DELTA_ZLIB)
+    predicted = g_malloc (row_size * undo_buffer->strip_height);
+
+  for (k = i; k < undo_buffer->n_strips; k += n)
+    {
+      const UndoStrip *strip = &undo_buffer->strips[k];
+      const guint8    *data  = strip->data;
+      GeglRectangle    rect;
+      gsize            size;
+
+      rect.x      = undo_buffer->extent.x;
+      rect.y      = undo_buffer->extent.y + k * undo_buffer->strip_height;
+      rect.width  = undo_buffer->extent.width;
+      rect.height = MIN (undo_buffer->strip_height,
+                         undo_buffer->extent.y + undo_buffer->extent.height -
+                         rect.y);
+
+      size = (gsize) row_size * rect.height;
+
+      if (! data)
+        {
+          /*  a truncated swap file doesn't have all the strips  */
+          if (! context->swap_data ||
+              strip->offset < 0    ||
+              (gsize) strip->offset > context->swap_length ||
+              strip->size > context->swap_length - strip->offset)
+            {
+              g_atomic_int_set (&context->failed, TRUE);
+              break;
+            }
+
+          data = context->swap_data + strip->offset;
+        }
+
+      if (strip->size == size)
+        {
+          memcpy (raw, data, size);
+        }
+      else if (! predicted)
+        {
+          uLongf raw_size = size;
+
+          if (uncompress (raw, &raw_size, data, strip->size) != Z_OK ||
+              raw_size != size)
+            {
+              g_atomic_int_set (&context->failed, TRUE);
+              break;
+            }
+        }
+      else
+        {
+          uLongf raw_size = size;
+          gint   y;
+
+          if (uncompress (predicted, &raw_size, data, strip->size) != Z_OK ||
+              raw_size != size)
+            {
+              g_atomic_int_set (&context->failed, TRUE);
+              break;
+            }
+
+          for (y = 0; y < rect.height; y++)
+            gimp_undo_buffer_unpredict (predicted + y * row_size,
+                                        raw       + y * row_size,
+                                        rect.width, bpp, component_size);
+        }
+
+      gegl_buffer_set (context->buffer, &rect, 0, undo_buffer->format,
+                       raw, GEGL_AUTO_ROWSTRIDE);
+    }
+
+  g_free (predicted);
+  g_free (raw);
+}
+
+static void
+gimp_undo_buffer_compress_func (CompressJob *job,
+                                gpointer     data)
+{
+  gboolean cancelled = FALSE;
+
+  if (job->buffer)
+    {
+      const Babl    *format         = gegl_buffer_get_format (job->buffer);
+      GeglRectangle  extent         = *gegl_buffer_get_extent (job->buffer);
+      gint           bpp            = babl_format_get_bytes_per_pixel (format);
+      gint           component_size = gimp_undo_buffer_component_size (format);
+      gint           row_size       = extent.width * bpp;
+      uLong          bound;
+      guint8        *raw;
+      guint8        *predicted      = NULL;
+      guint8        *packed;
+      gint           k;
+
+      bound  = compressBound (row_size * job->strip_height);
+      raw    = g_malloc (row_size * job->strip_height);
+      packed = g_malloc (bound);
+
+      if (job->compression == GIMP_UNDO_COMPRESSION_DELTA_ZLIB)
+        predicted = g_malloc (row_size * job->strip_height);
+
+      for (k = 0; k < job->n_strips && ! cancelled; k++)
+        {
+          UndoStrip     *strip = &job->strips[k];
+          GeglRectangle  rect;
+          const guint8  *src   = raw;
+          gsize          size;
+          uLongf         packed_size = bound;
+
+          rect.x      = extent.x;
+          rect.y      = extent.y + k * job->strip_height;
+          rect.width  = extent.width;
+          rect.height = MIN (job->strip_height,
+                             extent.y + extent.height - rect.y);
+
+          size = (gsize) row_size * rect.height;
+
+          gegl_buffer_get (job->buffer, &rect, 1.0, format, raw,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          if (predicted)
+            {
+              gint y;
+
+              for (y = 0; y < rect.height; y++)
+                gimp_undo_buffer_predict (raw       + y * row_size,
+                                          predicted + y * row_size,
+                                          rect.width, bpp, component_size);
+
+              src = predicted;
+            }
+
+          if (job->compression != GIMP_UNDO_COMPRESSION_NONE &&
+              compress2 (packed, &packed_size, src, size,
+                         Z_BEST_SPEED) == Z_OK &&
+              packed_size < size)
+            {
+              strip->data = g_memdup (packed, packed_size);
+              strip->size = packed_size;
+            }
+          else
+            {
+              strip->data = g_memdup (raw, size);
+              strip->size = size;
+            }
+
+          g_mutex_lock (&compress_mutex);
+          cancelled = job->cancelled;
+          g_mutex_unlock (&compress_mutex);
+        }
+
+      g_free (predicted);
+      g_free (packed);
+      g_free (raw);
+    }
+
+  if (job->swap_file && ! cancelled)
+    job->swapped = gimp_undo_buffer_write_strips (job);
+
+  g_mutex_lock (&compress_mutex);
+
+  if (job->cancelled)
+    {
+      g_mutex_unlock (&compress_mutex);
+
+      gimp_undo_buffer_job_free (job);
+    }
+  else
+    {
+      job->idle_id = g_idle_add ((GSourceFunc) gimp_undo_buffer_compress_done,
+                                 job);
+
+      g_cond_broadcast (&compress_cond);
+
+      g_mutex_unlock (&compress_mutex);
+    }
+}
+
+static gboolean
+gimp_undo_buffer_write_strips (CompressJob *job)
+{
+  FILE     *file;
+  goffset   offset  = 0;
+  gboolean  success = TRUE;
+  gint      k;
+
+  file = g_fopen (job->swap_file, "wb");
+
+  if (! file)
+    return FALSE;
+
+  for (k = 0; k < job->n_strips && success; k++)
+    {
+      UndoStrip *strip = &job->strips[k];
+
+      strip->offset = offset;
+
+      if (fwrite (strip->data, 1, strip->size, file) != strip->size)
+        success = FALSE;
+
+      offset += strip->size;
+    }
+
+  if (fclose (file) != 0)
+    success = FALSE;
+
+  if (! success)
+    {
+      g_unlink (job->swap_file);
+
+      return FALSE;
+    }
+
+  /*  the strips are only dropped once all of them are on disk  */
+  for (k = 0; k < job->n_strips; k++)
+    g_clear_pointer (&job->strips[k].data, g_free);
+
+  return TRUE;
+}
+
+static gboolean
+gimp_undo_buffer_compress_done (CompressJob *job)
+{
+  GimpUndoBuffer *undo_buffer = job->undo_buffer;
+  gint            k;
+
+  g_mutex_lock (&compress_mutex);
+  job->idle_id = 0;
+  g_mutex_unlock (&compress_mutex);
+
+  undo_buffer->job             = NULL;
+  undo_buffer->compression     = job->compression;
+  undo_buffer->strip_height    = job->strip_height;
+  undo_buffer->n_strips        = job->n_strips;
+  undo_buffer->strips          = job->strips;
+  undo_buffer->compressed_size = 0;
+
+  for (k = 0; k < undo_buffer->n_strips; k++)
+    undo_buffer->compressed_size += undo_buffer->strips[k].size;
+
+  if (job->swapped)
+    {
+      undo_buffer->swap_file = job->swap_file;
+      job->swap_file         = NULL;
+    }
+
+  job->strips = NULL;
+
+  gimp_undo_buffer_job_free (job);
+
+  g_clear_object (&undo_buffer->buffer);
+
+  if (undo_buffer->callback)
+    undo_buffer->callback (undo_buffer, undo_buffer->user_data);
+
+  return FALSE;
+}
+
+static void
+gimp_undo_buffer_job_free (CompressJob *job)
+{
+  gimp_undo_buffer_strips_free (job->strips, job->n_strips);
+
+  if (job->buffer)
+    g_object_unref (job->buffer);
+
+  if (job->swap_file)
+    {
+      /*  written, but never picked up  */
+      if (job->swapped)
+        g_unlink (job->swap_file);
+
+      g_free (job->swap_file);
+    }
+
+  g_slice_free (CompressJob, job);
+}
+
+static void
+gimp_undo_buffer_strips_free (UndoStrip *strips,
+                              gint       n_strips)
+{
+  gint k;
+
+  if (! strips)
+    return;
+
+  for (k = 0; k < n_strips; k++)
+    g_free (strips[k].data);
+
+  g_free (strips);
+}
+
+static gboolean
+gimp_undo_buffer_pid_is_running (gint pid)
+{
+#ifdef G_OS_WIN32
+  HANDLE   process;
+  DWORD    exit_code;
+  gboolean running = FALSE;
+
+  process = OpenProcess (PROCESS_QUERY_INFORMATION, FALSE, pid);
+
+  if (process)
+    {
+      running = (GetExitCodeProcess (process, &exit_code) &&
+                 exit_code == STILL_ACTIVE);
+
+      CloseHandle (process);
+    }
+
+  return running;
+#else
+  return (kill (pid, 0) == 0 || errno == EPERM);
+#endif
+}
+
+static gint
+gimp_undo_buffer_component_size (const Babl *format)
+{
+  gint bpp          = babl_format_get_bytes_per_pixel (format);
+  gint n_components = babl_format_get_n_components (format);
+  gint size;
+
+  if (n_components < 1 || bpp % n_components)
+    return 1;
+
+  size = bpp / n_components;
+
+  if (size != 1 && size != 2 && size != 4 && size != 8)
+    return 1;
+
+  return size;
+}
+
+/*  the predictor replaces each component by its difference to the same
+ *  component of the previous pixel, computed on the component's bits
+ *  as an unsigned integer so that it is exact for floats as well, and
+ *  then splits the row into planes of equally significant bytes.  for
+ *  smooth float data this turns the exponent and high mantissa bytes
+ *  into long runs of zeros, which zlib compresses well.
+ */
+
+#define PREDICT(type)                                                   \
+  G_STMT_START {                                                        \
+    const type *s = (const type *) src;                                 \
+                                                                        \
+    for (x = 0; x < width; x++)                                         \
+      for (c = 0; c < n_components; c++)                                \
+        {                                                               \
+          type          delta = s[x * n_components + c];                \
+          const guint8 *bytes = (const guint8 *) &delta;                \
+                                                                        \
+          if (x > 0)                                                    \
+            delta -= s[(x - 1) * n_components + c];                     \
+                                                                        \
+          for (b = 0; b < sizeof (type); b++)                           \
+            dest[(c * sizeof (type) + b) * width + x] = bytes[b];       \
+        }                                                               \
+  } G_STMT_END
+
+#define UNPREDICT(type)                                                 \
+  G_STMT_START {                                                        \
+    type *d = (type *) dest;                                            \
+                                                                        \
+    for (x = 0; x < width; x++)                                         \
+      for (c = 0; c < n_components; c++)                                \
+        {                                                               \
+          type    delta;                                                \
+          guint8 *bytes = (guint8 *) &delta;                            \
+                                                                        \
+          for (b = 0; b < sizeof (type); b++)                           \
+            bytes[b] = src[(c * sizeof (type) + b) * width + x];        \
+                                                                        \
+          if (x > 0)                                                    \
+            delta += d[(x - 1) * n_components + c];                     \
+                                                                        \
+          d[x * n_components + c] = delta;                              \
+        }                                                               \
+  } G_STMT_END
+
+static void
+gimp_undo_buffer_predict (const guint8 *src,
+                          guint8       *dest,
+                          gint          width,
+                          gint          bpp,
+                          gint          component_size)
+{
+  gint  n_components = bpp / component_size;
+  gint  x, c;
+  gsize b;
+
+  switch (component_size)
+    {
+    case 1: PREDICT (guint8);  break;
+    case 2: PREDICT (guint16); break;
+    case 4: PREDICT (guint32); break;
+    case 8: PREDICT (guint64); break;
+    }
+}
+
+static void
+gimp_undo_buffer_unpredict (const guint8 *src,
+                            guint8       *dest,
+                            gint          width,
+                            gint          bpp,
+                            gint          component_size)
+{
+  gint  n_components = bpp / component_size;
+  gint  x, c;
+  gsize b;
+
+  switch (component_size)
+    {
+    case 1: UNPREDICT (guint8);  break;
+    case 2: UNPREDICT (guint16); break;
+    case 4: UNPREDICT (guint32); break;
+    case 8: UNPREDICT (guint64); break;
+    }
+}
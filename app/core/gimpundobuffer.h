@@ -0,0 +1,54 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_UNDO_BUFFER_H__
+#define __GIMP_UNDO_BUFFER_H__
+
+
+typedef void (* GimpUndoBufferCallback) (GimpUndoBuffer *undo_buffer,
+                                         gpointer        user_data);
+
+
+GimpUndoBuffer * gimp_undo_buffer_new             (GeglBuffer             *buffer);
+void             gimp_undo_buffer_free            (GimpUndoBuffer         *undo_buffer);
+
+GeglBuffer     * gimp_undo_buffer_get_buffer      (GimpUndoBuffer         *undo_buffer,
+                                                   GError                **error);
+gint             gimp_undo_buffer_get_width       (GimpUndoBuffer         *undo_buffer);
+gint             gimp_undo_buffer_get_height      (GimpUndoBuffer         *undo_buffer);
+
+void             gimp_undo_buffer_compress        (GimpUndoBuffer         *undo_buffer,
+                                                   GimpUndoCompression     compression,
+                                                   GimpUndoBufferCallback  callback,
+                                                   gpointer                user_data);
+gboolean         gimp_undo_buffer_is_compressed   (GimpUndoBuffer         *undo_buffer);
+
+void             gimp_undo_buffer_swap_out        (GimpUndoBuffer         *undo_buffer,
+                                                   const gchar            *path,
+                                                   GimpUndoCompression     compression,
+                                                   GimpUndoBufferCallback  callback,
+                                                   gpointer                user_data);
+gboolean         gimp_undo_buffer_is_swapped      (GimpUndoBuffer         *undo_buffer);
+
+gint64           gimp_undo_buffer_get_memsize     (GimpUndoBuffer         *undo_buffer);
+gint64           gimp_undo_buffer_get_raw_memsize (GimpUndoBuffer         *undo_buffer);
+gint64           gimp_undo_buffer_get_swap_size   (GimpUndoBuffer         *undo_buffer);
+
+void             gimp_undo_buffer_clean_swap      (const gchar            *path);
+
+
+#endif  /*  __GIMP_UNDO_BUFFER_H__  */
@@ -38,6 +38,12 @@ static void    gimp_undo_stack_pop         (GimpUndo            *undo,
                                             GimpUndoAccumulator *accum);
 static void    gimp_undo_stack_free        (GimpUndo            *undo,
                                             GimpUndoMode         undo_mode);
+static gint64  gimp_undo_stack_get_uncompressed_size
+                                           (GimpUndo            *undo);
+static void    gimp_undo_stack_swap_out    (GimpUndo            *undo,
+                                            const gchar         *path);
+static gint64  gimp_undo_stack_get_swap_size
+                                           (GimpUndo            *undo);
 
 
 G_DEFINE_TYPE (GimpUndoStack, gimp_undo_stack, GIMP_TYPE_UNDO)
@@ -52,12 +58,15 @@ gimp_undo_stack_class_init (GimpUndoStackClass *klass)
   GimpObjectClass *gimp_object_class = GIMP_OBJECT_CLASS (klass);
   GimpUndoClass   *undo_class        = GIMP_UNDO_CLASS (klass);
 
-  object_class->finalize         = gimp_undo_stack_finalize;
+  object_class->finalize            = gimp_undo_stack_finalize;
 
-  gimp_object_class->get_memsize = gimp_undo_stack_get_memsize;
+  gimp_object_class->get_memsize    = gimp_undo_stack_get_memsize;
 
-  undo_class->pop                = gimp_undo_stack_pop;
-  undo_class->free               = gimp_undo_stack_free;
+  undo_class->pop                   = gimp_undo_stack_pop;
+  undo_class->free                  = gimp_undo_stack_free;
+  undo_class->get_uncompressed_size = gimp_undo_stack_get_uncompressed_size;
+  undo_class->swap_out              = gimp_undo_stack_swap_out;
+  undo_class->get_swap_size         = gimp_undo_stack_get_swap_size;
 }
 
 static void
@@ -87,7 +96,13 @@ gimp_undo_stack_get_memsize (GimpObject *object,
   GimpUndoStack *stack   = GIMP_UNDO_STACK (object);
   gint64         memsize = 0;
 
-  memsize += gimp_object_get_memsize (GIMP_OBJECT (stack->undos), gui_size);
+  /*  use the running totals instead of asking each undo, this is
+   *  called once per freed step when the undo stack is trimmed
+   */
+  memsize += (stack->memsize +
+              gimp_container_get_n_children (stack->undos) * sizeof (GList));
+
+  *gui_size += stack->gui_size;
 
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
@@ -108,6 +123,27 @@ gimp_undo_stack_pop (GimpUndo            *undo,
       GimpUndo *child = list->data;
 
       gimp_undo_pop (child, undo_mode, accum);
+
+      if (accum->failed)
+        break;
+    }
+
+  /*  a child failed, put the ones popped before it back the way they
+   *  were, so the whole group stays where it is
+   */
+  if (list)
+    {
+      GimpUndoMode        rollback_mode = (undo_mode == GIMP_UNDO_MODE_UNDO ?
+                                           GIMP_UNDO_MODE_REDO :
+                                           GIMP_UNDO_MODE_UNDO);
+      GimpUndoAccumulator rollback      = { 0, };
+
+      for (list = g_list_previous (list);
+           list;
+           list = g_list_previous (list))
+        {
+          gimp_undo_pop (list->data, rollback_mode, &rollback);
+        }
     }
 }
 
@@ -129,6 +165,55 @@ gimp_undo_stack_free (GimpUndo     *undo,
     }
 
   gimp_container_clear (stack->undos);
+
+  stack->memsize   = 0;
+  stack->gui_size  = 0;
+  stack->swap_size = 0;
+}
+
+static gint64
+gimp_undo_stack_get_uncompressed_size (GimpUndo *undo)
+{
+  GimpUndoStack *stack = GIMP_UNDO_STACK (undo);
+  gint64         size;
+  GList         *list;
+
+  size = GIMP_UNDO_CLASS (parent_class)->get_uncompressed_size (undo);
+
+  for (list = GIMP_LIST (stack->undos)->queue->head;
+       list;
+       list = g_list_next (list))
+    {
+      GimpUndo *child = list->data;
+
+      size += gimp_undo_get_uncompressed_size (child) - child->memsize;
+    }
+
+  return size;
+}
+
+static void
+gimp_undo_stack_swap_out (GimpUndo    *undo,
+                          const gchar *path)
+{
+  GimpUndoStack *stack = GIMP_UNDO_STACK (undo);
+  GList         *list;
+
+  for (list = GIMP_LIST (stack->undos)->queue->head;
+       list;
+       list = g_list_next (list))
+    {
+      GimpUndo *child = list->data;
+
+      gimp_undo_swap_out (child, path);
+      gimp_undo_stack_update_undo (stack, child);
+    }
+}
+
+static gint64
+gimp_undo_stack_get_swap_size (GimpUndo *undo)
+{
+  return GIMP_UNDO_STACK (undo)->swap_size;
 }
 
 GimpUndoStack *
@@ -148,6 +233,14 @@ gimp_undo_stack_push_undo (GimpUndoStack *stack,
   g_return_if_fail (GIMP_IS_UNDO_STACK (stack));
   g_return_if_fail (GIMP_IS_UNDO (undo));
 
+  undo->memsize   = gimp_object_get_memsize (GIMP_OBJECT (undo),
+                                             &undo->gui_size);
+  undo->swap_size = gimp_undo_get_swap_size (undo);
+
+  stack->memsize   += undo->memsize;
+  stack->gui_size  += undo->gui_size;
+  stack->swap_size += undo->swap_size;
+
   gimp_container_add (stack->undos, GIMP_OBJECT (undo));
 }
 
@@ -166,6 +259,11 @@ gimp_undo_stack_pop_undo (GimpUndoStack       *stack,
   if (undo)
     {
       gimp_container_remove (stack->undos, GIMP_OBJECT (undo));
+
+      stack->memsize   -= undo->memsize;
+      stack->gui_size  -= undo->gui_size;
+      stack->swap_size -= undo->swap_size;
+
       gimp_undo_pop (undo, undo_mode, accum);
 
       return undo;
@@ -187,6 +285,11 @@ gimp_undo_stack_free_bottom (GimpUndoStack *stack,
   if (undo)
     {
       gimp_container_remove (stack->undos, GIMP_OBJECT (undo));
+
+      stack->memsize   -= undo->memsize;
+      stack->gui_size  -= undo->gui_size;
+      stack->swap_size -= undo->swap_size;
+
       gimp_undo_free (undo, undo_mode);
 
       return undo;
@@ -195,6 +298,35 @@ gimp_undo_stack_free_bottom (GimpUndoStack *stack,
   return NULL;
 }
 
+/**
+ * gimp_undo_stack_update_undo:
+ * @stack: a #GimpUndoStack
+ * @undo:  an undo on @stack
+ *
+ * Takes the current size of @undo into the running totals of @stack.
+ * The size of an undo is only asked for when it is pushed, call this
+ * when it changed since, like when steps were added to an undo group.
+ **/
+void
+gimp_undo_stack_update_undo (GimpUndoStack *stack,
+                             GimpUndo      *undo)
+{
+  g_return_if_fail (GIMP_IS_UNDO_STACK (stack));
+  g_return_if_fail (GIMP_IS_UNDO (undo));
+
+  stack->memsize   -= undo->memsize;
+  stack->gui_size  -= undo->gui_size;
+  stack->swap_size -= undo->swap_size;
+
+  undo->memsize   = gimp_object_get_memsize (GIMP_OBJECT (undo),
+                                             &undo->gui_size);
+  undo->swap_size = gimp_undo_get_swap_size (undo);
+
+  stack->memsize   += undo->memsize;
+  stack->gui_size  += undo->gui_size;
+  stack->swap_size += undo->swap_size;
+}
+
 GimpUndo *
 gimp_undo_stack_peek (GimpUndoStack *stack)
 {
@@ -37,6 +37,10 @@ struct _GimpUndoStack
   GimpUndo       parent_instance;
 
   GimpContainer *undos;
+
+  gint64         memsize;   /* sum of the undos' sizes when pushed */
+  gint64         gui_size;
+  gint64         swap_size;
 };
 
 struct _GimpUndoStackClass
@@ -57,6 +61,8 @@ GimpUndo      * gimp_undo_stack_pop_undo    (GimpUndoStack       *stack,
 
 GimpUndo      * gimp_undo_stack_free_bottom (GimpUndoStack       *stack,
                                              GimpUndoMode         undo_mode);
+void            gimp_undo_stack_update_undo (GimpUndoStack       *stack,
+                                             GimpUndo            *undo);
 GimpUndo      * gimp_undo_stack_peek        (GimpUndoStack       *stack);
 gint            gimp_undo_stack_get_depth   (GimpUndoStack       *stack);
 
@@ -32,6 +32,7 @@
 
 #include "core-types.h"
 
+#include "gimp-memory-manager.h"
 #include "gimp-memsize.h"
 #include "gimpcontext.h"
 #include "gimpmarshal.h"
@@ -92,6 +93,10 @@ static gint64  gimp_viewable_get_memsize             (GimpObject    *object,
                                                       gint64        *gui_size);
 
 static void    gimp_viewable_real_invalidate_preview (GimpViewable  *viewable);
+static gint64  gimp_viewable_get_preview_memsize     (GimpViewable  *viewable,
+                                                      gpointer       data);
+static gboolean gimp_viewable_evict_preview          (GimpViewable  *viewable,
+                                                      gpointer       data);
 
 static GdkPixbuf * gimp_viewable_real_get_new_pixbuf (GimpViewable  *viewable,
                                                       GimpContext   *context,
@@ -230,6 +235,8 @@ gimp_viewable_finalize (GObject *object)
 {
   GimpViewablePrivate *private = GET_PRIVATE (object);
 
+  gimp_memory_manager_remove (object);
+
   if (private->icon_name)
     {
       g_free (private->icon_name);
@@ -321,17 +328,7 @@ static gint64
 gimp_viewable_get_memsize (GimpObject *object,
                            gint64     *gui_size)
 {
-  GimpViewablePrivate *private = GET_PRIVATE (object);
-
-  *gui_size += gimp_temp_buf_get_memsize (private->preview_temp_buf);
-
-  if (private->preview_pixbuf)
-    {
-      *gui_size +=
-        (gimp_g_object_get_memsize (G_OBJECT (private->preview_pixbuf)) +
-         (gsize) gdk_pixbuf_get_height (private->preview_pixbuf) *
-         gdk_pixbuf_get_rowstride (private->preview_pixbuf));
-    }
+  *gui_size += gimp_viewable_get_preview_memsize (G_OBJECT (object));
 
   return GIMP_OBJECT_CLASS (parent_class)->get_memsize (object, gui_size);
 }
@@ -354,6 +351,38 @@ gimp_viewable_real_invalidate_preview (GimpViewable *viewable)
     }
 }
 
+static gint64
+gimp_viewable_get_preview_memsize (GimpViewable *viewable,
+                                   gpointer      data)
+{
+  GimpViewablePrivate *private = GET_PRIVATE (viewable);
+  gint64               memsize;
+
+  memsize = gimp_temp_buf_get_memsize (private->preview_temp_buf);
+
+  if (private->preview_pixbuf)
+    {
+      memsize +=
+        (gimp_g_object_get_memsize (G_OBJECT (private->preview_pixbuf)) +
+         (gsize) gdk_pixbuf_get_height (private->preview_pixbuf) *
+         gdk_pixbuf_get_rowstride (private->preview_pixbuf));
+    }
+
+  return memsize;
+}
+
+static gboolean
+gimp_viewable_evict_preview (GimpViewable *viewable,
+                             gpointer      data)
+{
+  /*  the previews are recreated on demand, and views keep their own
+   *  copy of what they show, so there is nothing to notify
+   */
+  gimp_viewable_real_invalidate_preview (viewable);
+
+  return TRUE;
+}
+
 static void
 gimp_viewable_real_get_preview_size (GimpViewable *viewable,
                                      gint          size,
@@ -845,6 +874,8 @@ gimp_viewable_get_preview (GimpViewable *viewable,
       if (gimp_temp_buf_get_width  (private->preview_temp_buf) == width &&
           gimp_temp_buf_get_height (private->preview_temp_buf) == height)
         {
+          gimp_memory_manager_touch (viewable);
+
           return private->preview_temp_buf;
         }
 
@@ -858,6 +889,14 @@ gimp_viewable_get_preview (GimpViewable *viewable,
 
   private->preview_temp_buf = temp_buf;
 
+  if (temp_buf)
+    gimp_memory_manager_add (viewable,
+                             (GimpMemoryManagerSizeFunc)
+                             gimp_viewable_get_preview_memsize,
+                             (GimpMemoryManagerEvictFunc)
+                             gimp_viewable_evict_preview,
+                             NULL);
+
   return temp_buf;
 }
 
@@ -1003,6 +1042,8 @@ gimp_viewable_get_pixbuf (GimpViewable *viewable,
       if (gdk_pixbuf_get_width  (private->preview_pixbuf) == width &&
           gdk_pixbuf_get_height (private->preview_pixbuf) == height)
         {
+          gimp_memory_manager_touch (viewable);
+
           return private->preview_pixbuf;
         }
 
@@ -1015,6 +1056,14 @@ gimp_viewable_get_pixbuf (GimpViewable *viewable,
 
   private->preview_pixbuf = pixbuf;
 
+  if (pixbuf)
+    gimp_memory_manager_add (viewable,
+                             (GimpMemoryManagerSizeFunc)
+                             gimp_viewable_get_preview_memsize,
+                             (GimpMemoryManagerEvictFunc)
+                             gimp_viewable_evict_preview,
+                             NULL);
+
   return pixbuf;
 }
 
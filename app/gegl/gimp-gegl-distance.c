@@ -0,0 +1,1158 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-gegl-distance.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gegl.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "gimp-gegl-types.h"
+
+#include "gimp-gegl-distance.h"
+
+#include "core/gimp-parallel.h"
+
+
+/*  grow, shrink and border of binary masks.
+ *
+ *  every pixel first gets its vertical distance to the nearest seed
+ *  pixel of its column: a selected pixel for grow, an unselected one
+ *  for shrink, a pixel on the edge of the selection for border. the
+ *  elliptic structuring elements used by these operations are
+ *  symmetric and get shorter away from their center column, so
+ *  whether a pixel is reached from a given column only depends on
+ *  that column's distance. each row is then resolved in one or two
+ *  passes over its columns, and the cost doesn't depend on the
+ *  radius. the result is the same as that of the structuring element
+ *  scans in the grow, shrink and border operations.
+ */
+
+
+#define COLUMN_STRIP 64
+
+
+typedef enum
+{
+  SEED_SELECTED,
+  SEED_UNSELECTED,
+  SEED_EDGE
+} SeedType;
+
+typedef struct
+{
+  GeglBuffer    *src_buffer;
+  GeglBuffer    *dest_buffer;
+  GeglRectangle  roi;
+  gint           tile_height;
+  gint           first_tile_row;
+  gint           n_bands;
+
+  gint           radius_x;
+  gint           radius_y;
+  SeedType       seed_type;
+  gboolean       feather;
+  gboolean       edge_lock;
+
+  guint32       *dist;        /*  distance to the nearest seed of the
+                               *  column, capped at radius_y + 1
+                               */
+  gint          *reach;       /*  horizontal reach of each distance     */
+  gint           non_binary;
+
+  guint32       *column_dist; /*  uncapped distances, for the transform */
+  gfloat        *band_max;
+  gfloat         scale;
+} Distance;
+
+
+/*  local function prototypes  */
+
+static void      gimp_gegl_distance_init          (Distance            *distance,
+                                                   GeglBuffer          *src_buffer,
+                                                   GeglBuffer          *dest_buffer,
+                                                   const GeglRectangle *roi,
+                                                   gint                 radius_x,
+                                                   gint                 radius_y,
+                                                   SeedType             seed_type);
+static gboolean  gimp_gegl_distance_run           (Distance            *distance);
+
+static void      gimp_gegl_distance_get_band      (const Distance      *distance,
+                                                   gint                 k,
+                                                   GeglRectangle       *band);
+static void      gimp_gegl_distance_seeds_func    (gint                 i,
+                                                   gint                 n,
+                                                   gpointer             user_data);
+static void      gimp_gegl_distance_edges_func    (gint                 i,
+                                                   gint                 n,
+                                                   gpointer             user_data);
+static void      gimp_gegl_distance_columns_func  (gsize                offset,
+                                                   gsize                size,
+                                                   gpointer             user_data);
+static void      gimp_gegl_distance_rows_func     (gint                 i,
+                                                   gint                 n,
+                                                   gpointer             user_data);
+
+static void      gimp_gegl_distance_transform_seeds_func
+                                                  (gint                 i,
+                                                   gint                 n,
+                                                   gpointer             user_data);
+static void      gimp_gegl_distance_transform_columns_func
+                                                  (gsize                offset,
+                                                   gsize                size,
+                                                   gpointer             user_data);
+static void      gimp_gegl_distance_transform_rows_func
+                                                  (gint                 i,
+                                                   gint                 n,
+                                                   gpointer             user_data);
+static void      gimp_gegl_distance_normalize_func
+                                                  (gint                 i,
+                                                   gint                 n,
+                                                   gpointer             user_data);
+
+static void      gimp_gegl_distance_cover_row     (const Distance      *distance,
+                                                   const guint32       *dist,
+                                                   gfloat              *dest);
+static void      gimp_gegl_distance_border_row    (const Distance      *distance,
+                                                   const guint32       *dist,
+                                                   gfloat              *dest,
+                                                   gint                *envelope,
+                                                   gdouble             *bounds,
+                                                   gint                *nearest_left,
+                                                   gint                *nearest_right);
+
+
+/*  public functions  */
+
+/**
+ * gimp_gegl_distance_grow:
+ * @src_buffer:  a "Y float" mask
+ * @dest_buffer: the buffer to write the grown mask to
+ * @roi:         the area to grow
+ * @radius_x:    the horizontal radius
+ * @radius_y:    the vertical radius
+ *
+ * Grows the mask in @roi the way the gimp:grow operation does, in
+ * time independent of the radius.
+ *
+ * Return value: %FALSE if the mask isn't binary, in which case
+ *               nothing was written.
+ **/
+gboolean
+gimp_gegl_distance_grow (GeglBuffer          *src_buffer,
+                         GeglBuffer          *dest_buffer,
+                         const GeglRectangle *roi,
+                         gint                 radius_x,
+                         gint                 radius_y)
+{
+  Distance distance;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (src_buffer), FALSE);
+  g_return_val_if_fail (GEGL_IS_BUFFER (dest_buffer), FALSE);
+  g_return_val_if_fail (roi != NULL, FALSE);
+
+  gimp_gegl_distance_init (&distance, src_buffer, dest_buffer, roi,
+                           radius_x, radius_y, SEED_SELECTED);
+
+  return gimp_gegl_distance_run (&distance);
+}
+
+/**
+ * gimp_gegl_distance_shrink:
+ * @src_buffer:  a "Y float" mask
+ * @dest_buffer: the buffer to write the shrunk mask to
+ * @roi:         the area to shrink
+ * @radius_x:    the horizontal radius
+ * @radius_y:    the vertical radius
+ * @edge_lock:   whether the area outside @roi counts as selected
+ *
+ * Shrinks the mask in @roi the way the gimp:shrink operation does, in
+ * time independent of the radius.
+ *
+ * Return value: %FALSE if the mask isn't binary, in which case
+ *               nothing was written.
+ **/
+gboolean
+gimp_gegl_distance_shrink (GeglBuffer          *src_buffer,
+                           GeglBuffer          *dest_buffer,
+                           const GeglRectangle *roi,
+                           gint                 radius_x,
+                           gint                 radius_y,
+                           gboolean             edge_lock)
+{
+  Distance distance;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (src_buffer), FALSE);
+  g_return_val_if_fail (GEGL_IS_BUFFER (dest_buffer), FALSE);
+  g_return_val_if_fail (roi != NULL, FALSE);
+
+  gimp_gegl_distance_init (&distance, src_buffer, dest_buffer, roi,
+                           radius_x, radius_y, SEED_UNSELECTED);
+
+  distance.edge_lock = edge_lock;
+
+  return gimp_gegl_distance_run (&distance);
+}
+
+/**
+ * gimp_gegl_distance_border:
+ * @src_buffer:  a "Y float" mask
+ * @dest_buffer: the buffer to write the border to
+ * @roi:         the area to border
+ * @radius_x:    the horizontal radius
+ * @radius_y:    the vertical radius
+ * @feather:     whether to feather the border
+ * @edge_lock:   whether the area outside @roi counts as selected
+ *
+ * Computes the border of the mask in @roi the way the gimp:border
+ * operation does for radii larger than one, in time independent of
+ * the radius. The mask is thresholded at 0.5.
+ **/
+void
+gimp_gegl_distance_border (GeglBuffer          *src_buffer,
+                           GeglBuffer          *dest_buffer,
+                           const GeglRectangle *roi,
+                           gint                 radius_x,
+                           gint                 radius_y,
+                           gboolean             feather,
+                           gboolean             edge_lock)
+{
+  Distance distance;
+
+  g_return_if_fail (GEGL_IS_BUFFER (src_buffer));
+  g_return_if_fail (GEGL_IS_BUFFER (dest_buffer));
+  g_return_if_fail (roi != NULL);
+
+  gimp_gegl_distance_init (&distance, src_buffer, dest_buffer, roi,
+                           radius_x, radius_y, SEED_EDGE);
+
+  distance.feather   = feather;
+  distance.edge_lock = edge_lock;
+
+  gimp_gegl_distance_run (&distance);
+}
+
+/**
+ * gimp_gegl_distance_transform:
+ * @src_buffer:  a "Y float" mask
+ * @dest_buffer: the buffer to write the distances to
+ * @roi:         the area to transform
+ * @normalize:   whether to scale the distances to [0, 1]
+ *
+ * Computes the exact euclidean distance of every selected pixel in
+ * @roi to the nearest unselected pixel, counting the area outside
+ * @roi as unselected, for the gimp:shapeburst operation. A column
+ * pass finds the vertical distances and a row pass takes the lower
+ * envelope of their parabolas, both in parallel. Partially selected
+ * pixels are moved towards the unselected side by the part of them
+ * which isn't selected, and unselected pixels are zero.
+ *
+ * Return value: the largest distance.
+ **/
+gfloat
+gimp_gegl_distance_transform (GeglBuffer          *src_buffer,
+                              GeglBuffer          *dest_buffer,
+                              const GeglRectangle *roi,
+                              gboolean             normalize)
+{
+  Distance distance;
+  gfloat   max = 0.0;
+  gint     k;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (src_buffer), 0.0);
+  g_return_val_if_fail (GEGL_IS_BUFFER (dest_buffer), 0.0);
+  g_return_val_if_fail (roi != NULL, 0.0);
+
+  if (roi->width <= 0 || roi->height <= 0)
+    return 0.0;
+
+  gimp_gegl_distance_init (&distance, src_buffer, dest_buffer, roi,
+                           1, 1, SEED_UNSELECTED);
+
+  distance.column_dist = g_new (guint32,
+                                (gsize) roi->width * roi->height);
+  distance.band_max    = g_new0 (gfloat, distance.n_bands);
+
+  gimp_parallel_distribute (distance.n_bands,
+                            gimp_gegl_distance_transform_seeds_func,
+                            &distance);
+  gimp_parallel_distribute_range (roi->width, COLUMN_STRIP,
+                                  gimp_gegl_distance_transform_columns_func,
+                                  &distance);
+  gimp_parallel_distribute (distance.n_bands,
+                            gimp_gegl_distance_transform_rows_func,
+                            &distance);
+
+  g_free (distance.column_dist);
+
+  for (k = 0; k < distance.n_bands; k++)
+    max = MAX (max, distance.band_max[k]);
+
+  g_free (distance.band_max);
+
+  if (normalize && max > 0.0)
+    {
+      distance.scale = 1.0 / max;
+
+      gimp_parallel_distribute (distance.n_bands,
+                                gimp_gegl_distance_normalize_func,
+                                &distance);
+    }
+
+  return max;
+}
+
+
+/*  private functions  */
+
+static void
+gimp_gegl_distance_init (Distance            *distance,
+                         GeglBuffer          *src_buffer,
+                         GeglBuffer          *dest_buffer,
+                         const GeglRectangle *roi,
+                         gint                 radius_x,
+                         gint                 radius_y,
+                         SeedType             seed_type)
+{
+  memset (distance, 0, sizeof (Distance));
+
+  distance->src_buffer  = src_buffer;
+  distance->dest_buffer = dest_buffer;
+  distance->roi         = *roi;
+  distance->radius_x    = MAX (radius_x, 1);
+  distance->radius_y    = MAX (radius_y, 1);
+  distance->seed_type   = seed_type;
+
+  g_object_get (dest_buffer,
+                "tile-height", &distance->tile_height,
+                NULL);
+
+  distance->first_tile_row = roi->y / distance->tile_height;
+  distance->n_bands        = (roi->y + roi->height +
+                              distance->tile_height - 1) /
+                             distance->tile_height -
+                             distance->first_tile_row;
+}
+
+static gboolean
+gimp_gegl_distance_run (Distance *distance)
+{
+  gint rx = distance->radius_x;
+  gint ry = distance->radius_y;
+
+  if (distance->roi.width <= 0 || distance->roi.height <= 0)
+    return TRUE;
+
+  distance->dist = g_new (guint32,
+                          (gsize) distance->roi.width * distance->roi.height);
+
+  if (distance->seed_type == SEED_EDGE)
+    gimp_parallel_distribute (distance->n_bands,
+                              gimp_gegl_distance_edges_func, distance);
+  else
+    gimp_parallel_distribute (distance->n_bands,
+                              gimp_gegl_distance_seeds_func, distance);
+
+  if (distance->non_binary)
+    {
+      g_free (distance->dist);
+
+      return FALSE;
+    }
+
+  gimp_parallel_distribute_range (distance->roi.width, COLUMN_STRIP,
+                                  gimp_gegl_distance_columns_func, distance);
+
+  if (distance->seed_type != SEED_EDGE)
+    {
+      gint i;
+      gint d;
+
+      /*  the height of the structuring element at each column offset,
+       *  computed like compute_border() in the grow and shrink
+       *  operations, but in doubles so that large radii don't
+       *  overflow, turned into the largest column offset that still
+       *  reaches each distance
+       */
+      distance->reach = g_new (gint, ry + 1);
+
+      i = rx;
+
+      for (d = 0; d <= ry; d++)
+        {
+          while (i > 0)
+            {
+              gdouble tmp    = i - 0.5;
+              gint    height = RINT (ry / (gdouble) rx *
+                                     sqrt (SQR ((gdouble) rx) - SQR (tmp)));
+
+              if (height >= d)
+                break;
+
+              i--;
+            }
+
+          distance->reach[d] = i;
+        }
+    }
+
+  gimp_parallel_distribute (distance->n_bands,
+                            gimp_gegl_distance_rows_func, distance);
+
+  g_free (distance->reach);
+  g_free (distance->dist);
+
+  return TRUE;
+}
+
+static void
+gimp_gegl_distance_get_band (const Distance *distance,
+                             gint            k,
+                             GeglRectangle  *band)
+{
+  gint y1 = (distance->first_tile_row + k)     * distance->tile_height;
+  gint y2 = (distance->first_tile_row + k + 1) * distance->tile_height;
+
+  band->x      = distance->roi.x;
+  band->y      = MAX (y1, distance->roi.y);
+  band->width  = distance->roi.width;
+  band->height = MIN (y2, distance->roi.y + distance->roi.height) - band->y;
+}
+
+/*  marks the seed pixels of grow and shrink, and checks that the mask
+ *  is binary
+ */
+static void
+gimp_gegl_distance_seeds_func (gint     i,
+                               gint     n,
+                               gpointer user_data)
+{
+  Distance *distance = user_data;
+  guint32   far      = distance->radius_y + 1;
+  gfloat   *src;
+  gint      k;
+
+  src = g_new (gfloat, (gsize) distance->roi.width * distance->tile_height);
+
+  for (k = i;
+       k < distance->n_bands && ! g_atomic_int_get (&distance->non_binary);
+       k += n)
+    {
+      GeglRectangle  band;
+      guint32       *dist;
+      gsize          count;
+      gsize          j;
+
+      gimp_gegl_distance_get_band (distance, k, &band);
+
+      gegl_buffer_get (distance->src_buffer, &band, 1.0,
+                       babl_format ("Y float"), src,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      dist  = distance->dist +
+              (gsize) (band.y - distance->roi.y) * distance->roi.width;
+      count = (gsize) band.width * band.height;
+
+      for (j = 0; j < count; j++)
+        {
+          if (src[j] != 0.0 && src[j] != 1.0)
+            {
+              g_atomic_int_set (&distance->non_binary, TRUE);
+              break;
+            }
+
+          if (distance->seed_type == SEED_SELECTED)
+            dist[j] = src[j] != 0.0 ? 0 : far;
+          else
+            dist[j] = src[j] == 0.0 ? 0 : far;
+        }
+    }
+
+  g_free (src);
+}
+
+/*  marks the pixels of border's seeds: selected pixels with an
+ *  unselected pixel among their eight neighbors. with edge_lock,
+ *  pixels outside the roi count as selected.
+ */
+static void
+gimp_gegl_distance_edges_func (gint     i,
+                               gint     n,
+                               gpointer user_data)
+{
+  Distance *distance = user_data;
+  gint      width    = distance->roi.width;
+  guint32   far      = distance->radius_y + 1;
+  gfloat    outside  = distance->edge_lock ? 1.0 : 0.0;
+  gfloat   *src;
+  gint      k;
+
+  /*  the band plus one row above and below it, and one column left
+   *  and right of it
+   */
+  src = g_new (gfloat, (gsize) (width + 2) * (distance->tile_height + 2));
+
+  for (k = i; k < distance->n_bands; k += n)
+    {
+      GeglRectangle  band;
+      GeglRectangle  rect;
+      gint           stride = width + 2;
+      gint           y1;
+      gint           y2;
+      gint           x, y;
+
+      gimp_gegl_distance_get_band (distance, k, &band);
+
+      y1 = MAX (band.y - 1, distance->roi.y);
+      y2 = MIN (band.y + band.height + 1,
+                distance->roi.y + distance->roi.height);
+
+      for (x = 0; x < stride; x++)
+        {
+          src[x]                              = outside;
+          src[(band.height + 1) * stride + x] = outside;
+        }
+
+      rect.x      = band.x;
+      rect.y      = y1;
+      rect.width  = width;
+      rect.height = y2 - y1;
+
+      gegl_buffer_get (distance->src_buffer, &rect, 1.0,
+                       babl_format ("Y float"),
+                       src + (y1 - band.y + 1) * stride + 1,
+                       stride * sizeof (gfloat), GEGL_ABYSS_NONE);
+
+      for (y = 0; y < band.height + 2; y++)
+        {
+          src[y * stride]             = outside;
+          src[y * stride + width + 1] = outside;
+        }
+
+      for (y = 0; y < band.height; y++)
+        {
+          const gfloat *above = src + y * stride + 1;
+          const gfloat *row   = above + stride;
+          const gfloat *below = row   + stride;
+          guint32      *dist;
+
+          dist = distance->dist +
+                 (gsize) (band.y + y - distance->roi.y) * width;
+
+          for (x = 0; x < width; x++)
+            {
+              if (row[x] >= 0.5 &&
+                  (above[x - 1] < 0.5 || above[x] < 0.5 || above[x + 1] < 0.5 ||
+                   row[x - 1]   < 0.5 ||                   row[x + 1]   < 0.5 ||
+                   below[x - 1] < 0.5 || below[x] < 0.5 || below[x + 1] < 0.5))
+                {
+                  dist[x] = 0;
+                }
+              else
+                {
+                  dist[x] = far;
+                }
+            }
+        }
+    }
+
+  g_free (src);
+}
+
+/*  turns the seeds of a range of columns into the distance to the
+ *  nearest seed above or below
+ */
+static void
+gimp_gegl_distance_columns_func (gsize    offset,
+                                 gsize    size,
+                                 gpointer user_data)
+{
+  Distance *distance = user_data;
+  gint      width    = distance->roi.width;
+  gint      height   = distance->roi.height;
+  guint32   far      = distance->radius_y + 1;
+  guint32   start    = far;
+  guint32  *nearest;
+  gsize     x0;
+
+  /*  without edge_lock, shrink has unselected pixels right above and
+   *  below the roi
+   */
+  if (distance->seed_type == SEED_UNSELECTED && ! distance->edge_lock)
+    start = 0;
+
+  nearest = g_new (guint32, MIN (size, COLUMN_STRIP));
+
+  for (x0 = offset; x0 < offset + size; x0 += COLUMN_STRIP)
+    {
+      gsize n_columns = MIN (COLUMN_STRIP, offset + size - x0);
+      gsize x;
+      gint  y;
+
+      for (x = 0; x < n_columns; x++)
+        nearest[x] = start;
+
+      for (y = 0; y < height; y++)
+        {
+          guint32 *dist = distance->dist + (gsize) y * width + x0;
+
+          for (x = 0; x < n_columns; x++)
+            {
+              if (dist[x] == 0)
+                nearest[x] = 0;
+              else if (nearest[x] < far)
+                nearest[x]++;
+
+              dist[x] = nearest[x];
+            }
+        }
+
+      for (x = 0; x < n_columns; x++)
+        nearest[x] = start;
+
+      for (y = height - 1; y >= 0; y--)
+        {
+          guint32 *dist = distance->dist + (gsize) y * width + x0;
+
+          for (x = 0; x < n_columns; x++)
+            {
+              if (dist[x] == 0)
+                nearest[x] = 0;
+              else if (nearest[x] < far)
+                nearest[x]++;
+
+              dist[x] = MIN (dist[x], nearest[x]);
+            }
+        }
+    }
+
+  g_free (nearest);
+}
+
+static void
+gimp_gegl_distance_rows_func (gint     i,
+                              gint     n,
+                              gpointer user_data)
+{
+  Distance *distance = user_data;
+  gint      width    = distance->roi.width;
+  gfloat   *dest;
+  gint     *envelope      = NULL;
+  gdouble  *bounds        = NULL;
+  gint     *nearest_left  = NULL;
+  gint     *nearest_right = NULL;
+  gint      k;
+
+  dest = g_new (gfloat, (gsize) width * distance->tile_height);
+
+  if (distance->seed_type == SEED_EDGE)
+    {
+      envelope      = g_new (gint,    width);
+      bounds        = g_new (gdouble, width + 1);
+      nearest_left  = g_new (gint,    width);
+      nearest_right = g_new (gint,    width);
+    }
+
+  for (k = i; k < distance->n_bands; k += n)
+    {
+      GeglRectangle band;
+      gint          y;
+
+      gimp_gegl_distance_get_band (distance, k, &band);
+
+      for (y = 0; y < band.height; y++)
+        {
+          const guint32 *dist;
+
+          dist = distance->dist +
+                 (gsize) (band.y + y - distance->roi.y) * width;
+
+          if (distance->seed_type == SEED_EDGE)
+            gimp_gegl_distance_border_row (distance, dist,
+                                           dest + (gsize) y * width,
+                                           envelope, bounds,
+                                           nearest_left, nearest_right);
+          else
+            gimp_gegl_distance_cover_row (distance, dist,
+                                          dest + (gsize) y * width);
+        }
+
+      /*  bands are aligned to tile rows, so that no two threads
+       *  write to the same tile
+       */
+      gegl_buffer_set (distance->dest_buffer, &band, 0,
+                       babl_format ("Y float"), dest,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  g_free (dest);
+  g_free (envelope);
+  g_free (bounds);
+  g_free (nearest_left);
+  g_free (nearest_right);
+}
+
+#define TRANSFORM_EPSILON 0.0001
+
+static void
+gimp_gegl_distance_transform_seeds_func (gint     i,
+                                         gint     n,
+                                         gpointer user_data)
+{
+  Distance *distance = user_data;
+  gfloat   *src;
+  gint      k;
+
+  src = g_new (gfloat, (gsize) distance->roi.width * distance->tile_height);
+
+  for (k = i; k < distance->n_bands; k += n)
+    {
+      GeglRectangle  band;
+      guint32       *dist;
+      gsize          count;
+      gsize          j;
+
+      gimp_gegl_distance_get_band (distance, k, &band);
+
+      gegl_buffer_get (distance->src_buffer, &band, 1.0,
+                       babl_format ("Y float"), src,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      dist  = distance->column_dist +
+              (gsize) (band.y - distance->roi.y) * distance->roi.width;
+      count = (gsize) band.width * band.height;
+
+      for (j = 0; j < count; j++)
+        dist[j] = src[j] < TRANSFORM_EPSILON ? 0 : G_MAXUINT32;
+    }
+
+  g_free (src);
+}
+
+/*  the rows right above and below the roi are unselected  */
+static void
+gimp_gegl_distance_transform_columns_func (gsize    offset,
+                                           gsize    size,
+                                           gpointer user_data)
+{
+  Distance *distance = user_data;
+  gint      width    = distance->roi.width;
+  gint      height   = distance->roi.height;
+  guint32  *nearest;
+  gsize     x0;
+
+  nearest = g_new (guint32, MIN (size, COLUMN_STRIP));
+
+  for (x0 = offset; x0 < offset + size; x0 += COLUMN_STRIP)
+    {
+      gsize n_columns = MIN (COLUMN_STRIP, offset + size - x0);
+      gsize x;
+      gint  y;
+
+      for (x = 0; x < n_columns; x++)
+        nearest[x] = 0;
+
+      for (y = 0; y < height; y++)
+        {
+          guint32 *dist = distance->column_dist + (gsize) y * width + x0;
+
+          for (x = 0; x < n_columns; x++)
+            {
+              if (dist[x] == 0)
+                nearest[x] = 0;
+              else
+                nearest[x]++;
+
+              dist[x] = nearest[x];
+            }
+        }
+
+      for (x = 0; x < n_columns; x++)
+        nearest[x] = 0;
+
+      for (y = height - 1; y >= 0; y--)
+        {
+          guint32 *dist = distance->column_dist + (gsize) y * width + x0;
+
+          for (x = 0; x < n_columns; x++)
+            {
+              if (dist[x] == 0)
+                nearest[x] = 0;
+              else
+                nearest[x]++;
+
+              dist[x] = MIN (dist[x], nearest[x]);
+            }
+        }
+    }
+
+  g_free (nearest);
+}
+
+/*  the squared distance of a pixel is the lower envelope of the
+ *  parabolas (x - c)^2 + g(c)^2 of the columns c, where g(c) is the
+ *  column's vertical distance. the columns right left and right of
+ *  the roi are unselected, so their parabolas are included with
+ *  g = 0.
+ */
+static void
+gimp_gegl_distance_transform_rows_func (gint     i,
+                                        gint     n,
+                                        gpointer user_data)
+{
+  Distance *distance = user_data;
+  gint      width    = distance->roi.width;
+  gfloat   *dest;
+  gdouble  *f;
+  gint     *envelope;
+  gdouble  *bounds;
+  gint      k;
+
+  dest     = g_new (gfloat,  (gsize) width * distance->tile_height);
+  f        = g_new (gdouble, width + 2);
+  envelope = g_new (gint,    width + 2);
+  bounds   = g_new (gdouble, width + 3);
+
+  /*  f and envelope are indexed from column -1  */
+  f[0]         = 0.0;
+  f[width + 1] = 0.0;
+
+  for (k = i; k < distance->n_bands; k += n)
+    {
+      GeglRectangle band;
+      gfloat        max = 0.0;
+      gint          y;
+
+      gimp_gegl_distance_get_band (distance, k, &band);
+
+      gegl_buffer_get (distance->src_buffer, &band, 1.0,
+                       babl_format ("Y float"), dest,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      for (y = 0; y < band.height; y++)
+        {
+          const guint32 *dist;
+          gfloat        *row = dest + (gsize) y * width;
+          gint           m   = 0;
+          gint           c;
+          gint           x;
+
+          dist = distance->column_dist +
+                 (gsize) (band.y + y - distance->roi.y) * width;
+
+          for (c = 0; c < width; c++)
+            f[c + 1] = (gdouble) dist[c] * dist[c];
+
+          envelope[0] = -1;
+          bounds[0]   = -G_MAXDOUBLE;
+          bounds[1]   =  G_MAXDOUBLE;
+
+          for (c = 0; c <= width; c++)
+            {
+              gdouble fc = f[c + 1] + (gdouble) c * c;
+              gdouble z;
+
+              while (TRUE)
+                {
+                  gint p = envelope[m];
+
+                  z = (fc - (f[p + 1] + (gdouble) p * p)) / (2.0 * (c - p));
+
+                  if (z > bounds[m])
+                    break;
+
+                  m--;
+                }
+
+              m++;
+              envelope[m]   = c;
+              bounds[m]     = z;
+              bounds[m + 1] = G_MAXDOUBLE;
+            }
+
+          for (x = 0, m = 0; x < width; x++)
+            {
+              gint   p;
+              gfloat value;
+
+              while (bounds[m + 1] < x)
+                m++;
+
+              p = envelope[m];
+
+              if (row[x] < TRANSFORM_EPSILON)
+                {
+                  value = 0.0;
+                }
+              else
+                {
+                  value = sqrt ((x - p) * (gdouble) (x - p) + f[p + 1]) -
+                          (1.0 - MIN (row[x], 1.0));
+                }
+
+              row[x] = value;
+              max    = MAX (max, value);
+            }
+        }
+
+      distance->band_max[k] = max;
+
+      gegl_buffer_set (distance->dest_buffer, &band, 0,
+                       babl_format ("Y float"), dest,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  g_free (dest);
+  g_free (f);
+  g_free (envelope);
+  g_free (bounds);
+}
+
+static void
+gimp_gegl_distance_normalize_func (gint     i,
+                                   gint     n,
+                                   gpointer user_data)
+{
+  Distance *distance = user_data;
+  gint      k;
+
+  for (k = i; k < distance->n_bands; k += n)
+    {
+      GeglBufferIterator *iter;
+      GeglRectangle       band;
+
+      gimp_gegl_distance_get_band (distance, k, &band);
+
+      iter = gegl_buffer_iterator_new (distance->dest_buffer, &band, 0,
+                                       babl_format ("Y float"),
+                                       GEGL_ACCESS_READWRITE,
+                                       GEGL_ABYSS_NONE);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          gint    count = iter->length;
+          gfloat *data  = iter->data[0];
+
+          while (count--)
+            *data++ *= distance->scale;
+        }
+    }
+}
+
+/*  a pixel is reached by the structuring element centered on it if
+ *  any column within the reach of its distance is close enough to
+ *  it. one pass from each side keeps track of how far the columns
+ *  seen so far reach.
+ */
+static void
+gimp_gegl_distance_cover_row (const Distance *distance,
+                              const guint32  *dist,
+                              gfloat         *dest)
+{
+  const gint *reach   = distance->reach;
+  gint        width   = distance->roi.width;
+  gint        ry      = distance->radius_y;
+  gfloat      covered = distance->seed_type == SEED_SELECTED ? 1.0 : 0.0;
+  gint        right   = -1;
+  gint        left    = width;
+  gint        x;
+
+  /*  without edge_lock, shrink has unselected columns on both sides
+   *  of the roi
+   */
+  if (distance->seed_type == SEED_UNSELECTED && ! distance->edge_lock)
+    {
+      right = -1    + reach[0];
+      left  = width - reach[0];
+    }
+
+  for (x = 0; x < width; x++)
+    {
+      if (dist[x] <= ry)
+        right = MAX (right, x + reach[dist[x]]);
+
+      dest[x] = right >= x ? covered : 1.0 - covered;
+    }
+
+  for (x = width - 1; x >= 0; x--)
+    {
+      if (dist[x] <= ry)
+        left = MIN (left, x - reach[dist[x]]);
+
+      if (left <= x)
+        dest[x] = covered;
+    }
+}
+
+/*  the distance of column c's seed from a pixel in column x, in units
+ *  of the radius, as used by the density table of the border operation
+ */
+static inline gdouble
+gimp_gegl_distance_border_dist (const Distance *distance,
+                                gint            i,
+                                gint            d)
+{
+  gdouble tmpx = i ? ABS (i) - 0.5 : 0.0;
+  gdouble tmpy = d ? d       - 0.5 : 0.0;
+
+  return ((tmpy * tmpy) / SQR ((gdouble) distance->radius_y) +
+          (tmpx * tmpx) / SQR ((gdouble) distance->radius_x));
+}
+
+/*  finds, for every x, the column c minimizing
+ *  (x - c - offset)^2 + rx^2 * tmpy(c)^2 / ry^2, i.e. the lower
+ *  envelope of one parabola per column with a seed in reach.
+ */
+static void
+gimp_gegl_distance_envelope (const Distance *distance,
+                             const guint32  *dist,
+                             gdouble         offset,
+                             gint           *envelope,
+                             gdouble        *bounds,
+                             gint           *nearest)
+{
+  gint    width = distance->roi.width;
+  gint    ry    = distance->radius_y;
+  gdouble scale = SQR ((gdouble) distance->radius_x) / SQR ((gdouble) ry);
+  gint    n     = -1;
+  gint    c;
+  gint    x;
+
+#define HEIGHT(c) (dist[c] ? scale * SQR (dist[c] - 0.5) : 0.0)
+
+  for (c = 0; c < width; c++)
+    {
+      gdouble s;
+      gdouble fc;
+
+      if (dist[c] > ry)
+        continue;
+
+      s  = c + offset;
+      fc = HEIGHT (c) + s * s;
+
+      while (n >= 0)
+        {
+          gint    p  = envelope[n];
+          gdouble sp = p + offset;
+          gdouble z  = (fc - (HEIGHT (p) + sp * sp)) / (2.0 * (s - sp));
+
+          if (z > bounds[n])
+            {
+              n++;
+              envelope[n] = c;
+              bounds[n]   = z;
+              break;
+            }
+
+          n--;
+        }
+
+      if (n < 0)
+        {
+          n = 0;
+          envelope[0] = c;
+          bounds[0]   = -G_MAXDOUBLE;
+        }
+    }
+
+#undef HEIGHT
+
+  if (n < 0)
+    {
+      for (x = 0; x < width; x++)
+        nearest[x] = -1;
+
+      return;
+    }
+
+  bounds[n + 1] = G_MAXDOUBLE;
+
+  for (x = 0, c = 0; x < width; x++)
+    {
+      while (bounds[c + 1] < x)
+        c++;
+
+      nearest[x] = envelope[c];
+    }
+}
+
+/*  the border's value is falling off with the elliptic distance to
+ *  the nearest seed. the term (|x - c| - 0.5)^2 of a column c left of
+ *  x is a parabola centered at c + 0.5, and one right of x a parabola
+ *  centered at c - 0.5. both are never less than the actual term on
+ *  the other side, so the minimum of the two lower envelopes and of
+ *  the column itself is the exact minimum.
+ */
+static void
+gimp_gegl_distance_border_row (const Distance *distance,
+                               const guint32  *dist,
+                               gfloat         *dest,
+                               gint           *envelope,
+                               gdouble        *bounds,
+                               gint           *nearest_left,
+                               gint           *nearest_right)
+{
+  gint width = distance->roi.width;
+  gint ry    = distance->radius_y;
+  gint x;
+
+  gimp_gegl_distance_envelope (distance, dist, 0.5,
+                               envelope, bounds, nearest_left);
+
+  if (nearest_left[0] < 0)
+    {
+      memset (dest, 0, sizeof (gfloat) * width);
+      return;
+    }
+
+  gimp_gegl_distance_envelope (distance, dist, -0.5,
+                               envelope, bounds, nearest_right);
+
+  for (x = 0; x < width; x++)
+    {
+      gint    l   = nearest_left[x];
+      gint    r   = nearest_right[x];
+      gdouble min = gimp_gegl_distance_border_dist (distance, x - l, dist[l]);
+
+      min = MIN (min,
+                 gimp_gegl_distance_border_dist (distance, x - r, dist[r]));
+
+      if (dist[x] <= ry)
+        min = MIN (min, gimp_gegl_distance_border_dist (distance, 0, dist[x]));
+
+      if (min < 1.0)
+        {
+          gfloat a;
+
+          if (distance->feather)
+            a = 1.0 - sqrt (min);
+          else
+            a = 1.0;
+
+          dest[x] = a;
+        }
+      else
+        {
+          dest[x] = 0.0;
+        }
+    }
+}
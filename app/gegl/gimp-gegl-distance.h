@@ -0,0 +1,50 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-gegl-distance.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_GEGL_DISTANCE_H__
+#define __GIMP_GEGL_DISTANCE_H__
+
+
+gboolean   gimp_gegl_distance_grow   (GeglBuffer          *src_buffer,
+                                      GeglBuffer          *dest_buffer,
+                                      const GeglRectangle *roi,
+                                      gint                 radius_x,
+                                      gint                 radius_y);
+gboolean   gimp_gegl_distance_shrink (GeglBuffer          *src_buffer,
+                                      GeglBuffer          *dest_buffer,
+                                      const GeglRectangle *roi,
+                                      gint                 radius_x,
+                                      gint                 radius_y,
+                                      gboolean             edge_lock);
+void       gimp_gegl_distance_border (GeglBuffer          *src_buffer,
+                                      GeglBuffer          *dest_buffer,
+                                      const GeglRectangle *roi,
+                                      gint                 radius_x,
+                                      gint                 radius_y,
+                                      gboolean             feather,
+                                      gboolean             edge_lock);
+
+gfloat     gimp_gegl_distance_transform
+                                     (GeglBuffer          *src_buffer,
+                                      GeglBuffer          *dest_buffer,
+                                      const GeglRectangle *roi,
+                                      gboolean             normalize);
+
+
+#endif /* __GIMP_GEGL_DISTANCE_H__ */
@@ -32,178 +32,451 @@
 #include "gimp-babl.h"
 #include "gimp-gegl-loops.h"
 
+#include "core/gimp-parallel.h"
 #include "core/gimpprogress.h"
 
 
-void
-gimp_gegl_convolve (GeglBuffer          *src_buffer,
-                    const GeglRectangle *src_rect,
-                    GeglBuffer          *dest_buffer,
-                    const GeglRectangle *dest_rect,
-                    const gfloat        *kernel,
-                    gint                 kernel_size,
-                    gdouble              divisor,
-                    GimpConvolutionType  mode,
-                    gboolean             alpha_weighting)
+/*  don't bother splitting areas smaller than this across threads  */
+#define MIN_PARALLEL_SUB_AREA (64 * 64)
+
+#define DODGEBURN_LUT_SIZE    1024
+#define DODGEBURN_LUT_MIN     (1.0f / 64.0f)
+
+
+/*  maps @area, a part of @rect, to the same part of @other_rect  */
+static inline void
+gimp_gegl_loops_get_sub_rect (const GeglRectangle *area,
+                              const GeglRectangle *rect,
+                              GeglBuffer          *other_buffer,
+                              const GeglRectangle *other_rect,
+                              GeglRectangle       *other_area)
 {
-  GeglBufferIterator *dest_iter;
-  gfloat             *src;
-  gint                src_rowstride;
+  if (! other_rect)
+    other_rect = gegl_buffer_get_extent (other_buffer);
 
-  const Babl         *src_format;
-  const Babl         *dest_format;
-  gint                src_components;
-  gint                dest_components;
+  other_area->x      = other_rect->x + (area->x - rect->x);
+  other_area->y      = other_rect->y + (area->y - rect->y);
+  other_area->width  = area->width;
+  other_area->height = area->height;
+}
 
-  src_format = gegl_buffer_get_format (src_buffer);
 
-    src_format = gimp_babl_format (gimp_babl_format_get_base_type (src_format),
-                                   GIMP_PRECISION_FLOAT_GAMMA,
-                                   babl_format_has_alpha (src_format));
+typedef struct
+{
+  const gfloat        *src;
+  gint                 src_rowstride;
+  gint                 src_width;
+  gint                 src_height;
+  gint                 components;
+  GeglBuffer          *dest_buffer;
+  const Babl          *dest_format;
+  gint                 dest_components;
+  const gfloat        *kernel;
+  gint                 kernel_size;
+  gfloat               divisor;
+  gfloat               offset;
+  GimpConvolutionType  mode;
+  gboolean             alpha_weighting;
+} GimpGeglConvolveData;
+
+static void
+gimp_gegl_convolve_pixel (const GimpGeglConvolveData *data,
+                          gint                        x,
+                          gint                        y,
+                          gfloat                     *d)
+{
+  const gfloat *src        = data->src;
+  const gint    components = data->components;
+  const gint    a_component = components - 1;
+  const gint    margin     = data->kernel_size / 2;
+  const gint    x2         = data->src_width  - 1;
+  const gint    y2         = data->src_height - 1;
+  const gfloat *m          = data->kernel;
+  gdouble       total[4]   = { 0.0, 0.0, 0.0, 0.0 };
+  gint          i, j, b;
+
+  if (data->alpha_weighting)
+    {
+      gdouble weighted_divisor = 0.0;
 
-  dest_format = gegl_buffer_get_format (dest_buffer);
+      for (j = y - margin; j <= y + margin; j++)
+        {
+          for (i = x - margin; i <= x + margin; i++, m++)
+            {
+              gint          xx = CLAMP (i, 0, x2);
+              gint          yy = CLAMP (j, 0, y2);
+              const gfloat *s  = src + yy * data->src_rowstride + xx * components;
+              const gfloat  a  = s[a_component];
 
-    dest_format = gimp_babl_format (gimp_babl_format_get_base_type (dest_format),
-                                    GIMP_PRECISION_FLOAT_GAMMA,
-                                    babl_format_has_alpha (dest_format));
+              if (a)
+                {
+                  gdouble mult_alpha = *m * a;
 
-  src_components  = babl_format_get_n_components (src_format);
-  dest_components = babl_format_get_n_components (dest_format);
+                  weighted_divisor += mult_alpha;
 
-  /* Set up dest iterator */
-  dest_iter = gegl_buffer_iterator_new (dest_buffer, dest_rect, 0, dest_format,
-                                        GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+                  for (b = 0; b < a_component; b++)
+                    total[b] += mult_alpha * s[b];
 
-  /* Get source pixel data */
-  src_rowstride = src_components * src_rect->width;
-  src = g_malloc (sizeof(gfloat) * src_rowstride * src_rect->height);
-  gegl_buffer_get (src_buffer, src_rect, 1.0, src_format, src,
-                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+                  total[a_component] += mult_alpha;
+                }
+            }
+        }
 
-  while (gegl_buffer_iterator_next (dest_iter))
+      if (weighted_divisor == 0.0)
+        weighted_divisor = data->divisor;
+
+      for (b = 0; b < a_component; b++)
+        total[b] /= weighted_divisor;
+
+      total[a_component] /= data->divisor;
+    }
+  else
     {
-      /*  Convolve the src image using the convolution kernel, writing
-       *  to dest Convolve is not tile-enabled--use accordingly
-       */
-      gfloat       *dest        = dest_iter->data[0];
-      const gint    components  = src_components;
-      const gint    a_component = components - 1;
-      const gint    margin      = kernel_size / 2;
-      const gint    x1          = 0;
-      const gint    y1          = 0;
-      const gint    x2          = src_rect->width  - 1;
-      const gint    y2          = src_rect->height - 1;
-      const gint    dest_x1     = dest_iter->roi[0].x;
-      const gint    dest_y1     = dest_iter->roi[0].y;
-      const gint    dest_x2     = dest_iter->roi[0].x + dest_iter->roi[0].width;
-      const gint    dest_y2     = dest_iter->roi[0].y + dest_iter->roi[0].height;
-      gint          x, y;
-      gfloat        offset;
-
-      /*  If the mode is NEGATIVE_CONVOL, the offset should be 128  */
-      if (mode == GIMP_NEGATIVE_CONVOL)
+      for (j = y - margin; j <= y + margin; j++)
         {
-          offset = 0.5;
-          mode = GIMP_NORMAL_CONVOL;
+          for (i = x - margin; i <= x + margin; i++, m++)
+            {
+              gint          xx = CLAMP (i, 0, x2);
+              gint          yy = CLAMP (j, 0, y2);
+              const gfloat *s  = src + yy * data->src_rowstride + xx * components;
+
+              for (b = 0; b < components; b++)
+                total[b] += *m * s[b];
+            }
+        }
+
+      for (b = 0; b < components; b++)
+        total[b] /= data->divisor;
+    }
+
+  for (b = 0; b < components; b++)
+    {
+      total[b] += data->offset;
+
+      if (data->mode != GIMP_NORMAL_CONVOL && total[b] < 0.0)
+        total[b] = - total[b];
+
+      d[b] = CLAMP (total[b], 0.0, 1.0);
+    }
+}
+
+#if defined(__SSE__) && defined(__GNUC__) && __GNUC__ >= 4
+/*  the 3x3 kernel of GimpConvolve on RGBA pixels, away from the
+ *  source edges, one pixel per vector
+ */
+static void
+gimp_gegl_convolve_row_3x3_sse (const GimpGeglConvolveData *data,
+                                gint                        x1,
+                                gint                        x2,
+                                gint                        y,
+                                gfloat                     *d)
+{
+  typedef float v4sf __attribute__((vector_size(16)));
+  const gfloat *m       = data->kernel;
+  const gint    stride  = data->src_rowstride;
+  const v4sf    one     = { 1.0f, 1.0f, 1.0f, 1.0f };
+  const v4sf    offset  = { data->offset, data->offset,
+                            data->offset, data->offset };
+  const v4sf    a_mask  = { 0.0f, 0.0f, 0.0f, 1.0f };
+  union { v4sf v; gfloat f[4]; } u;
+  v4sf          k[9];
+  gint          x, i;
+
+  for (i = 0; i < 9; i++)
+    k[i] = (v4sf) { m[i], m[i], m[i], m[i] };
+
+#define Sv(dx,dy) (*(const v4sf *) (s + (dy) * stride + (dx) * 4))
+
+  for (x = x1; x < x2; x++, d += data->dest_components)
+    {
+      const gfloat *s = data->src + y * stride + x * 4;
+      v4sf          total;
+
+      if (data->alpha_weighting)
+        {
+          /*  weight each tap by its alpha, and keep the plain
+           *  weight in the alpha component
+           */
+          v4sf w[9];
+          v4sf weighted_divisor;
+
+#define Wv(j,dx,dy)                                                        \
+          do {                                                             \
+            const gfloat a = s[(dy) * stride + (dx) * 4 + 3];              \
+            w[j] = k[j] * (v4sf) { a, a, a, a };                           \
+          } while (0)
+
+          Wv (0, -1, -1); Wv (1, 0, -1); Wv (2, 1, -1);
+          Wv (3, -1,  0); Wv (4, 0,  0); Wv (5, 1,  0);
+          Wv (6, -1,  1); Wv (7, 0,  1); Wv (8, 1,  1);
+
+#undef Wv
+
+          weighted_divisor = (w[0] + w[1] + w[2] +
+                              w[3] + w[4] + w[5] +
+                              w[6] + w[7] + w[8]);
+
+          total = (w[0] * (Sv (-1, -1) * (one - a_mask) + a_mask) +
+                   w[1] * (Sv ( 0, -1) * (one - a_mask) + a_mask) +
+                   w[2] * (Sv ( 1, -1) * (one - a_mask) + a_mask) +
+                   w[3] * (Sv (-1,  0) * (one - a_mask) + a_mask) +
+                   w[4] * (Sv ( 0,  0) * (one - a_mask) + a_mask) +
+                   w[5] * (Sv ( 1,  0) * (one - a_mask) + a_mask) +
+                   w[6] * (Sv (-1,  1) * (one - a_mask) + a_mask) +
+                   w[7] * (Sv ( 0,  1) * (one - a_mask) + a_mask) +
+                   w[8] * (Sv ( 1,  1) * (one - a_mask) + a_mask));
+
+          u.v = weighted_divisor;
+
+          if (u.f[0] == 0.0f)
+            u.f[0] = data->divisor;
+
+          u.f[1] = u.f[2] = u.f[0];
+          u.f[3] = data->divisor;
+
+          total = total / u.v;
         }
       else
         {
-          offset = 0.0;
+          const v4sf divisor = { data->divisor, data->divisor,
+                                 data->divisor, data->divisor };
+
+          total = (k[0] * Sv (-1, -1) + k[1] * Sv (0, -1) + k[2] * Sv (1, -1) +
+                   k[3] * Sv (-1,  0) + k[4] * Sv (0,  0) + k[5] * Sv (1,  0) +
+                   k[6] * Sv (-1,  1) + k[7] * Sv (0,  1) + k[8] * Sv (1,  1));
+
+          total = total / divisor;
         }
 
-      for (y = dest_y1; y < dest_y2; y++)
+      u.v = total + offset;
+
+      for (i = 0; i < 4; i++)
         {
-          gfloat *d = dest;
+          gfloat t = u.f[i];
+
+          if (data->mode != GIMP_NORMAL_CONVOL && t < 0.0f)
+            t = - t;
 
-          if (alpha_weighting)
+          d[i] = CLAMP (t, 0.0f, 1.0f);
+        }
+    }
+
+#undef Sv
+}
+#endif
+
+/*  the 3x3 kernel of GimpConvolve, away from the source edges, so
+ *  that no clamping of source coordinates is needed
+ */
+static void
+gimp_gegl_convolve_row_3x3 (const GimpGeglConvolveData *data,
+                            gint                        x1,
+                            gint                        x2,
+                            gint                        y,
+                            gfloat                     *d)
+{
+  const gint    components  = data->components;
+  const gint    a_component = components - 1;
+  const gint    stride      = data->src_rowstride;
+  const gfloat *m           = data->kernel;
+  const gint    offsets[9]  =
+  {
+    -stride - components, -stride, -stride + components,
+            - components,       0,           components,
+     stride - components,  stride,  stride + components
+  };
+  gint          x, i, b;
+
+#if defined(__SSE__) && defined(__GNUC__) && __GNUC__ >= 4
+  if (components == 4)
+    {
+      gimp_gegl_convolve_row_3x3_sse (data, x1, x2, y, d);
+
+      return;
+    }
+#endif
+
+  for (x = x1; x < x2; x++, d += data->dest_components)
+    {
+      const gfloat *s        = data->src + y * stride + x * components;
+      gfloat        total[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+      if (data->alpha_weighting)
+        {
+          gfloat weighted_divisor = 0.0f;
+
+          for (i = 0; i < 9; i++)
             {
-              for (x = dest_x1; x < dest_x2; x++)
-                {
-                  const gfloat *m                = kernel;
-                  gdouble       total[4]         = { 0.0, 0.0, 0.0, 0.0 };
-                  gdouble       weighted_divisor = 0.0;
-                  gint          i, j, b;
+              const gfloat *p          = s + offsets[i];
+              const gfloat  mult_alpha = m[i] * p[a_component];
 
-                  for (j = y - margin; j <= y + margin; j++)
-                    {
-                      for (i = x - margin; i <= x + margin; i++, m++)
-                        {
-                          gint          xx = CLAMP (i, x1, x2);
-                          gint          yy = CLAMP (j, y1, y2);
-                          const gfloat *s  = src + yy * src_rowstride + xx * components;
-                          const gfloat  a  = s[a_component];
+              weighted_divisor += mult_alpha;
 
-                          if (a)
-                            {
-                              gdouble mult_alpha = *m * a;
+              for (b = 0; b < a_component; b++)
+                total[b] += mult_alpha * p[b];
 
-                              weighted_divisor += mult_alpha;
+              total[a_component] += mult_alpha;
+            }
 
-                              for (b = 0; b < a_component; b++)
-                                total[b] += mult_alpha * s[b];
+          if (weighted_divisor == 0.0f)
+            weighted_divisor = data->divisor;
 
-                              total[a_component] += mult_alpha;
-                            }
-                        }
-                    }
+          for (b = 0; b < a_component; b++)
+            total[b] /= weighted_divisor;
 
-                  if (weighted_divisor == 0.0)
-                    weighted_divisor = divisor;
+          total[a_component] /= data->divisor;
+        }
+      else
+        {
+          for (i = 0; i < 9; i++)
+            {
+              const gfloat *p = s + offsets[i];
 
-                  for (b = 0; b < a_component; b++)
-                    total[b] /= weighted_divisor;
+              for (b = 0; b < components; b++)
+                total[b] += m[i] * p[b];
+            }
 
-                  total[a_component] /= divisor;
+          for (b = 0; b < components; b++)
+            total[b] /= data->divisor;
+        }
 
-                  for (b = 0; b < components; b++)
-                    {
-                      total[b] += offset;
+      for (b = 0; b < components; b++)
+        {
+          total[b] += data->offset;
 
-                      if (mode != GIMP_NORMAL_CONVOL && total[b] < 0.0)
-                        total[b] = - total[b];
+          if (data->mode != GIMP_NORMAL_CONVOL && total[b] < 0.0f)
+            total[b] = - total[b];
 
-                      *d++ = CLAMP (total[b], 0.0, 1.0);
-                    }
-                }
+          d[b] = CLAMP (total[b], 0.0f, 1.0f);
+        }
+    }
+}
+
+static void
+gimp_gegl_convolve_area (const GeglRectangle *area,
+                         gpointer             user_data)
+{
+  const GimpGeglConvolveData *data = user_data;
+  GeglBufferIterator         *dest_iter;
+
+  dest_iter = gegl_buffer_iterator_new (data->dest_buffer, area, 0,
+                                        data->dest_format,
+                                        GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (dest_iter))
+    {
+      /*  Convolve the src image using the convolution kernel, writing
+       *  to dest Convolve is not tile-enabled--use accordingly
+       */
+      gfloat     *dest    = dest_iter->data[0];
+      const gint  dest_x1 = dest_iter->roi[0].x;
+      const gint  dest_y1 = dest_iter->roi[0].y;
+      const gint  dest_x2 = dest_iter->roi[0].x + dest_iter->roi[0].width;
+      const gint  dest_y2 = dest_iter->roi[0].y + dest_iter->roi[0].height;
+      gint        inner_x1;
+      gint        inner_x2;
+      gint        x, y;
+
+      /*  the part of each row whose 3x3 neighborhood is inside src  */
+      inner_x1 = CLAMP (1,                   dest_x1, dest_x2);
+      inner_x2 = CLAMP (data->src_width - 1, inner_x1, dest_x2);
+
+      for (y = dest_y1; y < dest_y2; y++)
+        {
+          gfloat *d = dest;
+
+          if (data->kernel_size == 3 &&
+              y >= 1 && y < data->src_height - 1)
+            {
+              for (x = dest_x1; x < inner_x1; x++, d += data->dest_components)
+                gimp_gegl_convolve_pixel (data, x, y, d);
+
+              gimp_gegl_convolve_row_3x3 (data, inner_x1, inner_x2, y, d);
+              d += (inner_x2 - inner_x1) * data->dest_components;
+
+              for (x = inner_x2; x < dest_x2; x++, d += data->dest_components)
+                gimp_gegl_convolve_pixel (data, x, y, d);
             }
           else
             {
-              for (x = dest_x1; x < dest_x2; x++)
-                {
-                  const gfloat *m        = kernel;
-                  gdouble       total[4] = { 0.0, 0.0, 0.0, 0.0 };
-                  gint          i, j, b;
+              for (x = dest_x1; x < dest_x2; x++, d += data->dest_components)
+                gimp_gegl_convolve_pixel (data, x, y, d);
+            }
 
-                  for (j = y - margin; j <= y + margin; j++)
-                    {
-                      for (i = x - margin; i <= x + margin; i++, m++)
-                        {
-                          gint          xx = CLAMP (i, x1, x2);
-                          gint          yy = CLAMP (j, y1, y2);
-                          const gfloat *s  = src + yy * src_rowstride + xx * components;
-
-                          for (b = 0; b < components; b++)
-                            total[b] += *m * s[b];
-                        }
-                    }
+          dest += dest_iter->roi[0].width * data->dest_components;
+        }
+    }
+}
 
-                  for (b = 0; b < components; b++)
-                    {
-                      total[b] = total[b] / divisor + offset;
+void
+gimp_gegl_convolve (GeglBuffer          *src_buffer,
+                    const GeglRectangle *src_rect,
+                    GeglBuffer          *dest_buffer,
+                    const GeglRectangle *dest_rect,
+                    const gfloat        *kernel,
+                    gint                 kernel_size,
+                    gdouble              divisor,
+                    GimpConvolutionType  mode,
+                    gboolean             alpha_weighting)
+{
+  GimpGeglConvolveData  data;
+  gfloat               *src;
+  const Babl           *src_format;
+  const Babl           *dest_format;
 
-                      if (mode != GIMP_NORMAL_CONVOL && total[b] < 0.0)
-                        total[b] = - total[b];
+  if (! src_rect)
+    src_rect = gegl_buffer_get_extent (src_buffer);
 
-                      *d++ = CLAMP (total[b], 0.0, 1.0);
-                    }
-                }
-            }
+  if (! dest_rect)
+    dest_rect = gegl_buffer_get_extent (dest_buffer);
 
-          dest += dest_iter->roi[0].width * dest_components;
-        }
+  src_format = gegl_buffer_get_format (src_buffer);
+
+    src_format = gimp_babl_format (gimp_babl_format_get_base_type (src_format),
+                                   GIMP_PRECISION_FLOAT_GAMMA,
+                                   babl_format_has_alpha (src_format));
+
+  dest_format = gegl_buffer_get_format (dest_buffer);
+
+    dest_format = gimp_babl_format (gimp_babl_format_get_base_type (dest_format),
+                                    GIMP_PRECISION_FLOAT_GAMMA,
+                                    babl_format_has_alpha (dest_format));
+
+  data.components      = babl_format_get_n_components (src_format);
+  data.dest_buffer     = dest_buffer;
+  data.dest_format     = dest_format;
+  data.dest_components = babl_format_get_n_components (dest_format);
+  data.kernel          = kernel;
+  data.kernel_size     = kernel_size;
+  data.divisor         = divisor;
+  data.alpha_weighting = alpha_weighting;
+  data.src_width       = src_rect->width;
+  data.src_height      = src_rect->height;
+
+  /*  If the mode is NEGATIVE_CONVOL, the offset should be 128  */
+  if (mode == GIMP_NEGATIVE_CONVOL)
+    {
+      data.offset = 0.5;
+      data.mode   = GIMP_NORMAL_CONVOL;
+    }
+  else
+    {
+      data.offset = 0.0;
+      data.mode   = mode;
     }
 
-  g_free (src);
+  /* Get source pixel data, aligned for the vectorized kernel */
+  data.src_rowstride = data.components * src_rect->width;
+  src = gegl_malloc (sizeof (gfloat) * data.src_rowstride * src_rect->height);
+  gegl_buffer_get (src_buffer, src_rect, 1.0, src_format, src,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  data.src = src;
+
+  gimp_parallel_distribute_area (dest_rect, MIN_PARALLEL_SUB_AREA,
+                                 gimp_gegl_convolve_area, &data);
+
+  gegl_free (src);
 }
 
 static inline gfloat
@@ -216,35 +489,82 @@ odd_powf (gfloat x,
     return -powf (-x, y);
 }
 
-void
-gimp_gegl_dodgeburn (GeglBuffer          *src_buffer,
-                     const GeglRectangle *src_rect,
-                     GeglBuffer          *dest_buffer,
-                     const GeglRectangle *dest_rect,
-                     gdouble              exposure,
-                     GimpDodgeBurnType    type,
-                     GimpTransferMode     mode)
+typedef struct
 {
-  GeglBufferIterator *iter;
+  GeglBuffer          *src_buffer;
+  const GeglRectangle *src_rect;
+  GeglBuffer          *dest_buffer;
+  const GeglRectangle *dest_rect;
+  gdouble              exposure;
+  GimpTransferMode     mode;
+  gfloat               factor;
+  const gfloat        *lut;
+} GimpGeglDodgeBurnData;
+
+/*  build a table of odd_powf (x, factor) for x in [0, 1], used by the
+ *  midtones transfer instead of calling powf() on every component
+ */
+static gfloat *
+gimp_gegl_dodgeburn_lut_new (gfloat factor)
+{
+  gfloat *lut = g_new (gfloat, DODGEBURN_LUT_SIZE + 2);
+  gint    i;
 
-  if (type == GIMP_DODGE_BURN_TYPE_BURN)
-    exposure = -exposure;
+  for (i = 0; i <= DODGEBURN_LUT_SIZE; i++)
+    lut[i] = powf ((gfloat) i / DODGEBURN_LUT_SIZE, factor);
+
+  /*  for interpolating at exactly 1.0  */
+  lut[DODGEBURN_LUT_SIZE + 1] = lut[DODGEBURN_LUT_SIZE];
 
-  iter = gegl_buffer_iterator_new (src_buffer, src_rect, 0,
+  return lut;
+}
+
+static inline gfloat
+gimp_gegl_dodgeburn_lut_eval (const gfloat *lut,
+                              gfloat        factor,
+                              gfloat        x)
+{
+  gfloat pos;
+  gint   i;
+
+  /*  powf() is too steep near 0 to interpolate, and the table only
+   *  covers [0, 1]
+   */
+  if (! (x >= DODGEBURN_LUT_MIN && x <= 1.0f))
+    return odd_powf (x, factor);
+
+  pos = x * DODGEBURN_LUT_SIZE;
+  i   = (gint) pos;
+  pos -= i;
+
+  return lut[i] + (lut[i + 1] - lut[i]) * pos;
+}
+
+static void
+gimp_gegl_dodgeburn_area (const GeglRectangle *area,
+                          gpointer             user_data)
+{
+  const GimpGeglDodgeBurnData *data     = user_data;
+  const gfloat                 factor   = data->factor;
+  const gfloat                *lut      = data->lut;
+  GeglRectangle                dest_area;
+  GeglBufferIterator          *iter;
+
+  gimp_gegl_loops_get_sub_rect (area, data->src_rect,
+                                data->dest_buffer, data->dest_rect,
+                                &dest_area);
+
+  iter = gegl_buffer_iterator_new (data->src_buffer, area, 0,
                                    babl_format ("RGBA float"),
                                    GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
 
-  gegl_buffer_iterator_add (iter, dest_buffer, dest_rect, 0,
+  gegl_buffer_iterator_add (iter, data->dest_buffer, &dest_area, 0,
                             babl_format ("RGBA float"),
                             GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
 
-  switch (mode)
+  switch (data->mode)
     {
-      gfloat factor;
-
     case GIMP_TRANSFER_HIGHLIGHTS:
-      factor = 1.0 + exposure * (0.333333);
-
       while (gegl_buffer_iterator_next (iter))
         {
           gfloat *src   = iter->data[0];
@@ -263,34 +583,38 @@ gimp_gegl_dodgeburn (GeglBuffer          *src_buffer,
       break;
 
     case GIMP_TRANSFER_MIDTONES:
-      if (exposure < 0)
-        factor = 1.0 - exposure * (0.333333);
-      else
-        factor = 1.0 / (1.0 + exposure);
-
       while (gegl_buffer_iterator_next (iter))
         {
           gfloat *src   = iter->data[0];
           gfloat *dest  = iter->data[1];
           gint    count = iter->length;
 
-          while (count--)
+          if (lut)
             {
-              *dest++ = odd_powf (*src++, factor);
-              *dest++ = odd_powf (*src++, factor);
-              *dest++ = odd_powf (*src++, factor);
+              while (count--)
+                {
+                  *dest++ = gimp_gegl_dodgeburn_lut_eval (lut, factor, *src++);
+                  *dest++ = gimp_gegl_dodgeburn_lut_eval (lut, factor, *src++);
+                  *dest++ = gimp_gegl_dodgeburn_lut_eval (lut, factor, *src++);
 
-              *dest++ = *src++;
+                  *dest++ = *src++;
+                }
+            }
+          else
+            {
+              while (count--)
+                {
+                  *dest++ = odd_powf (*src++, factor);
+                  *dest++ = odd_powf (*src++, factor);
+                  *dest++ = odd_powf (*src++, factor);
+
+                  *dest++ = *src++;
+                }
             }
         }
       break;
 
     case GIMP_TRANSFER_SHADOWS:
-      if (exposure >= 0)
-        factor = 0.333333 * exposure;
-      else
-        factor = -0.333333 * exposure;
-
       while (gegl_buffer_iterator_next (iter))
         {
           gfloat *src   = iter->data[0];
@@ -299,7 +623,7 @@ gimp_gegl_dodgeburn (GeglBuffer          *src_buffer,
 
           while (count--)
             {
-              if (exposure >= 0)
+              if (data->exposure >= 0)
                 {
                   gfloat s;
 
@@ -337,33 +661,101 @@ gimp_gegl_dodgeburn (GeglBuffer          *src_buffer,
     }
 }
 
-/*
- * blend_pixels patched 8-24-05 to fix bug #163721.  Note that this change
- * causes the function to treat src1 and src2 asymmetrically.  This gives the
- * right behavior for the smudge tool, which is the only user of this function
- * at the time of patching.  If you want to use the function for something
- * else, caveat emptor.
- */
 void
-gimp_gegl_smudge_blend (GeglBuffer          *top_buffer,
-                        const GeglRectangle *top_rect,
-                        GeglBuffer          *bottom_buffer,
-                        const GeglRectangle *bottom_rect,
-                        GeglBuffer          *dest_buffer,
-                        const GeglRectangle *dest_rect,
-                        gdouble              blend)
+gimp_gegl_dodgeburn (GeglBuffer          *src_buffer,
+                     const GeglRectangle *src_rect,
+                     GeglBuffer          *dest_buffer,
+                     const GeglRectangle *dest_rect,
+                     gdouble              exposure,
+                     GimpDodgeBurnType    type,
+                     GimpTransferMode     mode)
 {
-  GeglBufferIterator *iter;
+  GimpGeglDodgeBurnData  data;
+  gfloat                *lut = NULL;
 
-  iter = gegl_buffer_iterator_new (top_buffer, top_rect, 0,
+  if (! src_rect)
+    src_rect = gegl_buffer_get_extent (src_buffer);
+
+  if (type == GIMP_DODGE_BURN_TYPE_BURN)
+    exposure = -exposure;
+
+  switch (mode)
+    {
+    case GIMP_TRANSFER_HIGHLIGHTS:
+      data.factor = 1.0 + exposure * (0.333333);
+      break;
+
+    case GIMP_TRANSFER_MIDTONES:
+      if (exposure < 0)
+        data.factor = 1.0 - exposure * (0.333333);
+      else
+        data.factor = 1.0 / (1.0 + exposure);
+
+      /*  only worth it if there are more components than table entries  */
+      if ((gint64) src_rect->width * src_rect->height * 3 > DODGEBURN_LUT_SIZE)
+        lut = gimp_gegl_dodgeburn_lut_new (data.factor);
+      break;
+
+    case GIMP_TRANSFER_SHADOWS:
+      if (exposure >= 0)
+        data.factor = 0.333333 * exposure;
+      else
+        data.factor = -0.333333 * exposure;
+      break;
+    }
+
+  data.src_buffer  = src_buffer;
+  data.src_rect    = src_rect;
+  data.dest_buffer = dest_buffer;
+  data.dest_rect   = dest_rect;
+  data.exposure    = exposure;
+  data.mode        = mode;
+  data.lut         = lut;
+
+  gimp_parallel_distribute_area (src_rect, MIN_PARALLEL_SUB_AREA,
+                                 gimp_gegl_dodgeburn_area, &data);
+
+  g_free (lut);
+}
+
+typedef struct
+{
+  GeglBuffer          *top_buffer;
+  const GeglRectangle *top_rect;
+  GeglBuffer          *bottom_buffer;
+  const GeglRectangle *bottom_rect;
+  GeglBuffer          *dest_buffer;
+  const GeglRectangle *dest_rect;
+  gfloat               blend;
+} GimpGeglSmudgeBlendData;
+
+static void
+gimp_gegl_smudge_blend_area (const GeglRectangle *area,
+                             gpointer             user_data)
+{
+  const GimpGeglSmudgeBlendData *data   = user_data;
+  const gfloat                   blend1 = 1.0 - data->blend;
+  const gfloat                   blend2 = data->blend;
+  GeglRectangle                  bottom_area;
+  GeglRectangle                  dest_area;
+  GeglBufferIterator            *iter;
+
+  gimp_gegl_loops_get_sub_rect (area, data->top_rect,
+                                data->bottom_buffer, data->bottom_rect,
+                                &bottom_area);
+  gimp_gegl_loops_get_sub_rect (area, data->top_rect,
+                                data->dest_buffer, data->dest_rect,
+                                &dest_area);
+
+  iter = gegl_buffer_iterator_new (data->top_buffer, area, 0,
                                    babl_format ("RGBA float"),
                                    GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
 
-  gegl_buffer_iterator_add (iter, bottom_buffer, bottom_rect, 0,
+  gegl_buffer_iterator_add (iter, data->bottom_buffer, &bottom_area, 0,
                             babl_format ("RGBA float"),
                             GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
 
-  gegl_buffer_iterator_add (iter, dest_buffer, dest_rect, 0,
+  gegl_buffer_iterator_add (iter, data->dest_buffer, &dest_area, 0,
                             babl_format ("RGBA float"),
                             GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
 
@@ -373,8 +765,6 @@ gimp_gegl_smudge_blend (GeglBuffer          *top_buffer,
       const gfloat *bottom = iter->data[1];
       gfloat       *dest   = iter->data[2];
       gint          count  = iter->length;
-      const gfloat  blend1 = 1.0 - blend;
-      const gfloat  blend2 = blend;
 
       while (count--)
         {
@@ -404,6 +794,39 @@ gimp_gegl_smudge_blend (GeglBuffer          *top_buffer,
     }
 }
 
+/*
+ * blend_pixels patched 8-24-05 to fix bug #163721.  Note that this change
+ * causes the function to treat src1 and src2 asymmetrically.  This gives the
+ * right behavior for the smudge tool, which is the only user of this function
+ * at the time of patching.  If you want to use the function for something
+ * else, caveat emptor.
+ */
+void
+gimp_gegl_smudge_blend (GeglBuffer          *top_buffer,
+                        const GeglRectangle *top_rect,
+                        GeglBuffer          *bottom_buffer,
+                        const GeglRectangle *bottom_rect,
+                        GeglBuffer          *dest_buffer,
+                        const GeglRectangle *dest_rect,
+                        gdouble              blend)
+{
+  GimpGeglSmudgeBlendData data;
+
+  if (! top_rect)
+    top_rect = gegl_buffer_get_extent (top_buffer);
+
+  data.top_buffer    = top_buffer;
+  data.top_rect      = top_rect;
+  data.bottom_buffer = bottom_buffer;
+  data.bottom_rect   = bottom_rect;
+  data.dest_buffer   = dest_buffer;
+  data.dest_rect     = dest_rect;
+  data.blend         = blend;
+
+  gimp_parallel_distribute_area (top_rect, MIN_PARALLEL_SUB_AREA,
+                                 gimp_gegl_smudge_blend_area, &data);
+}
+
 void
 gimp_gegl_apply_mask (GeglBuffer          *mask_buffer,
                       const GeglRectangle *mask_rect,
@@ -32,6 +32,11 @@
 #include "gimp-gegl-utils.h"
 
 
+/*  floor and ceiling of a / b, for b > 0  */
+#define DIV_FLOOR(a, b) ((a) >= 0 ? (a) / (b) : -((-(a) + (b) - 1) / (b)))
+#define DIV_CEIL(a, b)  (DIV_FLOOR ((a) + (b) - 1, (b)))
+
+
 GType
 gimp_gegl_get_op_enum_type (const gchar *operation,
                             const gchar *property)
@@ -151,3 +156,177 @@ gimp_gegl_param_spec_has_key (GParamSpec  *pspec,
 
   return FALSE;
 }
+
+GeglBuffer *
+gimp_gegl_buffer_dup_area (GeglBuffer          *buffer,
+                           const GeglRectangle *rect)
+{
+  GeglBuffer *dup;
+  GeglBuffer *shifted;
+  gint        shift_x;
+  gint        shift_y;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (rect != NULL, NULL);
+
+  g_object_get (buffer,
+                "shift-x", &shift_x,
+                "shift-y", &shift_y,
+                NULL);
+
+  /*  allocate the copy at the same position in tile space as the
+   *  area, so gegl_buffer_copy() shares all tiles the area fully
+   *  covers copy-on-write, and only copies the pixels of the partial
+   *  tiles along its border.  a tile is then duplicated only when
+   *  either buffer writes to it later.
+   */
+  dup = gegl_buffer_new (GEGL_RECTANGLE (rect->x + shift_x,
+                                         rect->y + shift_y,
+                                         rect->width,
+                                         rect->height),
+                         gegl_buffer_get_format (buffer));
+
+  gegl_buffer_copy (buffer, rect, GEGL_ABYSS_NONE,
+                    dup, GEGL_RECTANGLE (rect->x + shift_x,
+                                         rect->y + shift_y,
+                                         0, 0));
+
+  /*  and present it at the origin, like a buffer of the area's size  */
+  shifted = g_object_new (GEGL_TYPE_BUFFER,
+                          "source",  dup,
+                          "shift-x", rect->x + shift_x,
+                          "shift-y", rect->y + shift_y,
+                          "x",       0,
+                          "y",       0,
+                          "width",   rect->width,
+                          "height",  rect->height,
+                          NULL);
+
+  g_object_unref (dup);
+
+  return shifted;
+}
+
+/**
+ * gimp_gegl_buffer_set_color:
+ * @buffer: a #GeglBuffer
+ * @rect:   the area to fill, or %NULL for the whole buffer
+ * @color:  the color to fill with
+ *
+ * Does the same as gegl_buffer_set_color(), but only one tile of the
+ * area is actually filled; all other whole tiles the area covers are
+ * copy-on-write duplicates of it. They take up no memory of their own
+ * until something draws on them, so filling a large new layer or mask
+ * is nearly free.
+ **/
+void
+gimp_gegl_buffer_set_color (GeglBuffer          *buffer,
+                            const GeglRectangle *rect,
+                            GeglColor           *color)
+{
+  GeglRectangle area;
+  GeglRectangle tiles;
+  gint          tile_width;
+  gint          tile_height;
+  gint          shift_x;
+  gint          shift_y;
+  gint          x1, y1;
+  gint          x2, y2;
+  gint          size;
+
+  g_return_if_fail (GEGL_IS_BUFFER (buffer));
+  g_return_if_fail (GEGL_IS_COLOR (color));
+
+  if (! rect)
+    rect = gegl_buffer_get_extent (buffer);
+
+  area = *rect;
+
+  g_object_get (buffer,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                "shift-x",     &shift_x,
+                "shift-y",     &shift_y,
+                NULL);
+
+  /*  the whole tiles within the area, in tile space  */
+  x1 = DIV_CEIL  (area.x + shift_x,               tile_width);
+  y1 = DIV_CEIL  (area.y + shift_y,               tile_height);
+  x2 = DIV_FLOOR (area.x + shift_x + area.width,  tile_width);
+  y2 = DIV_FLOOR (area.y + shift_y + area.height, tile_height);
+
+  if (x2 - x1 < 1 || y2 - y1 < 1 || (x2 - x1) * (y2 - y1) < 2)
+    {
+      gegl_buffer_set_color (buffer, &area, color);
+      return;
+    }
+
+  tiles.x      = x1 * tile_width  - shift_x;
+  tiles.y      = y1 * tile_height - shift_y;
+  tiles.width  = (x2 - x1) * tile_width;
+  tiles.height = (y2 - y1) * tile_height;
+
+  /*  fill the first tile, and duplicate it over the others, doubling
+   *  the filled area with each copy, first along the top row, then
+   *  downwards
+   */
+  gegl_buffer_set_color (buffer,
+                         GEGL_RECTANGLE (tiles.x, tiles.y,
+                                         tile_width, tile_height),
+                         color);
+
+  for (size = tile_width; size < tiles.width; size *= 2)
+    {
+      gint width = MIN (size, tiles.width - size);
+
+      gegl_buffer_copy (buffer,
+                        GEGL_RECTANGLE (tiles.x, tiles.y,
+                                        width, tile_height),
+                        GEGL_ABYSS_NONE,
+                        buffer,
+                        GEGL_RECTANGLE (tiles.x + size, tiles.y,
+                                        width, tile_height));
+    }
+
+  for (size = tile_height; size < tiles.height; size *= 2)
+    {
+      gint height = MIN (size, tiles.height - size);
+
+      gegl_buffer_copy (buffer,
+                        GEGL_RECTANGLE (tiles.x, tiles.y,
+                                        tiles.width, height),
+                        GEGL_ABYSS_NONE,
+                        buffer,
+                        GEGL_RECTANGLE (tiles.x, tiles.y + size,
+                                        tiles.width, height));
+    }
+
+  /*  and fill the partial tiles around them the usual way  */
+  if (tiles.y > area.y)
+    gegl_buffer_set_color (buffer,
+                           GEGL_RECTANGLE (area.x, area.y,
+                                           area.width, tiles.y - area.y),
+                           color);
+
+  if (tiles.y + tiles.height < area.y + area.height)
+    gegl_buffer_set_color (buffer,
+                           GEGL_RECTANGLE (area.x, tiles.y + tiles.height,
+                                           area.width,
+                                           area.y + area.height -
+                                           tiles.y - tiles.height),
+                           color);
+
+  if (tiles.x > area.x)
+    gegl_buffer_set_color (buffer,
+                           GEGL_RECTANGLE (area.x, tiles.y,
+                                           tiles.x - area.x, tiles.height),
+                           color);
+
+  if (tiles.x + tiles.width < area.x + area.width)
+    gegl_buffer_set_color (buffer,
+                           GEGL_RECTANGLE (tiles.x + tiles.width, tiles.y,
+                                           area.x + area.width -
+                                           tiles.x - tiles.width,
+                                           tiles.height),
+                           color);
+}
@@ -30,6 +30,9 @@
 #include "operations/gimp-operations.h"
 
 #include "core/gimp.h"
+#include "core/gimp-memory-manager.h"
+#include "core/gimp-memory-pool.h"
+#include "core/gimp-parallel.h"
 
 #include "gimp-babl.h"
 #include "gimp-gegl.h"
@@ -74,11 +77,25 @@ gimp_gegl_init (Gimp *gimp)
                     * g_signal_connect_data: assertion 'c_handler != NULL' failed
                     * */
 
+  gimp_parallel_init (gimp);
+  gimp_memory_pool_init (gimp);
+  gimp_memory_manager_init (gimp);
+
   gimp_babl_init ();
 
   gimp_operations_init (gimp);
 }
 
+void
+gimp_gegl_exit (Gimp *gimp)
+{
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  gimp_memory_manager_exit (gimp);
+  gimp_memory_pool_exit (gimp);
+  gimp_parallel_exit (gimp);
+}
+
 static void
 gimp_gegl_notify_tile_cache_size (GimpGeglConfig *config)
 {
@@ -416,3 +416,104 @@ gimp_tile_handler_validate_undo_invalidate (GimpTileHandlerValidate *validate,
 
   cairo_region_subtract_rectangle (validate->dirty_region, &rect);
 }
+
+/*  like invalidate, but also drops the tiles of the area, so their
+ *  memory is released until they are rendered again
+ */
+void
+gimp_tile_handler_validate_discard (GimpTileHandlerValidate *validate,
+                                    gint                     x,
+                                    gint                     y,
+                                    gint                     width,
+                                    gint                     height)
+{
+  cairo_rectangle_int_t  rect = { x, y, width, height };
+  GeglTileSource        *source;
+  gint                   tile_x1;
+  gint                   tile_y1;
+  gint                   tile_x2;
+  gint                   tile_y2;
+  gint                   tile_x;
+  gint                   tile_y;
+  gint                   tile_z;
+
+  g_return_if_fail (GIMP_IS_TILE_HANDLER_VALIDATE (validate));
+
+  if (width <= 0 || height <= 0)
+    return;
+
+  cairo_region_union_rectangle (validate->dirty_region, &rect);
+
+  source  = GEGL_TILE_SOURCE (validate);
+  tile_x1 = x / validate->tile_width;
+  tile_y1 = y / validate->tile_height;
+  tile_x2 = (x + width  - 1) / validate->tile_width + 1;
+  tile_y2 = (y + height - 1) / validate->tile_height + 1;
+
+  for (tile_z = 0; tile_z <= validate->max_z; tile_z++)
+    {
+      if (tile_z > 0)
+        {
+          tile_y1 = tile_y1 / 2;
+          tile_y2 = (tile_y2 + 1) / 2;
+          tile_x1 = tile_x1 / 2;
+          tile_x2 = (tile_x2 + 1) / 2;
+        }
+
+      for (tile_y = tile_y1; tile_y < tile_y2; tile_y++)
+        for (tile_x = tile_x1; tile_x < tile_x2; tile_x++)
+          gegl_tile_source_void (source, tile_x, tile_y, tile_z);
+    }
+}
+
+/*  counts the tiles of the area which are kept by the buffer, on all
+ *  levels, the ones never rendered or discarded don't count
+ */
+gint
+gimp_tile_handler_validate_count_tiles (GimpTileHandlerValidate *validate,
+                                        gint                     x,
+                                        gint                     y,
+                                        gint                     width,
+                                        gint                     height)
+{
+  GeglTileSource *source;
+  gint            tile_x1;
+  gint            tile_y1;
+  gint            tile_x2;
+  gint            tile_y2;
+  gint            tile_x;
+  gint            tile_y;
+  gint            tile_z;
+  gint            n_tiles = 0;
+
+  g_return_val_if_fail (GIMP_IS_TILE_HANDLER_VALIDATE (validate), 0);
+
+  if (width <= 0 || height <= 0)
+    return 0;
+
+  source  = GEGL_TILE_SOURCE (validate);
+  tile_x1 = x / validate->tile_width;
+  tile_y1 = y / validate->tile_height;
+  tile_x2 = (x + width  - 1) / validate->tile_width + 1;
+  tile_y2 = (y + height - 1) / validate->tile_height + 1;
+
+  for (tile_z = 0; tile_z <= validate->max_z; tile_z++)
+    {
+      if (tile_z > 0)
+        {
+          tile_y1 = tile_y1 / 2;
+          tile_y2 = (tile_y2 + 1) / 2;
+          tile_x1 = tile_x1 / 2;
+          tile_x2 = (tile_x2 + 1) / 2;
+        }
+
+      for (tile_y = tile_y1; tile_y < tile_y2; tile_y++)
+        for (tile_x = tile_x1; tile_x < tile_x2; tile_x++)
+          {
+            if (gegl_tile_source_exist (source, tile_x, tile_y, tile_z))
+              n_tiles++;
+          }
+    }
+
+  return n_tiles;
+}
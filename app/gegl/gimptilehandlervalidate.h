@@ -80,6 +80,16 @@ void         gimp_tile_handler_validate_undo_invalidate (GimpTileHandlerValidate
                                                          gint                     y,
                                                          gint                     width,
                                                          gint                     height);
+void              gimp_tile_handler_validate_discard    (GimpTileHandlerValidate *validate,
+                                                         gint                     x,
+                                                         gint                     y,
+                                                         gint                     width,
+                                                         gint                     height);
+gint             gimp_tile_handler_validate_count_tiles (GimpTileHandlerValidate *validate,
+                                                         gint                     x,
+                                                         gint                     y,
+                                                         gint                     width,
+                                                         gint                     height);
 
 
 G_END_DECLS
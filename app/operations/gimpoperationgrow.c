@@ -29,6 +29,8 @@
 
 #include "operations-types.h"
 
+#include "gegl/gimp-gegl-distance.h"
+
 #include "gimpoperationgrow.h"
 
 
@@ -245,6 +247,13 @@ gimp_operation_grow_process (GeglOperation       *operation,
   gint16             last_index;
   gfloat            *buffer;
 
+  /* Binary masks are grown by way of the distance of each pixel to
+   * the nearest selected pixel, which doesn't depend on the radius.
+   */
+  if (gimp_gegl_distance_grow (input, output, roi,
+                               self->radius_x, self->radius_y))
+    return TRUE;
+
   max = g_new (gfloat *, roi->width + 2 * self->radius_x);
   buf = g_new (gfloat *, self->radius_y + 1);
 
@@ -29,6 +29,8 @@
 
 #include "operations-types.h"
 
+#include "gegl/gimp-gegl-distance.h"
+
 #include "gimpoperationshapeburst.h"
 
 
@@ -173,148 +175,8 @@ gimp_operation_shapeburst_process (GeglOperation       *operation,
                                    const GeglRectangle *roi,
                                    gint                 level)
 {
-  const Babl *input_format   = babl_format ("Y float");
-  const Babl *output_format  = babl_format ("Y float");
-  gfloat      max_dist = 0.0;
-  gfloat     *distbuf;
-  gint        x, y;
-
-  distbuf = g_new0 (gfloat, (roi->width + 1) * 2);
-
-  for (y = 0; y < roi->height; y++)
-    {
-      gfloat *distbuf_cur;
-      gfloat *distbuf_prev;
-      gfloat  src = 0.0;
-
-      /* toggling distance buffers for the current and previous row.
-       * with one spare zero element on the left side */
-      if (y % 2)
-        {
-          distbuf_prev = distbuf + 1;
-          distbuf_cur  = distbuf + 1 + roi->width + 1;
-        }
-      else
-        {
-          distbuf_prev = distbuf + 1 + roi->width + 1;
-          distbuf_cur  = distbuf + 1;
-        }
-
-      /*  clear the current rows distbuffer */
-      memset (distbuf_cur, 0, sizeof (gfloat) * roi->width);
-
-      for (x = 0; x < roi->width; x++)
-        {
-          gfloat dist_nw = MIN (distbuf_cur[x-1], distbuf_prev[x]);
-          gfloat dist_se = MIN ((roi->width - x - 1), (roi->height - y - 1));
-          gfloat dist    = MIN (dist_se, dist_nw);
-          gfloat frac    = 1.0;
-          gint   k;
-
-#define EPSILON 0.0001
-
-          /*  This loop used to start at "k = (dist) ? (dist - 1) : 0"
-           *  and this comment suggested it might have to be changed to
-           *  "k = 0", but "k = 0" increases processing time significantly.
-           *
-           *  When porting this to float, i noticed that starting at
-           *  "dist - 2" gets rid of a lot of 8-bit artifacts, while starting
-           *  at "dist - 3" or smaller would introduce different artifacts.
-           *
-           *  Note that I didn't really understand the entire algorithm,
-           *  I just "blindly" ported it to float :) --mitch
-           */
-
-          /* the idea here is to check the south-eastern "thick" diagonal
-           * along the already established accumulated minimum distance.
-           *
-           * it is easy to understand why it is sufficient to check
-           * the triangle to this diagonal (k=0), but in fact we can
-           * omit that, since this check has already been incorporated
-           * in the accumulated minimum distance of the previous pixels.
-           *
-           * Not sure however if this is implemented properly.
-           *      -- simon
-           */
-
-          for (k = MAX (dist - 2, 0); k <= dist; k++)
-            {
-              gint x1  = x;
-              gint y1  = y + k;
-
-              while (y1 >= y)
-                {
-                  /* FIXME: this should be much faster, it converts to
-                   * 32 bit rgba intermediately, bah...
-                   */
-                  gegl_buffer_sample (input, x1 + roi->x, y1 + roi->y,
-                                      NULL, &src, input_format,
-                                      GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-
-                  if (src < EPSILON)
-                    {
-                      dist = k;
-                      break;
-                    }
-
-                  frac = MIN (frac, src);
-
-                  x1++;
-                  y1--;
-                }
-            }
-
-          if (src > EPSILON)
-            {
-              /*  If dist_se != dist_nw use the previous frac
-               *   if it is less than the one found
-               */
-              if (dist_se != dist)
-                {
-                  gfloat prev_frac = dist_nw - dist;
-
-                  if (ABS (prev_frac - 1.0) < EPSILON)
-                    prev_frac = 0.0;
-
-                  frac = MIN (frac, prev_frac);
-                }
-
-              dist += 1.0;
-            }
-
-          distbuf_cur[x] = dist + frac;
-
-          max_dist = MAX (max_dist, distbuf_cur[x]);
-        }
-
-      /*  set the dist row  */
-      gegl_buffer_set (output,
-                       GEGL_RECTANGLE (roi->x, roi->y + y,
-                                       roi->width, 1),
-                       0, output_format, distbuf_cur,
-                       GEGL_AUTO_ROWSTRIDE);
-
-      gegl_operation_progress (operation, (gdouble) y / roi->height, "");
-    }
-
-  g_free (distbuf);
-
-  if (GIMP_OPERATION_SHAPEBURST (operation)->normalize && max_dist > 0.0)
-    {
-      GeglBufferIterator *iter;
-
-      iter = gegl_buffer_iterator_new (output, NULL, 0, NULL,
-                                       GEGL_ACCESS_READWRITE, GEGL_ABYSS_NONE);
-
-      while (gegl_buffer_iterator_next (iter))
-        {
-          gint    count = iter->length;
-          gfloat *data  = iter->data[0];
-
-          while (count--)
-            *data++ /= max_dist;
-        }
-    }
+  gimp_gegl_distance_transform (input, output, roi,
+                                GIMP_OPERATION_SHAPEBURST (operation)->normalize);
 
   gegl_operation_progress (operation, 1.0, "");
 
@@ -29,6 +29,8 @@
 
 #include "operations-types.h"
 
+#include "gegl/gimp-gegl-distance.h"
+
 #include "gimpoperationshrink.h"
 
 
@@ -267,6 +269,14 @@ gimp_operation_shrink_process (GeglOperation       *operation,
   gfloat              *buffer;
   gint                 buffer_size;
 
+  /* Binary masks are shrunk by way of the distance of each pixel to
+   * the nearest unselected pixel, which doesn't depend on the radius.
+   */
+  if (gimp_gegl_distance_shrink (input, output, roi,
+                                 self->radius_x, self->radius_y,
+                                 self->edge_lock))
+    return TRUE;
+
   max = g_new (gfloat *, roi->width + 2 * self->radius_x);
   buf = g_new (gfloat *, self->radius_y + 1);
 
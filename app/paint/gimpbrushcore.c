@@ -81,6 +81,9 @@ static void      gimp_brush_core_interpolate        (GimpPaintCore    *core,
                                                      GimpDrawable     *drawable,
                                                      GimpPaintOptions *paint_options,
                                                      guint32           time);
+static void      gimp_brush_core_reserve_scratch    (GimpBrushCore    *core,
+                                                     GimpPaintOptions *paint_options,
+                                                     const GimpCoords *coords);
 
 static GeglBuffer * gimp_brush_core_get_paint_buffer(GimpPaintCore    *paint_core,
                                                      GimpDrawable     *drawable,
@@ -430,6 +433,8 @@ gimp_brush_core_start (GimpPaintCore     *paint_core,
                                                coords);
     }
 
+  gimp_brush_core_reserve_scratch (core, paint_options, coords);
+
   core->spacing = paint_options->brush_spacing;
 
   core->brush = core->main_brush;
@@ -441,6 +446,44 @@ gimp_brush_core_start (GimpPaintCore     *paint_core,
   return TRUE;
 }
 
+/*  reserves room in the paint core's scratch buffers for the largest
+ *  paint buffer of the stroke: the brush size, which the dynamics only
+ *  ever make smaller, turned to any angle, plus the paint buffer's
+ *  border
+ */
+static void
+gimp_brush_core_reserve_scratch (GimpBrushCore    *core,
+                                 GimpPaintOptions *paint_options,
+                                 const GimpCoords *coords)
+{
+  gint width;
+  gint height;
+
+  if (GIMP_BRUSH_CORE_GET_CLASS (core)->handles_transforming_brush)
+    {
+      gdouble max_view_scale = 1.0;
+      gdouble max_brush_size;
+
+      if (paint_options->brush_zoom && MAX (coords->xscale, coords->yscale) > 0)
+        max_view_scale = MAX (coords->xscale, coords->yscale);
+
+      max_brush_size = MIN (paint_options->brush_size / max_view_scale,
+                            GIMP_BRUSH_MAX_SIZE);
+
+      /*  the same headroom as the smudge accumulator  */
+      width  = ceil (sqrt (2 * SQR (max_brush_size + 1)) + 2);
+      height = width;
+    }
+  else
+    {
+      width  = gimp_brush_get_width  (core->main_brush);
+      height = gimp_brush_get_height (core->main_brush);
+    }
+
+  gimp_paint_core_reserve_scratch (GIMP_PAINT_CORE (core),
+                                   width + 2, height + 2);
+}
+
 /**
  * gimp_avoid_exact_integer
  * @x: points to a gdouble
@@ -859,8 +902,8 @@ gimp_brush_core_get_paint_buffer (GimpPaintCore    *paint_core,
   /*  configure the canvas buffer  */
   if ((x2 - x1) && (y2 - y1))
     {
-      GimpTempBuf *temp_buf;
-      const Babl  *format;
+      GeglBuffer *buffer;
+      const Babl *format;
 
 //        format = babl_format ("RGBA float");
       format = gimp_layer_mode_get_format (paint_mode,
@@ -868,29 +911,21 @@ gimp_brush_core_get_paint_buffer (GimpPaintCore    *paint_core,
                                            GIMP_LAYER_COLOR_SPACE_AUTO,
                                            NULL);
 
-      if (paint_core->paint_buffer                                       &&
-          gegl_buffer_get_width  (paint_core->paint_buffer) == (x2 - x1) &&
-          gegl_buffer_get_height (paint_core->paint_buffer) == (y2 - y1) &&
-          gegl_buffer_get_format (paint_core->paint_buffer) == format )
-        {
-          *paint_buffer_x = x1;
-          *paint_buffer_y = y1;
-
-          return paint_core->paint_buffer;
-        }
-
-      temp_buf = gimp_temp_buf_new ((x2 - x1), (y2 - y1),
-                                    format);
+      buffer = gimp_paint_core_get_scratch_buffer (paint_core,
+                                                   GIMP_PAINT_CORE_SCRATCH_PAINT,
+                                                   (x2 - x1), (y2 - y1),
+                                                   format);
 
       *paint_buffer_x = x1;
       *paint_buffer_y = y1;
 
-      if (paint_core->paint_buffer)
-        g_object_unref (paint_core->paint_buffer);
-
-      paint_core->paint_buffer = gimp_temp_buf_create_buffer (temp_buf);
+      if (paint_core->paint_buffer != buffer)
+        {
+          if (paint_core->paint_buffer)
+            g_object_unref (paint_core->paint_buffer);
 
-      gimp_temp_buf_unref (temp_buf);
+          paint_core->paint_buffer = g_object_ref (buffer);
+        }
 
       return paint_core->paint_buffer;
     }
@@ -1007,6 +1042,71 @@ gimp_brush_core_paste_canvas (GimpBrushCore            *core,
     }
 }
 
+/* Like gimp_brush_core_paste_canvas, but instead of pasting, copies
+ * the current paint buffer and brush mask to the scratch slots @slot
+ * and @slot + 1 and fills in @dab, so that several dabs can be pasted
+ * at once using gimp_paint_core_paste_dabs().
+ */
+gboolean
+gimp_brush_core_get_dab (GimpBrushCore            *core,
+                         const GimpCoords         *coords,
+                         gdouble                   brush_opacity,
+                         GimpBrushApplicationMode  brush_hardness,
+                         gdouble                   dynamic_force,
+                         GimpPaintApplicationMode  mode,
+                         GeglNode                 *op,
+                         gint                      slot,
+                         GimpPaintCoreDab         *dab)
+{
+  GimpPaintCore     *paint_core = GIMP_PAINT_CORE (core);
+  const GimpTempBuf *brush_mask;
+  GeglBuffer        *buffer;
+  gint               x;
+  gint               y;
+
+  g_return_val_if_fail (GIMP_IS_BRUSH_CORE (core), FALSE);
+  g_return_val_if_fail (dab != NULL, FALSE);
+
+  if (! paint_core->paint_buffer)
+    return FALSE;
+
+  brush_mask = gimp_brush_core_get_brush_mask (core, coords, op,
+                                               brush_hardness,
+                                               dynamic_force);
+
+  if (! brush_mask)
+    return FALSE;
+
+  x = (gint) floor (coords->x) - (gimp_temp_buf_get_width  (brush_mask) >> 1);
+  y = (gint) floor (coords->y) - (gimp_temp_buf_get_height (brush_mask) >> 1);
+
+  /*  both the paint buffer and the brush mask are reused for the
+   *  next dab, so copy them
+   */
+  buffer = gimp_paint_core_get_scratch_buffer (paint_core, slot,
+                                               gegl_buffer_get_width  (paint_core->paint_buffer),
+                                               gegl_buffer_get_height (paint_core->paint_buffer),
+                                               gegl_buffer_get_format (paint_core->paint_buffer));
+
+  gegl_buffer_copy (paint_core->paint_buffer, NULL, GEGL_ABYSS_NONE,
+                    buffer, NULL);
+
+  dab->paint_buffer        = buffer;
+  dab->paint_buffer_x      = paint_core->paint_buffer_x;
+  dab->paint_buffer_y      = paint_core->paint_buffer_y;
+
+  buffer = gimp_paint_core_get_scratch_temp_buf (paint_core, slot + 1,
+                                                 brush_mask);
+
+  dab->paint_mask          = gimp_gegl_buffer_get_temp_buf (buffer);
+  dab->paint_mask_offset_x = (x < 0) ? -x : 0;
+  dab->paint_mask_offset_y = (y < 0) ? -y : 0;
+  dab->paint_opacity       = brush_opacity;
+  dab->mode                = mode;
+
+  return TRUE;
+}
+
 /* Similar to gimp_brush_core_paste_canvas, but replaces the alpha channel
  * rather than using it to composite (i.e. transparent over opaque
  * becomes transparent rather than opauqe.
@@ -109,6 +109,15 @@ void   gimp_brush_core_paste_canvas   (GimpBrushCore            *core,
                                        gdouble                   dynamic_hardness,
                                        GimpPaintApplicationMode  mode,
                                        GeglNode                 *op);
+gboolean gimp_brush_core_get_dab     (GimpBrushCore            *core,
+                                       const GimpCoords         *coords,
+                                       gdouble                   brush_opacity,
+                                       GimpBrushApplicationMode  brush_hardness,
+                                       gdouble                   dynamic_force,
+                                       GimpPaintApplicationMode  mode,
+                                       GeglNode                 *op,
+                                       gint                      slot,
+                                       GimpPaintCoreDab         *dab);
 void   gimp_brush_core_replace_canvas (GimpBrushCore            *core,
                                        GimpDrawable             *drawable,
                                        const GimpCoords         *coords,
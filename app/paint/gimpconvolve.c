@@ -31,7 +31,6 @@
 #include "core/gimpimage.h"
 #include "core/gimppickable.h"
 #include "core/gimpsymmetry.h"
-#include "core/gimptempbuf.h"
 
 #include "gimpconvolve.h"
 #include "gimpconvolveoptions.h"
@@ -133,7 +132,6 @@ gimp_convolve_motion (GimpPaintCore    *paint_core,
   GeglBuffer          *paint_buffer;
   gint                 paint_buffer_x;
   gint                 paint_buffer_y;
-  GimpTempBuf         *temp_buf;
   GeglBuffer          *convolve_buffer;
   gdouble              fade_point;
   gdouble              opacity;
@@ -193,11 +191,12 @@ gimp_convolve_motion (GimpPaintCore    *paint_core,
                                       rate);
 
       /*  need a linear buffer for gimp_gegl_convolve()  */
-      temp_buf = gimp_temp_buf_new (gegl_buffer_get_width  (paint_buffer),
-                                    gegl_buffer_get_height (paint_buffer),
-                                    gegl_buffer_get_format (paint_buffer));
-      convolve_buffer = gimp_temp_buf_create_buffer (temp_buf);
-      gimp_temp_buf_unref (temp_buf);
+      convolve_buffer =
+        gimp_paint_core_get_scratch_buffer (paint_core,
+                                            GIMP_PAINT_CORE_SCRATCH_SOURCE,
+                                            gegl_buffer_get_width  (paint_buffer),
+                                            gegl_buffer_get_height (paint_buffer),
+                                            gegl_buffer_get_format (paint_buffer));
 
       gegl_buffer_copy (gimp_drawable_get_buffer (drawable),
                         GEGL_RECTANGLE (paint_buffer_x,
@@ -219,8 +218,6 @@ gimp_convolve_motion (GimpPaintCore    *paint_core,
                           convolve->matrix, 3, convolve->matrix_divisor,
                           GIMP_NORMAL_CONVOL, TRUE);
 
-      g_object_unref (convolve_buffer);
-
       gimp_brush_core_replace_canvas (brush_core, drawable,
                                       coords,
                                       MIN (opacity, GIMP_OPACITY_OPAQUE),
@@ -32,6 +32,7 @@
 
 #include "paint-types.h"
 
+#include "core/gimp-parallel.h"
 #include "core/gimpbrush.h"
 #include "core/gimpdrawable.h"
 #include "core/gimpdynamics.h"
@@ -54,9 +55,12 @@
  * but subtract them I2 = I0 - I1, where I0 is the sample image to be
  * corrected, I1 is the reference pattern. Then we solve DeltaI=0
  * (Laplace) with I2 Dirichlet conditions at the borders of the
- * mask. The solver is a red/black checker Gauss-Seidel with over-relaxation.
- * It could benefit from a multi-grid evaluation of an initial solution
- * before the main iteration loop.
+ * mask. The default solver runs multi-grid V-cycles, with red/black
+ * Gauss-Seidel as the smoother, on each component separately and
+ * concurrently. Its cost per cycle is linear in the brush area, and the
+ * number of cycles hardly depends on the brush size. The original
+ * red/black checker Gauss-Seidel with over-relaxation is kept as the
+ * fallback for small brushes.
  *
  * I reduced the convergence criteria to 0.1% (0.001) as we are
  * dealing here with RGB integer components, more is overkill.
@@ -64,6 +68,31 @@
  * Jean-Yves Couleaud cjyves@free.fr
  */
 
+/* Tolerate a total deviation-from-smoothness of 0.1 LSBs at 8bit depth. */
+#define EPSILON  (0.1/255)
+#define MAX_ITER 500
+
+/* Below this brush area, the vectorized SOR loop is faster. */
+#define MULTIGRID_MIN_AREA   (128 * 128)
+
+/* Don't coarsen the grid below this size. */
+#define MULTIGRID_MIN_SIZE   16
+#define MULTIGRID_MAX_LEVELS 16
+#define SMOOTH_SWEEPS        2
+#define COARSE_SWEEPS        50
+
+
+typedef struct
+{
+  gint    width;
+  gint    height;
+  gfloat *x;    /* the solution, or the correction on coarse levels */
+  gfloat *b;    /* the right hand side, NULL on the finest level    */
+  gfloat *r;    /* the residual                                     */
+  guchar *mask; /* the unknown cells                                */
+} GimpHealGrid;
+
+
 static gboolean     gimp_heal_start              (GimpPaintCore    *paint_core,
                                                   GimpDrawable     *drawable,
                                                   GimpPaintOptions *paint_options,
@@ -301,19 +330,16 @@ gimp_heal_laplace_iteration (gfloat *pixels,
   return err;
 }
 
-/* Solve the laplace equation for pixels and store the result in-place.
+/* Solve the laplace equation for pixels with Gauss-Seidel SOR, store
+ * the result in-place and return the number of iterations used.
  */
-static void
-gimp_heal_laplace_loop (gfloat *pixels,
-                        gint    height,
-                        gint    depth,
-                        gint    width,
-                        guchar *mask)
+static gint
+gimp_heal_laplace_sor (gfloat       *pixels,
+                       gint          height,
+                       gint          depth,
+                       gint          width,
+                       const guchar *mask)
 {
-  /* Tolerate a total deviation-from-smoothness of 0.1 LSBs at 8bit depth. */
-#define EPSILON  (0.1/255)
-#define MAX_ITER 500
-
   gint    i, j, iter, parity, nmask, zero;
   gfloat *Adiag;
   gint   *Aidx;
@@ -379,6 +405,349 @@ gimp_heal_laplace_loop (gfloat *pixels,
 
   g_free (Adiag);
   g_free (Aidx);
+
+  return MIN (iter + 1, MAX_ITER);
+}
+
+/* Red/black Gauss-Seidel sweeps over the unknown cells of a grid. */
+static void
+gimp_heal_multigrid_smooth (GimpHealGrid *grid,
+                            gint          n_sweeps)
+{
+  const gint    width  = grid->width;
+  const gint    height = grid->height;
+  gfloat       *x      = grid->x;
+  const gfloat *b      = grid->b;
+  const guchar *mask   = grid->mask;
+  gint          sweep, parity, i, j;
+
+  for (sweep = 0; sweep < n_sweeps; sweep++)
+    for (parity = 0; parity < 2; parity++)
+      for (i = 0; i < height; i++)
+        {
+          gboolean edge_row = (i == 0 || i == height - 1);
+
+          for (j = (i & 1) ^ parity; j < width; j += 2)
+            {
+              gint   o = i * width + j;
+              gfloat sum;
+              gint   n;
+
+              if (! mask[o])
+                continue;
+
+              sum = b ? b[o] : 0.0f;
+
+              if (! edge_row && j > 0 && j < width - 1)
+                {
+                  x[o] = 0.25f * (sum +
+                                  x[o - 1]     + x[o + 1] +
+                                  x[o - width] + x[o + width]);
+                  continue;
+                }
+
+              /* Omit neighbors off the edge of the canvas. */
+              n = 0;
+
+              if (j > 0)          { sum += x[o - 1];     n++; }
+              if (j < width - 1)  { sum += x[o + 1];     n++; }
+              if (i > 0)          { sum += x[o - width]; n++; }
+              if (i < height - 1) { sum += x[o + width]; n++; }
+
+              if (n > 0)
+                x[o] = sum / n;
+            }
+        }
+}
+
+/* Store the residual of the unknown cells in grid->r and return its
+ * sum of squares.
+ */
+static gdouble
+gimp_heal_multigrid_residual (GimpHealGrid *grid)
+{
+  gint    width  = grid->width;
+  gint    height = grid->height;
+  gdouble err    = 0.0;
+  gint    i, j;
+
+  for (i = 0; i < height; i++)
+    for (j = 0; j < width; j++)
+      {
+        gint   o = i * width + j;
+        gfloat r;
+
+        if (! grid->mask[o])
+          {
+            grid->r[o] = 0.0f;
+            continue;
+          }
+
+        r = grid->b ? grid->b[o] : 0.0f;
+
+        if (j > 0)          r += grid->x[o - 1]     - grid->x[o];
+        if (j < width - 1)  r += grid->x[o + 1]     - grid->x[o];
+        if (i > 0)          r += grid->x[o - width] - grid->x[o];
+        if (i < height - 1) r += grid->x[o + width] - grid->x[o];
+
+        grid->r[o] = r;
+        err += r * r;
+      }
+
+  return err;
+}
+
+static void
+gimp_heal_multigrid_vcycle (GimpHealGrid *grids,
+                            gint          level,
+                            gint          n_levels)
+{
+  GimpHealGrid *fine = &grids[level];
+  GimpHealGrid *coarse;
+  gint          i, j;
+
+  if (level == n_levels - 1)
+    {
+      gimp_heal_multigrid_smooth (fine, COARSE_SWEEPS);
+      return;
+    }
+
+  coarse = &grids[level + 1];
+
+  gimp_heal_multigrid_smooth (fine, SMOOTH_SWEEPS);
+  gimp_heal_multigrid_residual (fine);
+
+  /* the coarse right hand side is the sum of the fine residuals of
+   * each 2x2 block, which accounts for the doubled grid spacing
+   */
+  memset (coarse->b, 0, sizeof (gfloat) * coarse->width * coarse->height);
+  memset (coarse->x, 0, sizeof (gfloat) * coarse->width * coarse->height);
+
+  for (i = 0; i < fine->height; i++)
+    for (j = 0; j < fine->width; j++)
+      coarse->b[(i / 2) * coarse->width + (j / 2)] +=
+        fine->r[i * fine->width + j];
+
+  gimp_heal_multigrid_vcycle (grids, level + 1, n_levels);
+
+  /* bilinear interpolation of the coarse correction */
+  for (i = 0; i < fine->height; i++)
+    {
+      gint ci0 = i / 2;
+      gint ci1 = CLAMP (ci0 + ((i & 1) ? 1 : -1), 0, coarse->height - 1);
+
+      for (j = 0; j < fine->width; j++)
+        {
+          gint          cj0 = j / 2;
+          gint          cj1;
+          const gfloat *row0;
+          const gfloat *row1;
+
+          if (! fine->mask[i * fine->width + j])
+            continue;
+
+          cj1  = CLAMP (cj0 + ((j & 1) ? 1 : -1), 0, coarse->width - 1);
+          row0 = coarse->x + ci0 * coarse->width;
+          row1 = coarse->x + ci1 * coarse->width;
+
+          fine->x[i * fine->width + j] +=
+            0.5625f * row0[cj0] + 0.1875f * row0[cj1] +
+            0.1875f * row1[cj0] + 0.0625f * row1[cj1];
+        }
+    }
+
+  gimp_heal_multigrid_smooth (fine, SMOOTH_SWEEPS);
+}
+
+/* Solve the laplace equation for a single component plane with
+ * multi-grid V-cycles, store the result in-place and return the
+ * number of cycles used.
+ */
+static gint
+gimp_heal_laplace_multigrid (gfloat       *pixels,
+                             gint          height,
+                             gint          width,
+                             const guchar *mask)
+{
+  GimpHealGrid grids[MULTIGRID_MAX_LEVELS];
+  gint         n_levels;
+  gint         level;
+  gint         cycle;
+
+  /* not worth it for small brushes */
+  if (width < 2 * MULTIGRID_MIN_SIZE || height < 2 * MULTIGRID_MIN_SIZE)
+    return gimp_heal_laplace_sor (pixels, height, 1, width, mask);
+
+  grids[0].width  = width;
+  grids[0].height = height;
+  grids[0].x      = pixels;
+  grids[0].b      = NULL;
+  grids[0].r      = g_new (gfloat, width * height);
+  grids[0].mask   = (guchar *) mask;
+
+  for (n_levels = 1; n_levels < MULTIGRID_MAX_LEVELS; n_levels++)
+    {
+      GimpHealGrid *fine   = &grids[n_levels - 1];
+      GimpHealGrid *coarse = &grids[n_levels];
+      gint          i, j;
+
+      if (fine->width  < 2 * MULTIGRID_MIN_SIZE ||
+          fine->height < 2 * MULTIGRID_MIN_SIZE)
+        break;
+
+      coarse->width  = (fine->width  + 1) / 2;
+      coarse->height = (fine->height + 1) / 2;
+      coarse->x      = g_new  (gfloat, coarse->width * coarse->height);
+      coarse->b      = g_new  (gfloat, coarse->width * coarse->height);
+      coarse->r      = g_new  (gfloat, coarse->width * coarse->height);
+      coarse->mask   = g_new  (guchar, coarse->width * coarse->height);
+
+      /* a coarse cell is unknown only if all of its fine cells are */
+      memset (coarse->mask, TRUE, coarse->width * coarse->height);
+
+      for (i = 0; i < fine->height; i++)
+        for (j = 0; j < fine->width; j++)
+          if (! fine->mask[i * fine->width + j])
+            coarse->mask[(i / 2) * coarse->width + (j / 2)] = FALSE;
+    }
+
+  for (cycle = 0; cycle < MAX_ITER; cycle++)
+    {
+      gimp_heal_multigrid_vcycle (grids, 0, n_levels);
+
+      if (gimp_heal_multigrid_residual (&grids[0]) < EPSILON * EPSILON)
+        break;
+    }
+
+  g_free (grids[0].r);
+
+  for (level = 1; level < n_levels; level++)
+    {
+      g_free (grids[level].x);
+      g_free (grids[level].b);
+      g_free (grids[level].r);
+      g_free (grids[level].mask);
+    }
+
+  return MIN (cycle + 1, MAX_ITER);
+}
+
+typedef struct
+{
+  gfloat       *planes;
+  gint          height;
+  gint          width;
+  gint          depth;
+  const guchar *mask;
+  gboolean      multigrid;
+  gint          iterations[4];
+} GimpHealChannelData;
+
+static void
+gimp_heal_laplace_channels (gint                 i,
+                            gint                 n,
+                            GimpHealChannelData *data)
+{
+  gint size = data->width * data->height + 1;
+  gint k;
+
+  for (k = i; k < data->depth; k += n)
+    {
+      gfloat *plane = data->planes + k * size;
+
+      if (data->multigrid)
+        data->iterations[k] = gimp_heal_laplace_multigrid (plane,
+                                                           data->height,
+                                                           data->width,
+                                                           data->mask);
+      else
+        data->iterations[k] = gimp_heal_laplace_sor (plane,
+                                                     data->height, 1,
+                                                     data->width,
+                                                     data->mask);
+    }
+}
+
+/**
+ * gimp_heal_laplace_loop:
+ * @pixels:    @width x @height pixels of @depth floats, plus one
+ *             scratch pixel, 16-byte aligned
+ * @height:    the height of @pixels
+ * @depth:     the number of components per pixel, at most 4
+ * @width:     the width of @pixels
+ * @mask:      the unknown pixels, all other pixels are Dirichlet
+ *             conditions
+ * @multigrid: whether to use multi-grid V-cycles instead of plain SOR
+ *
+ * Solves the laplace equation for the masked pixels and stores the
+ * result in-place. The components are solved concurrently when using
+ * multi-grid, or when there are enough threads.
+ *
+ * Returns: the largest number of SOR iterations, or V-cycles, used.
+ **/
+gint
+gimp_heal_laplace_loop (gfloat       *pixels,
+                        gint          height,
+                        gint          depth,
+                        gint          width,
+                        const guchar *mask,
+                        gboolean      multigrid)
+{
+  gint n_pixels = width * height;
+  gint iterations;
+
+  g_return_val_if_fail (depth >= 1 && depth <= 4, 0);
+
+  if (depth == 1)
+    {
+      if (multigrid)
+        iterations = gimp_heal_laplace_multigrid (pixels, height,
+                                                  width, mask);
+      else
+        iterations = gimp_heal_laplace_sor (pixels, height, 1,
+                                            width, mask);
+    }
+  else if (multigrid || gimp_parallel_get_n_threads () >= depth)
+    {
+      GimpHealChannelData data;
+      gint                size = n_pixels + 1;
+      gint                i, k;
+
+      data.planes    = gegl_malloc (sizeof (gfloat) * depth * size);
+      data.height    = height;
+      data.width     = width;
+      data.depth     = depth;
+      data.mask      = mask;
+      data.multigrid = multigrid;
+
+      for (i = 0; i < n_pixels; i++)
+        for (k = 0; k < depth; k++)
+          data.planes[k * size + i] = pixels[i * depth + k];
+
+      gimp_parallel_distribute (depth,
+                                (GimpParallelDistributeFunc)
+                                gimp_heal_laplace_channels,
+                                &data);
+
+      for (i = 0; i < n_pixels; i++)
+        for (k = 0; k < depth; k++)
+          pixels[i * depth + k] = data.planes[k * size + i];
+
+      gegl_free (data.planes);
+
+      iterations = 0;
+
+      for (k = 0; k < depth; k++)
+        iterations = MAX (iterations, data.iterations[k]);
+    }
+  else
+    {
+      /* the interleaved SOR loop is vectorized over the components */
+      iterations = gimp_heal_laplace_sor (pixels, height, depth,
+                                          width, mask);
+    }
+
+  return iterations;
 }
 
 /* Original Algorithm Design:
@@ -436,7 +805,8 @@ gimp_heal (GeglBuffer          *src_buffer,
   gegl_buffer_get (mask_buffer, mask_rect, 1.0, babl_format ("Y u8"),
                    mask, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-  gimp_heal_laplace_loop (diff, height, src_components, width, mask);
+  gimp_heal_laplace_loop (diff, height, src_components, width, mask,
+                          width * height >= MULTIGRID_MIN_AREA);
 
   g_free (mask);
 
@@ -512,10 +882,11 @@ gimp_heal_motion (GimpSourceCore   *source_core,
     }
 
   /* Should heal work in perceptual space? */
-  src_copy = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
-                                              src_rect->width,
-                                              src_rect->height),
-                              babl_format ("RGBA float"));
+  src_copy = gimp_paint_core_get_scratch_buffer (paint_core,
+                                                 GIMP_PAINT_CORE_SCRATCH_SOURCE,
+                                                 src_rect->width,
+                                                 src_rect->height,
+                                                 babl_format ("RGBA float"));
 
   gegl_buffer_copy (src_buffer, src_rect, GEGL_ABYSS_NONE,
                     src_copy,
@@ -534,7 +905,9 @@ gimp_heal_motion (GimpSourceCore   *source_core,
                                     paint_area_width,
                                     paint_area_height));
 
-  mask_buffer = gimp_temp_buf_create_buffer ((GimpTempBuf *) mask_buf);
+  mask_buffer = gimp_paint_core_get_scratch_temp_buf (paint_core,
+                                                      GIMP_PAINT_CORE_SCRATCH_MASK,
+                                                      mask_buf);
 
   /* find the offset of the brush mask's rect */
   {
@@ -580,9 +953,6 @@ gimp_heal_motion (GimpSourceCore   *source_core,
                              paint_area_width,
                              paint_area_height));
 
-  g_object_unref (src_copy);
-  g_object_unref (mask_buffer);
-
   /* replace the canvas with our healed data */
   gimp_brush_core_replace_canvas (GIMP_BRUSH_CORE (paint_core), drawable,
                                   coords,
@@ -48,5 +48,12 @@ void    gimp_heal_register (Gimp                      *gimp,
 
 GType   gimp_heal_get_type (void) G_GNUC_CONST;
 
+gint    gimp_heal_laplace_loop (gfloat                    *pixels,
+                                gint                       height,
+                                gint                       depth,
+                                gint                       width,
+                                const guchar              *mask,
+                                gboolean                   multigrid);
+
 
 #endif  /*  __GIMP_HEAL_H__  */
@@ -36,7 +36,6 @@
 #include "core/gimpimage-undo.h"
 #include "core/gimppickable.h"
 #include "core/gimpsymmetry.h"
-#include "core/gimptempbuf.h"
 
 #include "gimpinkoptions.h"
 #include "gimpink.h"
@@ -256,8 +255,8 @@ gimp_ink_get_paint_buffer (GimpPaintCore    *paint_core,
   /*  configure the canvas buffer  */
   if ((x2 - x1) && (y2 - y1))
     {
-      GimpTempBuf *temp_buf;
-      const Babl  *format;
+      GeglBuffer *buffer;
+      const Babl *format;
 
 //        format = babl_format ("RGBA float");
       format = gimp_layer_mode_get_format (paint_mode,
@@ -265,18 +264,21 @@ gimp_ink_get_paint_buffer (GimpPaintCore    *paint_core,
                                            GIMP_LAYER_COLOR_SPACE_AUTO,
                                            NULL);
 
-      temp_buf = gimp_temp_buf_new ((x2 - x1), (y2 - y1),
-                                    format);
+      buffer = gimp_paint_core_get_scratch_buffer (paint_core,
+                                                   GIMP_PAINT_CORE_SCRATCH_PAINT,
+                                                   (x2 - x1), (y2 - y1),
+                                                   format);
 
       *paint_buffer_x = x1;
       *paint_buffer_y = y1;
 
-      if (paint_core->paint_buffer)
-        g_object_unref (paint_core->paint_buffer);
-
-      paint_core->paint_buffer = gimp_temp_buf_create_buffer (temp_buf);
+      if (paint_core->paint_buffer != buffer)
+        {
+          if (paint_core->paint_buffer)
+            g_object_unref (paint_core->paint_buffer);
 
-      gimp_temp_buf_unref (temp_buf);
+          paint_core->paint_buffer = g_object_ref (buffer);
+        }
 
       return paint_core->paint_buffer;
     }
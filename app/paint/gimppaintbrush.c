@@ -31,6 +31,7 @@
 
 #include "core/gimp.h"
 #include "core/gimp-palettes.h"
+#include "core/gimp-parallel.h"
 #include "core/gimpbrush.h"
 #include "core/gimpdrawable.h"
 #include "core/gimpdynamics.h"
@@ -147,6 +148,8 @@ _gimp_paintbrush_motion (GimpPaintCore    *paint_core,
   gdouble                   force;
   const GimpCoords         *coords;
   GeglNode                 *op;
+  GimpPaintCoreDab         *dabs   = NULL;
+  gint                      n_dabs = 0;
   gint                      n_strokes;
   gint                      i;
 
@@ -185,6 +188,17 @@ _gimp_paintbrush_motion (GimpPaintCore    *paint_core,
   paint_mode = gimp_context_get_paint_mode (context);
 
   n_strokes = gimp_symmetry_get_size (sym);
+
+  /*  collect the symmetric dabs and paste them at once, so the ones
+   *  which don't overlap can be pasted in parallel
+   */
+  if (n_strokes > 1               &&
+      ! paint_core->applicator    &&
+      gimp_parallel_get_n_threads () > 1)
+    {
+      dabs = g_new0 (GimpPaintCoreDab, n_strokes);
+    }
+
   for (i = 0; i < n_strokes; i++)
     {
       gint paint_width, paint_height;
@@ -263,14 +277,40 @@ _gimp_paintbrush_motion (GimpPaintCore    *paint_core,
       else
         force = paint_options->brush_force;
 
-      /* finally, let the brush core paste the colored area on the canvas */
-      gimp_brush_core_paste_canvas (brush_core, drawable,
-                                    coords,
-                                    MIN (opacity, GIMP_OPACITY_OPAQUE),
-                                    gimp_context_get_opacity (context),
-                                    paint_mode,
-                                    gimp_paint_options_get_brush_mode (paint_options),
-                                    force,
-                                    paint_appl_mode, op);
+      if (dabs)
+        {
+          if (gimp_brush_core_get_dab (brush_core,
+                                       coords,
+                                       MIN (opacity, GIMP_OPACITY_OPAQUE),
+                                       gimp_paint_options_get_brush_mode (paint_options),
+                                       force,
+                                       paint_appl_mode, op,
+                                       GIMP_PAINT_CORE_SCRATCH_LAST + 2 * i,
+                                       &dabs[n_dabs]))
+            {
+              n_dabs++;
+            }
+        }
+      else
+        {
+          /* finally, let the brush core paste the colored area on the canvas */
+          gimp_brush_core_paste_canvas (brush_core, drawable,
+                                        coords,
+                                        MIN (opacity, GIMP_OPACITY_OPAQUE),
+                                        gimp_context_get_opacity (context),
+                                        paint_mode,
+                                        gimp_paint_options_get_brush_mode (paint_options),
+                                        force,
+                                        paint_appl_mode, op);
+        }
+    }
+
+  if (dabs)
+    {
+      gimp_paint_core_paste_dabs (paint_core, dabs, n_dabs, drawable,
+                                  gimp_context_get_opacity (context),
+                                  paint_mode);
+
+      g_free (dabs);
     }
 }
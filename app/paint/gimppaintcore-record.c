@@ -0,0 +1,464 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpconfig/gimpconfig.h"
+
+#include "paint-types.h"
+
+#include "core/gimp.h"
+#include "core/gimpcontainer.h"
+#include "core/gimpcontext.h"
+#include "core/gimpdrawable.h"
+#include "core/gimppaintinfo.h"
+
+#include "gimppaintcore.h"
+#include "gimppaintcore-record.h"
+#include "gimppaintoptions.h"
+
+#include "gimp-intl.h"
+
+
+/*  A recorded stroke is the stream of coordinates a paint tool passed
+ *  to gimp_paint_core_interpolate(), together with a copy of the paint
+ *  options at the start of the stroke. It is saved in the usual GIMP
+ *  config syntax:
+ *
+ *    (paint-info "gimp-paintbrush")
+ *    (options ...)
+ *    (event x y pressure xtilt ytilt wheel velocity direction
+ *           xscale yscale extended time)
+ *    ...
+ *
+ *  and can be replayed headless through any paint core, which is what
+ *  the paint benchmark in app/tests does.
+ */
+
+
+enum
+{
+  PAINT_INFO = 1,
+  OPTIONS,
+  EVENT
+};
+
+
+static gboolean   gimp_paint_core_record_parse_double (GScanner            *scanner,
+                                                       gdouble             *dest);
+static GTokenType gimp_paint_core_record_parse_event  (GScanner            *scanner,
+                                                       GimpPaintCoreRecord *record);
+
+
+/*  public functions  */
+
+GimpPaintCoreRecord *
+gimp_paint_core_record_new (GimpPaintOptions *paint_options)
+{
+  GimpPaintCoreRecord *record;
+  GimpContextPropMask  serialize_props;
+
+  g_return_val_if_fail (paint_options == NULL ||
+                        GIMP_IS_PAINT_OPTIONS (paint_options), NULL);
+
+  record = g_slice_new0 (GimpPaintCoreRecord);
+
+  record->events = g_array_new (FALSE, FALSE,
+                                sizeof (GimpPaintCoreRecordEvent));
+
+  if (paint_options)
+    {
+      record->paint_options =
+        GIMP_PAINT_OPTIONS (gimp_config_duplicate (GIMP_CONFIG (paint_options)));
+
+      /*  the brush, dynamics and colors are part of the stroke  */
+      serialize_props =
+        gimp_context_get_serialize_properties (GIMP_CONTEXT (record->paint_options));
+
+      gimp_context_set_serialize_properties (GIMP_CONTEXT (record->paint_options),
+                                             serialize_props              |
+                                             GIMP_CONTEXT_PROP_MASK_PAINT |
+                                             GIMP_CONTEXT_PROP_MASK_MYBRUSH);
+    }
+
+  return record;
+}
+
+void
+gimp_paint_core_record_free (GimpPaintCoreRecord *record)
+{
+  g_return_if_fail (record != NULL);
+
+  if (record->paint_options)
+    g_object_unref (record->paint_options);
+
+  g_array_free (record->events, TRUE);
+
+  g_slice_free (GimpPaintCoreRecord, record);
+}
+
+void
+gimp_paint_core_record_add_event (GimpPaintCoreRecord *record,
+                                  const GimpCoords    *coords,
+                                  guint32              time)
+{
+  GimpPaintCoreRecordEvent event;
+
+  g_return_if_fail (record != NULL);
+  g_return_if_fail (coords != NULL);
+
+  event.coords = *coords;
+  event.time   = time;
+
+  g_array_append_val (record->events, event);
+}
+
+gboolean
+gimp_paint_core_record_save (GimpPaintCoreRecord  *record,
+                             GFile                *file,
+                             GError              **error)
+{
+  GimpConfigWriter *writer;
+  gint              i;
+
+  g_return_val_if_fail (record != NULL, FALSE);
+  g_return_val_if_fail (record->paint_options != NULL, FALSE);
+  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  writer = gimp_config_writer_new_gfile (file, TRUE,
+                                         "GIMP paint stroke\n\n"
+                                         "This file can be replayed by the "
+                                         "paint core benchmark.",
+                                         error);
+  if (! writer)
+    return FALSE;
+
+  gimp_config_writer_open (writer, "paint-info");
+  gimp_config_writer_string (writer,
+                             gimp_object_get_name (record->paint_options->paint_info));
+  gimp_config_writer_close (writer);
+
+  gimp_config_writer_open (writer, "options");
+  gimp_config_serialize (GIMP_CONFIG (record->paint_options), writer, NULL);
+  gimp_config_writer_close (writer);
+
+  gimp_config_writer_linefeed (writer);
+
+  for (i = 0; i < record->events->len; i++)
+    {
+      const GimpPaintCoreRecordEvent *event;
+      gchar                           buf[10][G_ASCII_DTOSTR_BUF_SIZE];
+
+      event = &g_array_index (record->events, GimpPaintCoreRecordEvent, i);
+
+      g_ascii_formatd (buf[0], G_ASCII_DTOSTR_BUF_SIZE, "%f", event->coords.x);
+      g_ascii_formatd (buf[1], G_ASCII_DTOSTR_BUF_SIZE, "%f", event->coords.y);
+      g_ascii_formatd (buf[2], G_ASCII_DTOSTR_BUF_SIZE, "%f", event->coords.pressure);
+      g_ascii_formatd (buf[3], G_ASCII_DTOSTR_BUF_SIZE, "%f", event->coords.xtilt);
+      g_ascii_formatd (buf[4], G_ASCII_DTOSTR_BUF_SIZE, "%f", event->coords.ytilt);
+      g_ascii_formatd (buf[5], G_ASCII_DTOSTR_BUF_SIZE, "%f", event->coords.wheel);
+      g_ascii_formatd (buf[6], G_ASCII_DTOSTR_BUF_SIZE, "%f", event->coords.velocity);
+      g_ascii_formatd (buf[7], G_ASCII_DTOSTR_BUF_SIZE, "%f", event->coords.direction);
+      g_ascii_formatd (buf[8], G_ASCII_DTOSTR_BUF_SIZE, "%f", event->coords.xscale);
+      g_ascii_formatd (buf[9], G_ASCII_DTOSTR_BUF_SIZE, "%f", event->coords.yscale);
+
+      gimp_config_writer_open (writer, "event");
+      gimp_config_writer_printf (writer, "%s %s %s %s %s %s %s %s %s %s %s %u",
+                                 buf[0], buf[1], buf[2], buf[3], buf[4],
+                                 buf[5], buf[6], buf[7], buf[8], buf[9],
+                                 event->coords.extended ? "yes" : "no",
+                                 event->time);
+      gimp_config_writer_close (writer);
+    }
+
+  return gimp_config_writer_finish (writer, "end of paint stroke", error);
+}
+
+GimpPaintCoreRecord *
+gimp_paint_core_record_load (Gimp    *gimp,
+                             GFile   *file,
+                             GError **error)
+{
+  GimpPaintCoreRecord *record;
+  GScanner            *scanner;
+  GTokenType           token;
+  GError              *my_error = NULL;
+
+  g_return_val_if_fail (GIMP_IS_GIMP (gimp), NULL);
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  scanner = gimp_scanner_new_gfile (file, &my_error);
+
+  if (! scanner)
+    {
+      g_propagate_error (error, my_error);
+      return NULL;
+    }
+
+  record = gimp_paint_core_record_new (NULL);
+
+  g_scanner_scope_add_symbol (scanner, 0, "paint-info",
+                              GINT_TO_POINTER (PAINT_INFO));
+  g_scanner_scope_add_symbol (scanner, 0, "options",
+                              GINT_TO_POINTER (OPTIONS));
+  g_scanner_scope_add_symbol (scanner, 0, "event",
+                              GINT_TO_POINTER (EVENT));
+
+  token = G_TOKEN_LEFT_PAREN;
+
+  while (g_scanner_peek_next_token (scanner) == token)
+    {
+      token = g_scanner_get_next_token (scanner);
+
+      switch (token)
+        {
+        case G_TOKEN_LEFT_PAREN:
+          token = G_TOKEN_SYMBOL;
+          break;
+
+        case G_TOKEN_SYMBOL:
+          if (scanner->value.v_symbol == GINT_TO_POINTER (PAINT_INFO))
+            {
+              GimpPaintInfo *paint_info;
+              gchar         *name;
+
+              token = G_TOKEN_STRING;
+
+              if (! gimp_scanner_parse_string (scanner, &name))
+                break;
+
+              paint_info = (GimpPaintInfo *)
+                gimp_container_get_child_by_name (gimp->paint_info_list, name);
+
+              if (! paint_info)
+                {
+                  g_scanner_error (scanner,
+                                   _("Unknown paint method '%s'"), name);
+                  g_free (name);
+                  token = G_TOKEN_LEFT_PAREN;
+                  goto error;
+                }
+
+              g_free (name);
+
+              if (record->paint_options)
+                g_object_unref (record->paint_options);
+
+              record->paint_options = gimp_paint_options_new (paint_info);
+            }
+          else if (scanner->value.v_symbol == GINT_TO_POINTER (OPTIONS))
+            {
+              if (! record->paint_options)
+                {
+                  token = G_TOKEN_SYMBOL;
+                  goto error;
+                }
+
+              if (! gimp_config_deserialize (GIMP_CONFIG (record->paint_options),
+                                             scanner, 1, NULL))
+                {
+                  /*  gimp_config_deserialize() already set an error  */
+                  token = G_TOKEN_LEFT_PAREN;
+                  goto error;
+                }
+            }
+          else if (scanner->value.v_symbol == GINT_TO_POINTER (EVENT))
+            {
+              token = gimp_paint_core_record_parse_event (scanner, record);
+
+              if (token != G_TOKEN_NONE)
+                break;
+            }
+          token = G_TOKEN_RIGHT_PAREN;
+          break;
+
+        case G_TOKEN_RIGHT_PAREN:
+          token = G_TOKEN_LEFT_PAREN;
+          break;
+
+        default: /* do nothing */
+          break;
+        }
+    }
+
+ error:
+
+  if (token != G_TOKEN_LEFT_PAREN)
+    {
+      g_scanner_get_next_token (scanner);
+      g_scanner_unexp_token (scanner, token, NULL, NULL, NULL,
+                             _("fatal parse error"), TRUE);
+    }
+
+  gimp_scanner_destroy (scanner);
+
+  if (my_error)
+    {
+      g_propagate_error (error, my_error);
+      gimp_paint_core_record_free (record);
+
+      return NULL;
+    }
+
+  if (! record->paint_options || record->events->len == 0)
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_PARSE,
+                   _("'%s' does not contain a paint stroke"),
+                   gimp_file_get_utf8_name (file));
+
+      gimp_paint_core_record_free (record);
+
+      return NULL;
+    }
+
+  return record;
+}
+
+/**
+ * gimp_paint_core_record_replay:
+ * @record:        a #GimpPaintCoreRecord
+ * @core:          the #GimpPaintCore to paint with
+ * @drawable:      the #GimpDrawable to paint on
+ * @paint_options: the options to use, or %NULL to use the recorded ones
+ * @push_undo:     whether to push an undo step
+ * @error:         return location for an error
+ *
+ * Replays @record the same way #GimpPaintTool paints a stroke: the
+ * first event starts the stroke and all following events are
+ * interpolated, with their original time stamps. Like
+ * gimp_paint_core_stroke(), the core is cleaned up afterwards.
+ *
+ * Return value: %TRUE if the stroke could be started.
+ **/
+gboolean
+gimp_paint_core_record_replay (GimpPaintCoreRecord  *record,
+                               GimpPaintCore        *core,
+                               GimpDrawable         *drawable,
+                               GimpPaintOptions     *paint_options,
+                               gboolean              push_undo,
+                               GError              **error)
+{
+  const GimpPaintCoreRecordEvent *event;
+  gint                            i;
+
+  g_return_val_if_fail (record != NULL, FALSE);
+  g_return_val_if_fail (record->events->len > 0, FALSE);
+  g_return_val_if_fail (GIMP_IS_PAINT_CORE (core), FALSE);
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), FALSE);
+  g_return_val_if_fail (paint_options == NULL ||
+                        GIMP_IS_PAINT_OPTIONS (paint_options), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (! paint_options)
+    paint_options = record->paint_options;
+
+  event = &g_array_index (record->events, GimpPaintCoreRecordEvent, 0);
+
+  if (! gimp_paint_core_start (core, drawable, paint_options,
+                               &event->coords, error))
+    return FALSE;
+
+  core->last_coords = core->cur_coords;
+
+  gimp_paint_core_paint (core, drawable, paint_options,
+                         GIMP_PAINT_STATE_INIT, event->time);
+
+  gimp_paint_core_paint (core, drawable, paint_options,
+                         GIMP_PAINT_STATE_MOTION, event->time);
+
+  for (i = 1; i < record->events->len; i++)
+    {
+      event = &g_array_index (record->events, GimpPaintCoreRecordEvent, i);
+
+      gimp_paint_core_interpolate (core, drawable, paint_options,
+                                   &event->coords, event->time);
+    }
+
+  gimp_paint_core_paint (core, drawable, paint_options,
+                         GIMP_PAINT_STATE_FINISH, event->time);
+
+  gimp_paint_core_finish (core, drawable, push_undo);
+
+  gimp_paint_core_cleanup (core);
+
+  return TRUE;
+}
+
+
+/*  private functions  */
+
+static gboolean
+gimp_paint_core_record_parse_double (GScanner *scanner,
+                                     gdouble  *dest)
+{
+  gboolean negate = FALSE;
+
+  if (g_scanner_peek_next_token (scanner) == '-')
+    {
+      negate = TRUE;
+      g_scanner_get_next_token (scanner);
+    }
+
+  if (! gimp_scanner_parse_float (scanner, dest))
+    return FALSE;
+
+  if (negate)
+    *dest = -*dest;
+
+  return TRUE;
+}
+
+static GTokenType
+gimp_paint_core_record_parse_event (GScanner            *scanner,
+                                    GimpPaintCoreRecord *record)
+{
+  GimpCoords  coords;
+  gdouble    *values[] = { &coords.x,
+                           &coords.y,
+                           &coords.pressure,
+                           &coords.xtilt,
+                           &coords.ytilt,
+                           &coords.wheel,
+                           &coords.velocity,
+                           &coords.direction,
+                           &coords.xscale,
+                           &coords.yscale };
+  gint64      time;
+  gint        i;
+
+  for (i = 0; i < G_N_ELEMENTS (values); i++)
+    {
+      if (! gimp_paint_core_record_parse_double (scanner, values[i]))
+        return G_TOKEN_FLOAT;
+    }
+
+  if (! gimp_scanner_parse_boolean (scanner, &coords.extended))
+    return G_TOKEN_IDENTIFIER;
+
+  if (! gimp_scanner_parse_int64 (scanner, &time))
+    return G_TOKEN_INT;
+
+  gimp_paint_core_record_add_event (record, &coords, (guint32) time);
+
+  return G_TOKEN_NONE;
+}
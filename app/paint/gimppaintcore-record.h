@@ -0,0 +1,59 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_PAINT_CORE_RECORD_H__
+#define __GIMP_PAINT_CORE_RECORD_H__
+
+
+typedef struct _GimpPaintCoreRecordEvent GimpPaintCoreRecordEvent;
+
+struct _GimpPaintCoreRecordEvent
+{
+  GimpCoords  coords;
+  guint32     time;
+};
+
+struct _GimpPaintCoreRecord
+{
+  GimpPaintOptions *paint_options;  /*  a copy of the options at stroke start  */
+  GArray           *events;         /*  GimpPaintCoreRecordEvent               */
+};
+
+
+GimpPaintCoreRecord * gimp_paint_core_record_new       (GimpPaintOptions     *paint_options);
+void                  gimp_paint_core_record_free      (GimpPaintCoreRecord  *record);
+
+void                  gimp_paint_core_record_add_event (GimpPaintCoreRecord  *record,
+                                                        const GimpCoords     *coords,
+                                                        guint32               time);
+
+gboolean              gimp_paint_core_record_save      (GimpPaintCoreRecord  *record,
+                                                        GFile                *file,
+                                                        GError              **error);
+GimpPaintCoreRecord * gimp_paint_core_record_load      (Gimp                 *gimp,
+                                                        GFile                *file,
+                                                        GError              **error);
+
+gboolean              gimp_paint_core_record_replay    (GimpPaintCoreRecord  *record,
+                                                        GimpPaintCore        *core,
+                                                        GimpDrawable         *drawable,
+                                                        GimpPaintOptions     *paint_options,
+                                                        gboolean              push_undo,
+                                                        GError              **error);
+
+
+#endif  /*  __GIMP_PAINT_CORE_RECORD_H__  */
@@ -36,6 +36,7 @@
 #include "gegl/gimpapplicator.h"
 
 #include "core/gimp.h"
+#include "core/gimp-parallel.h"
 #include "core/gimp-utils.h"
 #include "core/gimpchannel.h"
 #include "core/gimpimage.h"
@@ -66,6 +67,24 @@ enum
 };
 
 
+typedef struct
+{
+  GimpPaintCore          *core;
+  const GimpPaintCoreDab *dabs;
+  const gint             *dab_indices;
+  gint                    n_dab_indices;
+  GimpDrawable           *drawable;
+  gdouble                 image_opacity;
+  GimpLayerMode           paint_mode;
+} GimpPaintCorePasteData;
+
+typedef struct
+{
+  GimpTempBuf *store;   /*  the slot's memory, allocated once per stroke  */
+  GeglBuffer  *buffer;  /*  the buffer last handed out from it            */
+} GimpPaintCoreScratchSlot;
+
+
 /*  local function prototypes  */
 
 static void      gimp_paint_core_finalize            (GObject          *object);
@@ -117,6 +136,39 @@ static GimpUndo* gimp_paint_core_real_push_undo      (GimpPaintCore    *core,
                                                       GimpImage        *image,
                                                       const gchar      *undo_desc);
 
+static void      gimp_paint_core_paste_buffer        (GimpPaintCore    *core,
+                                                      GeglBuffer       *paint_buffer,
+                                                      gint              paint_buffer_x,
+                                                      gint              paint_buffer_y,
+                                                      const GimpTempBuf *paint_mask,
+                                                      gint              paint_mask_offset_x,
+                                                      gint              paint_mask_offset_y,
+                                                      GimpDrawable     *drawable,
+                                                      gdouble           paint_opacity,
+                                                      gdouble           image_opacity,
+                                                      GimpLayerMode     paint_mode,
+                                                      GimpPaintApplicationMode mode);
+static void      gimp_paint_core_paste_update        (GimpPaintCore    *core,
+                                                      GimpDrawable     *drawable,
+                                                      gint              x,
+                                                      gint              y,
+                                                      gint              width,
+                                                      gint              height);
+static void      gimp_paint_core_paste_dab           (GimpPaintCore    *core,
+                                                      const GimpPaintCoreDab *dab,
+                                                      GimpDrawable     *drawable,
+                                                      gdouble           image_opacity,
+                                                      GimpLayerMode     paint_mode);
+static void      gimp_paint_core_paste_dabs_func     (gint              i,
+                                                      gint              n,
+                                                      gpointer          user_data);
+static gboolean  gimp_paint_core_dabs_share_tiles    (GimpPaintCore    *core,
+                                                      GimpDrawable     *drawable,
+                                                      const GimpPaintCoreDab *dab1,
+                                                      const GimpPaintCoreDab *dab2);
+
+static void      gimp_paint_core_scratch_slot_free   (GimpPaintCoreScratchSlot *slot);
+
 
 G_DEFINE_TYPE (GimpPaintCore, gimp_paint_core, GIMP_TYPE_OBJECT)
 
@@ -327,6 +379,8 @@ gimp_paint_core_paint (GimpPaintCore    *core,
           /* Save coordinates for gimp_paint_core_interpolate() */
           core->last_paint.x = core->cur_coords.x;
           core->last_paint.y = core->cur_coords.y;
+
+          core->n_dabs++;
         }
 
       sym = g_object_ref (gimp_image_get_active_symmetry (image));
@@ -555,14 +609,8 @@ gimp_paint_core_finish (GimpPaintCore *core,
 
       GIMP_PAINT_CORE_GET_CLASS (core)->push_undo (core, image, NULL);
 
-      buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, width, height),
-                                gimp_drawable_get_format (drawable));
-
-      gegl_buffer_copy (core->undo_buffer,
-                        GEGL_RECTANGLE (x, y, width, height),
-                        GEGL_ABYSS_NONE,
-                        buffer,
-                        GEGL_RECTANGLE (0, 0, 0, 0));
+      buffer = gimp_gegl_buffer_dup_area (core->undo_buffer,
+                                          GEGL_RECTANGLE (x, y, width, height));
 
       gimp_drawable_push_undo (drawable, NULL,
                                buffer, x, y, width, height);
@@ -658,6 +706,11 @@ gimp_paint_core_cleanup (GimpPaintCore *core)
       g_object_unref (core->paint_buffer);
       core->paint_buffer = NULL;
     }
+
+  gimp_paint_core_free_scratch_buffers (core);
+
+  core->scratch_width  = 0;
+  core->scratch_height = 0;
 }
 
 void
@@ -795,6 +848,167 @@ gimp_paint_core_get_paint_buffer (GimpPaintCore    *core,
   return paint_buffer;
 }
 
+/**
+ * gimp_paint_core_reserve_scratch:
+ * @core:   the #GimpPaintCore
+ * @width:  the largest width the stroke will ask for
+ * @height: the largest height the stroke will ask for
+ *
+ * Tells @core how large its scratch buffers can get during the
+ * current stroke, usually the largest dab the brush size and dynamics
+ * allow, so that gimp_paint_core_get_scratch_buffer() allocates each
+ * slot only once, instead of whenever a dab is larger than the ones
+ * before it. The reservation lasts until gimp_paint_core_cleanup().
+ **/
+void
+gimp_paint_core_reserve_scratch (GimpPaintCore *core,
+                                 gint           width,
+                                 gint           height)
+{
+  g_return_if_fail (GIMP_IS_PAINT_CORE (core));
+
+  core->scratch_width  = MAX (core->scratch_width,  width);
+  core->scratch_height = MAX (core->scratch_height, height);
+}
+
+/**
+ * gimp_paint_core_get_scratch_buffer:
+ * @core:   the #GimpPaintCore
+ * @slot:   a #GimpPaintCoreScratch slot, or a subclass slot
+ * @width:  the width of the buffer
+ * @height: the height of the buffer
+ * @format: the format of the buffer
+ *
+ * Returns a linear buffer of the requested size and format which is
+ * owned by @core and stays around until gimp_paint_core_cleanup(), so
+ * the per-dab code paths don't have to allocate a buffer for every
+ * dab. The memory of a slot is allocated at the size reserved with
+ * gimp_paint_core_reserve_scratch(), and smaller buffers are laid
+ * out at its start; it is only allocated again if a buffer doesn't
+ * fit. The buffer's contents are undefined, and it shares its memory
+ * with the buffers returned for the same slot before.
+ *
+ * Return value: the scratch buffer of @slot, don't unref it.
+ **/
+GeglBuffer *
+gimp_paint_core_get_scratch_buffer (GimpPaintCore *core,
+                                    gint           slot,
+                                    gint           width,
+                                    gint           height,
+                                    const Babl    *format)
+{
+  GimpPaintCoreScratchSlot *scratch;
+  GimpTempBuf              *view;
+  gsize                     size;
+
+  g_return_val_if_fail (GIMP_IS_PAINT_CORE (core), NULL);
+  g_return_val_if_fail (slot >= 0, NULL);
+  g_return_val_if_fail (width > 0 && height > 0, NULL);
+  g_return_val_if_fail (format != NULL, NULL);
+
+  if (! core->scratch_buffers)
+    core->scratch_buffers =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) gimp_paint_core_scratch_slot_free);
+
+  if (slot >= core->scratch_buffers->len)
+    g_ptr_array_set_size (core->scratch_buffers, slot + 1);
+
+  scratch = g_ptr_array_index (core->scratch_buffers, slot);
+
+  if (! scratch)
+    {
+      scratch = g_slice_new0 (GimpPaintCoreScratchSlot);
+
+      g_ptr_array_index (core->scratch_buffers, slot) = scratch;
+    }
+
+  if (scratch->buffer                                    &&
+      gegl_buffer_get_width  (scratch->buffer) == width  &&
+      gegl_buffer_get_height (scratch->buffer) == height &&
+      gegl_buffer_get_format (scratch->buffer) == format)
+    {
+      return scratch->buffer;
+    }
+
+  size = (gsize) babl_format_get_bytes_per_pixel (format) * width * height;
+
+  if (! scratch->store ||
+      gimp_temp_buf_get_data_size (scratch->store) < size)
+    {
+      if (scratch->store)
+        gimp_temp_buf_unref (scratch->store);
+
+      scratch->store = gimp_temp_buf_new (MAX (width,  core->scratch_width),
+                                          MAX (height, core->scratch_height),
+                                          format);
+
+      core->n_scratch_allocs++;
+    }
+
+  /*  a new buffer, because the applicator nodes and the paint-core
+   *  loops expect a buffer's extent to be the size of its temp buf
+   */
+  view = gimp_temp_buf_new_view (scratch->store, width, height, format);
+
+  if (scratch->buffer)
+    g_object_unref (scratch->buffer);
+
+  scratch->buffer = gimp_temp_buf_create_buffer (view);
+  gimp_temp_buf_unref (view);
+
+  return scratch->buffer;
+}
+
+/**
+ * gimp_paint_core_get_scratch_temp_buf:
+ * @core:     the #GimpPaintCore
+ * @slot:     a #GimpPaintCoreScratch slot, or a subclass slot
+ * @temp_buf: a #GimpTempBuf
+ *
+ * Copies @temp_buf into the scratch buffer of @slot, for the places
+ * which used to wrap a temporary copy of a brush mask in a new
+ * buffer for every dab.
+ *
+ * Return value: the scratch buffer of @slot, don't unref it.
+ **/
+GeglBuffer *
+gimp_paint_core_get_scratch_temp_buf (GimpPaintCore     *core,
+                                      gint               slot,
+                                      const GimpTempBuf *temp_buf)
+{
+  GeglBuffer *buffer;
+  gint        width;
+  gint        height;
+
+  g_return_val_if_fail (GIMP_IS_PAINT_CORE (core), NULL);
+  g_return_val_if_fail (temp_buf != NULL, NULL);
+
+  width  = gimp_temp_buf_get_width  (temp_buf);
+  height = gimp_temp_buf_get_height (temp_buf);
+
+  buffer = gimp_paint_core_get_scratch_buffer (core, slot, width, height,
+                                               gimp_temp_buf_get_format (temp_buf));
+
+  gegl_buffer_set (buffer, GEGL_RECTANGLE (0, 0, width, height), 0,
+                   gimp_temp_buf_get_format (temp_buf),
+                   gimp_temp_buf_get_data (temp_buf),
+                   GEGL_AUTO_ROWSTRIDE);
+
+  return buffer;
+}
+
+void
+gimp_paint_core_free_scratch_buffers (GimpPaintCore *core)
+{
+  g_return_if_fail (GIMP_IS_PAINT_CORE (core));
+
+  if (core->scratch_buffers)
+    {
+      g_ptr_array_free (core->scratch_buffers, TRUE);
+      core->scratch_buffers = NULL;
+    }
+}
+
 GeglBuffer *
 gimp_paint_core_get_orig_image (GimpPaintCore *core)
 {
@@ -824,185 +1038,127 @@ gimp_paint_core_paste (GimpPaintCore            *core,
                        GimpLayerMode             paint_mode,
                        GimpPaintApplicationMode  mode)
 {
-  gint width  = gegl_buffer_get_width  (core->paint_buffer);
-  gint height = gegl_buffer_get_height (core->paint_buffer);
-
-  if (core->applicator)
-    {
-      /*  If the mode is CONSTANT:
-       *   combine the canvas buf, the paint mask to the canvas buffer
-       */
-      if (mode == GIMP_PAINT_CONSTANT)
-        {
-          /* Some tools (ink) paint the mask to paint_core->canvas_buffer
-           * directly. Don't need to copy it in this case.
-           */
-          if (paint_mask != NULL)
-            {
-              GimpTempBuf *modified_mask     = gimp_temp_buf_copy (paint_mask);
-              GeglBuffer  *paint_mask_buffer =
-                gimp_temp_buf_create_buffer ((GimpTempBuf *) modified_mask);
-
-              gimp_gegl_combine_mask_weird (paint_mask_buffer,
-                                            GEGL_RECTANGLE (paint_mask_offset_x,
-                                                            paint_mask_offset_y,
-                                                            width, height),
-                                            core->canvas_buffer,
-                                            GEGL_RECTANGLE (core->paint_buffer_x,
-                                                            core->paint_buffer_y,
-                                                            width, height),
-                                            paint_opacity,
-                                            GIMP_IS_AIRBRUSH (core));
-
-              g_object_unref (paint_mask_buffer);
-              gimp_temp_buf_unref (modified_mask);
-            }
-
-          gimp_gegl_apply_mask (core->canvas_buffer,
-                                GEGL_RECTANGLE (core->paint_buffer_x,
-                                                core->paint_buffer_y,
-                                                width, height),
+  gimp_paint_core_paste_buffer (core,
                                 core->paint_buffer,
-                                GEGL_RECTANGLE (0, 0, width, height),
-                                1.0);
-
-          gimp_applicator_set_src_buffer (core->applicator,
-                                          core->undo_buffer);
-        }
-      /*  Otherwise:
-       *   combine the canvas buf and the paint mask to the canvas buf
-       */
-      else
-        {
-          GeglBuffer *paint_mask_buffer =
-            gimp_temp_buf_create_buffer ((GimpTempBuf *) paint_mask);
-
-          gimp_gegl_apply_mask (paint_mask_buffer,
-                                GEGL_RECTANGLE (paint_mask_offset_x,
-                                                paint_mask_offset_y,
-                                                width, height),
-                                core->paint_buffer,
-                                GEGL_RECTANGLE (0, 0, width, height),
-                                paint_opacity);
+                                core->paint_buffer_x,
+                                core->paint_buffer_y,
+                                paint_mask,
+                                paint_mask_offset_x,
+                                paint_mask_offset_y,
+                                drawable,
+                                paint_opacity,
+                                image_opacity,
+                                paint_mode,
+                                mode);
 
-          g_object_unref (paint_mask_buffer);
+  gimp_paint_core_paste_update (core, drawable,
+                                core->paint_buffer_x,
+                                core->paint_buffer_y,
+                                gegl_buffer_get_width  (core->paint_buffer),
+                                gegl_buffer_get_height (core->paint_buffer));
+}
 
-          gimp_applicator_set_src_buffer (core->applicator,
-                                          gimp_drawable_get_buffer (drawable));
-        }
+/**
+ * gimp_paint_core_paste_dabs:
+ * @core:          the #GimpPaintCore
+ * @dabs:          the dabs to paste, in painting order
+ * @n_dabs:        the number of dabs
+ * @drawable:      the #GimpDrawable to paint on
+ * @image_opacity: the opacity to paste with
+ * @paint_mode:    the paint mode to paste with
+ *
+ * Pastes a number of dabs, like the symmetric copies of one brush
+ * stamp, each with its own paint buffer and mask. Dabs which touch
+ * disjoint tiles of the drawable and the canvas are pasted
+ * concurrently, dabs sharing a tile are pasted in the given order,
+ * so the result is the same as pasting them one by one.
+ **/
+void
+gimp_paint_core_paste_dabs (GimpPaintCore          *core,
+                            const GimpPaintCoreDab *dabs,
+                            gint                    n_dabs,
+                            GimpDrawable           *drawable,
+                            gdouble                 image_opacity,
+                            GimpLayerMode           paint_mode)
+{
+  GimpPaintCorePasteData  data;
+  gint                   *waves;
+  gint                   *wave_dabs;
+  gint                    n_waves = 0;
+  gint                    i, j;
 
-      gimp_applicator_set_apply_buffer (core->applicator,
-                                        core->paint_buffer);
-      gimp_applicator_set_apply_offset (core->applicator,
-                                        core->paint_buffer_x,
-                                        core->paint_buffer_y);
+  g_return_if_fail (GIMP_IS_PAINT_CORE (core));
+  g_return_if_fail (dabs != NULL || n_dabs == 0);
+  g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
 
-      gimp_applicator_set_opacity (core->applicator, image_opacity);
-      gimp_applicator_set_mode (core->applicator, paint_mode,
-                                GIMP_LAYER_COLOR_SPACE_AUTO,
-                                GIMP_LAYER_COLOR_SPACE_AUTO,
-                                gimp_layer_mode_get_paint_composite_mode (paint_mode));
+  data.core          = core;
+  data.dabs          = dabs;
+  data.drawable      = drawable;
+  data.image_opacity = image_opacity;
+  data.paint_mode    = paint_mode;
 
-      /*  apply the paint area to the image  */
-      gimp_applicator_blit (core->applicator,
-                            GEGL_RECTANGLE (core->paint_buffer_x,
-                                            core->paint_buffer_y,
-                                            width, height));
+  /*  the applicator's graph can only be used by one thread at a time  */
+  if (core->applicator || n_dabs < 2 || gimp_parallel_get_n_threads () < 2)
+    {
+      for (i = 0; i < n_dabs; i++)
+        gimp_paint_core_paste_dab (core, &dabs[i], drawable,
+                                   image_opacity, paint_mode);
     }
   else
     {
-      GimpTempBuf *paint_buf = gimp_gegl_buffer_get_temp_buf (core->paint_buffer);
-      GeglBuffer  *dest_buffer;
-      GeglBuffer  *src_buffer;
-
-      if (! paint_buf)
-        return;
-
-      if (core->comp_buffer)
-        dest_buffer = core->comp_buffer;
-      else
-        dest_buffer = gimp_drawable_get_buffer (drawable);
+      /*  put each dab into the first wave after all earlier dabs it
+       *  shares a tile with, the dabs of one wave can then be pasted
+       *  concurrently, and the waves one after the other
+       */
+      waves     = g_new (gint, n_dabs);
+      wave_dabs = g_new (gint, n_dabs);
 
-      if (mode == GIMP_PAINT_CONSTANT)
+      for (i = 0; i < n_dabs; i++)
         {
-          /* This step is skipped by the ink tool, which writes
-           * directly to canvas_buffer
-           */
-          if (paint_mask != NULL)
+          waves[i] = 0;
+
+          for (j = 0; j < i; j++)
             {
-              /* Mix paint mask and canvas_buffer */
-              combine_paint_mask_to_canvas_mask (paint_mask,
-                                                 paint_mask_offset_x,
-                                                 paint_mask_offset_y,
-                                                 core->canvas_buffer,
-                                                 core->paint_buffer_x,
-                                                 core->paint_buffer_y,
-                                                 paint_opacity,
-                                                 GIMP_IS_AIRBRUSH (core));
+              if (waves[j] >= waves[i] &&
+                  gimp_paint_core_dabs_share_tiles (core, drawable,
+                                                    &dabs[i], &dabs[j]))
+                {
+                  waves[i] = waves[j] + 1;
+                }
             }
 
-          /* Write canvas_buffer to paint_buf */
-          canvas_buffer_to_paint_buf_alpha (paint_buf,
-                                            core->canvas_buffer,
-                                            core->paint_buffer_x,
-                                            core->paint_buffer_y);
-
-          /* undo buf -> paint_buf -> dest_buffer */
-          src_buffer = core->undo_buffer;
+          n_waves = MAX (n_waves, waves[i] + 1);
         }
-      else
-        {
-          g_return_if_fail (paint_mask);
 
-          /* Write paint_mask to paint_buf, does not modify canvas_buffer */
-          paint_mask_to_paint_buffer (paint_mask,
-                                      paint_mask_offset_x,
-                                      paint_mask_offset_y,
-                                      paint_buf,
-                                      paint_opacity);
+      data.dab_indices = wave_dabs;
 
-          /* dest_buffer -> paint_buf -> dest_buffer */
-          if (core->comp_buffer)
-            src_buffer = gimp_drawable_get_buffer (drawable);
-          else
-            src_buffer = dest_buffer;
-        }
+      for (i = 0; i < n_waves; i++)
+        {
+          data.n_dab_indices = 0;
 
-      do_layer_blend (src_buffer,
-                      dest_buffer,
-                      paint_buf,
-                      core->mask_buffer,
-                      image_opacity,
-                      core->paint_buffer_x,
-                      core->paint_buffer_y,
-                      core->mask_x_offset,
-                      core->mask_y_offset,
-                      paint_mode);
+          for (j = 0; j < n_dabs; j++)
+            {
+              if (waves[j] == i)
+                wave_dabs[data.n_dab_indices++] = j;
+            }
 
-      if (core->comp_buffer)
-        {
-          mask_components_onto (src_buffer,
-                                core->comp_buffer,
-                                gimp_drawable_get_buffer (drawable),
-                                GEGL_RECTANGLE (core->paint_buffer_x,
-                                                core->paint_buffer_y,
-                                                width,
-                                                height),
-                                gimp_drawable_get_active_mask (drawable));
+          gimp_parallel_distribute (data.n_dab_indices,
+                                    gimp_paint_core_paste_dabs_func,
+                                    &data);
         }
-    }
 
-  /*  Update the undo extents  */
-  core->x1 = MIN (core->x1, core->paint_buffer_x);
-  core->y1 = MIN (core->y1, core->paint_buffer_y);
-  core->x2 = MAX (core->x2, core->paint_buffer_x + width);
-  core->y2 = MAX (core->y2, core->paint_buffer_y + height);
+      g_free (wave_dabs);
+      g_free (waves);
+    }
 
-  /*  Update the drawable  */
-  gimp_drawable_update (drawable,
-                        core->paint_buffer_x,
-                        core->paint_buffer_y,
-                        width, height);
+  for (i = 0; i < n_dabs; i++)
+    {
+      gimp_paint_core_paste_update (core, drawable,
+                                    dabs[i].paint_buffer_x,
+                                    dabs[i].paint_buffer_y,
+                                    gegl_buffer_get_width  (dabs[i].paint_buffer),
+                                    gegl_buffer_get_height (dabs[i].paint_buffer));
+    }
 }
 
 /* This works similarly to gimp_paint_core_paste. However, instead of
@@ -1053,7 +1209,9 @@ gimp_paint_core_replace (GimpPaintCore            *core,
       if (core->applicator)
         {
           paint_mask_buffer =
-            gimp_temp_buf_create_buffer ((GimpTempBuf *) paint_mask);
+            gimp_paint_core_get_scratch_temp_buf (core,
+                                                  GIMP_PAINT_CORE_SCRATCH_MASK,
+                                                  paint_mask);
 
           /* combine the paint mask and the canvas buffer */
           gimp_gegl_combine_mask_weird (paint_mask_buffer,
@@ -1066,8 +1224,6 @@ gimp_paint_core_replace (GimpPaintCore            *core,
                                                         width, height),
                                         paint_opacity,
                                         GIMP_IS_AIRBRUSH (core));
-
-          g_object_unref (paint_mask_buffer);
         }
       else
         {
@@ -1092,7 +1248,9 @@ gimp_paint_core_replace (GimpPaintCore            *core,
   else
     {
       paint_mask_buffer =
-        gimp_temp_buf_create_buffer ((GimpTempBuf *) paint_mask);
+        g_object_ref (gimp_paint_core_get_scratch_temp_buf (core,
+                                                            GIMP_PAINT_CORE_SCRATCH_MASK,
+                                                            paint_mask));
 
       mask_rect = *GEGL_RECTANGLE (paint_mask_offset_x,
                                    paint_mask_offset_y,
@@ -1189,3 +1347,316 @@ gimp_paint_core_smooth_coords (GimpPaintCore    *core,
         }
     }
 }
+
+
+/*  private functions  */
+
+static void
+gimp_paint_core_paste_buffer (GimpPaintCore            *core,
+                              GeglBuffer               *paint_buffer,
+                              gint                      paint_buffer_x,
+                              gint                      paint_buffer_y,
+                              const GimpTempBuf        *paint_mask,
+                              gint                      paint_mask_offset_x,
+                              gint                      paint_mask_offset_y,
+                              GimpDrawable             *drawable,
+                              gdouble                   paint_opacity,
+                              gdouble                   image_opacity,
+                              GimpLayerMode             paint_mode,
+                              GimpPaintApplicationMode  mode)
+{
+  gint width  = gegl_buffer_get_width  (paint_buffer);
+  gint height = gegl_buffer_get_height (paint_buffer);
+
+  if (core->applicator)
+    {
+      /*  If the mode is CONSTANT:
+       *   combine the canvas buf, the paint mask to the canvas buffer
+       */
+      if (mode == GIMP_PAINT_CONSTANT)
+        {
+          /* Some tools (ink) paint the mask to paint_core->canvas_buffer
+           * directly. Don't need to copy it in this case.
+           */
+          if (paint_mask != NULL)
+            {
+              GeglBuffer *paint_mask_buffer =
+                gimp_paint_core_get_scratch_temp_buf (core,
+                                                      GIMP_PAINT_CORE_SCRATCH_MASK,
+                                                      paint_mask);
+
+              gimp_gegl_combine_mask_weird (paint_mask_buffer,
+                                            GEGL_RECTANGLE (paint_mask_offset_x,
+                                                            paint_mask_offset_y,
+                                                            width, height),
+                                            core->canvas_buffer,
+                                            GEGL_RECTANGLE (paint_buffer_x,
+                                                            paint_buffer_y,
+                                                            width, height),
+                                            paint_opacity,
+                                            GIMP_IS_AIRBRUSH (core));
+            }
+
+          gimp_gegl_apply_mask (core->canvas_buffer,
+                                GEGL_RECTANGLE (paint_buffer_x,
+                                                paint_buffer_y,
+                                                width, height),
+                                paint_buffer,
+                                GEGL_RECTANGLE (0, 0, width, height),
+                                1.0);
+
+          gimp_applicator_set_src_buffer (core->applicator,
+                                          core->undo_buffer);
+        }
+      /*  Otherwise:
+       *   combine the canvas buf and the paint mask to the canvas buf
+       */
+      else
+        {
+          GeglBuffer *paint_mask_buffer =
+            gimp_paint_core_get_scratch_temp_buf (core,
+                                                  GIMP_PAINT_CORE_SCRATCH_MASK,
+                                                  paint_mask);
+
+          gimp_gegl_apply_mask (paint_mask_buffer,
+                                GEGL_RECTANGLE (paint_mask_offset_x,
+                                                paint_mask_offset_y,
+                                                width, height),
+                                paint_buffer,
+                                GEGL_RECTANGLE (0, 0, width, height),
+                                paint_opacity);
+
+          gimp_applicator_set_src_buffer (core->applicator,
+                                          gimp_drawable_get_buffer (drawable));
+        }
+
+      gimp_applicator_set_apply_buffer (core->applicator,
+                                        paint_buffer);
+      gimp_applicator_set_apply_offset (core->applicator,
+                                        paint_buffer_x,
+                                        paint_buffer_y);
+
+      gimp_applicator_set_opacity (core->applicator, image_opacity);
+      gimp_applicator_set_mode (core->applicator, paint_mode,
+                                GIMP_LAYER_COLOR_SPACE_AUTO,
+                                GIMP_LAYER_COLOR_SPACE_AUTO,
+                                gimp_layer_mode_get_paint_composite_mode (paint_mode));
+
+      /*  apply the paint area to the image  */
+      gimp_applicator_blit (core->applicator,
+                            GEGL_RECTANGLE (paint_buffer_x,
+                                            paint_buffer_y,
+                                            width, height));
+    }
+  else
+    {
+      GimpTempBuf *paint_buf = gimp_gegl_buffer_get_temp_buf (paint_buffer);
+      GeglBuffer  *dest_buffer;
+      GeglBuffer  *src_buffer;
+
+      if (! paint_buf)
+        return;
+
+      if (core->comp_buffer)
+        dest_buffer = core->comp_buffer;
+      else
+        dest_buffer = gimp_drawable_get_buffer (drawable);
+
+      if (mode == GIMP_PAINT_CONSTANT)
+        {
+          /* This step is skipped by the ink tool, which writes
+           * directly to canvas_buffer
+           */
+          if (paint_mask != NULL)
+            {
+              /* Mix paint mask and canvas_buffer */
+              combine_paint_mask_to_canvas_mask (paint_mask,
+                                                 paint_mask_offset_x,
+                                                 paint_mask_offset_y,
+                                                 core->canvas_buffer,
+                                                 paint_buffer_x,
+                                                 paint_buffer_y,
+                                                 paint_opacity,
+                                                 GIMP_IS_AIRBRUSH (core));
+            }
+
+          /* Write canvas_buffer to paint_buf */
+          canvas_buffer_to_paint_buf_alpha (paint_buf,
+                                            core->canvas_buffer,
+                                            paint_buffer_x,
+                                            paint_buffer_y);
+
+          /* undo buf -> paint_buf -> dest_buffer */
+          src_buffer = core->undo_buffer;
+        }
+      else
+        {
+          g_return_if_fail (paint_mask);
+
+          /* Write paint_mask to paint_buf, does not modify canvas_buffer */
+          paint_mask_to_paint_buffer (paint_mask,
+                                      paint_mask_offset_x,
+                                      paint_mask_offset_y,
+                                      paint_buf,
+                                      paint_opacity);
+
+          /* dest_buffer -> paint_buf -> dest_buffer */
+          if (core->comp_buffer)
+            src_buffer = gimp_drawable_get_buffer (drawable);
+          else
+            src_buffer = dest_buffer;
+        }
+
+      do_layer_blend (src_buffer,
+                      dest_buffer,
+                      paint_buf,
+                      core->mask_buffer,
+                      image_opacity,
+                      paint_buffer_x,
+                      paint_buffer_y,
+                      core->mask_x_offset,
+                      core->mask_y_offset,
+                      paint_mode);
+
+      if (core->comp_buffer)
+        {
+          mask_components_onto (src_buffer,
+                                core->comp_buffer,
+                                gimp_drawable_get_buffer (drawable),
+                                GEGL_RECTANGLE (paint_buffer_x,
+                                                paint_buffer_y,
+                                                width,
+                                                height),
+                                gimp_drawable_get_active_mask (drawable));
+        }
+    }
+}
+
+static void
+gimp_paint_core_paste_update (GimpPaintCore *core,
+                              GimpDrawable  *drawable,
+                              gint           x,
+                              gint           y,
+                              gint           width,
+                              gint           height)
+{
+  /*  Update the undo extents  */
+  core->x1 = MIN (core->x1, x);
+  core->y1 = MIN (core->y1, y);
+  core->x2 = MAX (core->x2, x + width);
+  core->y2 = MAX (core->y2, y + height);
+
+  /*  Update the drawable  */
+  gimp_drawable_update (drawable, x, y, width, height);
+}
+
+static void
+gimp_paint_core_paste_dab (GimpPaintCore          *core,
+                           const GimpPaintCoreDab *dab,
+                           GimpDrawable           *drawable,
+                           gdouble                 image_opacity,
+                           GimpLayerMode           paint_mode)
+{
+  gimp_paint_core_paste_buffer (core,
+                                dab->paint_buffer,
+                                dab->paint_buffer_x,
+                                dab->paint_buffer_y,
+                                dab->paint_mask,
+                                dab->paint_mask_offset_x,
+                                dab->paint_mask_offset_y,
+                                drawable,
+                                dab->paint_opacity,
+                                image_opacity,
+                                paint_mode,
+                                dab->mode);
+}
+
+static void
+gimp_paint_core_paste_dabs_func (gint     i,
+                                 gint     n,
+                                 gpointer user_data)
+{
+  GimpPaintCorePasteData *data = user_data;
+  gint                    k;
+
+  for (k = i; k < data->n_dab_indices; k += n)
+    {
+      gimp_paint_core_paste_dab (data->core,
+                                 &data->dabs[data->dab_indices[k]],
+                                 data->drawable,
+                                 data->image_opacity,
+                                 data->paint_mode);
+    }
+}
+
+static void
+gimp_paint_core_dab_get_tile_area (GeglBuffer             *buffer,
+                                   const GimpPaintCoreDab *dab,
+                                   GeglRectangle          *area)
+{
+  gint tile_width;
+  gint tile_height;
+
+  g_object_get (buffer,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                NULL);
+
+  /*  the dab's area, grown to whole tiles of @buffer  */
+  area->x      = floor ((gdouble) dab->paint_buffer_x / tile_width);
+  area->y      = floor ((gdouble) dab->paint_buffer_y / tile_height);
+  area->width  = ceil ((gdouble) (dab->paint_buffer_x +
+                                  gegl_buffer_get_width (dab->paint_buffer)) /
+                       tile_width)  - area->x;
+  area->height = ceil ((gdouble) (dab->paint_buffer_y +
+                                  gegl_buffer_get_height (dab->paint_buffer)) /
+                       tile_height) - area->y;
+}
+
+static gboolean
+gimp_paint_core_dabs_share_tiles (GimpPaintCore          *core,
+                                  GimpDrawable           *drawable,
+                                  const GimpPaintCoreDab *dab1,
+                                  const GimpPaintCoreDab *dab2)
+{
+  GeglBuffer *buffers[3];
+  gint        n_buffers = 0;
+  gint        i;
+
+  buffers[n_buffers++] = gimp_drawable_get_buffer (drawable);
+
+  if (core->canvas_buffer)
+    buffers[n_buffers++] = core->canvas_buffer;
+
+  if (core->comp_buffer)
+    buffers[n_buffers++] = core->comp_buffer;
+
+  for (i = 0; i < n_buffers; i++)
+    {
+      GeglRectangle area1;
+      GeglRectangle area2;
+
+      gimp_paint_core_dab_get_tile_area (buffers[i], dab1, &area1);
+      gimp_paint_core_dab_get_tile_area (buffers[i], dab2, &area2);
+
+      if (gegl_rectangle_intersect (NULL, &area1, &area2))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+gimp_paint_core_scratch_slot_free (GimpPaintCoreScratchSlot *slot)
+{
+  if (slot)
+    {
+      if (slot->buffer)
+        g_object_unref (slot->buffer);
+
+      if (slot->store)
+        gimp_temp_buf_unref (slot->store);
+
+      g_slice_free (GimpPaintCoreScratchSlot, slot);
+    }
+}
@@ -30,6 +30,34 @@
 #define GIMP_PAINT_CORE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GIMP_TYPE_PAINT_CORE, GimpPaintCoreClass))
 
 
+/*  the scratch buffer slots used by the paint core and its subclasses,
+ *  subclasses may use any slot from GIMP_PAINT_CORE_SCRATCH_LAST on
+ */
+typedef enum
+{
+  GIMP_PAINT_CORE_SCRATCH_PAINT,  /*  the paint buffer                  */
+  GIMP_PAINT_CORE_SCRATCH_MASK,   /*  the paint mask, as a buffer       */
+  GIMP_PAINT_CORE_SCRATCH_SOURCE, /*  the source pixels of a dab        */
+  GIMP_PAINT_CORE_SCRATCH_LAST
+} GimpPaintCoreScratch;
+
+
+/*  one brush stamp, with its own paint buffer and mask, for
+ *  gimp_paint_core_paste_dabs()
+ */
+typedef struct
+{
+  GeglBuffer               *paint_buffer;
+  gint                      paint_buffer_x;
+  gint                      paint_buffer_y;
+  const GimpTempBuf        *paint_mask;
+  gint                      paint_mask_offset_x;
+  gint                      paint_mask_offset_y;
+  gdouble                   paint_opacity;
+  GimpPaintApplicationMode  mode;
+} GimpPaintCoreDab;
+
+
 typedef struct _GimpPaintCoreClass GimpPaintCoreClass;
 
 struct _GimpPaintCore
@@ -70,6 +98,12 @@ struct _GimpPaintCore
   GimpApplicator *applicator;
 
   GArray      *stroke_buffer;
+
+  GPtrArray   *scratch_buffers;   /*  reusable per-dab buffers            */
+  gint         scratch_width;     /*  the size reserved for them          */
+  gint         scratch_height;
+  guint        n_scratch_allocs;  /*  number of scratch (re)allocations   */
+  guint        n_dabs;            /*  number of MOTION paint calls        */
 };
 
 struct _GimpPaintCoreClass
@@ -174,6 +208,19 @@ GeglBuffer * gimp_paint_core_get_paint_buffer       (GimpPaintCore    *core,
                                                      gint             *paint_width,
                                                      gint             *paint_height);
 
+void         gimp_paint_core_reserve_scratch        (GimpPaintCore    *core,
+                                                     gint              width,
+                                                     gint              height);
+GeglBuffer * gimp_paint_core_get_scratch_buffer     (GimpPaintCore    *core,
+                                                     gint              slot,
+                                                     gint              width,
+                                                     gint              height,
+                                                     const Babl       *format);
+GeglBuffer * gimp_paint_core_get_scratch_temp_buf   (GimpPaintCore    *core,
+                                                     gint              slot,
+                                                     const GimpTempBuf *temp_buf);
+void         gimp_paint_core_free_scratch_buffers   (GimpPaintCore    *core);
+
 GeglBuffer * gimp_paint_core_get_orig_image         (GimpPaintCore    *core);
 GeglBuffer * gimp_paint_core_get_orig_proj          (GimpPaintCore    *core);
 
@@ -186,6 +233,12 @@ void      gimp_paint_core_paste             (GimpPaintCore            *core,
                                              gdouble                   image_opacity,
                                              GimpLayerMode             paint_mode,
                                              GimpPaintApplicationMode  mode);
+void      gimp_paint_core_paste_dabs        (GimpPaintCore            *core,
+                                             const GimpPaintCoreDab   *dabs,
+                                             gint                      n_dabs,
+                                             GimpDrawable             *drawable,
+                                             gdouble                   image_opacity,
+                                             GimpLayerMode             paint_mode);
 
 void      gimp_paint_core_replace           (GimpPaintCore            *core,
                                              const GimpTempBuf        *paint_mask,
@@ -431,8 +431,10 @@ gimp_perspective_clone_get_source (GimpSourceCore   *source_core,
       break;
     }
 
-  dest_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, x2d - x1d, y2d - y1d),
-                                 src_format_alpha);
+  dest_buffer = gimp_paint_core_get_scratch_buffer (GIMP_PAINT_CORE (source_core),
+                                                    GIMP_PAINT_CORE_SCRATCH_SOURCE,
+                                                    x2d - x1d, y2d - y1d,
+                                                    src_format_alpha);
 
   gimp_perspective_clone_get_matrix (clone, &matrix);
 
@@ -452,7 +454,7 @@ gimp_perspective_clone_get_source (GimpSourceCore   *source_core,
 
   *src_rect = *GEGL_RECTANGLE (0, 0, x2d - x1d, y2d - y1d);
 
-  return dest_buffer;
+  return g_object_ref (dest_buffer);
 }
 
 
@@ -114,14 +114,8 @@ gimp_smudge_finalize (GObject *object)
 
   if (smudge->accum_buffers)
     {
-      GList *iter;
-
-      for (iter = smudge->accum_buffers; iter; iter = g_list_next (iter))
-        {
-          if (iter->data)
-            g_object_unref (iter->data);
-          smudge->accum_buffers = NULL;
-        }
+      g_ptr_array_free (smudge->accum_buffers, TRUE);
+      smudge->accum_buffers = NULL;
     }
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -151,16 +145,8 @@ gimp_smudge_paint (GimpPaintCore    *paint_core,
 
     case GIMP_PAINT_STATE_FINISH:
       if (smudge->accum_buffers)
-        {
-          GList *iter;
-
-          for  (iter = smudge->accum_buffers; iter; iter = g_list_next (iter))
-            {
-              if (iter->data)
-                g_object_unref (iter->data);
-              smudge->accum_buffers = NULL;
-            }
-        }
+        g_ptr_array_set_size (smudge->accum_buffers, 0);
+
       smudge->initialized = FALSE;
       break;
 
@@ -191,6 +177,12 @@ gimp_smudge_start (GimpPaintCore    *paint_core,
                                            paint_options,
                                            coords);
 
+  if (! smudge->accum_buffers)
+    smudge->accum_buffers =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+
+  g_ptr_array_set_size (smudge->accum_buffers, 0);
+
   n_strokes = gimp_symmetry_get_size (sym);
   for (i = 0; i < n_strokes; i++)
     {
@@ -200,13 +192,15 @@ gimp_smudge_start (GimpPaintCore    *paint_core,
 
       gimp_smudge_accumulator_size (paint_options, coords, &accum_size);
 
-      /*  Allocate the accumulation buffer */
-      accum_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
-                                                      accum_size,
-                                                      accum_size),
-                                      babl_format ("RGBA float"));
-      smudge->accum_buffers = g_list_prepend (smudge->accum_buffers,
-                                              accum_buffer);
+      /*  Get the accumulation buffer from a scratch slot of the paint
+       *  core, which lives until the end of the stroke
+       */
+      accum_buffer =
+        gimp_paint_core_get_scratch_buffer (paint_core,
+                                            GIMP_PAINT_CORE_SCRATCH_LAST + i,
+                                            accum_size, accum_size,
+                                            babl_format ("RGBA float"));
+      g_ptr_array_add (smudge->accum_buffers, g_object_ref (accum_buffer));
 
       /*  adjust the x and y coordinates to the upper left corner of the
        *  accumulator
@@ -221,7 +215,7 @@ gimp_smudge_start (GimpPaintCore    *paint_core,
       if (! paint_buffer)
         continue;
 
-      gimp_smudge_accumulator_coords (paint_core, coords, 0, &x, &y);
+      gimp_smudge_accumulator_coords (paint_core, coords, i, &x, &y);
 
       /*  If clipped, prefill the smudge buffer with the color at the
        *  brush position.
@@ -260,7 +254,6 @@ gimp_smudge_start (GimpPaintCore    *paint_core,
                                         paint_buffer_y - y,
                                         0, 0));
     }
-  smudge->accum_buffers = g_list_reverse (smudge->accum_buffers);
 
   return TRUE;
 }
@@ -324,7 +317,7 @@ gimp_smudge_motion (GimpPaintCore    *paint_core,
                                                        &paint_buffer_y,
                                                        &paint_width,
                                                        &paint_height);
-      if (! paint_buffer)
+      if (! paint_buffer || i >= smudge->accum_buffers->len)
         continue;
 
       op = gimp_symmetry_get_operation (sym, i,
@@ -354,7 +347,7 @@ gimp_smudge_motion (GimpPaintCore    *paint_core,
        *    (Accum,1) (if no alpha),
        */
 
-      accum_buffer = g_list_nth_data (smudge->accum_buffers, i);
+      accum_buffer = g_ptr_array_index (smudge->accum_buffers, i);
       gimp_gegl_smudge_blend (accum_buffer,
                               GEGL_RECTANGLE (paint_buffer_x - x,
                                               paint_buffer_y - y,
@@ -410,7 +403,7 @@ gimp_smudge_accumulator_coords (GimpPaintCore    *paint_core,
   GimpSmudge *smudge = GIMP_SMUDGE (paint_core);
   GeglBuffer *accum_buffer;
 
-  accum_buffer = g_list_nth_data (smudge->accum_buffers, stroke);
+  accum_buffer = g_ptr_array_index (smudge->accum_buffers, stroke);
   *x = (gint) coords->x - gegl_buffer_get_width  (accum_buffer) / 2;
   *y = (gint) coords->y - gegl_buffer_get_height (accum_buffer) / 2;
 }
@@ -37,7 +37,7 @@ struct _GimpSmudge
   GimpBrushCore  parent_instance;
 
   gboolean       initialized;
-  GList         *accum_buffers;
+  GPtrArray     *accum_buffers;
 };
 
 struct _GimpSmudgeClass
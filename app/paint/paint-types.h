@@ -60,6 +60,11 @@ typedef struct _GimpPerspectiveCloneOptions GimpPerspectiveCloneOptions;
 typedef struct _GimpSmudgeOptions           GimpSmudgeOptions;
 
 
+/*  misc  */
+
+typedef struct _GimpPaintCoreRecord         GimpPaintCoreRecord;
+
+
 /*  functions  */
 
 typedef void (* GimpPaintRegisterCallback) (Gimp        *gimp,
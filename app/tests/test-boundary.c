@@ -0,0 +1,217 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gegl.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "core/core-types.h"
+
+#include "core/gimpboundary.h"
+
+
+/* Finds the boundary of a large, ragged mask like the ones select by
+ * color produces, then edits a small area and finds it again using
+ * the cache. Both results must match an uncached search. Run with
+ * -m perf to get the timings.
+ */
+
+
+#define N_BLOBS   4000
+#define EDIT_SIZE 32
+
+
+static const gint mask_sizes[] = { 1024, 2048, 4096 };
+
+
+static void
+gimp_test_boundary_fill (GeglBuffer *buffer,
+                         gint        size)
+{
+  gfloat *data = g_new0 (gfloat, size * size);
+  gint    i;
+
+  for (i = 0; i < N_BLOBS; i++)
+    {
+      gint   cx     = g_random_int_range (0, size);
+      gint   cy     = g_random_int_range (0, size);
+      gint   radius = g_random_int_range (1, size / 32);
+      gfloat value  = g_random_boolean () ? 1.0 : 0.0;
+      gint   x, y;
+
+      for (y = MAX (cy - radius, 0); y < MIN (cy + radius, size); y++)
+        for (x = MAX (cx - radius, 0); x < MIN (cx + radius, size); x++)
+          {
+            if (SQR (x - cx) + SQR (y - cy) < SQR (radius))
+              data[y * size + x] = value;
+          }
+    }
+
+  gegl_buffer_set (buffer, GEGL_RECTANGLE (0, 0, size, size), 0,
+                   babl_format ("Y float"), data, GEGL_AUTO_ROWSTRIDE);
+
+  g_free (data);
+}
+
+static GimpBoundSeg *
+gimp_test_boundary_find (GimpBoundaryCache *cache,
+                         GeglBuffer        *buffer,
+                         gint               size,
+                         gint              *num_segs,
+                         gdouble           *seconds)
+{
+  GTimer       *timer = g_timer_new ();
+  GimpBoundSeg *segs;
+
+  if (cache)
+    segs = gimp_boundary_find_cached (cache, buffer, NULL,
+                                      babl_format ("Y float"),
+                                      GIMP_BOUNDARY_WITHIN_BOUNDS,
+                                      0, 0, size, size,
+                                      GIMP_BOUNDARY_HALF_WAY,
+                                      num_segs);
+  else
+    segs = gimp_boundary_find (buffer, NULL,
+                               babl_format ("Y float"),
+                               GIMP_BOUNDARY_WITHIN_BOUNDS,
+                               0, 0, size, size,
+                               GIMP_BOUNDARY_HALF_WAY,
+                               num_segs);
+
+  *seconds = g_timer_elapsed (timer, NULL);
+
+  g_timer_destroy (timer);
+
+  return segs;
+}
+
+static void
+gimp_test_boundary_assert_equal (const GimpBoundSeg *a,
+                                 gint                num_a,
+                                 const GimpBoundSeg *b,
+                                 gint                num_b)
+{
+  gint i;
+
+  g_assert_cmpint (num_a, ==, num_b);
+
+  for (i = 0; i < num_a; i++)
+    {
+      g_assert_cmpint (a[i].x1,   ==, b[i].x1);
+      g_assert_cmpint (a[i].y1,   ==, b[i].y1);
+      g_assert_cmpint (a[i].x2,   ==, b[i].x2);
+      g_assert_cmpint (a[i].y2,   ==, b[i].y2);
+      g_assert_cmpint (a[i].open, ==, b[i].open);
+    }
+}
+
+static void
+gimp_test_boundary_incremental (gconstpointer data)
+{
+  gint               size = GPOINTER_TO_INT (data);
+  GeglBuffer        *buffer;
+  GimpBoundaryCache *cache;
+  GimpBoundSeg      *full;
+  GimpBoundSeg      *cached;
+  GimpBoundSeg      *incremental;
+  GeglRectangle      edit;
+  gint               num_full;
+  gint               num_cached;
+  gint               num_incremental;
+  gdouble            full_time;
+  gdouble            cached_time;
+  gdouble            incremental_time;
+
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, size, size),
+                            babl_format ("Y float"));
+  cache  = gimp_boundary_cache_new ();
+
+  g_random_set_seed (size);
+
+  gimp_test_boundary_fill (buffer, size);
+
+  full   = gimp_test_boundary_find (NULL,  buffer, size,
+                                    &num_full, &full_time);
+  cached = gimp_test_boundary_find (cache, buffer, size,
+                                    &num_cached, &cached_time);
+
+  gimp_test_boundary_assert_equal (full, num_full, cached, num_cached);
+
+  g_free (full);
+  g_free (cached);
+
+  /*  clear a small square in the middle, like an eraser dab  */
+  edit = *GEGL_RECTANGLE ((size - EDIT_SIZE) / 2, (size - EDIT_SIZE) / 2,
+                          EDIT_SIZE, EDIT_SIZE);
+
+  gegl_buffer_clear (buffer, &edit);
+  gimp_boundary_cache_invalidate (cache, &edit);
+
+  full        = gimp_test_boundary_find (NULL,  buffer, size,
+                                         &num_full, &full_time);
+  incremental = gimp_test_boundary_find (cache, buffer, size,
+                                         &num_incremental, &incremental_time);
+
+  gimp_test_boundary_assert_equal (full, num_full,
+                                   incremental, num_incremental);
+
+  if (g_test_perf ())
+    {
+      g_test_message ("mask %4dpx: %7d segments, full %8.2f ms, "
+                      "cached %8.2f ms, after edit %8.2f ms",
+                      size, num_full,
+                      full_time        * 1000.0,
+                      cached_time      * 1000.0,
+                      incremental_time * 1000.0);
+
+      g_test_minimized_result (incremental_time,
+                               "boundary %dpx incremental", size);
+    }
+
+  g_free (full);
+  g_free (incremental);
+
+  gimp_boundary_cache_free (cache);
+  g_object_unref (buffer);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gint i;
+
+  gegl_init (&argc, &argv);
+  g_test_init (&argc, &argv, NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (mask_sizes); i++)
+    {
+      gchar *path = g_strdup_printf ("/gimpboundary/incremental/%d",
+                                     mask_sizes[i]);
+
+      g_test_add_data_func (path, GINT_TO_POINTER (mask_sizes[i]),
+                            gimp_test_boundary_incremental);
+
+      g_free (path);
+    }
+
+  return g_test_run ();
+}
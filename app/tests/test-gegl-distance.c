@@ -0,0 +1,1144 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gegl.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "gegl/gimp-gegl-types.h"
+
+#include "gegl/gimp-gegl-distance.h"
+
+
+/* Grows, shrinks and borders random binary masks with the functions
+ * of gimp-gegl-distance.c and with the structuring element scans the
+ * gimp:grow, gimp:shrink and gimp:border operations used before, and
+ * compares the results. The old scans are copied below unchanged,
+ * except for taking their properties as arguments.
+ *
+ * With edge lock, the old border copied the second-to-last row's edge
+ * pixels below the canvas, so the rows within reach of the bottom
+ * are not compared. The old scans read uninitialized rows for radii
+ * larger than the mask's height, so those are left out.
+ */
+
+
+#define WIDTH           97
+#define HEIGHT          83
+#define N_MASKS         6
+#define FEATHER_EPSILON 1e-6
+
+
+typedef struct
+{
+  gint radius_x;
+  gint radius_y;
+} Radii;
+
+static const Radii radii[] =
+{
+  {   1,   1 },
+  {   2,   2 },
+  {   3,   7 },
+  {   7,   3 },
+  {  12,  12 },
+  {  40,  25 },
+  {  30,  60 },
+  { 120,  20 }
+};
+
+
+/*  the old code  */
+
+static void
+compute_border (gint16  *circ,
+                guint16  xradius,
+                guint16  yradius)
+{
+  gint32  i;
+  gint32  diameter = xradius * 2 + 1;
+  gdouble tmp;
+
+  for (i = 0; i < diameter; i++)
+    {
+      if (i > xradius)
+        tmp = (i - xradius) - 0.5;
+      else if (i < xradius)
+        tmp = (xradius - i) - 0.5;
+      else
+        tmp = 0.0;
+
+      circ[i] = RINT (yradius /
+                      (gdouble) xradius * sqrt (SQR (xradius) - SQR (tmp)));
+    }
+}
+
+
+static inline void
+rotate_pointers (gfloat  **p,
+                 guint32   n)
+{
+  guint32  i;
+  gfloat  *tmp;
+
+  tmp = p[0];
+
+  for (i = 0; i < n - 1; i++)
+    p[i] = p[i + 1];
+
+  p[i] = tmp;
+}
+
+
+/* Computes whether pixels in `buf[1]', if they are selected, have neighbouring
+   pixels that are unselected. Put result in `transition'. */
+static void
+compute_transition (gfloat    *transition,
+                    gfloat   **buf,
+                    gint32     width,
+                    gboolean   edge_lock)
+{
+  register gint32 x = 0;
+
+  if (width == 1)
+    {
+      if (buf[1][0] >= 0.5 && (buf[0][0] < 0.5 || buf[2][0] < 0.5))
+        transition[0] = 1.0;
+      else
+        transition[0] = 0.0;
+      return;
+    }
+
+  if (buf[1][0] >= 0.5 && edge_lock)
+    {
+      /* The pixel to the left (outside of the canvas) is considered selected,
+         so we check if there are any unselected pixels in neighbouring pixels
+         _on_ the canvas. */
+      if (buf[0][x] < 0.5 || buf[0][x + 1] < 0.5 ||
+                             buf[1][x + 1] < 0.5 ||
+          buf[2][x] < 0.5 || buf[2][x + 1] < 0.5 )
+        {
+          transition[x] = 1.0;
+        }
+      else
+        {
+          transition[x] = 0.0;
+        }
+    }
+  else if (buf[1][0] >= 0.5 && !edge_lock)
+    {
+      /* We must not care about neighbouring pixels on the image canvas since
+         there always are unselected pixels to the left (which is outside of
+         the image canvas). */
+      transition[x] = 1.0;
+    }
+  else
+    {
+      transition[x] = 0.0;
+    }
+
+  for (x = 1; x < width - 1; x++)
+    {
+      if (buf[1][x] >= 0.5)
+        {
+          if (buf[0][x - 1] < 0.5 || buf[0][x] < 0.5 || buf[0][x + 1] < 0.5 ||
+              buf[1][x - 1] < 0.5 ||                    buf[1][x + 1] < 0.5 ||
+              buf[2][x - 1] < 0.5 || buf[2][x] < 0.5 || buf[2][x + 1] < 0.5)
+            transition[x] = 1.0;
+          else
+            transition[x] = 0.0;
+        }
+      else
+        {
+          transition[x] = 0.0;
+        }
+    }
+
+  if (buf[1][width - 1] >= 0.5 && edge_lock)
+    {
+      /* The pixel to the right (outside of the canvas) is considered selected,
+         so we check if there are any unselected pixels in neighbouring pixels
+         _on_ the canvas. */
+      if ( buf[0][x - 1] < 0.5 || buf[0][x] < 0.5 ||
+           buf[1][x - 1] < 0.5 ||
+           buf[2][x - 1] < 0.5 || buf[2][x] < 0.5)
+        {
+          transition[width - 1] = 1.0;
+        }
+      else
+        {
+          transition[width - 1] = 0.0;
+        }
+    }
+  else if (buf[1][width - 1] >= 0.5 && !edge_lock)
+    {
+      /* We must not care about neighbouring pixels on the image canvas since
+         there always are unselected pixels to the right (which is outside of
+         the image canvas). */
+      transition[width - 1] = 1.0;
+    }
+  else
+    {
+      transition[width - 1] = 0.0;
+    }
+}
+
+
+static gboolean
+gimp_test_distance_old_grow (GeglBuffer          *input,
+                             GeglBuffer          *output,
+                             const GeglRectangle *roi,
+                             gint                 radius_x,
+                             gint                 radius_y)
+{
+  /* Any bugs in this fuction are probably also in thin_region.
+   * Blame all bugs in this function on jaycox@gimp.org
+   */
+  const Babl        *input_format  = babl_format ("Y float");
+  const Babl        *output_format = babl_format ("Y float");
+  gint32             i, j, x, y;
+  gfloat           **buf;  /* caches the region's pixel data */
+  gfloat            *out;  /* holds the new scan line we are computing */
+  gfloat           **max;  /* caches the largest values for each column */
+  gint16            *circ; /* holds the y coords of the filter's mask */
+  gfloat             last_max;
+  gint16             last_index;
+  gfloat            *buffer;
+
+  max = g_new (gfloat *, roi->width + 2 * radius_x);
+  buf = g_new (gfloat *, radius_y + 1);
+
+  for (i = 0; i < radius_y + 1; i++)
+    buf[i] = g_new (gfloat, roi->width);
+
+  buffer = g_new (gfloat,
+                  (roi->width + 2 * radius_x) * (radius_y + 1));
+
+  for (i = 0; i < roi->width + 2 * radius_x; i++)
+    {
+      if (i < radius_x)
+        max[i] = buffer;
+      else if (i < roi->width + radius_x)
+        max[i] = &buffer[(radius_y + 1) * (i - radius_x)];
+      else
+        max[i] = &buffer[(radius_y + 1) * (roi->width + radius_x - 1)];
+
+      for (j = 0; j < radius_y + 1; j++)
+        max[i][j] = 0.0;
+    }
+
+  /* offset the max pointer by radius_x so the range of the
+   * array is [-radius_x] to [roi->width + radius_x]
+   */
+  max += radius_x;
+
+  out =  g_new (gfloat, roi->width);
+
+  circ = g_new (gint16, 2 * radius_x + 1);
+  compute_border (circ, radius_x, radius_y);
+
+  /* offset the circ pointer by radius_x so the range of the
+   * array is [-radius_x] to [radius_x]
+   */
+  circ += radius_x;
+
+  memset (buf[0], 0, roi->width * sizeof (gfloat));
+
+  for (i = 0; i < radius_y && i < roi->height; i++) /* load top of image */
+    gegl_buffer_get (input,
+                     GEGL_RECTANGLE (roi->x, roi->y + i,
+                                     roi->width, 1),
+                     1.0, input_format, buf[i + 1],
+                     GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (x = 0; x < roi->width; x++) /* set up max for top of image */
+    {
+      max[x][0] = 0.0;       /* buf[0][x] is always 0 */
+      max[x][1] = buf[1][x]; /* MAX (buf[1][x], max[x][0]) always = buf[1][x]*/
+
+      for (j = 2; j < radius_y + 1; j++)
+        max[x][j] = MAX (buf[j][x], max[x][j - 1]);
+    }
+
+  for (y = 0; y < roi->height; y++)
+    {
+      rotate_pointers (buf, radius_y + 1);
+
+      if (y < roi->height - (radius_y))
+        gegl_buffer_get (input,
+                         GEGL_RECTANGLE (roi->x,  roi->y + y + radius_y,
+                                         roi->width, 1),
+                         1.0, input_format, buf[radius_y],
+                         GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+      else
+        memset (buf[radius_y], 0, roi->width * sizeof (gfloat));
+
+      for (x = 0; x < roi->width; x++) /* update max array */
+        {
+          for (i = radius_y; i > 0; i--)
+            max[x][i] = MAX (MAX (max[x][i - 1], buf[i - 1][x]), buf[i][x]);
+
+          max[x][0] = buf[0][x];
+        }
+
+      last_max = max[0][circ[-1]];
+      last_index = 1;
+
+      for (x = 0; x < roi->width; x++) /* render scan line */
+        {
+          last_index--;
+
+          if (last_index >= 0)
+            {
+              if (last_max >= 1.0)
+                {
+                  out[x] = 1.0;
+                }
+              else
+                {
+                  last_max = 0.0;
+
+                  for (i = radius_x; i >= 0; i--)
+                    if (last_max < max[x + i][circ[i]])
+                      {
+                        last_max = max[x + i][circ[i]];
+                        last_index = i;
+                      }
+
+                  out[x] = last_max;
+                }
+            }
+          else
+            {
+              last_index = radius_x;
+              last_max = max[x + radius_x][circ[radius_x]];
+
+              for (i = radius_x - 1; i >= -radius_x; i--)
+                if (last_max < max[x + i][circ[i]])
+                  {
+                    last_max = max[x + i][circ[i]];
+                    last_index = i;
+                  }
+
+              out[x] = last_max;
+            }
+        }
+
+      gegl_buffer_set (output,
+                       GEGL_RECTANGLE (roi->x, roi->y + y,
+                                       roi->width, 1),
+                       0, output_format, out,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  /* undo the offsets to the pointers so we can free the malloced memmory */
+  circ -= radius_x;
+  max -= radius_x;
+
+  g_free (circ);
+  g_free (buffer);
+  g_free (max);
+
+  for (i = 0; i < radius_y + 1; i++)
+    g_free (buf[i]);
+
+  g_free (buf);
+  g_free (out);
+
+  return TRUE;
+}
+
+
+static gboolean
+gimp_test_distance_old_shrink (GeglBuffer          *input,
+                               GeglBuffer          *output,
+                               const GeglRectangle *roi,
+                               gint                 radius_x,
+                               gint                 radius_y,
+                               gboolean             edge_lock)
+{
+  /* Pretty much the same as fatten_region only different.
+   * Blame all bugs in this function on jaycox@gimp.org
+   *
+   * If edge_lock is true we assume that pixels outside the region we
+   * are passed are identical to the edge pixels.  If edge_lock is
+   * false, we assume that pixels outside the region are 0
+   */
+  const Babl          *input_format  = babl_format ("Y float");
+  const Babl          *output_format = babl_format ("Y float");
+  gint32               i, j, x, y;
+  gfloat             **buf;  /* caches the the region's pixels */
+  gfloat              *out;  /* holds the new scan line we are computing */
+  gfloat             **max;  /* caches the smallest values for each column */
+  gint16              *circ; /* holds the y coords of the filter's mask */
+  gfloat               last_max;
+  gint16               last_index;
+  gfloat              *buffer;
+  gint                 buffer_size;
+
+  max = g_new (gfloat *, roi->width + 2 * radius_x);
+  buf = g_new (gfloat *, radius_y + 1);
+
+  for (i = 0; i < radius_y + 1; i++)
+    buf[i] = g_new (gfloat, roi->width);
+
+  buffer_size = (roi->width+ 2 * radius_x + 1) * (radius_y + 1);
+  buffer = g_new (gfloat, buffer_size);
+
+  if (edge_lock)
+    {
+      for (i = 0; i < buffer_size; i++)
+        buffer[i] = 1.0;
+    }
+  else
+    {
+      memset (buffer, 0, buffer_size * sizeof (gfloat));
+    }
+
+  for (i = 0; i < roi->width + 2 * radius_x; i++)
+    {
+      if (i < radius_x)
+        {
+          if (edge_lock)
+            max[i] = buffer;
+          else
+            max[i] = &buffer[(radius_y + 1) * (roi->width + radius_x)];
+        }
+      else if (i < roi->width + radius_x)
+        {
+          max[i] = &buffer[(radius_y + 1) * (i - radius_x)];
+        }
+      else
+        {
+          if (edge_lock)
+            max[i] = &buffer[(radius_y + 1) * (roi->width + radius_x - 1)];
+          else
+            max[i] = &buffer[(radius_y + 1) * (roi->width + radius_x)];
+        }
+    }
+
+  if (! edge_lock)
+    for (j = 0 ; j < radius_y + 1; j++)
+      max[0][j] = 0.0;
+
+  /* offset the max pointer by radius_x so the range of the
+   * array is [-radius_x] to [roi->width + radius_x]
+   */
+  max += radius_x;
+
+  out = g_new (gfloat, roi->width);
+
+  circ = g_new (gint16, 2 * radius_x + 1);
+  compute_border (circ, radius_x, radius_y);
+
+ /* offset the circ pointer by radius_x so the range of the
+  * array is [-radius_x] to [radius_x]
+  */
+  circ += radius_x;
+
+  for (i = 0; i < radius_y && i < roi->height; i++) /* load top of image */
+    gegl_buffer_get (input,
+                     GEGL_RECTANGLE (roi->x, roi->y + i,
+                                     roi->width, 1),
+                     1.0, input_format, buf[i + 1],
+                     GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  if (edge_lock)
+    memcpy (buf[0], buf[1], roi->width * sizeof (gfloat));
+  else
+    memset (buf[0], 0, roi->width * sizeof (gfloat));
+
+  for (x = 0; x < roi->width; x++) /* set up max for top of image */
+    {
+      max[x][0] = buf[0][x];
+
+      for (j = 1; j < radius_y + 1; j++)
+        max[x][j] = MIN (buf[j][x], max[x][j - 1]);
+    }
+
+  for (y = 0; y < roi->height; y++)
+    {
+      rotate_pointers (buf, radius_y + 1);
+
+      if (y < roi->height - radius_y)
+        gegl_buffer_get (input,
+                         GEGL_RECTANGLE (roi->x,  roi->y + y + radius_y,
+                                         roi->width, 1),
+                         1.0, input_format, buf[radius_y],
+                         GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      else if (edge_lock)
+        memcpy (buf[radius_y], buf[radius_y - 1],
+                roi->width * sizeof (gfloat));
+      else
+        memset (buf[radius_y], 0, roi->width * sizeof (gfloat));
+
+      for (x = 0 ; x < roi->width; x++) /* update max array */
+        {
+          for (i = radius_y; i > 0; i--)
+            max[x][i] = MIN (MIN (max[x][i - 1], buf[i - 1][x]), buf[i][x]);
+
+          max[x][0] = buf[0][x];
+        }
+
+      last_max =  max[0][circ[-1]];
+      last_index = 0;
+
+      for (x = 0 ; x < roi->width; x++) /* render scan line */
+        {
+          last_index--;
+
+          if (last_index >= 0)
+            {
+              if (last_max <= 0.0)
+                {
+                  out[x] = 0.0;
+                }
+              else
+                {
+                  last_max = 1.0;
+
+                  for (i = radius_x; i >= 0; i--)
+                    if (last_max > max[x + i][circ[i]])
+                      {
+                        last_max = max[x + i][circ[i]];
+                        last_index = i;
+                      }
+
+                  out[x] = last_max;
+                }
+            }
+          else
+            {
+              last_index = radius_x;
+              last_max = max[x + radius_x][circ[radius_x]];
+
+              for (i = radius_x - 1; i >= -radius_x; i--)
+                if (last_max > max[x + i][circ[i]])
+                  {
+                    last_max = max[x + i][circ[i]];
+                    last_index = i;
+                  }
+
+              out[x] = last_max;
+            }
+        }
+
+      gegl_buffer_set (output,
+                       GEGL_RECTANGLE (roi->x, roi->y + y,
+                                       roi->width, 1),
+                       0, output_format, out,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  /* undo the offsets to the pointers so we can free the malloced memmory */
+  circ -= radius_x;
+  max -= radius_x;
+
+  /* free the memmory */
+  g_free (circ);
+  g_free (buffer);
+  g_free (max);
+
+  for (i = 0; i < radius_y + 1; i++)
+    g_free (buf[i]);
+
+  g_free (buf);
+  g_free (out);
+
+  return TRUE;
+}
+
+
+static gboolean
+gimp_test_distance_old_border (GeglBuffer          *input,
+                               GeglBuffer          *output,
+                               const GeglRectangle *roi,
+                               gint                 radius_x,
+                               gint                 radius_y,
+                               gboolean             feather,
+                               gboolean             edge_lock)
+{
+  /* This function has no bugs, but if you imagine some you can blame
+   * them on jaycox@gimp.org
+   */
+  const Babl          *input_format  = babl_format ("Y float");
+  const Babl          *output_format = babl_format ("Y float");
+
+  gint32 i, j, x, y;
+
+  /* A cache used in the algorithm as it works its way down. `buf[1]' is the
+     current row. Thus, at algorithm initialization, `buf[0]' represents the
+     row 'above' the first row of the region. */
+  gfloat  *buf[3];
+
+  /* The resulting selection is calculated row by row, and this buffer holds the
+     output for each individual row, on each iteration. */
+  gfloat  *out;
+
+  /* Keeps track of transitional pixels (pixels that are selected and have
+     unselected neighbouring pixels). */
+  gfloat **transition;
+
+  /* TODO: Figure out role clearly in algorithm. */
+  gint16  *max;
+
+  /* TODO: Figure out role clearly in algorithm. */
+  gfloat **density;
+
+  gint16   last_index;
+
+  max = g_new (gint16, roi->width + 2 * radius_x);
+
+  for (i = 0; i < (roi->width + 2 * radius_x); i++)
+    max[i] = radius_y + 2;
+
+  max += radius_x;
+
+  for (i = 0; i < 3; i++)
+    buf[i] = g_new (gfloat, roi->width);
+
+  transition = g_new (gfloat *, radius_y + 1);
+
+  for (i = 0; i < radius_y + 1; i++)
+    {
+      transition[i] = g_new (gfloat, roi->width + 2 * radius_x);
+      memset (transition[i], 0,
+              (roi->width + 2 * radius_x) * sizeof (gfloat));
+      transition[i] += radius_x;
+    }
+
+  out = g_new (gfloat, roi->width);
+
+  density = g_new (gfloat *, 2 * radius_x + 1);
+  density += radius_x;
+
+  /* allocate density[][] */
+  for (x = 0; x < (radius_x + 1); x++)
+    {
+      density[ x]  = g_new (gfloat, 2 * radius_y + 1);
+      density[ x] += radius_y;
+      density[-x]  = density[x];
+    }
+
+  /* compute density[][] */
+  for (x = 0; x < (radius_x + 1); x++)
+    {
+      gdouble tmpx, tmpy, dist;
+      gfloat  a;
+
+      if (x > 0)
+        tmpx = x - 0.5;
+      else if (x < 0)
+        tmpx = x + 0.5;
+      else
+        tmpx = 0.0;
+
+      for (y = 0; y < (radius_y + 1); y++)
+        {
+          if (y > 0)
+            tmpy = y - 0.5;
+          else if (y < 0)
+            tmpy = y + 0.5;
+          else
+            tmpy = 0.0;
+
+          dist = ((tmpy * tmpy) / (radius_y * radius_y) +
+                  (tmpx * tmpx) / (radius_x * radius_x));
+
+          if (dist < 1.0)
+            {
+              if (feather)
+                a = 1.0 - sqrt (dist);
+              else
+                a = 1.0;
+            }
+          else
+            {
+              a = 0.0;
+            }
+
+          density[ x][ y] = a;
+          density[ x][-y] = a;
+          density[-x][ y] = a;
+          density[-x][-y] = a;
+        }
+    }
+
+  /* Since the algorithm considerers `buf[0]' to be 'over' the row
+   * currently calculated, we must start with `buf[0]' as non-selected
+   * if there is no `edge_lock. If there is an
+   * 'edge_lock', initialize the first row to 'selected'. Refer
+   * to bug #350009.
+   */
+  if (edge_lock)
+    {
+      for (i = 0; i < roi->width; i++)
+        buf[0][i] = 1.0;
+    }
+  else
+    {
+      memset (buf[0], 0, roi->width * sizeof (gfloat));
+    }
+
+  gegl_buffer_get (input,
+                   GEGL_RECTANGLE (roi->x, roi->y + 0,
+                                   roi->width, 1),
+                   1.0, input_format, buf[1],
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  if (roi->height > 1)
+    gegl_buffer_get (input,
+                     GEGL_RECTANGLE (roi->x, roi->y + 1,
+                                     roi->width, 1),
+                     1.0, input_format, buf[2],
+                     GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  else
+    memcpy (buf[2], buf[1], roi->width * sizeof (gfloat));
+
+  compute_transition (transition[1], buf, roi->width, edge_lock);
+
+   /* set up top of image */
+  for (y = 1; y < radius_y && y + 1 < roi->height; y++)
+    {
+      rotate_pointers (buf, 3);
+      gegl_buffer_get (input,
+                       GEGL_RECTANGLE (roi->x, roi->y + y + 1,
+                                       roi->width, 1),
+                       1.0, input_format, buf[2],
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+      compute_transition (transition[y + 1], buf, roi->width, edge_lock);
+    }
+
+  /* set up max[] for top of image */
+  for (x = 0; x < roi->width; x++)
+    {
+      max[x] = -(radius_y + 7);
+
+      for (j = 1; j < radius_y + 1; j++)
+        if (transition[j][x])
+          {
+            max[x] = j;
+            break;
+          }
+    }
+
+  /* main calculation loop */
+  for (y = 0; y < roi->height; y++)
+    {
+      rotate_pointers (buf, 3);
+      rotate_pointers (transition, radius_y + 1);
+
+      if (y < roi->height - (radius_y + 1))
+        {
+          gegl_buffer_get (input,
+                           GEGL_RECTANGLE (roi->x,
+                                           roi->y + y + radius_y + 1,
+                                           roi->width, 1),
+                           1.0, input_format, buf[2],
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+          compute_transition (transition[radius_y], buf, roi->width, edge_lock);
+        }
+      else
+        {
+          if (edge_lock)
+            {
+              memcpy (transition[radius_y], transition[radius_y - 1], roi->width * sizeof (gfloat));
+            }
+          else
+            {
+              /* No edge lock, set everything 'below canvas' as seen
+               * from the algorithm as unselected.
+               */
+              memset (buf[2], 0, roi->width * sizeof (gfloat));
+              compute_transition (transition[radius_y], buf, roi->width, edge_lock);
+            }
+        }
+
+      /* update max array */
+      for (x = 0; x < roi->width; x++)
+        {
+          if (max[x] < 1)
+            {
+              if (max[x] <= -radius_y)
+                {
+                  if (transition[radius_y][x])
+                    max[x] = radius_y;
+                  else
+                    max[x]--;
+                }
+              else
+                {
+                  if (transition[-max[x]][x])
+                    max[x] = -max[x];
+                  else if (transition[-max[x] + 1][x])
+                    max[x] = -max[x] + 1;
+                  else
+                    max[x]--;
+                }
+            }
+          else
+            {
+              max[x]--;
+            }
+
+          if (max[x] < -radius_y - 1)
+            max[x] = -radius_y - 1;
+        }
+
+      last_index = 1;
+
+       /* render scan line */
+      for (x = 0 ; x < roi->width; x++)
+        {
+          gfloat last_max;
+
+          last_index--;
+
+          if (last_index >= 0)
+            {
+              last_max = 0.0;
+
+              for (i = radius_x; i >= 0; i--)
+                if (max[x + i] <= radius_y && max[x + i] >= -radius_y &&
+                    density[i][max[x+i]] > last_max)
+                  {
+                    last_max = density[i][max[x + i]];
+                    last_index = i;
+                  }
+
+              out[x] = last_max;
+            }
+          else
+            {
+              last_max = 0.0;
+
+              for (i = radius_x; i >= -radius_x; i--)
+                if (max[x + i] <= radius_y && max[x + i] >= -radius_y &&
+                    density[i][max[x + i]] > last_max)
+                  {
+                    last_max = density[i][max[x + i]];
+                    last_index = i;
+                  }
+
+              out[x] = last_max;
+            }
+
+          if (last_max <= 0.0)
+            {
+              for (i = x + 1; i < roi->width; i++)
+                {
+                  if (max[i] >= -radius_y)
+                    break;
+                }
+
+              if (i - x > radius_x)
+                {
+                  for (; x < i - radius_x; x++)
+                    out[x] = 0;
+
+                  x--;
+                }
+
+              last_index = radius_x;
+            }
+        }
+
+      gegl_buffer_set (output,
+                       GEGL_RECTANGLE (roi->x, roi->y + y,
+                                       roi->width, 1),
+                       0, output_format, out,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  g_free (out);
+
+  for (i = 0; i < 3; i++)
+    g_free (buf[i]);
+
+  max -= radius_x;
+  g_free (max);
+
+  for (i = 0; i < radius_y + 1; i++)
+    {
+      transition[i] -= radius_x;
+      g_free (transition[i]);
+    }
+
+  g_free (transition);
+
+  for (i = 0; i < radius_x + 1 ; i++)
+    {
+      density[i] -= radius_y;
+      g_free (density[i]);
+    }
+
+  density -= radius_x;
+  g_free (density);
+
+  return TRUE;
+}
+
+
+/*  the tests  */
+
+static const GeglRectangle test_roi = { 13, 7, WIDTH, HEIGHT };
+
+
+static GeglBuffer *
+gimp_test_distance_make_mask (gint index)
+{
+  GeglBuffer *buffer;
+  gfloat     *data;
+  gint        n_shapes;
+  gint        i;
+
+  data = g_new0 (gfloat, WIDTH * HEIGHT);
+
+  /*  the first masks are nearly empty and nearly full  */
+  if (index == 0)
+    {
+      data[(HEIGHT / 2) * WIDTH + WIDTH / 3] = 1.0;
+    }
+  else
+    {
+      if (index == 1)
+        {
+          for (i = 0; i < WIDTH * HEIGHT; i++)
+            data[i] = 1.0;
+
+          data[(HEIGHT / 3) * WIDTH + WIDTH / 2] = 0.0;
+        }
+
+      n_shapes = g_random_int_range (1, 12);
+
+      for (i = 0; i < n_shapes; i++)
+        {
+          gint     cx      = g_random_int_range (-10, WIDTH  + 10);
+          gint     cy      = g_random_int_range (-10, HEIGHT + 10);
+          gint     rx      = g_random_int_range (1, WIDTH  / 3);
+          gint     ry      = g_random_int_range (1, HEIGHT / 3);
+          gboolean ellipse = g_random_boolean ();
+          gfloat   value   = g_random_boolean () ? 1.0 : 0.0;
+          gint     x, y;
+
+          for (y = MAX (cy - ry, 0); y < MIN (cy + ry, HEIGHT); y++)
+            for (x = MAX (cx - rx, 0); x < MIN (cx + rx, WIDTH); x++)
+              {
+                if (ellipse &&
+                    SQR ((x - cx) / (gdouble) rx) +
+                    SQR ((y - cy) / (gdouble) ry) > 1.0)
+                  continue;
+
+                data[y * WIDTH + x] = value;
+              }
+        }
+    }
+
+  buffer = gegl_buffer_new (&test_roi, babl_format ("Y float"));
+
+  gegl_buffer_set (buffer, &test_roi, 0, babl_format ("Y float"), data,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  g_free (data);
+
+  return buffer;
+}
+
+static void
+gimp_test_distance_compare (GeglBuffer *expected,
+                            GeglBuffer *result,
+                            gint        n_rows,
+                            gdouble     epsilon)
+{
+  gfloat *expected_data = g_new (gfloat, WIDTH * HEIGHT);
+  gfloat *result_data   = g_new (gfloat, WIDTH * HEIGHT);
+  gint    i;
+
+  gegl_buffer_get (expected, &test_roi, 1.0, babl_format ("Y float"),
+                   expected_data, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  gegl_buffer_get (result, &test_roi, 1.0, babl_format ("Y float"),
+                   result_data, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (i = 0; i < WIDTH * n_rows; i++)
+    g_assert_cmpfloat (fabs (result_data[i] - expected_data[i]), <=, epsilon);
+
+  g_free (expected_data);
+  g_free (result_data);
+}
+
+static void
+gimp_test_distance_grow_shrink (void)
+{
+  gint m, r;
+
+  g_random_set_seed (1);
+
+  for (m = 0; m < N_MASKS; m++)
+    {
+      GeglBuffer *mask     = gimp_test_distance_make_mask (m);
+      GeglBuffer *expected = gegl_buffer_new (&test_roi, babl_format ("Y float"));
+      GeglBuffer *result   = gegl_buffer_new (&test_roi, babl_format ("Y float"));
+
+      for (r = 0; r < G_N_ELEMENTS (radii); r++)
+        {
+          gint     rx = radii[r].radius_x;
+          gint     ry = radii[r].radius_y;
+          gboolean edge_lock;
+
+          gimp_test_distance_old_grow (mask, expected, &test_roi, rx, ry);
+          g_assert (gimp_gegl_distance_grow (mask, result, &test_roi, rx, ry));
+
+          gimp_test_distance_compare (expected, result, HEIGHT, 0.0);
+
+          for (edge_lock = FALSE; edge_lock <= TRUE; edge_lock++)
+            {
+              gimp_test_distance_old_shrink (mask, expected, &test_roi, rx, ry,
+                                             edge_lock);
+              g_assert (gimp_gegl_distance_shrink (mask, result, &test_roi, rx, ry,
+                                                   edge_lock));
+
+              gimp_test_distance_compare (expected, result, HEIGHT, 0.0);
+            }
+        }
+
+      g_object_unref (mask);
+      g_object_unref (expected);
+      g_object_unref (result);
+    }
+}
+
+static void
+gimp_test_distance_border (void)
+{
+  gint m, r;
+
+  g_random_set_seed (2);
+
+  for (m = 0; m < N_MASKS; m++)
+    {
+      GeglBuffer *mask     = gimp_test_distance_make_mask (m);
+      GeglBuffer *expected = gegl_buffer_new (&test_roi, babl_format ("Y float"));
+      GeglBuffer *result   = gegl_buffer_new (&test_roi, babl_format ("Y float"));
+
+      for (r = 0; r < G_N_ELEMENTS (radii); r++)
+        {
+          gint     rx = radii[r].radius_x;
+          gint     ry = radii[r].radius_y;
+          gboolean feather;
+          gboolean edge_lock;
+
+          /*  the operation keeps its own scan for a radius of one  */
+          if (rx == 1 && ry == 1)
+            continue;
+
+          for (feather = FALSE; feather <= TRUE; feather++)
+            for (edge_lock = FALSE; edge_lock <= TRUE; edge_lock++)
+              {
+                gint n_rows = edge_lock ? MAX (HEIGHT - ry - 1, 0) : HEIGHT;
+
+                gimp_test_distance_old_border (mask, expected, &test_roi, rx, ry,
+                                               feather, edge_lock);
+                gimp_gegl_distance_border (mask, result, &test_roi, rx, ry,
+                                           feather, edge_lock);
+
+                gimp_test_distance_compare (expected, result, n_rows,
+                                            feather ? FEATHER_EPSILON : 0.0);
+              }
+        }
+
+      g_object_unref (mask);
+      g_object_unref (expected);
+      g_object_unref (result);
+    }
+}
+
+/*  radii which don't fit into 16 bits, the old scans can't do these.
+ *  with 16 bit column distances, 65535 and 65536 wrapped to a cap of
+ *  0 and 1 pixels.
+ */
+static void
+gimp_test_distance_huge_radius (void)
+{
+  static const gint huge_radii[] = { 65535, 65536, 70000 };
+
+  GeglBuffer *mask   = gimp_test_distance_make_mask (0);
+  GeglBuffer *result = gegl_buffer_new (&test_roi, babl_format ("Y float"));
+  GeglBuffer *shrunk = gegl_buffer_new (&test_roi, babl_format ("Y float"));
+  gfloat     *data   = g_new (gfloat, WIDTH * HEIGHT);
+  gint        r;
+  gint        i;
+
+  for (r = 0; r < G_N_ELEMENTS (huge_radii); r++)
+    {
+      gint radius = huge_radii[r];
+
+      g_assert (gimp_gegl_distance_grow (mask, result, &test_roi,
+                                         radius, radius));
+
+      gegl_buffer_get (result, &test_roi, 1.0, babl_format ("Y float"), data,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      for (i = 0; i < WIDTH * HEIGHT; i++)
+        g_assert_cmpfloat (data[i], ==, 1.0);
+
+      g_assert (gimp_gegl_distance_shrink (result, shrunk, &test_roi,
+                                           radius, radius, FALSE));
+
+      gegl_buffer_get (shrunk, &test_roi, 1.0, babl_format ("Y float"), data,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      for (i = 0; i < WIDTH * HEIGHT; i++)
+        g_assert_cmpfloat (data[i], ==, 0.0);
+
+      /*  the single pixel is its own edge, and reaches everything  */
+      gimp_gegl_distance_border (mask, result, &test_roi,
+                                 radius, radius, FALSE, FALSE);
+
+      gegl_buffer_get (result, &test_roi, 1.0, babl_format ("Y float"), data,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      for (i = 0; i < WIDTH * HEIGHT; i++)
+        g_assert_cmpfloat (data[i], ==, 1.0);
+    }
+
+  g_free (data);
+  g_object_unref (mask);
+  g_object_unref (result);
+  g_object_unref (shrunk);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gegl_init (&argc, &argv);
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/gimp-gegl-distance/grow-shrink",
+                   gimp_test_distance_grow_shrink);
+  g_test_add_func ("/gimp-gegl-distance/border",
+                   gimp_test_distance_border);
+  g_test_add_func ("/gimp-gegl-distance/huge-radius",
+                   gimp_test_distance_huge_radius);
+
+  return g_test_run ();
+}
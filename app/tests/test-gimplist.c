@@ -0,0 +1,229 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+
+#include "core/core-types.h"
+
+#include "core/gimplist.h"
+
+
+/* Does the same random adds, removes, renames and reorders to an
+ * indexed list and to a plain one, and checks that both end up with
+ * the same names in the same order, and that the indexed lookups agree
+ * with the plain ones.
+ */
+
+
+#define N_STEPS 2000
+
+
+static const gchar *names[] =
+{
+  "Layer",
+  "Layer #1",
+  "Layer #2",
+  "Layer #001",
+  "Layer #01",
+  "Layer #1 #1",
+  "Background"
+};
+
+
+static GimpObject *
+gimp_test_list_add (GimpContainer *container,
+                    const gchar   *name)
+{
+  GimpObject *object = g_object_new (GIMP_TYPE_OBJECT,
+                                     "name", name,
+                                     NULL);
+
+  gimp_container_add (container, object);
+  g_object_unref (object);
+
+  return object;
+}
+
+static void
+gimp_test_list_check (GimpContainer *indexed,
+                      GimpContainer *plain)
+{
+  gint n_children = gimp_container_get_n_children (plain);
+  gint i;
+
+  g_assert_cmpint (gimp_container_get_n_children (indexed), ==, n_children);
+
+  for (i = 0; i < n_children; i++)
+    {
+      GimpObject  *object  = gimp_container_get_child_by_index (indexed, i);
+      GimpObject  *object2 = gimp_container_get_child_by_index (plain, i);
+      const gchar *name    = gimp_object_get_name (object);
+
+      g_assert_cmpstr (name, ==, gimp_object_get_name (object2));
+
+      g_assert_cmpint (gimp_container_get_child_index (indexed, object),
+                       ==, i);
+      g_assert (gimp_container_get_child_by_name (indexed, name) == object);
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (names); i++)
+    {
+      GimpObject *object  = gimp_container_get_child_by_name (indexed,
+                                                              names[i]);
+      GimpObject *object2 = gimp_container_get_child_by_name (plain,
+                                                              names[i]);
+
+      g_assert ((object == NULL) == (object2 == NULL));
+
+      if (object)
+        g_assert_cmpint (gimp_container_get_child_index (indexed, object),
+                         ==,
+                         gimp_container_get_child_index (plain, object2));
+    }
+}
+
+static void
+gimp_test_list_unique_names (void)
+{
+  GimpContainer *container = gimp_list_new_indexed (GIMP_TYPE_OBJECT, TRUE);
+  GimpObject    *object;
+  gint           i;
+
+  for (i = 0; i < 3; i++)
+    gimp_test_list_add (container, "Layer");
+
+  g_assert (gimp_container_get_child_by_name (container, "Layer"));
+  g_assert (gimp_container_get_child_by_name (container, "Layer #1"));
+  g_assert (gimp_container_get_child_by_name (container, "Layer #2"));
+
+  /*  "#001" is a different number than "#1"  */
+  object = gimp_test_list_add (container, "Layer #001");
+  g_assert_cmpstr (gimp_object_get_name (object), ==, "Layer #001");
+
+  /*  reordering must not count the names again  */
+  for (i = 0; i < 4; i++)
+    {
+      gimp_list_reverse (GIMP_LIST (container));
+      gimp_list_sort_by_name (GIMP_LIST (container));
+    }
+
+  gimp_container_remove (container,
+                         gimp_container_get_child_by_name (container,
+                                                           "Layer #1"));
+
+  object = gimp_test_list_add (container, "Layer");
+  g_assert_cmpstr (gimp_object_get_name (object), ==, "Layer #1");
+
+  /*  a renamed child frees its old number  */
+  object = gimp_container_get_child_by_name (container, "Layer #2");
+  gimp_object_set_name (object, "Background");
+
+  object = gimp_test_list_add (container, "Layer");
+  g_assert_cmpstr (gimp_object_get_name (object), ==, "Layer #2");
+
+  g_object_unref (container);
+}
+
+static void
+gimp_test_list_random (void)
+{
+  GimpContainer *indexed = gimp_list_new_indexed (GIMP_TYPE_OBJECT, TRUE);
+  GimpContainer *plain   = gimp_list_new (GIMP_TYPE_OBJECT, TRUE);
+  gint           step;
+
+  g_random_set_seed (0);
+
+  for (step = 0; step < N_STEPS; step++)
+    {
+      gint         n_children = gimp_container_get_n_children (plain);
+      gint         index      = 0;
+      const gchar *name;
+
+      name = names[g_random_int_range (0, G_N_ELEMENTS (names))];
+
+      if (n_children)
+        index = g_random_int_range (0, n_children);
+
+      switch (n_children ? g_random_int_range (0, 6) : 0)
+        {
+        case 0:
+          gimp_test_list_add (indexed, name);
+          gimp_test_list_add (plain,   name);
+          break;
+
+        case 1:
+          gimp_container_remove (indexed,
+                                 gimp_container_get_child_by_index (indexed,
+                                                                    index));
+          gimp_container_remove (plain,
+                                 gimp_container_get_child_by_index (plain,
+                                                                    index));
+          break;
+
+        case 2:
+          gimp_object_set_name (gimp_container_get_child_by_index (indexed,
+                                                                   index),
+                                name);
+          gimp_object_set_name (gimp_container_get_child_by_index (plain,
+                                                                   index),
+                                name);
+          break;
+
+        case 3:
+          {
+            gint new_index = g_random_int_range (0, n_children);
+
+            gimp_container_reorder (indexed,
+                                    gimp_container_get_child_by_index (indexed,
+                                                                       index),
+                                    new_index);
+            gimp_container_reorder (plain,
+                                    gimp_container_get_child_by_index (plain,
+                                                                       index),
+                                    new_index);
+          }
+          break;
+
+        case 4:
+          gimp_list_reverse (GIMP_LIST (indexed));
+          gimp_list_reverse (GIMP_LIST (plain));
+          break;
+
+        case 5:
+          gimp_list_sort_by_name (GIMP_LIST (indexed));
+          gimp_list_sort_by_name (GIMP_LIST (plain));
+          break;
+        }
+
+      gimp_test_list_check (indexed, plain);
+    }
+
+  g_object_unref (indexed);
+  g_object_unref (plain);
+}
+
+int main(int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/gimplist/unique-names", gimp_test_list_unique_names);
+  g_test_add_func ("/gimplist/random",       gimp_test_list_random);
+
+  return g_test_run ();
+}
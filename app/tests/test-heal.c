@@ -0,0 +1,172 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gegl.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "paint/paint-types.h"
+
+#include "paint/gimpheal.h"
+
+
+/* Compares the plain SOR heal solver with the multi-grid one on round
+ * brushes of increasing size. Run with -m perf to get the timings.
+ */
+
+
+#define DEPTH     4
+#define MAX_ITER  500
+#define TOLERANCE (2.0 / 255.0)
+
+
+static const gint brush_sizes[] = { 32, 64, 128, 256, 384, 512 };
+
+
+static void
+gimp_test_heal_fill (gfloat *pixels,
+                     guchar *mask,
+                     gint    size)
+{
+  gint  radius = size / 2;
+  gint  i, j, k;
+
+  for (i = 0; i < size; i++)
+    for (j = 0; j < size; j++)
+      {
+        gint dx = j - radius;
+        gint dy = i - radius;
+
+        mask[i * size + j] = (dx * dx + dy * dy < (radius - 1) * (radius - 1));
+
+        for (k = 0; k < DEPTH; k++)
+          pixels[(i * size + j) * DEPTH + k] =
+            0.5 + 0.25 * sin ((k + 1) * 2.0 * G_PI * i / size) *
+                         cos ((k + 1) * 2.0 * G_PI * j / size) +
+            0.1 * g_random_double ();
+      }
+}
+
+static gint
+gimp_test_heal_solve (const gfloat  *input,
+                      gfloat        *output,
+                      const guchar  *mask,
+                      gint           size,
+                      gboolean       multigrid,
+                      gdouble       *seconds)
+{
+  GTimer *timer = g_timer_new ();
+  gint    iterations;
+
+  memcpy (output, input, sizeof (gfloat) * size * size * DEPTH);
+
+  g_timer_start (timer);
+
+  iterations = gimp_heal_laplace_loop (output, size, DEPTH, size,
+                                       mask, multigrid);
+
+  *seconds = g_timer_elapsed (timer, NULL);
+
+  g_timer_destroy (timer);
+
+  return iterations;
+}
+
+static void
+gimp_test_heal_multigrid_matches_sor (gconstpointer data)
+{
+  gint     size = GPOINTER_TO_INT (data);
+  gint     n    = size * size * DEPTH;
+  gfloat  *input;
+  gfloat  *sor;
+  gfloat  *multigrid;
+  guchar  *mask;
+  gint     sor_iterations;
+  gint     multigrid_iterations;
+  gdouble  sor_time;
+  gdouble  multigrid_time;
+  gdouble  max_diff = 0.0;
+  gint     i;
+
+  input     = gegl_malloc (sizeof (gfloat) * (n + DEPTH));
+  sor       = gegl_malloc (sizeof (gfloat) * (n + DEPTH));
+  multigrid = gegl_malloc (sizeof (gfloat) * (n + DEPTH));
+  mask      = g_new (guchar, size * size);
+
+  g_random_set_seed (size);
+
+  gimp_test_heal_fill (input, mask, size);
+
+  sor_iterations       = gimp_test_heal_solve (input, sor, mask, size,
+                                               FALSE, &sor_time);
+  multigrid_iterations = gimp_test_heal_solve (input, multigrid, mask, size,
+                                               TRUE, &multigrid_time);
+
+  for (i = 0; i < n; i++)
+    max_diff = MAX (max_diff, fabs (sor[i] - multigrid[i]));
+
+  if (g_test_perf ())
+    {
+      g_test_message ("brush %3dpx: SOR %3d iterations %8.2f ms, "
+                      "multigrid %3d iterations %8.2f ms, max diff %g",
+                      size,
+                      sor_iterations,       sor_time       * 1000.0,
+                      multigrid_iterations, multigrid_time * 1000.0,
+                      max_diff);
+
+      g_test_minimized_result (multigrid_time, "heal %dpx multigrid", size);
+    }
+
+  /*  both solvers must agree wherever plain SOR converged  */
+  if (sor_iterations < MAX_ITER)
+    g_assert_cmpfloat (max_diff, <, TOLERANCE);
+
+  g_assert_cmpint (multigrid_iterations, <=, sor_iterations);
+
+  gegl_free (input);
+  gegl_free (sor);
+  gegl_free (multigrid);
+  g_free (mask);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gint i;
+
+  gegl_init (&argc, &argv);
+  g_test_init (&argc, &argv, NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (brush_sizes); i++)
+    {
+      gchar *path = g_strdup_printf ("/gimpheal/multigrid-matches-sor/%d",
+                                     brush_sizes[i]);
+
+      g_test_add_data_func (path, GINT_TO_POINTER (brush_sizes[i]),
+                            gimp_test_heal_multigrid_matches_sor);
+
+      g_free (path);
+    }
+
+  return g_test_run ();
+}
@@ -0,0 +1,266 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "core/core-types.h"
+
+#include "gegl/gimp-gegl-mask.h"
+
+#include "core/gimp.h"
+#include "core/gimpchannel.h"
+#include "core/gimpchannel-combine.h"
+#include "core/gimpimage.h"
+#include "core/gimpmasktiles.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+/* Changes a selection mask in the ways which keep its tile summary up
+ * to date, and checks that every tile state known to the summary
+ * matches the pixels, and that the bounds, emptiness and fullness
+ * found from the summary match the ones found from the pixels.
+ */
+
+
+#define GIMP_TEST_IMAGE_WIDTH  300
+#define GIMP_TEST_IMAGE_HEIGHT 200
+#define GIMP_TEST_STEP         16
+
+
+static Gimp *gimp = NULL;
+
+
+static GimpMaskTileState
+gimp_test_mask_tiles_get_pixel_state (GeglBuffer          *buffer,
+                                      const GeglRectangle *rect)
+{
+  gfloat   *data = g_new (gfloat, rect->width * rect->height);
+  gboolean  any  = FALSE;
+  gboolean  all  = TRUE;
+  gint      i;
+
+  gegl_buffer_get (buffer, rect, 1.0, babl_format ("Y float"), data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (i = 0; i < rect->width * rect->height; i++)
+    {
+      if (data[i] != 0.0)
+        any = TRUE;
+
+      if (data[i] != 1.0)
+        all = FALSE;
+    }
+
+  g_free (data);
+
+  if (all)
+    return GIMP_MASK_TILE_FULL;
+  else if (! any)
+    return GIMP_MASK_TILE_EMPTY;
+  else
+    return GIMP_MASK_TILE_PARTIAL;
+}
+
+/*  checks the tiles the summary knows about, without making it look
+ *  at any pixels, and returns the number of unknown tiles seen
+ */
+static gint
+gimp_test_mask_tiles_check_states (GimpChannel *mask)
+{
+  GeglBuffer *buffer    = gimp_drawable_get_buffer (GIMP_DRAWABLE (mask));
+  gint        n_unknown = 0;
+  gint        x, y;
+
+  for (y = 0; y < GIMP_TEST_IMAGE_HEIGHT; y += GIMP_TEST_STEP)
+    for (x = 0; x < GIMP_TEST_IMAGE_WIDTH; x += GIMP_TEST_STEP)
+      {
+        GimpMaskTileState state;
+        GeglRectangle     rect;
+
+        state = gimp_mask_tiles_get_state (mask->mask_tiles, x, y, &rect);
+
+        if (state == GIMP_MASK_TILE_UNKNOWN)
+          n_unknown++;
+        else
+          g_assert_cmpint (state, ==,
+                           gimp_test_mask_tiles_get_pixel_state (buffer,
+                                                                 &rect));
+      }
+
+  return n_unknown;
+}
+
+static void
+gimp_test_mask_tiles_check_bounds (GimpChannel *mask)
+{
+  GeglBuffer    *buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (mask));
+  GeglRectangle  extent = *gegl_buffer_get_extent (buffer);
+  gboolean       expected_empty;
+  gboolean       expected_full;
+  gint           x1, y1, x2, y2;
+  gint           x, y, width, height;
+
+  expected_empty = ! gimp_gegl_mask_bounds (buffer, &x1, &y1, &x2, &y2);
+
+  g_assert_cmpint (gimp_channel_is_empty (mask), ==, expected_empty);
+
+  if (! expected_empty)
+    {
+      g_assert (gimp_item_bounds (GIMP_ITEM (mask), &x, &y, &width, &height));
+
+      g_assert_cmpint (x,          ==, x1);
+      g_assert_cmpint (y,          ==, y1);
+      g_assert_cmpint (x + width,  ==, x2);
+      g_assert_cmpint (y + height, ==, y2);
+    }
+
+  expected_full = (gimp_test_mask_tiles_get_pixel_state (buffer, &extent) ==
+                   GIMP_MASK_TILE_FULL);
+
+  g_assert_cmpint (gimp_channel_is_full (mask), ==, expected_full);
+
+  /*  whatever was looked at must still be right  */
+  gimp_test_mask_tiles_check_states (mask);
+}
+
+static void
+gimp_test_mask_tiles_summary (void)
+{
+  GimpImage   *image;
+  GimpChannel *mask;
+  GeglBuffer  *buffer;
+  gfloat      *data;
+  gint         i;
+
+  g_random_set_seed (0);
+
+  image = gimp_image_new (gimp,
+                          GIMP_TEST_IMAGE_WIDTH,
+                          GIMP_TEST_IMAGE_HEIGHT,
+                          GIMP_RGB,
+                          GIMP_PRECISION_U8_GAMMA);
+
+  mask   = gimp_image_get_mask (image);
+  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (mask));
+
+  /*  a new mask is empty  */
+  gimp_test_mask_tiles_check_bounds (mask);
+  g_assert (gimp_channel_is_empty (mask));
+
+  /*  a rect's inner tiles are known right away, without a scan  */
+  gimp_channel_combine_rect (mask, GIMP_CHANNEL_OP_ADD, 37, 21, 200, 150);
+
+  g_assert_cmpint (gimp_mask_tiles_get_state (mask->mask_tiles, 100, 100,
+                                              NULL),
+                   ==, GIMP_MASK_TILE_FULL);
+  gimp_test_mask_tiles_check_states (mask);
+  gimp_test_mask_tiles_check_bounds (mask);
+
+  gimp_channel_combine_rect (mask, GIMP_CHANNEL_OP_SUBTRACT, 64, 64, 64, 64);
+
+  g_assert_cmpint (gimp_mask_tiles_get_state (mask->mask_tiles, 100, 100,
+                                              NULL),
+                   ==, GIMP_MASK_TILE_EMPTY);
+  gimp_test_mask_tiles_check_states (mask);
+  gimp_test_mask_tiles_check_bounds (mask);
+
+  /*  all and clear make every tile known  */
+  gimp_channel_all (mask, FALSE);
+
+  g_assert_cmpint (gimp_test_mask_tiles_check_states (mask), ==, 0);
+  g_assert (gimp_channel_is_full (mask));
+  gimp_test_mask_tiles_check_bounds (mask);
+
+  gimp_channel_combine_rect (mask, GIMP_CHANNEL_OP_SUBTRACT,
+                             GIMP_TEST_IMAGE_WIDTH - 1,
+                             GIMP_TEST_IMAGE_HEIGHT - 1, 1, 1);
+
+  g_assert (! gimp_channel_is_full (mask));
+  gimp_test_mask_tiles_check_bounds (mask);
+
+  gimp_channel_clear (mask, NULL, FALSE);
+
+  g_assert_cmpint (gimp_test_mask_tiles_check_states (mask), ==, 0);
+  g_assert (gimp_channel_is_empty (mask));
+  gimp_test_mask_tiles_check_bounds (mask);
+
+  /*  writing to the buffer directly forgets everything  */
+  data = g_new0 (gfloat, GIMP_TEST_IMAGE_WIDTH * GIMP_TEST_IMAGE_HEIGHT);
+
+  for (i = 0; i < 8; i++)
+    {
+      gint x = g_random_int_range (0, GIMP_TEST_IMAGE_WIDTH);
+      gint y = g_random_int_range (0, GIMP_TEST_IMAGE_HEIGHT);
+
+      data[y * GIMP_TEST_IMAGE_WIDTH + x] = g_random_double_range (0.1, 1.0);
+    }
+
+  gegl_buffer_set (buffer, NULL, 0, babl_format ("Y float"), data,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  gimp_channel_invalidate_bounds (mask);
+
+  g_assert_cmpint (gimp_test_mask_tiles_check_states (mask), >, 0);
+  gimp_test_mask_tiles_check_bounds (mask);
+
+  for (i = 0; i < GIMP_TEST_IMAGE_WIDTH * GIMP_TEST_IMAGE_HEIGHT; i++)
+    data[i] = 1.0;
+
+  gegl_buffer_set (buffer, NULL, 0, babl_format ("Y float"), data,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  gimp_channel_invalidate_bounds (mask);
+
+  g_assert (gimp_channel_is_full (mask));
+  gimp_test_mask_tiles_check_bounds (mask);
+
+  g_free (data);
+
+  g_object_unref (image);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  int result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  gimp = gimp_init_for_testing ();
+
+  g_test_add_func ("/gimpmasktiles/summary",
+                   gimp_test_mask_tiles_summary);
+
+  result = g_test_run ();
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
@@ -0,0 +1,421 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "paint/paint-types.h"
+
+#include "gegl/gimp-gegl-apply-operation.h"
+
+#include "core/gimp.h"
+#include "core/gimpbrush.h"
+#include "core/gimpcontainer.h"
+#include "core/gimpcontext.h"
+#include "core/gimpdynamics.h"
+#include "core/gimpdynamicsoutput.h"
+#include "core/gimpimage.h"
+#include "core/gimplayer.h"
+#include "core/gimplayer-new.h"
+#include "core/gimpmybrush.h"
+#include "core/gimppaintinfo.h"
+#include "core/gimppattern.h"
+
+#include "paint/gimpbrushcore.h"
+#include "paint/gimppaintcore.h"
+#include "paint/gimppaintcore-record.h"
+#include "paint/gimppaintoptions.h"
+#include "paint/gimpsourcecore.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+/* Replays one stroke through every paint core and reports dabs per
+ * second, time per event and peak memory. The stroke is read from
+ * the file named by $GIMP_TEST_PAINT_STROKE, as recorded by the paint
+ * tools when $GIMP_PAINT_RECORD_DIR is set, or synthesized otherwise.
+ * Run with --verbose to see the numbers.
+ *
+ * Also checks that the brush cores allocate their scratch buffers
+ * once per stroke, however much the dynamics change the brush size.
+ */
+
+
+#define GIMP_TEST_IMAGE_SIZE 2048
+#define GIMP_TEST_N_EVENTS   1024
+
+
+static const gchar *paint_infos[] =
+{
+  "gimp-paintbrush",
+  "gimp-airbrush",
+  "gimp-clone",
+  "gimp-heal",
+  "gimp-smudge",
+  "gimp-ink",
+  "gimp-mybrush",
+  "gimp-dodge-burn",
+  "gimp-convolve"
+};
+
+
+static Gimp                *gimp   = NULL;
+static GimpPaintCoreRecord *stroke = NULL;
+
+
+static GimpPaintCoreRecord *
+gimp_test_paint_core_synthesize_stroke (void)
+{
+  GimpPaintCoreRecord *record = gimp_paint_core_record_new (NULL);
+  GimpCoords           coords = GIMP_COORDS_DEFAULT_VALUES;
+  gint                 i;
+
+  /*  a spiral around the image center, well inside the image  */
+  for (i = 0; i < GIMP_TEST_N_EVENTS; i++)
+    {
+      gdouble t      = (gdouble) i / GIMP_TEST_N_EVENTS;
+      gdouble radius = GIMP_TEST_IMAGE_SIZE * (0.05 + 0.3 * t);
+      gdouble angle  = 6.0 * G_PI * t;
+
+      coords.x        = GIMP_TEST_IMAGE_SIZE / 2 + radius * cos (angle);
+      coords.y        = GIMP_TEST_IMAGE_SIZE / 2 + radius * sin (angle);
+      coords.pressure = 0.5 + 0.5 * sin (8.0 * G_PI * t);
+
+      gimp_paint_core_record_add_event (record, &coords, i * 8);
+    }
+
+  return record;
+}
+
+static glong
+gimp_test_paint_core_get_peak_memory (void)
+{
+#ifdef HAVE_SYS_RESOURCE_H
+  struct rusage usage;
+
+  if (getrusage (RUSAGE_SELF, &usage) == 0)
+    return usage.ru_maxrss;
+#endif
+
+  return -1;
+}
+
+static GimpLayer *
+gimp_test_paint_core_create_layer (GimpImage *image)
+{
+  GimpLayer *layer;
+  GeglNode  *checkerboard;
+
+  layer = gimp_layer_new (image,
+                          GIMP_TEST_IMAGE_SIZE,
+                          GIMP_TEST_IMAGE_SIZE,
+                          gimp_image_get_layer_format (image, TRUE),
+                          "Test Layer",
+                          GIMP_OPACITY_OPAQUE,
+                          GIMP_LAYER_MODE_NORMAL);
+
+  gimp_image_add_layer (image, layer, GIMP_IMAGE_ACTIVE_PARENT, 0, FALSE);
+
+  /*  give the smudge, heal and convolve cores some structure to work on  */
+  checkerboard = gegl_node_new_child (NULL,
+                                      "operation", "gegl:checkerboard",
+                                      "x",         32,
+                                      "y",         32,
+                                      NULL);
+
+  gimp_gegl_apply_operation (NULL, NULL, NULL, checkerboard,
+                             gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
+                             NULL);
+
+  g_object_unref (checkerboard);
+
+  return layer;
+}
+
+static GimpPaintOptions *
+gimp_test_paint_core_get_options (GimpPaintInfo *paint_info)
+{
+  GimpPaintOptions *options;
+  GimpContext      *context;
+
+  if (stroke->paint_options &&
+      stroke->paint_options->paint_info == paint_info)
+    {
+      return g_object_ref (stroke->paint_options);
+    }
+
+  options = gimp_paint_options_new (paint_info);
+  context = GIMP_CONTEXT (options);
+
+  gimp_context_set_brush    (context, GIMP_BRUSH    (gimp_brush_get_standard    (context)));
+  gimp_context_set_dynamics (context, GIMP_DYNAMICS (gimp_dynamics_get_standard (context)));
+  gimp_context_set_mybrush  (context, GIMP_MYBRUSH  (gimp_mybrush_get_standard  (context)));
+  gimp_context_set_pattern  (context, GIMP_PATTERN  (gimp_pattern_get_standard  (context)));
+
+  return options;
+}
+
+static void
+gimp_test_paint_core_replay (gconstpointer data)
+{
+  const gchar      *name = data;
+  GimpPaintInfo    *paint_info;
+  GimpImage        *image;
+  GimpLayer        *layer;
+  GimpPaintOptions *options;
+  GimpPaintCore    *core;
+  GTimer           *timer;
+  gdouble           seconds;
+  glong             peak_memory;
+  GError           *error = NULL;
+
+  paint_info = (GimpPaintInfo *)
+    gimp_container_get_child_by_name (gimp->paint_info_list, name);
+
+  if (! paint_info)
+    {
+      g_test_message ("%s is not available, skipping", name);
+      return;
+    }
+
+  image = gimp_image_new (gimp,
+                          GIMP_TEST_IMAGE_SIZE,
+                          GIMP_TEST_IMAGE_SIZE,
+                          GIMP_RGB,
+                          GIMP_PRECISION_U8_GAMMA);
+
+  layer = gimp_test_paint_core_create_layer (image);
+
+  options = gimp_test_paint_core_get_options (paint_info);
+
+  core = g_object_new (paint_info->paint_type,
+                       "undo-desc", paint_info->blurb,
+                       NULL);
+
+  if (GIMP_IS_SOURCE_CORE (core))
+    g_object_set (core,
+                  "src-drawable", layer,
+                  "src-x",        GIMP_TEST_IMAGE_SIZE / 4,
+                  "src-y",        GIMP_TEST_IMAGE_SIZE / 4,
+                  NULL);
+
+  timer = g_timer_new ();
+
+  if (! gimp_paint_core_record_replay (stroke, core, GIMP_DRAWABLE (layer),
+                                       options, FALSE, &error))
+    {
+      g_test_message ("%s could not paint: %s, skipping",
+                      name, error->message);
+      g_clear_error (&error);
+    }
+  else
+    {
+      seconds     = g_timer_elapsed (timer, NULL);
+      peak_memory = gimp_test_paint_core_get_peak_memory ();
+
+      g_test_message ("%-16s %6u dabs %10.1f dabs/s %8.3f ms/event "
+                      "%4u scratch allocations, peak memory %ld kB",
+                      name,
+                      core->n_dabs,
+                      core->n_dabs / MAX (seconds, 1e-9),
+                      seconds * 1000.0 / stroke->events->len,
+                      core->n_scratch_allocs,
+                      peak_memory);
+
+      if (g_test_perf ())
+        g_test_minimized_result (seconds, "%s stroke", name);
+
+      g_assert_cmpuint (core->n_dabs, >, 0);
+    }
+
+  g_timer_destroy (timer);
+
+  g_object_unref (core);
+  g_object_unref (options);
+  g_object_unref (image);
+}
+
+static guint
+gimp_test_paint_core_count_scratch_allocs (GimpPaintInfo *paint_info,
+                                           GimpDynamics  *dynamics)
+{
+  GimpImage        *image;
+  GimpLayer        *layer;
+  GimpPaintOptions *options;
+  GimpPaintCore    *core;
+  guint             n_scratch_allocs;
+  GError           *error = NULL;
+
+  image = gimp_image_new (gimp,
+                          GIMP_TEST_IMAGE_SIZE,
+                          GIMP_TEST_IMAGE_SIZE,
+                          GIMP_RGB,
+                          GIMP_PRECISION_U8_GAMMA);
+
+  layer = gimp_test_paint_core_create_layer (image);
+
+  options = gimp_paint_options_new (paint_info);
+
+  gimp_context_set_brush    (GIMP_CONTEXT (options),
+                             GIMP_BRUSH (gimp_brush_get_standard (GIMP_CONTEXT (options))));
+  gimp_context_set_dynamics (GIMP_CONTEXT (options), dynamics);
+
+  core = g_object_new (paint_info->paint_type,
+                       "undo-desc", paint_info->blurb,
+                       NULL);
+
+  if (GIMP_IS_SOURCE_CORE (core))
+    g_object_set (core,
+                  "src-drawable", layer,
+                  "src-x",        GIMP_TEST_IMAGE_SIZE / 4,
+                  "src-y",        GIMP_TEST_IMAGE_SIZE / 4,
+                  NULL);
+
+  if (! gimp_paint_core_record_replay (stroke, core, GIMP_DRAWABLE (layer),
+                                       options, FALSE, &error))
+    g_error ("%s could not paint: %s", paint_info->blurb, error->message);
+
+  g_assert_cmpuint (core->n_dabs, >, 0);
+
+  n_scratch_allocs = core->n_scratch_allocs;
+
+  g_object_unref (core);
+  g_object_unref (options);
+  g_object_unref (image);
+
+  return n_scratch_allocs;
+}
+
+static void
+gimp_test_paint_core_scratch (gconstpointer data)
+{
+  const gchar   *name = data;
+  GimpPaintInfo *paint_info;
+  GimpDynamics  *fixed_size;
+  GimpDynamics  *pressure_size;
+  guint          n_fixed;
+  guint          n_pressure;
+
+  paint_info = (GimpPaintInfo *)
+    gimp_container_get_child_by_name (gimp->paint_info_list, name);
+
+  if (! paint_info ||
+      ! g_type_is_a (paint_info->paint_type, GIMP_TYPE_BRUSH_CORE))
+    {
+      g_test_message ("%s doesn't use a brush, skipping", name);
+      return;
+    }
+
+  fixed_size    = GIMP_DYNAMICS (gimp_dynamics_new (NULL, "Fixed Size"));
+  pressure_size = GIMP_DYNAMICS (gimp_dynamics_new (NULL, "Pressure Size"));
+
+  g_object_set (gimp_dynamics_get_output (pressure_size,
+                                          GIMP_DYNAMICS_OUTPUT_SIZE),
+                "use-pressure", TRUE,
+                NULL);
+
+  n_fixed    = gimp_test_paint_core_count_scratch_allocs (paint_info,
+                                                          fixed_size);
+  n_pressure = gimp_test_paint_core_count_scratch_allocs (paint_info,
+                                                          pressure_size);
+
+  g_test_message ("%-16s %4u scratch allocations with a fixed size, "
+                  "%4u with pressure size",
+                  name, n_fixed, n_pressure);
+
+  /*  every dab of a fixed size stroke fits into the first buffers  */
+  g_assert_cmpuint (n_pressure, ==, n_fixed);
+
+  g_object_unref (fixed_size);
+  g_object_unref (pressure_size);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  const gchar *stroke_file;
+  gint         result;
+  gint         i;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  gimp = gimp_init_for_testing ();
+
+  stroke_file = g_getenv ("GIMP_TEST_PAINT_STROKE");
+
+  if (stroke_file)
+    {
+      GFile  *file  = g_file_new_for_path (stroke_file);
+      GError *error = NULL;
+
+      stroke = gimp_paint_core_record_load (gimp, file, &error);
+
+      if (! stroke)
+        g_error ("%s", error->message);
+
+      g_object_unref (file);
+    }
+  else
+    {
+      stroke = gimp_test_paint_core_synthesize_stroke ();
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (paint_infos); i++)
+    {
+      gchar *path = g_strdup_printf ("/gimp-paint-core/replay/%s",
+                                     paint_infos[i]);
+
+      g_test_add_data_func (path, paint_infos[i],
+                            gimp_test_paint_core_replay);
+
+      g_free (path);
+
+      path = g_strdup_printf ("/gimp-paint-core/scratch/%s",
+                              paint_infos[i]);
+
+      g_test_add_data_func (path, paint_infos[i],
+                            gimp_test_paint_core_scratch);
+
+      g_free (path);
+    }
+
+  result = g_test_run ();
+
+  gimp_paint_core_record_free (stroke);
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
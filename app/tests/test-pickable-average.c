@@ -0,0 +1,214 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "core/core-types.h"
+
+#include "core/gimp.h"
+#include "core/gimpdrawable.h"
+#include "core/gimpimage.h"
+#include "core/gimplayer.h"
+#include "core/gimplayer-new.h"
+#include "core/gimppickable.h"
+#include "core/gimppickable-average.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+/* Averages random rectangles of a layer with gimp_pickable_get_average()
+ * and by reading every pixel, before and after parts of the layer are
+ * changed, and compares the results.
+ */
+
+
+#define GIMP_TEST_IMAGE_WIDTH  300
+#define GIMP_TEST_IMAGE_HEIGHT 200
+#define GIMP_TEST_N_RECTS      200
+#define GIMP_TEST_N_CHANGES    8
+#define GIMP_TEST_EPSILON      1e-9
+
+
+static Gimp *gimp = NULL;
+
+
+static void
+gimp_test_pickable_average_fill (GeglBuffer          *buffer,
+                                 const GeglRectangle *rect)
+{
+  const Babl *format = gegl_buffer_get_format (buffer);
+  gint        bpp    = babl_format_get_bytes_per_pixel (format);
+  gint        size   = rect->width * rect->height * bpp;
+  guchar     *data   = g_new (guchar, size);
+  gint        i;
+
+  for (i = 0; i < size; i++)
+    data[i] = g_random_int_range (0, 256);
+
+  gegl_buffer_set (buffer, rect, 0, format, data, GEGL_AUTO_ROWSTRIDE);
+
+  g_free (data);
+}
+
+static void
+gimp_test_pickable_average_random_rect (GeglRectangle *rect)
+{
+  /*  partly outside of the layer, and across blocks  */
+  rect->x      = g_random_int_range (-16, GIMP_TEST_IMAGE_WIDTH);
+  rect->y      = g_random_int_range (-16, GIMP_TEST_IMAGE_HEIGHT);
+  rect->width  = g_random_int_range (1, 160);
+  rect->height = g_random_int_range (1, 160);
+}
+
+static void
+gimp_test_pickable_average_compare (GimpPickable *pickable)
+{
+  GeglBuffer *buffer = gimp_pickable_get_buffer (pickable);
+  gint        i;
+
+  for (i = 0; i < GIMP_TEST_N_RECTS; i++)
+    {
+      GeglRectangle  rect;
+      GeglRectangle  area;
+      gdouble        average[4];
+      gdouble        expected[4] = { 0.0, 0.0, 0.0, 0.0 };
+      gdouble       *data;
+      gint           n_pixels;
+      gint           k, c;
+
+      gimp_test_pickable_average_random_rect (&rect);
+
+      n_pixels = gimp_pickable_get_average (pickable, &rect, average);
+
+      if (! gegl_rectangle_intersect (&area, &rect,
+                                      gegl_buffer_get_extent (buffer)))
+        {
+          g_assert_cmpint (n_pixels, ==, 0);
+          continue;
+        }
+
+      g_assert_cmpint (n_pixels, ==, area.width * area.height);
+
+      data = g_new (gdouble, n_pixels * 4);
+
+      gegl_buffer_get (buffer, &area, 1.0,
+                       babl_format ("RaGaBaA double"), data,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      for (k = 0; k < n_pixels; k++)
+        for (c = 0; c < 4; c++)
+          expected[c] += data[k * 4 + c];
+
+      for (c = 0; c < 4; c++)
+        g_assert_cmpfloat (fabs (average[c] - expected[c] / n_pixels),
+                           <=, GIMP_TEST_EPSILON);
+
+      g_free (data);
+    }
+}
+
+static void
+gimp_test_pickable_average_layer (void)
+{
+  GimpImage  *image;
+  GimpLayer  *layer;
+  GeglBuffer *buffer;
+  gint        i;
+
+  g_random_set_seed (0);
+
+  image = gimp_image_new (gimp,
+                          GIMP_TEST_IMAGE_WIDTH,
+                          GIMP_TEST_IMAGE_HEIGHT,
+                          GIMP_RGB,
+                          GIMP_PRECISION_U8_GAMMA);
+
+  layer = gimp_layer_new (image,
+                          GIMP_TEST_IMAGE_WIDTH,
+                          GIMP_TEST_IMAGE_HEIGHT,
+                          gimp_image_get_layer_format (image, TRUE),
+                          "Test Layer",
+                          GIMP_OPACITY_OPAQUE,
+                          GIMP_LAYER_MODE_NORMAL);
+
+  gimp_image_add_layer (image, layer, GIMP_IMAGE_ACTIVE_PARENT, 0, FALSE);
+
+  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+
+  gimp_test_pickable_average_fill (buffer,
+                                   GEGL_RECTANGLE (0, 0,
+                                                   GIMP_TEST_IMAGE_WIDTH,
+                                                   GIMP_TEST_IMAGE_HEIGHT));
+
+  gimp_test_pickable_average_compare (GIMP_PICKABLE (layer));
+
+  /*  the cached sums of changed blocks must be dropped  */
+  for (i = 0; i < GIMP_TEST_N_CHANGES; i++)
+    {
+      GeglRectangle rect;
+
+      gimp_test_pickable_average_random_rect (&rect);
+
+      gegl_rectangle_intersect (&rect, &rect,
+                                gegl_buffer_get_extent (buffer));
+
+      if (rect.width > 0 && rect.height > 0)
+        {
+          gimp_test_pickable_average_fill (buffer, &rect);
+
+          gimp_drawable_update (GIMP_DRAWABLE (layer),
+                                rect.x, rect.y, rect.width, rect.height);
+        }
+
+      gimp_test_pickable_average_compare (GIMP_PICKABLE (layer));
+    }
+
+  g_object_unref (image);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  int result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  gimp = gimp_init_for_testing ();
+
+  g_test_add_func ("/gimppickable/average/layer",
+                   gimp_test_pickable_average_layer);
+
+  result = g_test_run ();
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
@@ -0,0 +1,279 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <cairo.h>
+#include <gegl.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "core/core-types.h"
+
+#include "core/gimpscanconvert.h"
+
+
+/* Fills random paths with GimpScanConvert and with cairo, the way
+ * fills were rendered before GimpScanConvert rasterized them itself,
+ * and compares the results. Cairo samples fewer rows per pixel and
+ * flattens curves differently, so edge pixels may differ slightly. Run
+ * with -m perf to get the timings.
+ */
+
+
+#define SIZE           512
+#define N_PATHS        16
+#define MAX_DIFFERENCE 0.2
+#define MAX_MEAN       0.005
+#define MAX_WRONG      (SIZE / 8)
+
+
+typedef enum
+{
+  PATH_POLYGON,
+  PATH_STAR,
+  PATH_CURVES
+} PathType;
+
+
+static void
+gimp_test_scan_convert_make_path (cairo_t  *cr,
+                                  PathType  type)
+{
+  gint n = g_random_int_range (3, 40);
+  gint i;
+
+  switch (type)
+    {
+    case PATH_POLYGON:
+      /*  self-intersecting, with points outside the buffer  */
+      for (i = 0; i < n; i++)
+        cairo_line_to (cr,
+                       g_random_double_range (-32.0, SIZE + 32.0),
+                       g_random_double_range (-32.0, SIZE + 32.0));
+      cairo_close_path (cr);
+      break;
+
+    case PATH_STAR:
+      {
+        gdouble cx = g_random_double_range (SIZE / 4, SIZE * 3 / 4);
+        gdouble cy = g_random_double_range (SIZE / 4, SIZE * 3 / 4);
+
+        for (i = 0; i < 2 * n; i++)
+          {
+            gdouble radius = (i % 2) ? SIZE / 8 : SIZE / 3;
+            gdouble angle  = i * G_PI / n;
+
+            cairo_line_to (cr,
+                           cx + radius * cos (angle),
+                           cy + radius * sin (angle));
+          }
+        cairo_close_path (cr);
+
+        /*  a hole in the middle  */
+        cairo_new_sub_path (cr);
+        cairo_arc (cr, cx, cy, SIZE / 16, 0.0, 2 * G_PI);
+        cairo_close_path (cr);
+      }
+      break;
+
+    case PATH_CURVES:
+      cairo_move_to (cr,
+                     g_random_double_range (0.0, SIZE),
+                     g_random_double_range (0.0, SIZE));
+
+      for (i = 0; i < n / 4 + 1; i++)
+        cairo_curve_to (cr,
+                        g_random_double_range (0.0, SIZE),
+                        g_random_double_range (0.0, SIZE),
+                        g_random_double_range (0.0, SIZE),
+                        g_random_double_range (0.0, SIZE),
+                        g_random_double_range (0.0, SIZE),
+                        g_random_double_range (0.0, SIZE));
+      cairo_close_path (cr);
+      break;
+    }
+}
+
+static gfloat *
+gimp_test_scan_convert_render_cairo (cairo_path_t *path,
+                                     gboolean      antialias)
+{
+  cairo_surface_t *surface;
+  cairo_t         *cr;
+  const guchar    *src;
+  gfloat          *data;
+  gint             stride;
+  gint             x, y;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_A8, SIZE, SIZE);
+  cr      = cairo_create (surface);
+
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_rgba (cr, 0, 0, 0, 1.0);
+  cairo_append_path (cr, path);
+  cairo_set_antialias (cr, antialias ?
+                       CAIRO_ANTIALIAS_GRAY : CAIRO_ANTIALIAS_NONE);
+  cairo_set_fill_rule (cr, CAIRO_FILL_RULE_EVEN_ODD);
+  cairo_fill (cr);
+
+  cairo_destroy (cr);
+  cairo_surface_flush (surface);
+
+  src    = cairo_image_surface_get_data (surface);
+  stride = cairo_image_surface_get_stride (surface);
+  data   = g_new (gfloat, SIZE * SIZE);
+
+  for (y = 0; y < SIZE; y++)
+    for (x = 0; x < SIZE; x++)
+      data[y * SIZE + x] = src[y * stride + x] / 255.0;
+
+  cairo_surface_destroy (surface);
+
+  return data;
+}
+
+static gfloat *
+gimp_test_scan_convert_render_gimp (cairo_path_t *path,
+                                    gboolean      antialias,
+                                    gdouble      *seconds)
+{
+  GimpScanConvert *sc;
+  GeglBuffer      *buffer;
+  GTimer          *timer;
+  gfloat          *data;
+
+  sc     = gimp_scan_convert_new ();
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, SIZE, SIZE),
+                            babl_format ("Y float"));
+
+  gimp_scan_convert_add_bezier (sc, path);
+
+  timer = g_timer_new ();
+
+  gimp_scan_convert_render (sc, buffer, 0, 0, antialias);
+
+  *seconds = g_timer_elapsed (timer, NULL);
+
+  g_timer_destroy (timer);
+
+  data = g_new (gfloat, SIZE * SIZE);
+
+  gegl_buffer_get (buffer, GEGL_RECTANGLE (0, 0, SIZE, SIZE), 1.0,
+                   babl_format ("Y float"), data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  g_object_unref (buffer);
+  gimp_scan_convert_free (sc);
+
+  return data;
+}
+
+static void
+gimp_test_scan_convert_fill (gconstpointer data)
+{
+  PathType type  = GPOINTER_TO_INT (data);
+  gdouble  total = 0.0;
+  gint     i;
+
+  g_random_set_seed (type);
+
+  for (i = 0; i < N_PATHS; i++)
+    {
+      cairo_surface_t *surface;
+      cairo_t         *cr;
+      cairo_path_t    *path;
+      gboolean         antialias = (i % 2 == 0);
+      gfloat          *expected;
+      gfloat          *result;
+      gdouble          seconds;
+      gdouble          sum     = 0.0;
+      gdouble          max     = 0.0;
+      gint             n_wrong = 0;
+      gint             k;
+
+      surface = cairo_image_surface_create (CAIRO_FORMAT_A8, 1, 1);
+      cr      = cairo_create (surface);
+
+      gimp_test_scan_convert_make_path (cr, type);
+      path = cairo_copy_path (cr);
+
+      cairo_destroy (cr);
+      cairo_surface_destroy (surface);
+
+      expected = gimp_test_scan_convert_render_cairo (path, antialias);
+      result   = gimp_test_scan_convert_render_gimp (path, antialias,
+                                                     &seconds);
+
+      for (k = 0; k < SIZE * SIZE; k++)
+        {
+          gdouble difference = fabs (result[k] - expected[k]);
+
+          sum += difference;
+          max  = MAX (max, difference);
+
+          if (difference > 0.5)
+            n_wrong++;
+        }
+
+      if (antialias)
+        {
+          g_assert_cmpfloat (max, <=, MAX_DIFFERENCE);
+          g_assert_cmpfloat (sum / (SIZE * SIZE), <=, MAX_MEAN);
+        }
+      else
+        {
+          /*  only pixel centers right on an edge may go either way,
+           *  curves are flattened a bit differently
+           */
+          g_assert_cmpint (n_wrong, <=, MAX_WRONG);
+        }
+
+      total += seconds;
+
+      g_free (expected);
+      g_free (result);
+      cairo_path_destroy (path);
+    }
+
+  if (g_test_perf ())
+    {
+      g_test_message ("%d paths: %8.2f ms", N_PATHS, total * 1000.0);
+
+      g_test_minimized_result (total, "scan convert fill %d", type);
+    }
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gegl_init (&argc, &argv);
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_data_func ("/gimpscanconvert/fill/polygon",
+                        GINT_TO_POINTER (PATH_POLYGON),
+                        gimp_test_scan_convert_fill);
+  g_test_add_data_func ("/gimpscanconvert/fill/star",
+                        GINT_TO_POINTER (PATH_STAR),
+                        gimp_test_scan_convert_fill);
+  g_test_add_data_func ("/gimpscanconvert/fill/curves",
+                        GINT_TO_POINTER (PATH_CURVES),
+                        gimp_test_scan_convert_fill);
+
+  return g_test_run ();
+}
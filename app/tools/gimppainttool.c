@@ -37,6 +37,7 @@
 #include "core/gimptoolinfo.h"
 
 #include "paint/gimppaintcore.h"
+#include "paint/gimppaintcore-record.h"
 #include "paint/gimppaintoptions.h"
 
 #include "widgets/gimpdevices.h"
@@ -99,6 +100,9 @@ static GimpCanvasItem *
                                               gdouble                x,
                                               gdouble                y);
 
+static void   gimp_paint_tool_save_record    (GimpPaintTool         *paint_tool,
+                                              GimpDisplay           *display);
+
 static void   gimp_paint_tool_hard_notify    (GimpPaintOptions      *options,
                                               const GParamSpec      *pspec,
                                               GimpTool              *tool);
@@ -158,6 +162,7 @@ gimp_paint_tool_init (GimpPaintTool *paint_tool)
   paint_tool->status_ctrl = _("%s to pick a color");
 
   paint_tool->core        = NULL;
+  paint_tool->record      = NULL;
 }
 
 static void
@@ -212,6 +217,12 @@ gimp_paint_tool_finalize (GObject *object)
       paint_tool->core = NULL;
     }
 
+  if (paint_tool->record)
+    {
+      gimp_paint_core_record_free (paint_tool->record);
+      paint_tool->record = NULL;
+    }
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -347,6 +358,18 @@ gimp_paint_tool_button_press (GimpTool            *tool,
   /*  pause the current selection  */
   gimp_display_shell_selection_pause (shell);
 
+  /*  record the stroke for the paint benchmark, if requested  */
+  if (g_getenv ("GIMP_PAINT_RECORD_DIR"))
+    {
+      if (paint_tool->record)
+        gimp_paint_core_record_free (paint_tool->record);
+
+      paint_tool->record = gimp_paint_core_record_new (paint_options);
+
+      gimp_paint_core_record_add_event (paint_tool->record,
+                                        &core->cur_coords, time);
+    }
+
   /*  Let the specific painting function initialize itself  */
   gimp_paint_core_paint (core, drawable, paint_options,
                          GIMP_PAINT_STATE_INIT, time);
@@ -410,6 +433,15 @@ gimp_paint_tool_button_release (GimpTool              *tool,
   else
     gimp_paint_core_finish (core, drawable, TRUE);
 
+  if (paint_tool->record)
+    {
+      if (release_type != GIMP_BUTTON_RELEASE_CANCEL)
+        gimp_paint_tool_save_record (paint_tool, display);
+
+      gimp_paint_core_record_free (paint_tool->record);
+      paint_tool->record = NULL;
+    }
+
   gimp_image_flush (image);
 
   gimp_draw_tool_resume (GIMP_DRAW_TOOL (tool));
@@ -456,6 +488,9 @@ gimp_paint_tool_motion (GimpTool         *tool,
   gimp_paint_core_interpolate (core, drawable, paint_options,
                                &curr_coords, time);
 
+  if (paint_tool->record)
+    gimp_paint_core_record_add_event (paint_tool->record, &curr_coords, time);
+
   gimp_projection_flush_now (gimp_image_get_projection (image));
   gimp_display_flush_now (display);
 
@@ -895,6 +930,34 @@ gimp_paint_tool_get_outline (GimpPaintTool *paint_tool,
   return NULL;
 }
 
+static void
+gimp_paint_tool_save_record (GimpPaintTool *paint_tool,
+                             GimpDisplay   *display)
+{
+  GimpPaintOptions *paint_options = paint_tool->record->paint_options;
+  gchar            *basename;
+  gchar            *path;
+  GFile            *file;
+  GError           *error = NULL;
+
+  basename = g_strdup_printf ("%s-%" G_GINT64_FORMAT ".stroke",
+                              gimp_object_get_name (paint_options->paint_info),
+                              g_get_real_time ());
+  path = g_build_filename (g_getenv ("GIMP_PAINT_RECORD_DIR"), basename, NULL);
+  file = g_file_new_for_path (path);
+
+  if (! gimp_paint_core_record_save (paint_tool->record, file, &error))
+    {
+      gimp_tool_message_literal (GIMP_TOOL (paint_tool), display,
+                                 error->message);
+      g_clear_error (&error);
+    }
+
+  g_object_unref (file);
+  g_free (path);
+  g_free (basename);
+}
+
 static void
 gimp_paint_tool_hard_notify (GimpPaintOptions *options,
                              const GParamSpec *pspec,
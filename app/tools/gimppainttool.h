@@ -56,6 +56,8 @@ struct _GimpPaintTool
   const gchar   *status_ctrl;  /* additional message for the ctrl modifier */
 
   GimpPaintCore *core;
+
+  GimpPaintCoreRecord *record; /* the current stroke, if recording */
 };
 
 struct _GimpPaintToolClass
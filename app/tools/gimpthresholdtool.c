@@ -413,7 +413,7 @@ gimp_threshold_tool_auto_clicked (GtkWidget         *button,
 
   low = gimp_histogram_get_threshold (t_tool->histogram,
                                       channel,
-                                      0, n_bins - 1);
+                                      0, n_bins - 1, NULL);
 
   gimp_histogram_view_set_range (t_tool->histogram_box->view,
                                  low, n_bins - 1);
@@ -72,8 +72,18 @@ static void     gimp_histogram_editor_frozen_update (GimpHistogramEditor *editor
 /*static void     gimp_histogram_editor_buffer_update (GimpHistogramEditor *editor,
                                                      const GParamSpec    *pspec);*/
 static void     gimp_histogram_editor_update        (GimpHistogramEditor *editor);
+static void     gimp_histogram_editor_drawable_update
+                                                    (GimpDrawable        *drawable,
+                                                     gint                 x,
+                                                     gint                 y,
+                                                     gint                 width,
+                                                     gint                 height,
+                                                     GimpHistogramEditor *editor);
+static void     gimp_histogram_editor_mask_changed  (GimpHistogramEditor *editor);
 
 static gboolean gimp_histogram_editor_idle_update   (GimpHistogramEditor *editor);
+static gboolean gimp_histogram_editor_idle_refine   (GimpHistogramEditor *editor);
+static void     gimp_histogram_editor_stop_refine   (GimpHistogramEditor *editor);
 static gboolean gimp_histogram_menu_sensitivity     (gint                 value,
                                                      gpointer             data);
 static void     gimp_histogram_editor_menu_update   (GimpHistogramEditor *editor);
@@ -90,6 +100,12 @@ G_DEFINE_TYPE_WITH_CODE (GimpHistogramEditor, gimp_histogram_editor,
 
 #define parent_class gimp_histogram_editor_parent_class
 
+/*  above this many pixels, the histogram is first estimated and then
+ *  completed in the background, this many pixels at a time
+ */
+#define APPROXIMATE_PIXELS (200 * 1000 * 1000)
+#define REFINE_PIXELS      (16 * 1024 * 1024)
+
 static GimpDockedInterface *parent_docked_iface = NULL;
 
 
@@ -138,6 +154,7 @@ gimp_histogram_editor_init (GimpHistogramEditor *editor)
   editor->bg_histogram = NULL;
   editor->valid        = FALSE;
   editor->idle_id      = 0;
+  editor->refine_id    = 0;
   editor->box          = gimp_histogram_box_new ();
 
   gimp_editor_set_show_name (GIMP_EDITOR (editor), TRUE);
@@ -352,8 +369,10 @@ gimp_histogram_editor_set_image (GimpImageEditor *image_editor,
           editor->idle_id = 0;
         }
 
+      gimp_histogram_editor_stop_refine (editor);
+
       g_signal_handlers_disconnect_by_func (image_editor->image,
-                                            gimp_histogram_editor_update,
+                                            gimp_histogram_editor_mask_changed,
                                             editor);
       g_signal_handlers_disconnect_by_func (image_editor->image,
                                             gimp_histogram_editor_layer_changed,
@@ -385,6 +404,9 @@ gimp_histogram_editor_set_image (GimpImageEditor *image_editor,
     {
       editor->histogram = gimp_histogram_new (TRUE);
 
+      /*  painting only recalculates the blocks it touched  */
+      gimp_histogram_set_incremental (editor->histogram, TRUE);
+
       gimp_histogram_view_set_histogram (view, editor->histogram);
 
       g_signal_connect_object (image, "mode-changed",
@@ -394,7 +416,7 @@ gimp_histogram_editor_set_image (GimpImageEditor *image_editor,
                                G_CALLBACK (gimp_histogram_editor_layer_changed),
                                editor, 0);
       g_signal_connect_object (image, "mask-changed",
-                               G_CALLBACK (gimp_histogram_editor_update),
+                               G_CALLBACK (gimp_histogram_editor_mask_changed),
                                editor, G_CONNECT_SWAPPED);
     }
 
@@ -440,7 +462,7 @@ gimp_histogram_editor_layer_changed (GimpImage           *image,
                                             gimp_histogram_editor_menu_update,
                                             editor);
       g_signal_handlers_disconnect_by_func (editor->drawable,
-                                            gimp_histogram_editor_update,
+                                            gimp_histogram_editor_drawable_update,
                                             editor);
       g_signal_handlers_disconnect_by_func (editor->drawable,
 //                                            gimp_histogram_editor_buffer_update,
@@ -451,6 +473,8 @@ gimp_histogram_editor_layer_changed (GimpImage           *image,
       editor->drawable = NULL;
     }
 
+  gimp_histogram_editor_stop_refine (editor);
+
   if (image)
     editor->drawable = (GimpDrawable *) gimp_image_get_active_layer (image);
 
@@ -465,8 +489,8 @@ gimp_histogram_editor_layer_changed (GimpImage           *image,
 //                               G_CALLBACK (gimp_histogram_editor_buffer_update),
                                editor, G_CONNECT_SWAPPED);
       g_signal_connect_object (editor->drawable, "update",
-                               G_CALLBACK (gimp_histogram_editor_update),
-                               editor, G_CONNECT_SWAPPED);
+                               G_CALLBACK (gimp_histogram_editor_drawable_update),
+                               editor, 0);
       g_signal_connect_object (editor->drawable, "alpha-changed",
                                G_CALLBACK (gimp_histogram_editor_menu_update),
                                editor, G_CONNECT_SWAPPED);
@@ -492,9 +516,32 @@ gimp_histogram_editor_validate (GimpHistogramEditor *editor)
   if (! editor->valid && editor->histogram)
     {
       if (editor->drawable)
-        gimp_drawable_calculate_histogram (editor->drawable, editor->histogram);
+        {
+          gint64 n_pixels;
+          gint64 max_pixels = -1;
+
+          n_pixels = ((gint64) gimp_item_get_width  (GIMP_ITEM (editor->drawable)) *
+                      (gint64) gimp_item_get_height (GIMP_ITEM (editor->drawable)));
+
+          if (n_pixels > APPROXIMATE_PIXELS)
+            max_pixels = REFINE_PIXELS;
+
+          if (! gimp_drawable_calculate_histogram_approximate (editor->drawable,
+                                                               editor->histogram,
+                                                               max_pixels) &&
+              ! editor->refine_id)
+            {
+              editor->refine_id =
+                g_idle_add_full (G_PRIORITY_LOW,
+                                 (GSourceFunc) gimp_histogram_editor_idle_refine,
+                                 editor,
+                                 NULL);
+            }
+        }
       else
-        gimp_histogram_clear_values (editor->histogram);
+        {
+          gimp_histogram_clear_values (editor->histogram);
+        }
 
       gimp_histogram_editor_info_update (editor);
 
@@ -548,8 +595,11 @@ gimp_histogram_editor_frozen_update (GimpHistogramEditor *editor,
 static void
 gimp_histogram_editor_update (GimpHistogramEditor *editor)
 {
+  /*  don't push a pending update back, so that the histogram keeps
+   *  following a paint stroke instead of waiting for it to pause
+   */
   if (editor->idle_id)
-    g_source_remove (editor->idle_id);
+    return;
 
   editor->idle_id =
     g_timeout_add_full (G_PRIORITY_LOW,
@@ -559,6 +609,30 @@ gimp_histogram_editor_update (GimpHistogramEditor *editor)
                         NULL);
 }
 
+static void
+gimp_histogram_editor_drawable_update (GimpDrawable        *drawable,
+                                       gint                 x,
+                                       gint                 y,
+                                       gint                 width,
+                                       gint                 height,
+                                       GimpHistogramEditor *editor)
+{
+  if (editor->histogram)
+    gimp_histogram_invalidate (editor->histogram,
+                               GEGL_RECTANGLE (x, y, width, height));
+
+  gimp_histogram_editor_update (editor);
+}
+
+static void
+gimp_histogram_editor_mask_changed (GimpHistogramEditor *editor)
+{
+  if (editor->histogram)
+    gimp_histogram_invalidate (editor->histogram, NULL);
+
+  gimp_histogram_editor_update (editor);
+}
+
 static gboolean
 gimp_histogram_editor_idle_update (GimpHistogramEditor *editor)
 {
@@ -574,6 +648,37 @@ gimp_histogram_editor_idle_update (GimpHistogramEditor *editor)
   return FALSE;
 }
 
+static gboolean
+gimp_histogram_editor_idle_refine (GimpHistogramEditor *editor)
+{
+  gboolean exact = TRUE;
+
+  if (editor->drawable && editor->histogram)
+    {
+      exact = gimp_drawable_calculate_histogram_approximate (editor->drawable,
+                                                             editor->histogram,
+                                                             REFINE_PIXELS);
+
+      gimp_histogram_editor_info_update (editor);
+      gtk_widget_queue_draw (GTK_WIDGET (editor->box));
+    }
+
+  if (exact)
+    editor->refine_id = 0;
+
+  return ! exact;
+}
+
+static void
+gimp_histogram_editor_stop_refine (GimpHistogramEditor *editor)
+{
+  if (editor->refine_id)
+    {
+      g_source_remove (editor->refine_id);
+      editor->refine_id = 0;
+    }
+}
+
 static gboolean
 gimp_histogram_editor_channel_valid (GimpHistogramEditor  *editor,
                                      GimpHistogramChannel  channel)
@@ -645,10 +750,14 @@ gimp_histogram_editor_info_update (GimpHistogramEditor *editor)
 
   if (hist)
     {
-      gint    n_bins;
-      gdouble pixels;
-      gdouble count;
-      gchar   text[12];
+      gint         n_bins;
+      gdouble      pixels;
+      gdouble      count;
+      gdouble      mean;
+      gdouble      median;
+      gboolean     approximate;
+      const gchar *prefix;
+      gchar        text[16];
 
       n_bins = gimp_histogram_n_bins (hist);
 
@@ -656,31 +765,35 @@ gimp_histogram_editor_info_update (GimpHistogramEditor *editor)
       count  = gimp_histogram_get_count (hist, view->channel,
                                          view->start, view->end);
 
-      g_snprintf (text, sizeof (text), "%.3f",
-                  gimp_histogram_get_mean (hist, view->channel,
-                                           view->start, view->end));
+      mean   = gimp_histogram_get_mean   (hist, view->channel,
+                                          view->start, view->end,
+                                          &approximate);
+      median = gimp_histogram_get_median (hist, view->channel,
+                                          view->start, view->end,
+                                          NULL);
+
+      /*  mark the values of an estimated histogram  */
+      prefix = approximate ? "~" : "";
+
+      g_snprintf (text, sizeof (text), "%s%.3f", prefix, mean);
       gtk_label_set_text (GTK_LABEL (editor->labels[0]), text);
 
-      g_snprintf (text, sizeof (text), "%.3f",
+      g_snprintf (text, sizeof (text), "%s%.3f", prefix,
                   gimp_histogram_get_std_dev (hist, view->channel,
                                               view->start, view->end));
       gtk_label_set_text (GTK_LABEL (editor->labels[1]), text);
 
-      g_snprintf (text, sizeof (text), "%.3f",
-                  gimp_histogram_get_median  (hist, view->channel,
-                                              view->start,
-                                              view->end));
+      g_snprintf (text, sizeof (text), "%s%.3f", prefix, median);
       gtk_label_set_text (GTK_LABEL (editor->labels[2]), text);
 
-      g_snprintf (text, sizeof (text), "%d", (gint) pixels);
+      g_snprintf (text, sizeof (text), "%s%d", prefix, (gint) pixels);
       gtk_label_set_text (GTK_LABEL (editor->labels[3]), text);
 
-      g_snprintf (text, sizeof (text), "%d", (gint) count);
+      g_snprintf (text, sizeof (text), "%s%d", prefix, (gint) count);
       gtk_label_set_text (GTK_LABEL (editor->labels[4]), text);
 
-      g_snprintf (text, sizeof (text), "%.1f", (pixels > 0 ?
-                                                 (100.0 * count / pixels) :
-                                                 0.0));
+      g_snprintf (text, sizeof (text), "%s%.1f", prefix,
+                  (pixels > 0 ? (100.0 * count / pixels) : 0.0));
       gtk_label_set_text (GTK_LABEL (editor->labels[5]), text);
     }
   else
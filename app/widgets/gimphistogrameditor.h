@@ -43,6 +43,7 @@ struct _GimpHistogramEditor
   GimpHistogram        *bg_histogram;
 
   guint                 idle_id;
+  guint                 refine_id;
   gboolean              valid;
 
   GtkWidget            *menu;
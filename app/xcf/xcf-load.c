@@ -1307,8 +1307,7 @@ xcf_load_channel_props (XcfInfo      *info,
             GIMP_DRAWABLE (*channel)->private->buffer = NULL;
             g_object_unref (*channel);
             *channel = mask;
-            (*channel)->boundary_known = FALSE;
-            (*channel)->bounds_known   = FALSE;
+            gimp_channel_invalidate_bounds (*channel);
 
             /* Don't restore info->active_channel because the
              * selection can't be the active channel